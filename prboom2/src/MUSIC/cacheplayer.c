@@ -0,0 +1,393 @@
+/* Emacs style mode select   -*- C -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *  Plays songs that were pre-rendered by a synth player into the music
+ *  cache, and encodes new cache entries. Entries are 16 bit stereo FLAC
+ *  images at the output sample rate, decoded on the fly.
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sndfile.h"
+
+#include "lprintf.h"
+#include "memio.h"
+#include "z_zone.h"
+
+#include "musicplayer.h"
+#include "cacheplayer.h"
+
+static int cache_samplerate = 0;
+static int cache_volume = 0; // 0-15
+static int cache_looping = 0;
+static int cache_paused = 0;
+static int cache_playing = 0;
+
+static MEMFILE *cache_stream;
+static SNDFILE *cache_file;
+
+// io callbacks for the reader
+
+static sf_count_t cache_vio_get_filelen (void *user_data)
+{
+  MEMFILE *fs = user_data;
+  long pos;
+  sf_count_t len;
+
+  pos = mem_ftell (fs);
+  mem_fseek (fs, 0, MEM_SEEK_END);
+  len = mem_ftell (fs);
+  mem_fseek (fs, pos, MEM_SEEK_SET);
+
+  return len;
+}
+
+static sf_count_t cache_vio_seek (sf_count_t offset, int whence, void *user_data)
+{
+  MEMFILE *fs = user_data;
+  mem_fseek (fs, offset, whence);
+  return mem_ftell (fs);
+}
+
+static sf_count_t cache_vio_read (void *ptr, sf_count_t count, void *user_data)
+{
+  return mem_fread (ptr, 1, count, (MEMFILE *) user_data);
+}
+
+static sf_count_t cache_vio_write (const void *ptr, sf_count_t count, void *user_data)
+{
+  return mem_fwrite (ptr, 1, count, (MEMFILE *) user_data);
+}
+
+static sf_count_t cache_vio_tell (void *user_data)
+{
+  return mem_ftell ((MEMFILE *) user_data);
+}
+
+static SF_VIRTUAL_IO cache_vio =
+{
+  cache_vio_get_filelen,
+  cache_vio_seek,
+  cache_vio_read,
+  cache_vio_write,
+  cache_vio_tell
+};
+
+static const char *cache_name (void)
+{
+  return "music cache player";
+}
+
+static int cache_init (int samplerate)
+{
+  cache_samplerate = samplerate;
+  return 1;
+}
+
+static void cache_shutdown (void)
+{
+  // nothing to do
+}
+
+// data is a cache entry as written by I_CacheWriterClose
+static const void *cache_registersong (const void *data, unsigned len)
+{
+  SF_INFO sfinfo = { 0 };
+
+  cache_stream = mem_fopen_read (data, len);
+  cache_file = sf_open_virtual (&cache_vio, SFM_READ, &sfinfo, cache_stream);
+
+  if (!cache_file)
+  {
+    lprintf (LO_WARN, "cache_registersong: %s\n", sf_strerror (NULL));
+    mem_fclose (cache_stream);
+    cache_stream = NULL;
+    return NULL;
+  }
+
+  if (sfinfo.channels != 2 || sfinfo.samplerate != cache_samplerate)
+  {
+    sf_close (cache_file);
+    mem_fclose (cache_stream);
+    cache_file = NULL;
+    cache_stream = NULL;
+    return NULL;
+  }
+
+  // handle not used
+  return data;
+}
+
+static void cache_setvolume (int v)
+{
+  cache_volume = v;
+}
+
+static void cache_pause (void)
+{
+  cache_paused = 1;
+}
+
+static void cache_resume (void)
+{
+  cache_paused = 0;
+}
+
+static void cache_unregistersong (const void *handle)
+{
+  cache_playing = 0;
+
+  if (cache_file)
+  {
+    sf_close (cache_file);
+    mem_fclose (cache_stream);
+    cache_file = NULL;
+    cache_stream = NULL;
+  }
+}
+
+static void cache_play (const void *handle, int looping)
+{
+  sf_seek (cache_file, 0, SEEK_SET);
+
+  cache_playing = 1;
+  cache_looping = looping;
+}
+
+static void cache_stop (void)
+{
+  cache_playing = 0;
+}
+
+static void cache_render (void *dest, unsigned nsamp)
+{
+  short *sout = (short *) dest;
+  int multiplier = cache_volume * 256 / 15;
+  int rewound = 0;
+
+  while (nsamp > 0)
+  {
+    sf_count_t numread;
+    unsigned i;
+
+    if (!cache_playing || cache_paused)
+    {
+      memset (sout, 0, nsamp * 4);
+      return;
+    }
+
+    numread = sf_readf_short (cache_file, sout, nsamp);
+
+    if (numread <= 0)
+    { // EOF
+      if (cache_looping && !rewound && sf_seek (cache_file, 0, SEEK_SET) == 0)
+      {
+        rewound = 1;
+        continue;
+      }
+
+      cache_playing = 0;
+      continue;
+    }
+
+    // volume is applied here; the cache is rendered at full volume
+    for (i = 0; i < numread * 2; i++)
+      sout[i] = sout[i] * multiplier / 256;
+
+    sout += numread * 2;
+    nsamp -= numread;
+    rewound = 0;
+  }
+}
+
+const music_player_t cache_player =
+{
+  cache_name,
+  cache_init,
+  cache_shutdown,
+  cache_setvolume,
+  cache_pause,
+  cache_resume,
+  cache_registersong,
+  cache_unregistersong,
+  cache_play,
+  cache_stop,
+  cache_render
+};
+
+//
+// Cache writer
+//
+// The writer runs on the music capture thread, so it keeps its own buffer
+// and sticks to malloc; the zone belongs to the main thread.
+//
+
+struct cache_writer_s
+{
+  unsigned char *buf;
+  size_t size;
+  size_t alloced;
+  size_t position;
+  SNDFILE *file;
+};
+
+static sf_count_t writer_vio_get_filelen (void *user_data)
+{
+  return ((cache_writer_t *) user_data)->size;
+}
+
+static sf_count_t writer_vio_seek (sf_count_t offset, int whence, void *user_data)
+{
+  cache_writer_t *writer = user_data;
+  sf_count_t position;
+
+  switch (whence)
+  {
+    case SEEK_SET:
+      position = offset;
+      break;
+    case SEEK_CUR:
+      position = writer->position + offset;
+      break;
+    case SEEK_END:
+      position = writer->size + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (position < 0 || position > writer->size)
+    return -1;
+
+  writer->position = position;
+  return position;
+}
+
+static sf_count_t writer_vio_read (void *ptr, sf_count_t count, void *user_data)
+{
+  cache_writer_t *writer = user_data;
+
+  if (count > writer->size - writer->position)
+    count = writer->size - writer->position;
+
+  memcpy (ptr, writer->buf + writer->position, count);
+  writer->position += count;
+
+  return count;
+}
+
+static sf_count_t writer_vio_write (const void *ptr, sf_count_t count, void *user_data)
+{
+  cache_writer_t *writer = user_data;
+
+  if (count > writer->alloced - writer->position)
+  {
+    size_t alloced = writer->alloced ? writer->alloced : 65536;
+    unsigned char *buf;
+
+    while (count > alloced - writer->position)
+      alloced *= 2;
+
+    buf = realloc (writer->buf, alloced);
+    if (!buf)
+      return 0;
+
+    writer->buf = buf;
+    writer->alloced = alloced;
+  }
+
+  memcpy (writer->buf + writer->position, ptr, count);
+  writer->position += count;
+
+  if (writer->position > writer->size)
+    writer->size = writer->position;
+
+  return count;
+}
+
+static sf_count_t writer_vio_tell (void *user_data)
+{
+  return ((cache_writer_t *) user_data)->position;
+}
+
+static SF_VIRTUAL_IO writer_vio =
+{
+  writer_vio_get_filelen,
+  writer_vio_seek,
+  writer_vio_read,
+  writer_vio_write,
+  writer_vio_tell
+};
+
+cache_writer_t *I_CacheWriterOpen (int samplerate)
+{
+  cache_writer_t *writer;
+  SF_INFO sfinfo = { 0 };
+
+  sfinfo.samplerate = samplerate;
+  sfinfo.channels = 2;
+  sfinfo.format = SF_FORMAT_FLAC | SF_FORMAT_PCM_16;
+
+  writer = calloc (1, sizeof (*writer));
+  if (!writer)
+    return NULL;
+
+  writer->file = sf_open_virtual (&writer_vio, SFM_WRITE, &sfinfo, writer);
+
+  if (!writer->file)
+  {
+    free (writer->buf);
+    free (writer);
+    return NULL;
+  }
+
+  return writer;
+}
+
+int I_CacheWriterWrite (cache_writer_t *writer, const short *frames, unsigned nsamp)
+{
+  return sf_writef_short (writer->file, frames, nsamp) == nsamp;
+}
+
+void I_CacheWriterClose (cache_writer_t *writer, void **data, size_t *len)
+{
+  sf_close (writer->file);
+
+  if (data)
+  {
+    *data = writer->buf;
+    *len = writer->size;
+  }
+  else
+    free (writer->buf);
+
+  free (writer);
+}
@@ -0,0 +1,46 @@
+/* Emacs style mode select   -*- C -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifndef CACHEPLAYER_H
+#define CACHEPLAYER_H
+
+#include <stddef.h>
+
+extern const music_player_t cache_player;
+
+typedef struct cache_writer_s cache_writer_t;
+
+// Encodes s16 stereo frames into an in-memory cache entry; safe to use
+// from threads other than the main one
+cache_writer_t *I_CacheWriterOpen (int samplerate);
+int I_CacheWriterWrite (cache_writer_t *writer, const short *frames, unsigned nsamp);
+
+// Finishes the entry; if data is not NULL it receives the entry, which the
+// caller releases with free()
+void I_CacheWriterClose (cache_writer_t *writer, void **data, size_t *len);
+
+#endif // CACHEPLAYER_H
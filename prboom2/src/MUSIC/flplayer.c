@@ -102,6 +102,10 @@ static int f_volume;
 static double spmc;
 static double f_delta;
 static int f_soundrate;
+static unsigned f_leadout; // samples left to render after a song ended
+
+// how long the synth keeps running once a song ends, so notes can release
+#define FL_LEADOUT_SECONDS 10
 
 static const char *fl_name (void)
 {
@@ -403,6 +407,7 @@ static void fl_play (const void *handle, int looping)
   eventpos = 0;
   f_looping = looping;
   f_playing = 1;
+  f_leadout = 0;
   //f_paused = 0;
   f_delta = 0.0;
   fluid_synth_program_reset (f_syn);
@@ -413,6 +418,7 @@ static void fl_stop (void)
 {
   int i;
   f_playing = 0;
+  f_leadout = 0;
 
   for (i = 0; i < 16; i++)
   {
@@ -466,6 +472,13 @@ static void fl_render (void *vdest, unsigned length)
 
   midi_event_t *currevent;
 
+  if (!f_playing && !f_paused && f_leadout)
+  { // the song ended; let released notes and reverb die away
+    fl_writesamples_ex (dest, length);
+    f_leadout = length < f_leadout ? f_leadout - length : 0;
+    return;
+  }
+
   if (!f_playing || f_paused)
   {
     // save CPU time and allow for seamless resume after pause
@@ -548,6 +561,7 @@ static void fl_render (void *vdest, unsigned length)
           }
           // stop, write leadout
           fl_stop ();
+          f_leadout = f_soundrate * FL_LEADOUT_SECONDS;
           samples = length - sampleswritten;
           if (samples)
           {
@@ -593,6 +607,10 @@ static void fl_render (void *vdest, unsigned length)
 
 }
 
+static int fl_songfinished (void)
+{
+  return !f_playing;
+}
 
 const music_player_t fl_player =
 {
@@ -606,7 +624,8 @@ const music_player_t fl_player =
   fl_unregistersong,
   fl_play,
   fl_stop,
-  fl_render
+  fl_render,
+  fl_songfinished
 };
 
 
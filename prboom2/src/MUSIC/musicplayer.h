@@ -82,6 +82,10 @@ typedef struct
   // s16 stereo, with samplerate as specified in init.  player needs to be able to handle
   // just about anything for nsamp.  render can be called even during pause+stop.
   void (*render)(void *dest, unsigned nsamp);
+
+  // optional.  nonzero once a song played without looping has reached its end;
+  // synth players that provide it can be pre-rendered into the music cache
+  int (*songfinished)(void);
 } music_player_t;
 
 #endif // MUSICPLAYER_H
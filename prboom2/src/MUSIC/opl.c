@@ -257,6 +257,11 @@ void OPL_Render_Samples (void *dest, unsigned buffer_len)
     }
 }
 
+void OPL_SetReferenceSlots(int enabled)
+{
+    OPL3_SetReferenceSlots(enabled);
+}
+
 void OPL_WritePort(opl_port_t port, unsigned int value)
 {
     if (port == OPL_REGISTER_PORT)
@@ -120,6 +120,10 @@ extern unsigned int opl_sample_rate;
 
 void OPL_Render_Samples (void *dest, unsigned nsamp);
 
+// Switch between the batched and the reference slot pipeline.
+
+void OPL_SetReferenceSlots(int enabled);
+
 
 void OPL_SetCallback(uint64_t us, opl_callback_t callback, void *data);
 
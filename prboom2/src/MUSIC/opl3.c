@@ -37,6 +37,7 @@
 
 #include "dsda/configuration.h"
 static int mus_opl_gain;
+static int opl3_reference_slots;
 
 #if defined OPL_ENABLE_STEREOEXT && !defined OPL_SIN
 #ifndef _USE_MATH_DEFINES
@@ -208,7 +209,6 @@ static uint8_t panpot_lut_build = 0;
     Envelope generator
 */
 
-typedef int16_t(*envelope_sinfunc)(uint16_t phase, uint16_t envelope);
 typedef void(*envelope_genfunc)(opl3_slot *slott);
 
 static int16_t OPL3_EnvelopeCalcExp(uint32_t level)
@@ -357,17 +357,6 @@ static int16_t OPL3_EnvelopeCalcSin7(uint16_t phase, uint16_t envelope)
     return OPL3_EnvelopeCalcExp(out + (envelope << 3)) ^ neg;
 }
 
-static const envelope_sinfunc envelope_sin[8] = {
-    OPL3_EnvelopeCalcSin0,
-    OPL3_EnvelopeCalcSin1,
-    OPL3_EnvelopeCalcSin2,
-    OPL3_EnvelopeCalcSin3,
-    OPL3_EnvelopeCalcSin4,
-    OPL3_EnvelopeCalcSin5,
-    OPL3_EnvelopeCalcSin6,
-    OPL3_EnvelopeCalcSin7
-};
-
 enum envelope_gen_num
 {
     envelope_gen_num_attack = 0,
@@ -692,7 +681,36 @@ static void OPL3_SlotWriteE0(opl3_slot *slot, uint8_t data)
 
 static void OPL3_SlotGenerate(opl3_slot *slot)
 {
-    slot->out = envelope_sin[slot->reg_wf](slot->pg_phase_out + *slot->mod, slot->eg_out);
+    uint16_t phase = slot->pg_phase_out + *slot->mod;
+
+    /* A switch lets the waveform calculation be inlined */
+    switch (slot->reg_wf)
+    {
+    case 0:
+        slot->out = OPL3_EnvelopeCalcSin0(phase, slot->eg_out);
+        break;
+    case 1:
+        slot->out = OPL3_EnvelopeCalcSin1(phase, slot->eg_out);
+        break;
+    case 2:
+        slot->out = OPL3_EnvelopeCalcSin2(phase, slot->eg_out);
+        break;
+    case 3:
+        slot->out = OPL3_EnvelopeCalcSin3(phase, slot->eg_out);
+        break;
+    case 4:
+        slot->out = OPL3_EnvelopeCalcSin4(phase, slot->eg_out);
+        break;
+    case 5:
+        slot->out = OPL3_EnvelopeCalcSin5(phase, slot->eg_out);
+        break;
+    case 6:
+        slot->out = OPL3_EnvelopeCalcSin6(phase, slot->eg_out);
+        break;
+    default:
+        slot->out = OPL3_EnvelopeCalcSin7(phase, slot->eg_out);
+        break;
+    }
 }
 
 static void OPL3_SlotCalcFB(opl3_slot *slot)
@@ -1111,6 +1129,97 @@ static void OPL3_ProcessSlot(opl3_slot *slot)
     OPL3_SlotGenerate(slot);
 }
 
+/*
+    Batched slot processing
+
+    The feedback, envelope and phase stages of a slot never read the current
+    sample's output of another slot, so they run for all 36 slots in one
+    pass up front, leaving only waveform generation interleaved with the
+    channel mix. Slots are still visited in order (the phase stage shares
+    the noise and rhythm state). Silent slots take shortcuts that give the
+    same results, so the output is bit-exact with OPL3_ProcessSlot.
+*/
+
+static void OPL3_ProcessSlotStages(opl3_chip *chip)
+{
+    opl3_slot *slot;
+    opl3_slot *end = chip->slot + 36;
+
+    for (slot = chip->slot; slot < end; slot++)
+    {
+        OPL3_SlotCalcFB(slot);
+
+        /* A released slot that has fully decayed stays that way until it is
+           keyed on again; only its attenuation output can change */
+        if (!slot->key && slot->eg_gen == envelope_gen_num_release
+            && slot->eg_rout == 0x1ff)
+        {
+            slot->eg_out = 0x1ff + (slot->reg_tl << 2)
+                         + (slot->eg_ksl >> kslshift[slot->reg_ksl]) + *slot->trem;
+            slot->pg_reset = 0;
+        }
+        else
+        {
+            OPL3_EnvelopeCalc(slot);
+        }
+        OPL3_PhaseGenerate(slot);
+    }
+}
+
+static void OPL3_SlotGenerateBatched(opl3_slot *slot)
+{
+    uint16_t phase;
+
+    if (slot->eg_out < 0x1ff)
+    {
+        OPL3_SlotGenerate(slot);
+        return;
+    }
+
+    /* Fully attenuated: every waveform has zero magnitude, only the sign
+       is left */
+    phase = slot->pg_phase_out + *slot->mod;
+    switch (slot->reg_wf)
+    {
+    case 0:
+    case 6:
+    case 7:
+        slot->out = (phase & 0x200) ? -1 : 0;
+        break;
+    case 4:
+        slot->out = ((phase & 0x300) == 0x100) ? -1 : 0;
+        break;
+    default:
+        slot->out = 0;
+        break;
+    }
+}
+
+static void OPL3_ProcessSlotRange(opl3_chip *chip, uint8_t first, uint8_t last)
+{
+    uint8_t ii;
+
+    if (opl3_reference_slots)
+    {
+        for (ii = first; ii < last; ii++)
+        {
+            OPL3_ProcessSlot(&chip->slot[ii]);
+        }
+    }
+    else
+    {
+        for (ii = first; ii < last; ii++)
+        {
+            OPL3_SlotGenerateBatched(&chip->slot[ii]);
+        }
+    }
+}
+
+void OPL3_SetReferenceSlots(int enabled)
+{
+    opl3_reference_slots = enabled;
+}
+
 inline void OPL3_Generate4Ch(opl3_chip *chip, int16_t *buf4)
 {
     opl3_channel *channel;
@@ -1124,14 +1233,16 @@ inline void OPL3_Generate4Ch(opl3_chip *chip, int16_t *buf4)
     buf4[1] = OPL3_ClipSample(chip->mixbuff[1]);
     buf4[3] = OPL3_ClipSample(chip->mixbuff[3]);
 
+    if (!opl3_reference_slots)
+    {
+        OPL3_ProcessSlotStages(chip);
+    }
+
 #if OPL_QUIRK_CHANNELSAMPLEDELAY
-    for (ii = 0; ii < 15; ii++)
+    OPL3_ProcessSlotRange(chip, 0, 15);
 #else
-    for (ii = 0; ii < 36; ii++)
+    OPL3_ProcessSlotRange(chip, 0, 36);
 #endif
-    {
-        OPL3_ProcessSlot(&chip->slot[ii]);
-    }
 
     mix[0] = mix[1] = 0;
     for (ii = 0; ii < 18; ii++)
@@ -1150,20 +1261,14 @@ inline void OPL3_Generate4Ch(opl3_chip *chip, int16_t *buf4)
     chip->mixbuff[2] = mix[1];
 
 #if OPL_QUIRK_CHANNELSAMPLEDELAY
-    for (ii = 15; ii < 18; ii++)
-    {
-        OPL3_ProcessSlot(&chip->slot[ii]);
-    }
+    OPL3_ProcessSlotRange(chip, 15, 18);
 #endif
 
     buf4[0] = OPL3_ClipSample(chip->mixbuff[0]);
     buf4[2] = OPL3_ClipSample(chip->mixbuff[2]);
 
 #if OPL_QUIRK_CHANNELSAMPLEDELAY
-    for (ii = 18; ii < 33; ii++)
-    {
-        OPL3_ProcessSlot(&chip->slot[ii]);
-    }
+    OPL3_ProcessSlotRange(chip, 18, 33);
 #endif
 
     mix[0] = mix[1] = 0;
@@ -1183,10 +1288,7 @@ inline void OPL3_Generate4Ch(opl3_chip *chip, int16_t *buf4)
     chip->mixbuff[3] = mix[1];
 
 #if OPL_QUIRK_CHANNELSAMPLEDELAY
-    for (ii = 33; ii < 36; ii++)
-    {
-        OPL3_ProcessSlot(&chip->slot[ii]);
-    }
+    OPL3_ProcessSlotRange(chip, 33, 36);
 #endif
 
     if ((chip->timer & 0x3f) == 0x3f)
@@ -1737,6 +1737,11 @@ void I_OPL_RenderSamples (void *dest, unsigned nsamp)
     OPL_Render_Samples (dest, nsamp);
 }
 
+static int I_OPL_SongFinished(void)
+{
+    return !song_looping && running_tracks == 0;
+}
+
 const music_player_t opl_synth_player =
 {
   I_OPL_SynthName,
@@ -1749,5 +1754,6 @@ const music_player_t opl_synth_player =
   I_OPL_UnRegisterSong,
   I_OPL_PlaySong,
   I_OPL_StopSong,
-  I_OPL_RenderSamples
+  I_OPL_RenderSamples,
+  I_OPL_SongFinished
 };
@@ -75,7 +75,9 @@
 #include "dsda/args.h"
 #include "dsda/analysis.h"
 #include "dsda/args.h"
+#include "dsda/benchmark.h"
 #include "dsda/endoom.h"
+#include "dsda/parallel_render.h"
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
 #include "dsda/split_tracker.h"
@@ -343,6 +345,14 @@ int main(int argc, char **argv)
   signal(SIGINT,  I_IntHandler);
 #endif
 
+  // Runs the benchmark suite in child processes and exits
+  if (dsda_Flag(dsda_arg_benchmark))
+    dsda_RunBenchmark();
+
+  // Renders the video in child processes and exits
+  if (dsda_Flag(dsda_arg_render_jobs) && dsda_ParallelRenderPass() == parallel_render_none)
+    dsda_RunParallelRender();
+
   // Priority class for the prboom-plus process
   I_SetProcessPriority();
 
@@ -54,6 +54,8 @@
 #include "z_zone.h"
 
 #include "m_swap.h"
+#include "m_file.h"
+#include "md5.h"
 #include "i_sound.h"
 #include "i_sndfile.h"
 #include "m_misc.h"
@@ -72,7 +74,11 @@
 #include "e6y.h"
 
 #include "dsda/ambient.h"
+#include "dsda/args.h"
+#include "dsda/data_organizer.h"
 #include "dsda/settings.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
 
 static dboolean registered_non_rw = false;
 
@@ -698,6 +704,7 @@ dboolean I_AnySoundStillPlaying(void)
 //
 
 static void UpdateMusic (void *buff, unsigned nsamp);
+static dboolean ReadMusicAhead (void *buff, unsigned nsamp);
 
 static void I_UpdateSound(void *unused, Uint8 *stream, int len)
 {
@@ -726,7 +733,7 @@ static void I_UpdateSound(void *unused, Uint8 *stream, int len)
     return;
 
   // do music update
-  if (registered_non_rw)
+  if (registered_non_rw && !ReadMusicAhead (stream, len / 4))
   {
     SDL_LockMutex (musmutex);
     UpdateMusic (stream, len / 4);
@@ -1005,6 +1012,9 @@ void I_ResampleStream (void *dest, unsigned nsamp, void (*proc) (void *dest, uns
 //
 
 static void UpdateMusic (void *buff, unsigned nsamp);
+static void StartMusicAhead (void);
+static void StopMusicAhead (void);
+static void FlushMusicAhead (void);
 static int RegisterSong (const void *data, size_t len);
 static int RegisterSongEx (const void *data, size_t len, int try_mus2mid);
 static void UnRegisterSong(int handle);
@@ -1012,6 +1022,10 @@ static void StopSong(int handle);
 static void ResumeSong (int handle);
 static void PauseSong (int handle);
 static void PlaySong(int handle, int looping);
+static void SetPlayerVolume (void);
+static void StartMusicCapture (int looping);
+static void AbandonMusicCapture (void);
+static void FinishMusicCapture (void);
 
 #include "mus2mid.h"
 
@@ -1022,6 +1036,8 @@ static void PlaySong(int handle, int looping);
 #include "MUSIC/flplayer.h"
 #include "MUSIC/vorbisplayer.h"
 #include "MUSIC/portmidiplayer.h"
+#include "MUSIC/opl.h"
+#include "MUSIC/cacheplayer.h"
 
 static Mix_Music *music[2] = { NULL, NULL };
 
@@ -1069,11 +1085,46 @@ char music_player_order[NUM_MUS_PLAYERS][200] =
 const char *midiplayers[midi_player_last + 1] = {
   "fluidsynth", "opl", "portmidi", NULL };
 
-static int current_player = -1;
+static const music_player_t *current_player = NULL;
 static const void *music_handle = NULL;
 
 static void *mus2mid_conversion_data = NULL;
 
+// backs the cache player while a cached song is registered
+static byte *music_cache_data = NULL;
+
+// capture of a song that isn't in the music cache yet; see below
+typedef enum
+{
+  music_capture_none,
+  music_capture_armed,  // registered, waiting for PlaySong
+  music_capture_active, // first pass or tail being captured
+  music_capture_done,   // fully captured; a looping song restarts
+} music_capture_state_t;
+
+// Under musmutex; music_linear_volume is only written by the main thread
+static music_capture_state_t music_capture_state;
+static dboolean music_capture_loop;
+static unsigned int music_capture_frames;
+static unsigned int music_capture_tail;
+static unsigned int music_capture_quiet;
+static dboolean music_linear_volume;
+static int music_output_volume;
+
+// Main thread only
+static char *music_capture_filename;
+static SDL_Thread *music_capture_thread;
+
+// Shared with the capture thread
+static Uint32 *music_capture_ring;
+static SDL_atomic_t music_capture_write;
+static SDL_atomic_t music_capture_read;
+static SDL_atomic_t music_capture_finish; // 1 when complete, -1 when abandoned
+static SDL_atomic_t music_capture_exited;
+static SDL_sem *music_capture_sem;
+static void *music_capture_entry;
+static size_t music_capture_length;
+
 void I_ShutdownMusic(void)
 {
   int i;
@@ -1085,6 +1136,8 @@ void I_ShutdownMusic(void)
       music_players[i]->shutdown ();
   }
 
+  StopMusicAhead ();
+
   if (musmutex)
   {
     SDL_DestroyMutex (musmutex);
@@ -1092,6 +1145,146 @@ void I_ShutdownMusic(void)
   }
 }
 
+//
+// I_BenchmarkOPL
+//
+// Renders the opening of every MUS / MIDI lump through the OPL synth twice,
+// once with the reference slot pipeline and once with the batched one, and
+// reports how long each took and whether the output matched.
+//
+
+#define OPL_BENCHMARK_SECONDS 20
+#define OPL_BENCHMARK_CHUNK 512
+
+static int I_BenchmarkOPLPass(const void *data, size_t len, short *out, int frames)
+{
+  const void *handle;
+  int done;
+
+  handle = opl_synth_player.registersong(data, len);
+  if (!handle)
+    return false;
+
+  opl_synth_player.setvolume(15);
+  opl_synth_player.play(handle, true);
+
+  for (done = 0; done < frames; done += OPL_BENCHMARK_CHUNK)
+  {
+    int n = MIN(OPL_BENCHMARK_CHUNK, frames - done);
+
+    opl_synth_player.render(out + done * 2, n);
+  }
+
+  opl_synth_player.stop();
+  opl_synth_player.unregistersong(handle);
+
+  return true;
+}
+
+static void I_BenchmarkOPL(void)
+{
+  int i, lump;
+  int frames;
+  int songs = 0, mismatches = 0;
+  unsigned long long total[2] = { 0, 0 };
+  short *out[2];
+
+  for (i = 0; music_players[i]; i++)
+    if (music_players[i] == &opl_synth_player)
+      break;
+
+  if (!music_players[i] || !music_player_was_init[i])
+  {
+    lprintf(LO_WARN, "I_BenchmarkOPL: OPL synth player is not available\n");
+    return;
+  }
+
+  frames = snd_samplerate * OPL_BENCHMARK_SECONDS;
+  out[0] = Z_Malloc(frames * 2 * sizeof(short));
+  out[1] = Z_Malloc(frames * 2 * sizeof(short));
+
+  SDL_LockMutex(musmutex);
+
+  for (lump = 0; lump < numlumps; lump++)
+  {
+    const byte *data;
+    int len = W_LumpLength(lump);
+    MEMFILE *instream = NULL;
+    MEMFILE *outstream = NULL;
+    void *midi;
+    size_t midi_len;
+    unsigned long long elapsed[2];
+    int pass, same, ok = true;
+
+    if (len <= 4)
+      continue;
+
+    data = W_LumpByNum(lump);
+
+    if (!memcmp(data, "MUS\x1a", 4))
+    {
+      instream = mem_fopen_read(data, len);
+      outstream = mem_fopen_write();
+
+      if (mus2mid(instream, outstream) != 0)
+      {
+        mem_fclose(instream);
+        mem_fclose(outstream);
+        continue;
+      }
+
+      mem_get_buf(outstream, &midi, &midi_len);
+    }
+    else if (!memcmp(data, "MThd", 4))
+    {
+      midi = (void *) data;
+      midi_len = len;
+    }
+    else
+      continue;
+
+    for (pass = 0; pass < 2 && ok; pass++)
+    {
+      OPL_SetReferenceSlots(pass == 0);
+
+      dsda_StartTimer(dsda_timer_temp);
+      ok = I_BenchmarkOPLPass(midi, midi_len, out[pass], frames);
+      elapsed[pass] = dsda_ElapsedTime(dsda_timer_temp);
+    }
+
+    if (instream)
+    {
+      mem_fclose(instream);
+      mem_fclose(outstream);
+    }
+
+    if (!ok)
+      continue;
+
+    songs++;
+    total[0] += elapsed[0];
+    total[1] += elapsed[1];
+
+    same = !memcmp(out[0], out[1], frames * 2 * sizeof(short));
+    if (!same)
+      mismatches++;
+
+    lprintf(LO_INFO, "I_BenchmarkOPL: %-8.8s reference %llu us, batched %llu us, %s\n",
+            W_LumpName(lump), elapsed[0], elapsed[1],
+            same ? "identical" : "DIFFERENT");
+  }
+
+  OPL_SetReferenceSlots(false);
+
+  SDL_UnlockMutex(musmutex);
+
+  Z_Free(out[0]);
+  Z_Free(out[1]);
+
+  lprintf(LO_INFO, "I_BenchmarkOPL: %d songs, %d s each, reference %llu ms, batched %llu ms, %d mismatches\n",
+          songs, OPL_BENCHMARK_SECONDS, total[0] / 1000, total[1] / 1000, mismatches);
+}
+
 void I_InitMusic(void)
 {
   int i;
@@ -1101,6 +1294,13 @@ void I_InitMusic(void)
   for (i = 0; music_players[i]; i++)
     music_player_was_init[i] = music_players[i]->init (snd_samplerate);
 
+  cache_player.init (snd_samplerate);
+
+  if (dsda_Flag(dsda_arg_opl_benchmark))
+    I_BenchmarkOPL ();
+
+  StartMusicAhead ();
+
   I_AtExit(I_ShutdownMusic, true, "I_ShutdownMusic", exit_priority_normal);
 }
 
@@ -1124,7 +1324,7 @@ void I_ResetMusicVolume(void)
   if (music_handle)
   {
     SDL_LockMutex(musmutex);
-    music_players[current_player]->setvolume(music_volume);
+    SetPlayerVolume();
     SDL_UnlockMutex(musmutex);
   }
 }
@@ -1273,8 +1473,15 @@ static void PlaySong(int handle, int looping)
   if (music_handle)
   {
     SDL_LockMutex (musmutex);
-    music_players[current_player]->play (music_handle, looping);
-    music_players[current_player]->setvolume (music_volume);
+    if (music_capture_state == music_capture_armed)
+      StartMusicCapture (looping);
+    else
+    {
+      AbandonMusicCapture ();
+      current_player->play (music_handle, looping);
+    }
+    SetPlayerVolume ();
+    FlushMusicAhead ();
     SDL_UnlockMutex (musmutex);
   }
 }
@@ -1288,14 +1495,19 @@ static void PauseSong (int handle)
   switch (dsda_IntConfig(dsda_config_mus_pause_opt))
   {
     case 0:
-      music_players[current_player]->stop ();
+      AbandonMusicCapture ();
+      current_player->stop ();
       break;
     case 1:
-      music_players[current_player]->pause ();
+      // a pause would leave a gap in the capture
+      if (music_capture_state != music_capture_done)
+        AbandonMusicCapture ();
+      current_player->pause ();
       break;
     default: // Default - let music continue
       break;
   }
+  FlushMusicAhead ();
   SDL_UnlockMutex (musmutex);
 }
 
@@ -1309,14 +1521,15 @@ static void ResumeSong (int handle)
   {
     case 0: // i'm not sure why we can guarantee looping=true here,
             // but that's what the old code did
-      music_players[current_player]->play (music_handle, 1);
+      current_player->play (music_handle, 1);
       break;
     case 1:
-      music_players[current_player]->resume ();
+      current_player->resume ();
       break;
     default: // Default - music was never stopped
       break;
   }
+  FlushMusicAhead ();
   SDL_UnlockMutex (musmutex);
 }
 
@@ -1325,7 +1538,9 @@ static void StopSong(int handle)
   if (music_handle)
   {
     SDL_LockMutex (musmutex);
-    music_players[current_player]->stop ();
+    AbandonMusicCapture ();
+    current_player->stop ();
+    FlushMusicAhead ();
     SDL_UnlockMutex (musmutex);
   }
 }
@@ -1335,15 +1550,384 @@ static void UnRegisterSong(int handle)
   if (music_handle)
   {
     SDL_LockMutex (musmutex);
-    music_players[current_player]->unregistersong (music_handle);
+    AbandonMusicCapture ();
+    music_linear_volume = false;
+    current_player->unregistersong (music_handle);
     music_handle = NULL;
     if (mus2mid_conversion_data)
     {
       Z_Free (mus2mid_conversion_data);
       mus2mid_conversion_data = NULL;
     }
+    if (music_cache_data)
+    {
+      Z_Free (music_cache_data);
+      music_cache_data = NULL;
+    }
+    FlushMusicAhead ();
     SDL_UnlockMutex (musmutex);
+
+    // A completed capture is still stored
+    FinishMusicCapture ();
+
+    if (music_capture_filename)
+    {
+      Z_Free (music_capture_filename);
+      music_capture_filename = NULL;
+    }
+  }
+}
+
+//
+// Music cache
+//
+// With mus_render_cache set, songs handled by a synth player are stored as
+// FLAC under the data root, keyed by the MD5 of the song data, the player and
+// its settings. Later registrations play the stored entry through the cache
+// player instead.
+//
+// A song that isn't cached yet plays live through its synth, held at full
+// volume with music volume applied to the output, as the cache player does.
+// Its first pass and the release tail that follows are copied into a ring
+// that a capture thread encodes as it fills, so nothing extra is rendered
+// and musmutex is never held for more than a chunk. The main thread writes
+// the entry once the capture thread is done.
+//
+
+#define MUSIC_CACHE_MAX_SECONDS (20 * 60)
+#define MUSIC_CACHE_TAIL_SECONDS 10
+#define MUSIC_CACHE_QUIET_LEVEL 4
+#define MUSIC_CAPTURE_RING (1 << 18)
+#define MUSIC_CAPTURE_CHUNK 1024
+
+static char *music_cache_dir;
+
+static char *MusicCacheFileName (const music_player_t *player, const void *data, size_t len)
+{
+  struct MD5Context md5;
+  dsda_cksum_t cksum;
+  dsda_string_t settings;
+  char *filename;
+  int length;
+
+  if (!music_cache_dir)
+  {
+    const char *data_root = dsda_DataRoot ();
+
+    length = strlen (data_root) + 13; // "/music_cache\0"
+    music_cache_dir = Z_Malloc (length);
+    snprintf (music_cache_dir, length, "%s/music_cache", data_root);
+
+    M_MakeDir (music_cache_dir, false);
+  }
+
+  dsda_StringPrintF (&settings, "%s %d %d %d %s %d %d %d %d %d %d %d %d %d %d",
+                     player->name (), snd_samplerate,
+                     dsda_IntConfig (dsda_config_mus_opl_gain),
+                     dsda_IntConfig (dsda_config_mus_opl_opl3mode),
+                     dsda_StringConfig (dsda_config_snd_soundfont),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_chorus),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_reverb),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_gain),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_chorus_depth),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_chorus_level),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_reverb_damp),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_reverb_level),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_reverb_width),
+                     dsda_IntConfig (dsda_config_mus_fluidsynth_reverb_room_size),
+                     snd_samplecount);
+
+  MD5Init (&md5);
+  MD5Update (&md5, data, len);
+  MD5Update (&md5, (const byte *) settings.string, settings.size);
+  MD5Final (cksum.bytes, &md5);
+  dsda_TranslateCheckSum (&cksum);
+
+  dsda_FreeString (&settings);
+
+  length = strlen (music_cache_dir) + 39; // "/<cksum (32)>.flac\0"
+  filename = Z_Malloc (length);
+  snprintf (filename, length, "%s/%s.flac", music_cache_dir, cksum.string);
+
+  return filename;
+}
+
+// Call with musmutex held
+static void SetPlayerVolume (void)
+{
+  if (music_linear_volume)
+  {
+    music_output_volume = music_volume;
+    current_player->setvolume (15);
+  }
+  else
+    current_player->setvolume (music_volume);
+}
+
+// returns 1 once the entry is encoded, 0 if abandoned, -1 on failure
+static int SDLCALL MusicCaptureThread (void *data)
+{
+  Uint32 chunk[MUSIC_CAPTURE_CHUNK];
+  cache_writer_t *writer;
+  int finish = -1;
+
+  writer = I_CacheWriterOpen (snd_samplerate);
+
+  while (writer)
+  {
+    unsigned int write, read, count, start, first;
+
+    // The finish flag comes first: a write position loaded after it
+    // covers everything captured before the song was marked complete
+    finish = SDL_AtomicGet (&music_capture_finish);
+    write = SDL_AtomicGet (&music_capture_write);
+    read = SDL_AtomicGet (&music_capture_read);
+
+    if (finish < 0)
+      break;
+
+    if (write == read)
+    {
+      if (finish > 0)
+        break;
+
+      SDL_SemWaitTimeout (music_capture_sem, 100);
+      continue;
+    }
+
+    count = MIN(write - read, MUSIC_CAPTURE_CHUNK);
+    start = read & (MUSIC_CAPTURE_RING - 1);
+    first = MIN(count, MUSIC_CAPTURE_RING - start);
+    memcpy (chunk, music_capture_ring + start, first * sizeof (*chunk));
+    memcpy (chunk + first, music_capture_ring, (count - first) * sizeof (*chunk));
+
+    SDL_AtomicSet (&music_capture_read, read + count);
+
+    if (!I_CacheWriterWrite (writer, (short *) chunk, count))
+    {
+      I_CacheWriterClose (writer, NULL, NULL);
+      writer = NULL;
+      finish = -1;
+    }
+  }
+
+  if (writer)
+  {
+    if (finish > 0)
+      I_CacheWriterClose (writer, &music_capture_entry, &music_capture_length);
+    else
+      I_CacheWriterClose (writer, NULL, NULL);
+  }
+
+  SDL_AtomicSet (&music_capture_exited, 1);
+
+  return finish;
+}
+
+// Call with musmutex held; plays the armed song without looping
+static void StartMusicCapture (int looping)
+{
+  music_capture_state = music_capture_none;
+
+  if (!music_capture_ring)
+  {
+    music_capture_ring = Z_Malloc (MUSIC_CAPTURE_RING * sizeof (*music_capture_ring));
+    music_capture_sem = SDL_CreateSemaphore (0);
+  }
+
+  SDL_AtomicSet (&music_capture_write, 0);
+  SDL_AtomicSet (&music_capture_read, 0);
+  SDL_AtomicSet (&music_capture_finish, 0);
+  SDL_AtomicSet (&music_capture_exited, 0);
+  music_capture_entry = NULL;
+  music_capture_length = 0;
+
+  music_capture_thread = SDL_CreateThread (MusicCaptureThread, "music capture", NULL);
+
+  if (!music_capture_thread)
+  {
+    lprintf (LO_WARN, "StartMusicCapture: couldn't create thread (%s)\n", SDL_GetError ());
+    current_player->play (music_handle, looping);
+    return;
   }
+
+  music_capture_state = music_capture_active;
+  music_capture_loop = looping;
+  music_capture_frames = 0;
+  music_capture_tail = 0;
+  music_capture_quiet = 0;
+
+  current_player->play (music_handle, false);
+}
+
+// Call with musmutex held; also cancels the restart of a captured song
+static void AbandonMusicCapture (void)
+{
+  if (music_capture_state == music_capture_active)
+  {
+    SDL_AtomicSet (&music_capture_finish, -1);
+    SDL_SemPost (music_capture_sem);
+  }
+
+  music_capture_state = music_capture_none;
+}
+
+// Call with musmutex held, from wherever the song is rendered
+static void CaptureMusic (const void *buff, unsigned nsamp)
+{
+  const Uint32 *in = buff;
+  const short *samples = buff;
+  unsigned int write, read, start, first, i;
+
+  write = SDL_AtomicGet (&music_capture_write);
+  read = SDL_AtomicGet (&music_capture_read);
+
+  if (write - read + nsamp > MUSIC_CAPTURE_RING ||
+      music_capture_frames >= (unsigned int) snd_samplerate * MUSIC_CACHE_MAX_SECONDS)
+  {
+    AbandonMusicCapture ();
+    return;
+  }
+
+  start = write & (MUSIC_CAPTURE_RING - 1);
+  first = MIN(nsamp, MUSIC_CAPTURE_RING - start);
+  memcpy (music_capture_ring + start, in, first * sizeof (*in));
+  memcpy (music_capture_ring, in + first, (nsamp - first) * sizeof (*in));
+
+  SDL_AtomicSet (&music_capture_write, write + nsamp);
+  SDL_SemPost (music_capture_sem);
+
+  music_capture_frames += nsamp;
+
+  if (!current_player->songfinished ())
+    return;
+
+  // The song is over, but the synth keeps sounding until its notes release
+  for (i = 0; i < nsamp * 2; i++)
+    if (samples[i] > MUSIC_CACHE_QUIET_LEVEL || samples[i] < -MUSIC_CACHE_QUIET_LEVEL)
+      break;
+
+  music_capture_quiet = i < nsamp * 2 ? 0 : music_capture_quiet + nsamp;
+  music_capture_tail += nsamp;
+
+  if (music_capture_quiet >= (unsigned int) snd_samplerate / 4 ||
+      music_capture_tail >= (unsigned int) snd_samplerate * MUSIC_CACHE_TAIL_SECONDS)
+  {
+    SDL_AtomicSet (&music_capture_finish, 1);
+    SDL_SemPost (music_capture_sem);
+    music_capture_state = music_capture_done;
+  }
+}
+
+// Joins the capture thread and stores what it encoded
+static void FinishMusicCapture (void)
+{
+  int result;
+
+  if (!music_capture_thread)
+    return;
+
+  SDL_WaitThread (music_capture_thread, &result);
+  music_capture_thread = NULL;
+
+  if (result > 0)
+  {
+    if (M_WriteFile (music_capture_filename, music_capture_entry, music_capture_length))
+      lprintf (LO_INFO, "FinishMusicCapture: cached %s\n", music_capture_filename);
+    else
+      lprintf (LO_WARN, "FinishMusicCapture: couldn't write %s\n", music_capture_filename);
+  }
+  else if (result < 0)
+    lprintf (LO_WARN, "FinishMusicCapture: encoding failed, not cached\n");
+
+  free (music_capture_entry);
+  music_capture_entry = NULL;
+}
+
+// Switches a freshly registered song over to its cache entry, if any;
+// otherwise arms the capture of the live song
+static dboolean RegisterCachedSong (const music_player_t *player, const void *handle,
+                                    const void *data, size_t len)
+{
+  char *filename;
+  byte *entry = NULL;
+  int length;
+  const void *cache_handle;
+
+  if (!dsda_IntConfig (dsda_config_mus_render_cache) || !player->songfinished || !snd_samplerate)
+    return false;
+
+  filename = MusicCacheFileName (player, data, len);
+
+  length = M_ReadFile (filename, &entry);
+
+  if (entry && length <= 0)
+  {
+    Z_Free (entry);
+    entry = NULL;
+  }
+
+  if (!entry)
+  {
+    if (dumping_sound)
+    {
+      Z_Free (filename);
+      return false;
+    }
+
+    // The previous song was unregistered first, so no capture is running
+    music_capture_filename = filename;
+
+    SDL_LockMutex (musmutex);
+    music_linear_volume = true;
+    music_capture_state = music_capture_armed;
+    SDL_UnlockMutex (musmutex);
+
+    return false;
+  }
+
+  Z_Free (filename);
+
+  cache_handle = cache_player.registersong (entry, length);
+  if (!cache_handle)
+  {
+    Z_Free (entry);
+    return false;
+  }
+
+  player->unregistersong (handle);
+
+  SDL_LockMutex (musmutex);
+  current_player = &cache_player;
+  music_handle = cache_handle;
+  music_cache_data = entry;
+  SDL_UnlockMutex (musmutex);
+
+  return true;
+}
+
+// Called from the main loop; stores finished captures and restarts the
+// songs they were taken from
+void I_UpdateMusic (void)
+{
+  if (music_capture_thread && SDL_AtomicGet (&music_capture_exited))
+    FinishMusicCapture ();
+
+  if (!music_handle || !music_linear_volume)
+    return;
+
+  SDL_LockMutex (musmutex);
+  if (music_capture_state == music_capture_done)
+  {
+    if (music_capture_loop)
+    {
+      current_player->play (music_handle, true);
+      SetPlayerVolume ();
+    }
+
+    music_capture_state = music_capture_none;
+  }
+  SDL_UnlockMutex (musmutex);
 }
 
 // returns 1 on success, 0 on failure
@@ -1386,8 +1970,14 @@ static int RegisterSongEx (const void *data, size_t len, int try_mus2mid)
             const void *temp_handle = music_players[i]->registersong (data, len);
             if (temp_handle)
             {
+              if (RegisterCachedSong (music_players[i], temp_handle, data, len))
+              {
+                lprintf(LO_DEBUG, "RegisterSongEx: Using cached render of player %s\n", music_players[i]->name ());
+                return 1;
+              }
+
               SDL_LockMutex (musmutex);
-              current_player = i;
+              current_player = music_players[i];
               music_handle = temp_handle;
               SDL_UnlockMutex (musmutex);
               lprintf(LO_DEBUG, "RegisterSongEx: Using player %s\n", music_players[i]->name ());
@@ -1483,7 +2073,191 @@ static void UpdateMusic (void *buff, unsigned nsamp)
     return;
   }
 
-  music_players[current_player]->render (buff, nsamp);
+  current_player->render (buff, nsamp);
+
+  if (music_capture_state == music_capture_active)
+    CaptureMusic (buff, nsamp);
+
+  if (music_linear_volume)
+  {
+    short *sout = buff;
+    int multiplier = music_output_volume * 256 / 15;
+    unsigned i;
+
+    for (i = 0; i < nsamp * 2; i++)
+      sout[i] = sout[i] * multiplier / 256;
+  }
+}
+
+//
+// Music render-ahead
+//
+// With mus_render_ahead_ms set, a producer thread synthesizes music ahead of
+// the audio callback into a single-producer single-consumer ring of stereo
+// frames, so that OPL emulation or FluidSynth never runs inside the real-time
+// callback. Positions only ever increase; unsigned differences handle wrap.
+//
+
+#define MUSIC_AHEAD_CHUNK 256
+
+static Uint32 *music_ring;
+static unsigned int music_ring_mask;
+static unsigned int music_ahead_frames;
+static SDL_atomic_t music_ring_write;
+static SDL_atomic_t music_ring_read;
+static SDL_atomic_t music_ring_flush;
+static int music_ring_flushed;
+static SDL_atomic_t music_ahead_quit;
+static SDL_atomic_t music_underruns;
+static SDL_atomic_t music_underrun_frames;
+static SDL_Thread *music_ahead_thread;
+static SDL_sem *music_ahead_sem;
+
+static int SDLCALL MusicAheadThread (void *data)
+{
+  Uint32 chunk[MUSIC_AHEAD_CHUNK];
+
+  while (!SDL_AtomicGet (&music_ahead_quit))
+  {
+    unsigned int write = SDL_AtomicGet (&music_ring_write);
+    unsigned int read = SDL_AtomicGet (&music_ring_read);
+    unsigned int start, first;
+
+    if (write - read + MUSIC_AHEAD_CHUNK > music_ahead_frames)
+    {
+      SDL_SemWaitTimeout (music_ahead_sem, 10);
+      continue;
+    }
+
+    SDL_LockMutex (musmutex);
+
+    if (!registered_non_rw)
+    {
+      SDL_UnlockMutex (musmutex);
+      SDL_SemWaitTimeout (music_ahead_sem, 10);
+      continue;
+    }
+
+    UpdateMusic (chunk, MUSIC_AHEAD_CHUNK);
+
+    start = write & music_ring_mask;
+    first = MIN(MUSIC_AHEAD_CHUNK, music_ring_mask + 1 - start);
+    memcpy (music_ring + start, chunk, first * sizeof (*chunk));
+    memcpy (music_ring, chunk + first, (MUSIC_AHEAD_CHUNK - first) * sizeof (*chunk));
+
+    // Published under musmutex, so a flush requested by a song change
+    // can never be followed by audio rendered for the old state
+    SDL_AtomicSet (&music_ring_write, write + MUSIC_AHEAD_CHUNK);
+
+    SDL_UnlockMutex (musmutex);
+  }
+
+  return 0;
+}
+
+static void StartMusicAhead (void)
+{
+  int ms;
+  unsigned int size;
+
+  ms = dsda_IntConfig (dsda_config_mus_render_ahead_ms);
+
+  if (!ms || dumping_sound || !snd_samplerate)
+    return;
+
+  music_ahead_frames = MAX(ms * snd_samplerate / 1000, 2 * MUSIC_AHEAD_CHUNK);
+  for (size = 1; size < music_ahead_frames; size <<= 1);
+
+  music_ring = Z_Calloc (size, sizeof (*music_ring));
+  music_ring_mask = size - 1;
+  SDL_AtomicSet (&music_ring_write, 0);
+  SDL_AtomicSet (&music_ring_read, 0);
+  SDL_AtomicSet (&music_ring_flush, 0);
+  music_ring_flushed = 0;
+  SDL_AtomicSet (&music_ahead_quit, 0);
+
+  music_ahead_sem = SDL_CreateSemaphore (0);
+  music_ahead_thread = SDL_CreateThread (MusicAheadThread, "music render-ahead", NULL);
+
+  if (!music_ahead_thread)
+  {
+    lprintf (LO_WARN, "StartMusicAhead: couldn't create thread (%s)\n", SDL_GetError ());
+    SDL_DestroySemaphore (music_ahead_sem);
+    music_ahead_sem = NULL;
+    Z_Free (music_ring);
+    music_ring = NULL;
+    return;
+  }
+
+  lprintf (LO_DEBUG, "StartMusicAhead: rendering %u frames ahead\n", music_ahead_frames);
+}
+
+static void StopMusicAhead (void)
+{
+  if (!music_ahead_thread)
+    return;
+
+  SDL_AtomicSet (&music_ahead_quit, 1);
+  SDL_SemPost (music_ahead_sem);
+  SDL_WaitThread (music_ahead_thread, NULL);
+  music_ahead_thread = NULL;
+
+  // The ring and semaphore stay allocated: the audio callback may still be
+  // running, and only drains what is left
+}
+
+// Call with musmutex held after changing the player state
+static void FlushMusicAhead (void)
+{
+  if (music_ring)
+    SDL_AtomicIncRef (&music_ring_flush);
+}
+
+// Returns false if music should be rendered in the callback instead
+static dboolean ReadMusicAhead (void *buff, unsigned nsamp)
+{
+  Uint32 *out = buff;
+  unsigned int write, read, count, start, first;
+  int flush;
+
+  if (!music_ring || dumping_sound)
+    return false;
+
+  // The flush count comes first: a write position loaded after it
+  // covers every chunk published before the flush, so they're all dropped
+  flush = SDL_AtomicGet (&music_ring_flush);
+  write = SDL_AtomicGet (&music_ring_write);
+  read = SDL_AtomicGet (&music_ring_read);
+
+  if (flush != music_ring_flushed)
+  {
+    // Drop what was rendered before the change; the gap is expected
+    music_ring_flushed = flush;
+    read = write;
+  }
+  else if (write - read < nsamp)
+  {
+    SDL_AtomicIncRef (&music_underruns);
+    SDL_AtomicAdd (&music_underrun_frames, nsamp - (write - read));
+  }
+
+  count = MIN(write - read, nsamp);
+  start = read & music_ring_mask;
+  first = MIN(count, music_ring_mask + 1 - start);
+  memcpy (out, music_ring + start, first * sizeof (*out));
+  memcpy (out + first, music_ring, (count - first) * sizeof (*out));
+  memset (out + count, 0, (nsamp - count) * sizeof (*out));
+
+  SDL_AtomicSet (&music_ring_read, read + count);
+  SDL_SemPost (music_ahead_sem);
+
+  return true;
+}
+
+void I_GetMusicUnderruns (int *count, int *frames)
+{
+  *count = SDL_AtomicGet (&music_underruns);
+  *frames = SDL_AtomicGet (&music_underrun_frames);
 }
 
 void M_ChangeMIDIPlayer(void)
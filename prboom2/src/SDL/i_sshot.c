@@ -37,6 +37,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "SDL.h"
 
@@ -47,11 +48,15 @@
 #include "doomstat.h"
 #include "doomdef.h"
 #include "doomtype.h"
+#include "g_game.h"
+#include "i_system.h"
 #include "v_video.h"
 #include "i_video.h"
+#include "m_file.h"
 #include "z_zone.h"
 #include "lprintf.h"
 
+#include "dsda/args.h"
 #include "dsda/gl/render_scale.h"
 
 int renderW;
@@ -64,31 +69,517 @@ void I_UpdateRenderSize(void)
 }
 
 //
-// I_ScreenShot // Modified to work with SDL2 resizeable window and fullscreen desktop - DTIED
+// Screenshot encoder
+//
+// Grabbed frames are copied into a small ring of pooled buffers and
+// encoded (or written to the capture pipe) by one worker thread, in the
+// order they were grabbed. When every buffer is waiting for the encoder
+// the game thread blocks until one is free, since neither screenshots nor
+// video frames may be dropped, and the time spent waiting is reported.
+//
+// The buffers are only resized by the game thread while they are not
+// queued. The worker uses malloc for its scratch space, since the zone
+// is not thread safe.
 //
 
-int I_ScreenShot(const char *fname)
+#define SSHOT_QUEUE_SIZE 8
+#define SSHOT_RAW_MAGIC "DSDAPAL8"
+
+typedef enum
 {
-  int result = -1;
-  unsigned char *pixels = I_GrabScreen();
-  SDL_Surface *screenshot = NULL;
+  sshot_format_bmp,
+  sshot_format_tga,
+  sshot_format_png,
+  sshot_format_raw, // 8-bit indices and the palette, software renderer only
+  sshot_format_stream, // raw RGB24 written to a capture pipe
+} sshot_format_t;
+
+typedef struct
+{
+  sshot_format_t format;
+  byte *pixels;
+  int pixels_size;
+  int width;
+  int height;
+  byte palette[256 * 3];
+  char *name;
+  int name_size;
+  FILE *stream;
+} sshot_job_t;
+
+static sshot_job_t sshot_queue[SSHOT_QUEUE_SIZE];
+static int sshot_head;
+static int sshot_count;
+static dboolean sshot_quit;
+
+static SDL_Thread *sshot_thread;
+static SDL_mutex *sshot_mutex;
+static SDL_cond *sshot_work_cond;
+static SDL_cond *sshot_space_cond;
+
+static SDL_atomic_t sshot_failures;
+static int sshot_failures_reported;
+static char sshot_failed_name[256];
+
+static int sshot_stalls;
+static Uint32 sshot_stall_ms;
+static dboolean sshot_stalling;
+
+static const char *sshot_format_ext[] = { "bmp", "tga", "png", "pal8" };
+
+static void I_WriteLE16(byte *p, int value)
+{
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+}
+
+static void I_WriteLE32(byte *p, int value)
+{
+  I_WriteLE16(p, value & 0xffff);
+  I_WriteLE16(p + 2, (value >> 16) & 0xffff);
+}
+
+static int I_SaveSurface(const sshot_job_t *job)
+{
+  SDL_Surface *surface;
+  int result;
+
+  surface = SDL_CreateRGBSurfaceFrom(job->pixels, job->width, job->height, 24,
+    job->width * 3, 0x000000ff, 0x0000ff00, 0x00ff0000, 0);
+
+  if (!surface)
+    return -1;
+
+#ifdef HAVE_LIBSDL2_IMAGE
+  if (job->format == sshot_format_png)
+    result = IMG_SavePNG(surface, job->name);
+  else
+#endif
+    result = SDL_SaveBMP(surface, job->name);
+
+  SDL_FreeSurface(surface);
+
+  return result;
+}
+
+// Uncompressed truecolor with a top-left origin, so rows are written in order
+static int I_SaveTGA(const sshot_job_t *job)
+{
+  byte header[18] = { 0 };
+  byte *row;
+  FILE *f;
+  int x, y;
+  int result = 0;
+
+  f = M_OpenFile(job->name, "wb");
+  if (!f)
+    return -1;
+
+  header[2] = 2;
+  I_WriteLE16(header + 12, job->width);
+  I_WriteLE16(header + 14, job->height);
+  header[16] = 24;
+  header[17] = 0x20;
+
+  row = malloc(job->width * 3);
+
+  if (!row || fwrite(header, sizeof(header), 1, f) != 1)
+    result = -1;
 
-  if (pixels)
+  for (y = 0; y < job->height && !result; y++)
   {
-    screenshot = SDL_CreateRGBSurfaceFrom(pixels, renderW, renderH, 24,
-      renderW * 3, 0x000000ff, 0x0000ff00, 0x00ff0000, 0);
+    const byte *src = job->pixels + y * job->width * 3;
+
+    for (x = 0; x < job->width; x++)
+    {
+      row[3 * x + 0] = src[3 * x + 2];
+      row[3 * x + 1] = src[3 * x + 1];
+      row[3 * x + 2] = src[3 * x + 0];
+    }
+
+    if (fwrite(row, job->width * 3, 1, f) != 1)
+      result = -1;
   }
 
-  if (screenshot)
+  free(row);
+  fclose(f);
+
+  return result;
+}
+
+// "DSDAPAL8", width and height (little endian), the palette as 256 RGB
+// triplets, then one index per pixel, row by row
+static int I_SaveRaw(const sshot_job_t *job)
+{
+  byte header[16];
+  FILE *f;
+  int result = 0;
+
+  f = M_OpenFile(job->name, "wb");
+  if (!f)
+    return -1;
+
+  memcpy(header, SSHOT_RAW_MAGIC, 8);
+  I_WriteLE32(header + 8, job->width);
+  I_WriteLE32(header + 12, job->height);
+
+  if (fwrite(header, sizeof(header), 1, f) != 1 ||
+      fwrite(job->palette, sizeof(job->palette), 1, f) != 1 ||
+      fwrite(job->pixels, job->width * job->height, 1, f) != 1)
+    result = -1;
+
+  fclose(f);
+
+  return result;
+}
+
+static int I_EncodeScreenShot(const sshot_job_t *job)
+{
+  switch (job->format)
+  {
+    case sshot_format_tga:
+      return I_SaveTGA(job);
+    case sshot_format_raw:
+      return I_SaveRaw(job);
+    case sshot_format_stream:
+      return fwrite(job->pixels, job->width * job->height * 3, 1, job->stream) == 1 ? 0 : -1;
+    default:
+      return I_SaveSurface(job);
+  }
+}
+
+static int SDLCALL I_ScreenShotThread(void *data)
+{
+  SDL_LockMutex(sshot_mutex);
+
+  while (true)
   {
+    sshot_job_t *job;
+    int result;
+
+    while (!sshot_count && !sshot_quit)
+      SDL_CondWait(sshot_work_cond, sshot_mutex);
+
+    if (!sshot_count)
+      break;
+
+    // The job stays queued while it is encoded, so its buffers aren't reused
+    job = &sshot_queue[sshot_head];
+    SDL_UnlockMutex(sshot_mutex);
+
+    result = I_EncodeScreenShot(job);
+
+    SDL_LockMutex(sshot_mutex);
+
+    if (result)
+    {
+      if (job->format == sshot_format_stream)
+        snprintf(sshot_failed_name, sizeof(sshot_failed_name), "the video pipe");
+      else
+        snprintf(sshot_failed_name, sizeof(sshot_failed_name), "%s", job->name);
+      SDL_AtomicIncRef(&sshot_failures);
+    }
+
+    sshot_head = (sshot_head + 1) % SSHOT_QUEUE_SIZE;
+    sshot_count--;
+    SDL_CondSignal(sshot_space_cond);
+  }
+
+  SDL_UnlockMutex(sshot_mutex);
+
+  return 0;
+}
+
+static void I_ShutdownScreenShots(void)
+{
+  if (!sshot_thread)
+    return;
+
+  I_FlushScreenShots();
+
+  SDL_LockMutex(sshot_mutex);
+  sshot_quit = true;
+  SDL_CondSignal(sshot_work_cond);
+  SDL_UnlockMutex(sshot_mutex);
+
+  SDL_WaitThread(sshot_thread, NULL);
+  sshot_thread = NULL;
+
+  SDL_DestroyCond(sshot_space_cond);
+  SDL_DestroyCond(sshot_work_cond);
+  SDL_DestroyMutex(sshot_mutex);
+}
+
+static void I_StartScreenShotThread(void)
+{
+  sshot_mutex = SDL_CreateMutex();
+  sshot_work_cond = SDL_CreateCond();
+  sshot_space_cond = SDL_CreateCond();
+  sshot_thread = SDL_CreateThread(I_ScreenShotThread, "screenshot encoder", NULL);
+
+  if (!sshot_thread)
+    I_Error("I_StartScreenShotThread: unable to create thread (%s)", SDL_GetError());
+
+  I_AtExit(I_ShutdownScreenShots, true, "I_ShutdownScreenShots", exit_priority_normal);
+}
+
+// Returns the next free job, waiting for the encoder if the queue is full
+static sshot_job_t *I_AcquireScreenShotJob(void)
+{
+  sshot_job_t *job;
+
+  if (!sshot_thread)
+    I_StartScreenShotThread();
+
+  SDL_LockMutex(sshot_mutex);
+
+  if (sshot_count == SSHOT_QUEUE_SIZE)
+  {
+    Uint32 start = SDL_GetTicks();
+
+    while (sshot_count == SSHOT_QUEUE_SIZE)
+      SDL_CondWait(sshot_space_cond, sshot_mutex);
+
+    sshot_stalls++;
+    sshot_stall_ms += SDL_GetTicks() - start;
+
+    if (!sshot_stalling)
+    {
+      sshot_stalling = true;
+      lprintf(LO_WARN, "I_ScreenShot: the encoder is falling behind, frames are waiting for it\n");
+    }
+  }
+  else if (!sshot_count)
+  {
+    sshot_stalling = false;
+  }
+
+  job = &sshot_queue[(sshot_head + sshot_count) % SSHOT_QUEUE_SIZE];
+
+  SDL_UnlockMutex(sshot_mutex);
+
+  return job;
+}
+
+static void I_SubmitScreenShotJob(void)
+{
+  SDL_LockMutex(sshot_mutex);
+  sshot_count++;
+  SDL_CondSignal(sshot_work_cond);
+  SDL_UnlockMutex(sshot_mutex);
+}
+
+static void I_SetScreenShotJobName(sshot_job_t *job, const char *name)
+{
+  int size = strlen(name) + 1;
+
+  if (size > job->name_size)
+  {
+    job->name_size = size;
+    job->name = Z_Realloc(job->name, size);
+  }
+
+  memcpy(job->name, name, size);
+}
+
+static void I_ReserveScreenShotJob(sshot_job_t *job, int size)
+{
+  if (size > job->pixels_size)
+  {
+    job->pixels_size = size;
+    job->pixels = Z_Realloc(job->pixels, size);
+  }
+}
+
+static int I_GrabScreenToJob(sshot_job_t *job)
+{
+  unsigned char *pixels = I_GrabScreen();
+
+  if (!pixels || !renderW || !renderH)
+    return -1;
+
+  job->width = renderW;
+  job->height = renderH;
+  I_ReserveScreenShotJob(job, renderW * renderH * 3);
+  memcpy(job->pixels, pixels, renderW * renderH * 3);
+
+  return 0;
+}
+
+static void I_GrabIndexedScreenToJob(sshot_job_t *job)
+{
+  int y;
+
+  job->width = SCREENWIDTH;
+  job->height = SCREENHEIGHT;
+  I_ReserveScreenShotJob(job, SCREENWIDTH * SCREENHEIGHT);
+
+  for (y = 0; y < SCREENHEIGHT; y++)
+    memcpy(job->pixels + y * SCREENWIDTH, screens[0].data + y * screens[0].pitch, SCREENWIDTH);
+
+  I_GetScreenPalette(job->palette);
+}
+
+// Waits until every queued frame has been written
+void I_FlushScreenShots(void)
+{
+  if (!sshot_thread)
+    return;
+
+  SDL_LockMutex(sshot_mutex);
+  while (sshot_count)
+    SDL_CondWait(sshot_space_cond, sshot_mutex);
+  SDL_UnlockMutex(sshot_mutex);
+
+  I_ReportScreenShots();
+
+  if (sshot_stalls)
+  {
+    lprintf(LO_INFO, "I_FlushScreenShots: %d frames waited %u ms for the encoder\n",
+            sshot_stalls, sshot_stall_ms);
+    sshot_stalls = 0;
+    sshot_stall_ms = 0;
+  }
+}
+
+// Failures happen on the worker, so they are reported from the game thread
+void I_ReportScreenShots(void)
+{
+  char name[sizeof(sshot_failed_name)];
+  int failures;
+
+  if (!sshot_thread)
+    return;
+
+  failures = SDL_AtomicGet(&sshot_failures);
+
+  if (failures == sshot_failures_reported)
+    return;
+
+  SDL_LockMutex(sshot_mutex);
+  memcpy(name, sshot_failed_name, sizeof(name));
+  SDL_UnlockMutex(sshot_mutex);
+
+  doom_printf("I_ScreenShot: Error writing %s", name);
+  sshot_failures_reported = failures;
+}
+
+//
+// I_ScreenShot // Modified to work with SDL2 resizeable window and fullscreen desktop - DTIED
+//
+
+int I_ScreenShot(const char *fname)
+{
+  sshot_job_t *job = I_AcquireScreenShotJob();
+
+  if (I_GrabScreenToJob(job))
+    return -1;
+
 #ifdef HAVE_LIBSDL2_IMAGE
-    result = IMG_SavePNG(screenshot, fname);
+  job->format = sshot_format_png;
 #else
-    result = SDL_SaveBMP(screenshot, fname);
+  job->format = sshot_format_bmp;
 #endif
-    SDL_FreeSurface(screenshot);
+  I_SetScreenShotJobName(job, fname);
+  I_SubmitScreenShotJob();
+
+  return 0;
+}
+
+// Writes the current frame as raw RGB24 to a capture pipe
+void I_QueueScreenStream(FILE *stream)
+{
+  sshot_job_t *job = I_AcquireScreenShotJob();
+
+  if (I_GrabScreenToJob(job))
+    return;
+
+  job->format = sshot_format_stream;
+  job->stream = stream;
+  I_SubmitScreenShotJob();
+}
+
+//
+// Frame dumps
+//
+
+static int frame_dump_active = -1;
+static sshot_format_t frame_dump_format;
+static const char *frame_dump_dir;
+static int frame_dump_count;
+
+static void I_InitFrameDump(void)
+{
+  dsda_arg_t *arg;
+
+  arg = dsda_Arg(dsda_arg_frame_dump);
+  frame_dump_active = arg->found;
+
+  if (!frame_dump_active)
+    return;
+
+  frame_dump_dir = arg->value.v_string;
+  M_MakeDir(frame_dump_dir, false);
+
+  frame_dump_format = sshot_format_bmp;
+
+  arg = dsda_Arg(dsda_arg_frame_dump_format);
+  if (arg->found)
+  {
+    int i;
+
+    for (i = 0; i < (int) (sizeof(sshot_format_ext) / sizeof(*sshot_format_ext)); i++)
+      if (!strcasecmp(arg->value.v_string, sshot_format_ext[i]) ||
+          (i == sshot_format_raw && !strcasecmp(arg->value.v_string, "raw")))
+        break;
+
+    if (i == sizeof(sshot_format_ext) / sizeof(*sshot_format_ext))
+      I_Error("I_InitFrameDump: unknown frame dump format \"%s\"", arg->value.v_string);
+
+    frame_dump_format = i;
   }
-  return result;
+
+#ifndef HAVE_LIBSDL2_IMAGE
+  if (frame_dump_format == sshot_format_png)
+  {
+    lprintf(LO_WARN, "I_InitFrameDump: png is not supported in this build, using bmp\n");
+    frame_dump_format = sshot_format_bmp;
+  }
+#endif
+}
+
+dboolean I_FrameDumpActive(void)
+{
+  if (frame_dump_active < 0)
+    I_InitFrameDump();
+
+  return frame_dump_active;
+}
+
+void I_DumpFrame(void)
+{
+  sshot_job_t *job;
+  sshot_format_t format;
+  char name[PATH_MAX];
+
+  // The 8-bit screen only exists in the software renderer
+  format = frame_dump_format;
+  if (format == sshot_format_raw && V_IsOpenGLMode())
+    format = sshot_format_tga;
+
+  job = I_AcquireScreenShotJob();
+
+  if (format == sshot_format_raw)
+    I_GrabIndexedScreenToJob(job);
+  else if (I_GrabScreenToJob(job))
+    return;
+
+  snprintf(name, sizeof(name), "%s/frame_%06d.%s",
+           frame_dump_dir, frame_dump_count++, sshot_format_ext[format]);
+
+  job->format = format;
+  I_SetScreenShotJobName(job, name);
+  I_SubmitScreenShotJob();
 }
 
 // NSM
@@ -120,8 +611,17 @@ unsigned char *I_GrabScreen(void)
 
   if (pixels && size)
   {
-    SDL_Rect screen = { 0, 0, renderW, renderH };
-    SDL_RenderReadPixels(sdl_renderer, &screen, SDL_PIXELFORMAT_RGB24, pixels, renderW * 3);
+    // Unscaled output matches the 8-bit screen exactly,
+    // so skip the round trip through the renderer
+    if (renderW == SCREENWIDTH && renderH == SCREENHEIGHT)
+    {
+      I_ConvertScreenToRGB24(pixels);
+    }
+    else
+    {
+      SDL_Rect screen = { 0, 0, renderW, renderH };
+      SDL_RenderReadPixels(sdl_renderer, &screen, SDL_PIXELFORMAT_RGB24, pixels, renderW * 3);
+    }
   }
 
   return pixels;
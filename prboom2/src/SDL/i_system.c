@@ -66,6 +66,22 @@
 #include <io.h>
 #endif
 
+#ifdef _WIN32
+#include <process.h>
+#endif
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define I_HAVE_X86_CPUID
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
 #include "lprintf.h"
 #include "m_file.h"
 #include "doomtype.h"
@@ -82,6 +98,7 @@
 
 #include "z_zone.h"
 
+#include "dsda/args.h"
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
 #include "dsda/time.h"
@@ -166,6 +183,85 @@ fixed_t I_GetTimeFrac (void)
   return frac;
 }
 
+/*
+ * I_SIMDLevel
+ *
+ * Highest vector instruction set the software drawers may use.
+ * -simd none|sse4.1|avx2 caps it for testing and comparison.
+ */
+static simd_level_t I_DetectSIMDLevel(void)
+{
+#ifdef I_HAVE_X86_CPUID
+#if defined(_MSC_VER) && !defined(__clang__)
+  int regs[4];
+
+  __cpuid(regs, 0);
+  if (regs[0] >= 7)
+  {
+    __cpuid(regs, 1);
+    // AVX and OSXSAVE, and the OS must save the ymm state
+    if ((regs[2] & (1 << 27 | 1 << 28)) == (1 << 27 | 1 << 28) && (_xgetbv(0) & 6) == 6)
+    {
+      __cpuidex(regs, 7, 0);
+      if (regs[1] & (1 << 5))
+        return simd_avx2;
+    }
+  }
+
+  __cpuid(regs, 1);
+  if (regs[2] & (1 << 19))
+    return simd_sse41;
+#else
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return simd_avx2;
+
+  if (__builtin_cpu_supports("sse4.1"))
+    return simd_sse41;
+#endif
+#endif
+
+  return simd_none;
+}
+
+static const char* simd_level_names[] = { "none", "sse4.1", "avx2" };
+
+simd_level_t I_SIMDLevel(void)
+{
+  static simd_level_t level = -1;
+
+  if (level == -1)
+  {
+    dsda_arg_t *arg;
+
+    level = I_DetectSIMDLevel();
+
+    arg = dsda_Arg(dsda_arg_simd);
+    if (arg->found)
+    {
+      simd_level_t requested;
+
+      for (requested = simd_none; requested <= simd_avx2; ++requested)
+        if (!strcasecmp(arg->value.v_string, simd_level_names[requested]))
+          break;
+
+      if (requested > simd_avx2)
+        I_Error("-simd: unknown instruction set %s (expected none, sse4.1 or avx2)",
+                arg->value.v_string);
+
+      if (requested > level)
+        lprintf(LO_WARN, "I_SIMDLevel: %s is not supported by this CPU\n", arg->value.v_string);
+      else
+        level = requested;
+    }
+
+    lprintf(LO_DEBUG, "I_SIMDLevel: %s\n", simd_level_names[level]);
+  }
+
+  return level;
+}
+
 /*
  * I_GetRandomTimeSeed
  *
@@ -218,16 +314,36 @@ void I_Read(int fd, void* vbuf, size_t sz)
   }
 }
 
+/*
+ * I_Seek
+ *
+ * Wrapper for lseek(2) with 64 bit offsets, which aborts on error.
+ */
+void I_Seek(int fd, int64_t offset)
+{
+#ifdef _WIN32
+  if (_lseeki64(fd, offset, SEEK_SET) == -1)
+#else
+  if ((int64_t) (off_t) offset != offset || lseek(fd, (off_t) offset, SEEK_SET) == -1)
+#endif
+    I_Error("I_Seek: seek failed: %s", strerror(errno));
+}
+
 /*
  * I_Filelength
  *
  * Return length of an open file.
  */
 
-int I_Filelength(int handle)
+int64_t I_Filelength(int handle)
 {
+#ifdef _WIN32
+  struct _stati64 fileinfo;
+  if (_fstati64(handle,&fileinfo) == -1)
+#else
   struct stat   fileinfo;
   if (fstat(handle,&fileinfo) == -1)
+#endif
     I_Error("I_Filelength: %s",strerror(errno));
   return fileinfo.st_size;
 }
@@ -440,6 +556,166 @@ const char *I_GetTempDir(void)
 
 #endif
 
+#ifdef _WIN32
+
+// The C runtime splits the command line that _wspawnv joins with spaces.
+// Backslashes are literal unless they come before a quote, so those are
+// doubled, along with the ones before the closing quote, and quotes in
+// the argument are escaped.
+static char* I_QuoteProcessArg(const char* arg)
+{
+  char* quoted;
+  char* out;
+  int backslashes = 0;
+
+  quoted = Z_Malloc(2 * strlen(arg) + 3);
+  out = quoted;
+
+  *out++ = '"';
+
+  for (; *arg; arg++)
+  {
+    if (*arg == '\\')
+    {
+      backslashes++;
+      continue;
+    }
+
+    if (*arg == '"')
+      backslashes = 2 * backslashes + 1;
+
+    for (; backslashes; backslashes--)
+      *out++ = '\\';
+
+    *out++ = *arg;
+  }
+
+  for (backslashes *= 2; backslashes; backslashes--)
+    *out++ = '\\';
+
+  *out++ = '"';
+  *out = '\0';
+
+  return quoted;
+}
+
+#endif
+
+/*
+ * I_StartProcess
+ *
+ * Starts a program without waiting for it, returning a handle for
+ * I_WaitProcess or -1
+ */
+
+intptr_t I_StartProcess(char** argv)
+{
+#ifdef _WIN32
+  wchar_t** wargv;
+  int argc, i;
+  intptr_t result = -1;
+
+  for (argc = 0; argv[argc]; argc++);
+
+  wargv = Z_Calloc(argc + 1, sizeof(*wargv));
+
+  for (i = 0; i < argc; i++)
+  {
+    char* quoted;
+
+    quoted = I_QuoteProcessArg(argv[i]);
+    wargv[i] = ConvertUtf8ToWide(quoted);
+    Z_Free(quoted);
+
+    if (!wargv[i])
+      break;
+  }
+
+  if (i == argc)
+  {
+    wchar_t* wpath = ConvertUtf8ToWide(argv[0]);
+
+    if (wpath)
+    {
+      result = _wspawnv(_P_NOWAIT, wpath, (const wchar_t* const*) wargv);
+      Z_Free(wpath);
+    }
+  }
+
+  for (i = 0; i < argc; i++)
+    Z_Free(wargv[i]);
+  Z_Free(wargv);
+
+  return result;
+#elif defined(AMIGA) || !defined(HAVE_UNISTD_H) || !defined(HAVE_SYS_WAIT_H)
+  return -1;
+#else
+  pid_t pid;
+
+  fflush(stdout);
+  fflush(stderr);
+
+  pid = fork();
+
+  if (pid < 0)
+    return -1;
+
+  if (pid == 0)
+  {
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+
+  return pid;
+#endif
+}
+
+/*
+ * I_WaitProcess
+ *
+ * Waits for a program started by I_StartProcess, returning its exit code or -1
+ */
+
+int I_WaitProcess(intptr_t process)
+{
+  if (process == -1)
+    return -1;
+
+#ifdef _WIN32
+  {
+    int status;
+
+    if (_cwait(&status, process, 0) == -1)
+      return -1;
+
+    return status;
+  }
+#elif defined(AMIGA) || !defined(HAVE_UNISTD_H) || !defined(HAVE_SYS_WAIT_H)
+  return -1;
+#else
+  {
+    int status;
+
+    while (waitpid((pid_t) process, &status, 0) < 0)
+      if (errno != EINTR)
+        return -1;
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  }
+#endif
+}
+
+/*
+ * I_RunProcess
+ *
+ * Runs a program to completion, returning its exit code or -1
+ */
+
+int I_RunProcess(char** argv)
+{
+  return I_WaitProcess(I_StartProcess(argv));
+}
+
 /*
  * HasTrailingSlash
  *
@@ -46,6 +46,17 @@
 #endif // _WIN32
 
 #include <stdlib.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define I_VIDEO_HAVE_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define I_VIDEO_TARGET_AVX2
+#else
+#define I_VIDEO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -492,6 +503,164 @@ static void I_InitInputs(void)
 ///////////////////////////////////////////////////////////
 // Palette stuff.
 //
+//
+// Palette conversion
+//
+// The software framebuffer is converted from 8-bit indices straight into
+// the locked streaming texture (ARGB8888) through a 256-entry lookup table.
+// This replaces the copy into the 8-bit SDL surface, the SDL_LowerBlit into
+// an intermediate 32-bit surface and the SDL_UpdateTexture upload.
+//
+
+static uint32_t palette_lut[256];
+
+static void I_SetPaletteLUT(const SDL_Color *colours)
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+    palette_lut[i] = 0xff000000u | (colours[i].r << 16) | (colours[i].g << 8) | colours[i].b;
+}
+
+static void I_ConvertPaletted_Scalar(uint32_t *dest, int dest_pitch,
+                                     const byte *src, int src_pitch,
+                                     int width, int height)
+{
+  int x;
+
+  for (; height > 0; height--)
+  {
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+      dest[x + 0] = palette_lut[src[x + 0]];
+      dest[x + 1] = palette_lut[src[x + 1]];
+      dest[x + 2] = palette_lut[src[x + 2]];
+      dest[x + 3] = palette_lut[src[x + 3]];
+    }
+    for (; x < width; x++)
+      dest[x] = palette_lut[src[x]];
+
+    dest = (uint32_t *)((byte *)dest + dest_pitch);
+    src += src_pitch;
+  }
+}
+
+#ifdef I_VIDEO_HAVE_AVX2
+// The table holds 32-bit entries, so an 8-lane gather never reads outside it
+I_VIDEO_TARGET_AVX2
+static void I_ConvertPaletted_AVX2(uint32_t *dest, int dest_pitch,
+                                   const byte *src, int src_pitch,
+                                   int width, int height)
+{
+  const int *lut = (const int *)palette_lut;
+  int x;
+
+  for (; height > 0; height--)
+  {
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+      __m128i idx = _mm_loadu_si128((const __m128i *)(src + x));
+      __m256i lo = _mm256_i32gather_epi32(lut, _mm256_cvtepu8_epi32(idx), 4);
+      __m256i hi = _mm256_i32gather_epi32(lut, _mm256_cvtepu8_epi32(_mm_srli_si128(idx, 8)), 4);
+
+      _mm256_storeu_si256((__m256i *)(dest + x), lo);
+      _mm256_storeu_si256((__m256i *)(dest + x + 8), hi);
+    }
+    for (; x < width; x++)
+      dest[x] = palette_lut[src[x]];
+
+    dest = (uint32_t *)((byte *)dest + dest_pitch);
+    src += src_pitch;
+  }
+}
+#endif
+
+typedef void (*convert_paletted_f)(uint32_t *dest, int dest_pitch,
+                                   const byte *src, int src_pitch,
+                                   int width, int height);
+
+static convert_paletted_f I_GetConvertPaletted(simd_level_t level)
+{
+#ifdef I_VIDEO_HAVE_AVX2
+  if (level >= simd_avx2)
+    return I_ConvertPaletted_AVX2;
+#endif
+
+  return I_ConvertPaletted_Scalar;
+}
+
+// Fills rgb with the current 8-bit screen as packed RGB24, without going
+// through the renderer. Used by the capture path at native resolution.
+void I_ConvertScreenToRGB24(byte *rgb)
+{
+  const byte *src = screens[0].data;
+  int x, y;
+
+  for (y = 0; y < SCREENHEIGHT; y++)
+  {
+    for (x = 0; x < SCREENWIDTH; x++)
+    {
+      uint32_t c = palette_lut[src[x]];
+
+      rgb[0] = (c >> 16) & 0xff;
+      rgb[1] = (c >> 8) & 0xff;
+      rgb[2] = c & 0xff;
+      rgb += 3;
+    }
+    src += screens[0].pitch;
+  }
+}
+
+// Fills rgb with the 256 colors of the palette the screen is shown with
+void I_GetScreenPalette(byte *rgb)
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+  {
+    rgb[3 * i + 0] = (palette_lut[i] >> 16) & 0xff;
+    rgb[3 * i + 1] = (palette_lut[i] >> 8) & 0xff;
+    rgb[3 * i + 2] = palette_lut[i] & 0xff;
+  }
+}
+
+// Times the palette conversion of the current frame into a scratch buffer,
+// for each available kernel
+void I_BenchmarkPaletteConversion(int frames)
+{
+  uint32_t *scratch;
+  simd_level_t level;
+  convert_paletted_f last = NULL;
+
+  if (!screens[0].data || frames <= 0)
+    return;
+
+  scratch = Z_Malloc(SCREENWIDTH * SCREENHEIGHT * sizeof(*scratch));
+
+  for (level = simd_none; level <= I_SIMDLevel(); level++)
+  {
+    convert_paletted_f convert = I_GetConvertPaletted(level);
+    unsigned long long elapsed;
+    int i;
+
+    if (convert == last)
+      continue;
+    last = convert;
+
+    dsda_StartTimer(dsda_timer_temp);
+    for (i = 0; i < frames; i++)
+      convert(scratch, SCREENWIDTH * sizeof(*scratch),
+              screens[0].data, screens[0].pitch, SCREENWIDTH, SCREENHEIGHT);
+    elapsed = dsda_ElapsedTime(dsda_timer_temp);
+
+    lprintf(LO_INFO, "I_BenchmarkPaletteConversion: %s %dx%d, %.3f ms/frame\n",
+            convert == I_ConvertPaletted_Scalar ? "scalar" : "avx2",
+            SCREENWIDTH, SCREENHEIGHT, (double) elapsed / 1000 / frames);
+  }
+
+  Z_Free(scratch);
+}
+
 static void I_UploadNewPalette(int pal, int force)
 {
   // This is used to replace the current 256 colour cmap with a new one
@@ -545,6 +714,7 @@ static void I_UploadNewPalette(int pal, int force)
 #endif
 
   SDL_SetPaletteColors(screen->format->palette, playpal_data->colours + 256 * pal, 0, 256);
+  I_SetPaletteLUT(playpal_data->colours + 256 * pal);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -569,6 +739,12 @@ void I_QueueScreenshot(void)
   queue_screenshot = true;
 }
 
+// Frame dumps grab every frame, so they count as a queued capture
+dboolean I_FrameCaptureQueued(void)
+{
+  return queue_frame_capture || queue_screenshot || I_FrameDumpActive();
+}
+
 void I_HandleCapture(void)
 {
   if (queue_frame_capture)
@@ -582,14 +758,40 @@ void I_HandleCapture(void)
     M_ScreenShot();
     queue_screenshot = false;
   }
+
+  if (I_FrameDumpActive())
+    I_DumpFrame();
+
+  I_ReportScreenShots();
 }
 
 //
 // I_FinishUpdate
 //
-static int newpal = 0;
+// A tic simulated during the present may set the next palette
+static SDL_atomic_t newpal;
 #define NO_PALETTE_CHANGE 1000
 
+static dboolean hold_palette;
+
+void I_UpdatePalette(void)
+{
+  int pal;
+
+  if (V_IsOpenGLMode())
+    return;
+
+  pal = SDL_AtomicSet(&newpal, NO_PALETTE_CHANGE);
+  if (pal != NO_PALETTE_CHANGE) {
+    I_UploadNewPalette(pal, false);
+  }
+}
+
+void I_HoldPalette(dboolean hold)
+{
+  hold_palette = hold;
+}
+
 void I_FinishUpdate (void)
 {
   if (V_IsOpenGLMode()) {
@@ -598,43 +800,40 @@ void I_FinishUpdate (void)
     return;
   }
 
-  if (SDL_MUSTLOCK(screen)) {
-      int h;
-      byte *src;
-      byte *dest;
+  if (!hold_palette)
+    I_UpdatePalette();
 
-      if (SDL_LockSurface(screen) < 0) {
+  {
+    void *pixels;
+    int pitch;
+
+    // Convert the paletted screen buffer straight into the texture memory.
+    if (SDL_LockTexture(sdl_texture, &src_rect, &pixels, &pitch) == 0)
+    {
+      I_GetConvertPaletted(I_SIMDLevel())(pixels, pitch,
+                                          screens[0].data, screens[0].pitch,
+                                          SCREENWIDTH, SCREENHEIGHT);
+      SDL_UnlockTexture(sdl_texture);
+    }
+    else
+    {
+      // Fall back to the intermediate 32-bit surface
+      if (SDL_MUSTLOCK(buffer) && SDL_LockSurface(buffer) < 0) {
         lprintf(LO_INFO,"I_FinishUpdate: %s\n", SDL_GetError());
         return;
       }
 
-      dest=(byte*)screen->pixels;
-      src=screens[0].data;
-      h=screen->h;
-      for (; h>0; h--)
-      {
-        memcpy(dest,src,SCREENWIDTH); //e6y
-        dest+=screen->pitch;
-        src+=screens[0].pitch;
-      }
+      I_GetConvertPaletted(I_SIMDLevel())(buffer->pixels, buffer->pitch,
+                                          screens[0].data, screens[0].pitch,
+                                          SCREENWIDTH, SCREENHEIGHT);
 
-      SDL_UnlockSurface(screen);
-  }
+      if (SDL_MUSTLOCK(buffer))
+        SDL_UnlockSurface(buffer);
 
-  /* Update the display buffer (flipping video pages if supported)
-   * If we need to change palette, that implicitely does a flip */
-  if (newpal != NO_PALETTE_CHANGE) {
-    I_UploadNewPalette(newpal, false);
-    newpal = NO_PALETTE_CHANGE;
+      SDL_UpdateTexture(sdl_texture, &src_rect, buffer->pixels, buffer->pitch);
+    }
   }
 
-  // Blit from the paletted 8-bit screen buffer to the intermediate
-  // 32-bit RGBA buffer that we can load into the texture.
-  SDL_LowerBlit(screen, &src_rect, buffer, &src_rect);
-
-  // Update the intermediate texture with the contents of the RGBA buffer.
-  SDL_UpdateTexture(sdl_texture, &src_rect, buffer->pixels, buffer->pitch);
-
   // Make sure the pillarboxes are kept clear each frame.
   SDL_RenderClear(sdl_renderer);
 
@@ -655,7 +854,7 @@ void I_FinishUpdate (void)
 //
 void I_SetPalette (int pal)
 {
-  newpal = pal;
+  SDL_AtomicSet(&newpal, pal);
 }
 
 // I_PreInitGraphics
@@ -1296,10 +1495,11 @@ void I_UpdateVideoMode(void)
     SDL_RenderSetIntegerScale(sdl_renderer, integer_scaling);
 
     screen = SDL_CreateRGBSurface(0, SCREENWIDTH, SCREENHEIGHT, 8, 0, 0, 0, 0);
-    buffer = SDL_CreateRGBSurface(0, SCREENWIDTH, SCREENHEIGHT, 32, 0, 0, 0, 0);
+    buffer = SDL_CreateRGBSurfaceWithFormat(0, SCREENWIDTH, SCREENHEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
     SDL_FillRect(buffer, NULL, 0);
 
-    sdl_texture = SDL_CreateTextureFromSurface(sdl_renderer, buffer);
+    sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888,
+                                    SDL_TEXTUREACCESS_STREAMING, SCREENWIDTH, SCREENHEIGHT);
 
     if(screen == NULL) {
       I_Error("Couldn't set %dx%d video mode [%s]", SCREENWIDTH, SCREENHEIGHT, SDL_GetError());
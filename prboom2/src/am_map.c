@@ -1638,6 +1638,260 @@ static void AM_drawGrid(int color)
   }
 }
 
+//
+// Spatial index
+//
+// Uniform grids over the lines and sectors of the level, so that the automap
+// and the minimap only visit the cells intersecting the frame instead of
+// testing every line and sector each frame. Polyobject lines move and are
+// kept out of the grid; they are always tested.
+//
+
+#define AM_GRID_CELL_SHIFT (9 + MAPBITS) // 512 units
+#define AM_GRID_MAX_SIZE 256
+
+typedef struct
+{
+  fixed_t orgx, orgy;
+  int shift;
+  int width, height;
+  int *cells;   // first item of each cell, plus one past the end
+  int *items;
+  int *stamps;  // last query that visited each item
+  int stamp;
+} am_grid_t;
+
+static am_grid_t am_line_grid;
+static am_grid_t am_sector_grid;
+static int *am_dynamic_lines;
+static int am_dynamic_line_count;
+static int *am_visible;
+static int am_visible_size;
+
+static void AM_GridCellRange(const am_grid_t *grid, const fixed_t *bbox,
+                             int *x1, int *y1, int *x2, int *y2)
+{
+  *x1 = MAX(0, (int) (((int64_t) bbox[BOXLEFT] - grid->orgx) >> grid->shift));
+  *y1 = MAX(0, (int) (((int64_t) bbox[BOXBOTTOM] - grid->orgy) >> grid->shift));
+  *x2 = MIN(grid->width - 1, (int) (((int64_t) bbox[BOXRIGHT] - grid->orgx) >> grid->shift));
+  *y2 = MIN(grid->height - 1, (int) (((int64_t) bbox[BOXTOP] - grid->orgy) >> grid->shift));
+}
+
+static void AM_GridInit(am_grid_t *grid, int count, const fixed_t *bbox)
+{
+  grid->orgx = bbox[BOXLEFT];
+  grid->orgy = bbox[BOXBOTTOM];
+  grid->shift = AM_GRID_CELL_SHIFT;
+
+  while (
+    ((int64_t) bbox[BOXRIGHT] - bbox[BOXLEFT]) >> grid->shift >= AM_GRID_MAX_SIZE ||
+    ((int64_t) bbox[BOXTOP] - bbox[BOXBOTTOM]) >> grid->shift >= AM_GRID_MAX_SIZE
+  )
+    grid->shift++;
+
+  grid->width = (int) ((((int64_t) bbox[BOXRIGHT] - bbox[BOXLEFT]) >> grid->shift) + 1);
+  grid->height = (int) ((((int64_t) bbox[BOXTOP] - bbox[BOXBOTTOM]) >> grid->shift) + 1);
+  grid->cells = Z_CallocLevel(grid->width * grid->height + 1, sizeof(*grid->cells));
+  grid->items = NULL;
+  grid->stamps = Z_CallocLevel(MAX(count, 1), sizeof(*grid->stamps));
+  grid->stamp = 0;
+}
+
+// Counts (items == NULL) or files an item in every cell its bbox touches
+static void AM_GridAdd(am_grid_t *grid, int item, const fixed_t *bbox)
+{
+  int x, y, x1, y1, x2, y2;
+
+  AM_GridCellRange(grid, bbox, &x1, &y1, &x2, &y2);
+
+  for (y = y1; y <= y2; y++)
+    for (x = x1; x <= x2; x++)
+    {
+      int cell = y * grid->width + x;
+
+      if (grid->items)
+        grid->items[grid->cells[cell]++] = item;
+      else
+        grid->cells[cell + 1]++;
+    }
+}
+
+static void AM_GridPrepareFill(am_grid_t *grid)
+{
+  int i;
+  int ncells = grid->width * grid->height;
+
+  for (i = 0; i < ncells; i++)
+    grid->cells[i + 1] += grid->cells[i];
+
+  grid->items = Z_MallocLevel(MAX(grid->cells[ncells], 1) * sizeof(*grid->items));
+}
+
+static void AM_GridFinishFill(am_grid_t *grid)
+{
+  int i;
+
+  // Filling advanced each start to the start of the next cell
+  for (i = grid->width * grid->height; i > 0; i--)
+    grid->cells[i] = grid->cells[i - 1];
+  grid->cells[0] = 0;
+}
+
+static void AM_LineMapBBox(const line_t *line, fixed_t *bbox)
+{
+  bbox[BOXLEFT] = line->bbox[BOXLEFT] >> FRACTOMAPBITS;
+  bbox[BOXRIGHT] = line->bbox[BOXRIGHT] >> FRACTOMAPBITS;
+  bbox[BOXBOTTOM] = line->bbox[BOXBOTTOM] >> FRACTOMAPBITS;
+  bbox[BOXTOP] = line->bbox[BOXTOP] >> FRACTOMAPBITS;
+}
+
+void AM_BuildSpatialIndex(void)
+{
+  int i, pass;
+  fixed_t bbox[4];
+  fixed_t level_bbox[4];
+  byte *dynamic;
+
+  am_visible = NULL;
+  am_visible_size = 0;
+
+  dynamic = Z_CallocLevel(MAX(numlines, 1), sizeof(*dynamic));
+  am_dynamic_line_count = 0;
+  for (i = 0; i < po_NumPolyobjs; i++)
+  {
+    int j;
+
+    for (j = 0; j < polyobjs[i].numsegs; j++)
+    {
+      line_t *line = polyobjs[i].segs[j]->linedef;
+
+      if (line && !dynamic[line - lines])
+      {
+        dynamic[line - lines] = 1;
+        am_dynamic_line_count++;
+      }
+    }
+  }
+
+  am_dynamic_lines = Z_MallocLevel(MAX(am_dynamic_line_count, 1) * sizeof(*am_dynamic_lines));
+  am_dynamic_line_count = 0;
+  for (i = 0; i < numlines; i++)
+    if (dynamic[i])
+      am_dynamic_lines[am_dynamic_line_count++] = i;
+
+  M_ClearBox(level_bbox);
+  for (i = 0; i < numvertexes; i++)
+    M_AddToBox(level_bbox, vertexes[i].x >> FRACTOMAPBITS, vertexes[i].y >> FRACTOMAPBITS);
+  for (i = 0; i < numsectors; i++)
+  {
+    M_AddToBox(level_bbox, sectors[i].bbox[BOXLEFT], sectors[i].bbox[BOXBOTTOM]);
+    M_AddToBox(level_bbox, sectors[i].bbox[BOXRIGHT], sectors[i].bbox[BOXTOP]);
+  }
+
+  if (level_bbox[BOXLEFT] > level_bbox[BOXRIGHT])
+    level_bbox[BOXLEFT] = level_bbox[BOXRIGHT] = level_bbox[BOXBOTTOM] = level_bbox[BOXTOP] = 0;
+
+  AM_GridInit(&am_line_grid, numlines, level_bbox);
+  AM_GridInit(&am_sector_grid, numsectors, level_bbox);
+
+  for (pass = 0; pass < 2; pass++)
+  {
+    for (i = 0; i < numlines; i++)
+      if (!dynamic[i])
+      {
+        AM_LineMapBBox(&lines[i], bbox);
+        AM_GridAdd(&am_line_grid, i, bbox);
+      }
+
+    for (i = 0; i < numsectors; i++)
+      AM_GridAdd(&am_sector_grid, i, sectors[i].bbox);
+
+    if (!pass)
+    {
+      AM_GridPrepareFill(&am_line_grid);
+      AM_GridPrepareFill(&am_sector_grid);
+    }
+  }
+
+  AM_GridFinishFill(&am_line_grid);
+  AM_GridFinishFill(&am_sector_grid);
+
+  Z_Free(dynamic);
+}
+
+static int AM_CompareInt(const void *a, const void *b)
+{
+  return *(const int *) a - *(const int *) b;
+}
+
+//
+// AM_GridQuery
+//
+// Collects the items filed in the cells touched by the frame into am_visible,
+// in index order so that drawing order does not change. Returns -1 if the
+// frame covers most of the grid, in which case visiting everything is
+// cheaper.
+//
+
+static int AM_GridQuery(am_grid_t *grid, const int *extra, int extra_count)
+{
+  int x, y, x1, y1, x2, y2;
+  int count = 0;
+  int i;
+
+  if (!grid->cells)
+    return -1;
+
+  AM_GridCellRange(grid, am_frame.bbox, &x1, &y1, &x2, &y2);
+
+  if (x1 > x2 || y1 > y2)
+    x2 = x1 - 1;
+  else if ((x2 - x1 + 1) * (y2 - y1 + 1) * 2 > grid->width * grid->height)
+    return -1;
+
+  grid->stamp++;
+
+  for (y = y1; y <= y2 && x1 <= x2; y++)
+    for (x = x1; x <= x2; x++)
+    {
+      int cell = y * grid->width + x;
+      int end = grid->cells[cell + 1];
+
+      for (i = grid->cells[cell]; i < end; i++)
+      {
+        int item = grid->items[i];
+
+        if (grid->stamps[item] == grid->stamp)
+          continue;
+
+        grid->stamps[item] = grid->stamp;
+
+        if (count == am_visible_size)
+        {
+          am_visible_size = am_visible_size ? am_visible_size * 2 : 1024;
+          am_visible = Z_ReallocLevel(am_visible, am_visible_size * sizeof(*am_visible));
+        }
+
+        am_visible[count++] = item;
+      }
+    }
+
+  for (i = 0; i < extra_count; i++)
+  {
+    if (count == am_visible_size)
+    {
+      am_visible_size = am_visible_size ? am_visible_size * 2 : 1024;
+      am_visible = Z_ReallocLevel(am_visible, am_visible_size * sizeof(*am_visible));
+    }
+
+    am_visible[count++] = extra[i];
+  }
+
+  qsort(am_visible, count, sizeof(*am_visible), AM_CompareInt);
+
+  return count;
+}
+
 static dboolean AM_DrawHiddenSecrets(void)
 {
   return !!mapcolor_p->secr && !map_secret_after;
@@ -1798,120 +2052,135 @@ static automap_style_t AM_wallStyle(int i)
   return ams_invisible;
 }
 
-static void AM_drawWalls(void)
+static void AM_drawWall(int i, int hide_locks)
 {
-  int i;
   automap_style_t automap_style;
   static mline_t l;
-  int hide_locks;
 
-  hide_locks = map_blinking_locks && (gametic & 16);
+  if (lines[i].bbox[BOXLEFT] >> FRACTOMAPBITS > am_frame.bbox[BOXRIGHT] ||
+    lines[i].bbox[BOXRIGHT] >> FRACTOMAPBITS < am_frame.bbox[BOXLEFT] ||
+    lines[i].bbox[BOXBOTTOM] >> FRACTOMAPBITS > am_frame.bbox[BOXTOP] ||
+    lines[i].bbox[BOXTOP] >> FRACTOMAPBITS < am_frame.bbox[BOXBOTTOM])
+  {
+    return;
+  }
 
-  // draw the unclipped visible portions of all lines
-  for (i=0;i<numlines;i++)
+  l.a.x = lines[i].v1->x >> FRACTOMAPBITS;
+  l.a.y = lines[i].v1->y >> FRACTOMAPBITS;
+  l.b.x = lines[i].v2->x >> FRACTOMAPBITS;
+  l.b.y = lines[i].v2->y >> FRACTOMAPBITS;
+
+  if (automap_rotate)
   {
-    if (lines[i].bbox[BOXLEFT] >> FRACTOMAPBITS > am_frame.bbox[BOXRIGHT] ||
-      lines[i].bbox[BOXRIGHT] >> FRACTOMAPBITS < am_frame.bbox[BOXLEFT] ||
-      lines[i].bbox[BOXBOTTOM] >> FRACTOMAPBITS > am_frame.bbox[BOXTOP] ||
-      lines[i].bbox[BOXTOP] >> FRACTOMAPBITS < am_frame.bbox[BOXBOTTOM])
-    {
-      continue;
-    }
+    AM_rotatePoint(&l.a);
+    AM_rotatePoint(&l.b);
+  }
+  else
+  {
+    AM_SetMPointFloatValue(&l.a);
+    AM_SetMPointFloatValue(&l.b);
+  }
 
-    l.a.x = lines[i].v1->x >> FRACTOMAPBITS;
-    l.a.y = lines[i].v1->y >> FRACTOMAPBITS;
-    l.b.x = lines[i].v2->x >> FRACTOMAPBITS;
-    l.b.y = lines[i].v2->y >> FRACTOMAPBITS;
+  automap_style = AM_wallStyle(i);
 
-    if (automap_rotate)
-    {
-      AM_rotatePoint(&l.a);
-      AM_rotatePoint(&l.b);
-    }
-    else
-    {
-      AM_SetMPointFloatValue(&l.a);
-      AM_SetMPointFloatValue(&l.b);
-    }
+  switch (automap_style)
+  {
+    case ams_invisible:
+      return;
 
-    automap_style = AM_wallStyle(i);
+    case ams_locked:
+      if (hide_locks)
+      {
+        AM_drawMline(&l, mapcolor_p->grid);
+        return;
+      }
 
-    switch (automap_style)
-    {
-      case ams_invisible:
-        continue;
+      switch (dsda_DoorType(i))
+      {
+        case 0: // red
+          AM_drawMline(&l, mapcolor_p->rdor? mapcolor_p->rdor : mapcolor_p->cchg);
+          return;
+        case 1: // blue
+          AM_drawMline(&l, mapcolor_p->bdor? mapcolor_p->bdor : mapcolor_p->cchg);
+          return;
+        case 2: // yellow
+          AM_drawMline(&l, mapcolor_p->ydor? mapcolor_p->ydor : mapcolor_p->cchg);
+          return;
+        default:
+          AM_drawMline(&l, mapcolor_p->clsd? mapcolor_p->clsd : mapcolor_p->cchg);
+          return;
+      }
 
-      case ams_locked:
-        if (hide_locks)
-        {
-          AM_drawMline(&l, mapcolor_p->grid);
-          continue;
-        }
+    case ams_exit:
+      AM_drawMline(&l, mapcolor_p->exit);
+      return;
 
-        switch (dsda_DoorType(i))
-        {
-          case 0: // red
-            AM_drawMline(&l, mapcolor_p->rdor? mapcolor_p->rdor : mapcolor_p->cchg);
-            continue;
-          case 1: // blue
-            AM_drawMline(&l, mapcolor_p->bdor? mapcolor_p->bdor : mapcolor_p->cchg);
-            continue;
-          case 2: // yellow
-            AM_drawMline(&l, mapcolor_p->ydor? mapcolor_p->ydor : mapcolor_p->cchg);
-            continue;
-          default:
-            AM_drawMline(&l, mapcolor_p->clsd? mapcolor_p->clsd : mapcolor_p->cchg);
-            continue;
-        }
+    case ams_exit_secret:
+      AM_drawMline(&l, mapcolor_p->exitsecr);
+      return;
 
-      case ams_exit:
-        AM_drawMline(&l, mapcolor_p->exit);
-        continue;
+    case ams_one_sided:
+      AM_drawMline(&l, mapcolor_p->wall);
+      return;
 
-      case ams_exit_secret:
-        AM_drawMline(&l, mapcolor_p->exitsecr);
-        continue;
+    case ams_secret:
+    case ams_unseen_secret:
+      AM_drawMline(&l, mapcolor_p->secr);
+      return;
 
-      case ams_one_sided:
-        AM_drawMline(&l, mapcolor_p->wall);
-        continue;
+    case ams_revealed_secret:
+      AM_drawMline(&l, mapcolor_p->revsecr);
+      return;
 
-      case ams_secret:
-      case ams_unseen_secret:
-        AM_drawMline(&l, mapcolor_p->secr);
-        continue;
+    case ams_teleport:
+      AM_drawMline(&l, mapcolor_p->tele);
+      return;
 
-      case ams_revealed_secret:
-        AM_drawMline(&l, mapcolor_p->revsecr);
-        continue;
+    case ams_closed_door:
+      AM_drawMline(&l, mapcolor_p->clsd);
+      return;
 
-      case ams_teleport:
-        AM_drawMline(&l, mapcolor_p->tele);
-        continue;
+    case ams_floor_diff:
+      AM_drawMline(&l, mapcolor_p->fchg);
+      return;
 
-      case ams_closed_door:
-        AM_drawMline(&l, mapcolor_p->clsd);
-        continue;
+    case ams_ceiling_diff:
+      AM_drawMline(&l, mapcolor_p->cchg);
+      return;
 
-      case ams_floor_diff:
-        AM_drawMline(&l, mapcolor_p->fchg);
-        continue;
+    case ams_two_sided:
+      AM_drawMline(&l, mapcolor_p->flat);
+      return;
 
-      case ams_ceiling_diff:
-        AM_drawMline(&l, mapcolor_p->cchg);
-        continue;
+    case ams_unseen:
+      AM_drawMline(&l, mapcolor_p->unsn);
+      return;
 
-      case ams_two_sided:
-        AM_drawMline(&l, mapcolor_p->flat);
-        continue;
+    default:
+      return;
+  }
+}
 
-      case ams_unseen:
-        AM_drawMline(&l, mapcolor_p->unsn);
-        continue;
+static void AM_drawWalls(void)
+{
+  int i;
+  int count;
+  int hide_locks;
 
-      default:
-        continue;
-    }
+  hide_locks = map_blinking_locks && (gametic & 16);
+
+  // draw the unclipped visible portions of all lines
+  count = AM_GridQuery(&am_line_grid, am_dynamic_lines, am_dynamic_line_count);
+
+  if (count < 0)
+  {
+    for (i = 0; i < numlines; i++)
+      AM_drawWall(i, hide_locks);
+  }
+  else
+  {
+    for (i = 0; i < count; i++)
+      AM_drawWall(am_visible[i], hide_locks);
   }
 }
 
@@ -2267,7 +2536,7 @@ static void AM_ProcessNiceThing(mobj_t* mobj, angle_t angle, fixed_t x, fixed_t
 
 static void AM_DrawNiceThings(void)
 {
-  int i;
+  int i, k, count;
   mobj_t* t;
   mpoint_t p;
   angle_t angle;
@@ -2295,9 +2564,14 @@ static void AM_DrawNiceThings(void)
   // walls
   if (dsda_RevealAutomap() == 2)
   {
+    count = (players[displayplayer].cheats & CF_NOCLIP) ?
+            -1 : AM_GridQuery(&am_sector_grid, NULL, 0);
+
     // for all sectors
-    for (i = 0; i < numsectors; i++)
+    for (k = 0; k < (count < 0 ? numsectors : count); k++)
     {
+      i = (count < 0 ? k : am_visible[k]);
+
       if (!(players[displayplayer].cheats & CF_NOCLIP) &&
         (sectors[i].bbox[BOXLEFT] > am_frame.bbox[BOXRIGHT] ||
         sectors[i].bbox[BOXRIGHT] < am_frame.bbox[BOXLEFT] ||
@@ -2372,7 +2646,7 @@ static void AM_DrawNiceThings(void)
 //
 static void AM_drawThings(void)
 {
-  int   i;
+  int   i, k, count;
   mobj_t* t;
   mline_t* lineguy = thintriangle_guy;
   int lineguylines = NUMTHINTRIANGLEGUYLINES;
@@ -2391,8 +2665,11 @@ static void AM_drawThings(void)
   if (dsda_RevealAutomap() != 2)
     return;
 
+  count = (players[displayplayer].cheats & CF_NOCLIP) ?
+          -1 : AM_GridQuery(&am_sector_grid, NULL, 0);
+
   // for all sectors
-  for (i=0;i<numsectors;i++)
+  for (k = 0; k < (count < 0 ? numsectors : count); k++)
   {
    // e6y
    // Two-pass method for better usability of automap:
@@ -2402,6 +2679,8 @@ static void AM_drawThings(void)
    int pass;
    int enemies = 0;
 
+   i = (count < 0 ? k : am_visible[k]);
+
    if (!(players[displayplayer].cheats & CF_NOCLIP) &&
      (sectors[i].bbox[BOXLEFT] > am_frame.bbox[BOXRIGHT] ||
      sectors[i].bbox[BOXRIGHT] < am_frame.bbox[BOXLEFT] ||
@@ -145,6 +145,7 @@ void M_ChangeMapTextured(void);
 void M_ChangeMapMultisamling(void);
 void AM_ResetIDDTcheat(void);
 void AM_SetMapCenter(fixed_t x, fixed_t y);
+void AM_BuildSpatialIndex(void);
 
 typedef struct am_frame_s
 {
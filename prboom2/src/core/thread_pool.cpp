@@ -41,7 +41,8 @@ static void do_work(ThreadPool::Task& work)
 	(work.deleter)(work.raw.data());
 	if (work.pseudosema)
 	{
-		work.pseudosema->fetch_sub(1, std::memory_order_relaxed);
+		// release, so the waiter sees everything the task wrote
+		work.pseudosema->fetch_sub(1, std::memory_order_release);
 	}
 }
 
@@ -301,6 +302,14 @@ void I_ThreadPoolInit(void)
 {
 	DSDA_ASSERT(g_main_threadpool == nullptr);
 	size_t thread_count = std::min(static_cast<unsigned int>(9), std::thread::hardware_concurrency());
+	bool single_threaded = dsda_Arg(dsda_arg_singlethreaded)->found;
+
+	if (dsda_Arg(dsda_arg_threads)->found)
+	{
+		thread_count = dsda_Arg(dsda_arg_threads)->value.v_int;
+		single_threaded = single_threaded || thread_count == 1;
+	}
+
 	if (thread_count > 1)
 	{
 		// The main thread will act as a worker when waiting for pool idle
@@ -308,7 +317,7 @@ void I_ThreadPoolInit(void)
 		thread_count -= 1;
 	}
 
-	if (dsda_Arg(dsda_arg_singlethreaded)->found)
+	if (single_threaded)
 	{
 		g_main_threadpool = std::make_unique<ThreadPool>();
 	}
@@ -345,3 +354,51 @@ void I_ThreadPoolWaitIdle(void)
 
 	g_main_threadpool->wait_idle();
 }
+
+void I_ThreadPoolRun(dsdacthunk_t thunk, void* jobs, size_t size, int count)
+{
+	DSDA_ASSERT(g_main_threadpool != nullptr);
+
+	g_main_threadpool->begin_sema();
+	for (int i = 0; i < count; i++)
+	{
+		void* data = static_cast<char*>(jobs) + size * i;
+
+		g_main_threadpool->schedule([=]() {
+			(thunk)(data);
+		});
+	}
+	ThreadPool::Sema sema = g_main_threadpool->end_sema();
+
+	g_main_threadpool->notify_sema(sema);
+	g_main_threadpool->wait_sema(sema);
+}
+
+struct thread_pool_task_s
+{
+	ThreadPool::Sema sema;
+};
+
+thread_pool_task_t* I_ThreadPoolStart(dsdacthunk_t thunk, void* data)
+{
+	DSDA_ASSERT(g_main_threadpool != nullptr);
+
+	thread_pool_task_t* task = new thread_pool_task_t;
+
+	g_main_threadpool->begin_sema();
+	g_main_threadpool->schedule([=]() {
+		(thunk)(data);
+	});
+	task->sema = g_main_threadpool->end_sema();
+	g_main_threadpool->notify_sema(task->sema);
+
+	return task;
+}
+
+void I_ThreadPoolFinish(thread_pool_task_t* task)
+{
+	DSDA_ASSERT(g_main_threadpool != nullptr);
+
+	g_main_threadpool->wait_sema(task->sema);
+	delete task;
+}
@@ -190,6 +190,15 @@ void I_ThreadPoolShutdown(void);
 void I_ThreadPoolSubmit(dsdacthunk_t thunk, void* data);
 void I_ThreadPoolWaitIdle(void);
 
+// Runs the thunk on count jobs of size bytes each, returns once all of
+// them have finished
+void I_ThreadPoolRun(dsdacthunk_t thunk, void* jobs, size_t size, int count);
+
+// Runs the thunk in the background, I_ThreadPoolFinish waits for it
+typedef struct thread_pool_task_s thread_pool_task_t;
+thread_pool_task_t* I_ThreadPoolStart(dsdacthunk_t thunk, void* data);
+void I_ThreadPoolFinish(thread_pool_task_t* task);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
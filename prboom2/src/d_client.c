@@ -61,6 +61,7 @@
 #include "e6y.h"
 
 #include "dsda/args.h"
+#include "dsda/pipeline.h"
 #include "dsda/settings.h"
 #include "dsda/time.h"
 
@@ -144,9 +145,11 @@ void TryRunTics (void)
   while (runtics--) {
     if (advancedemo)
       D_DoAdvanceDemo ();
+    dsda_PipelineTicStart();
     M_Ticker ();
     G_Ticker ();
     gametic++;
+    dsda_PipelineTicEnd();
     FakeNetUpdate();
   }
 }
@@ -97,6 +97,7 @@
 #include "dsda/mobjinfo.h"
 #include "dsda/options.h"
 #include "dsda/pause.h"
+#include "dsda/pipeline.h"
 #include "dsda/playback.h"
 #include "dsda/preferences.h"
 #include "dsda/render_stats.h"
@@ -378,6 +379,8 @@ void D_Display (fixed_t frac)
   dboolean wipe;
   dboolean viewactive = false, isborder = false;
 
+  dsda_PipelineFrameStart();
+
   // e6y
   if (dsda_SkipMode())
   {
@@ -394,7 +397,15 @@ void D_Display (fixed_t frac)
 
   if (!dsda_SkipMode() || !dsda_InputActive(dsda_input_use))
     if (nodrawers)                    // for comparative timing / profiling
+    {
+      // sound only capture takes the frames a drawn capture would
+      if (capturing_video)
+      {
+        wipegamestate = gamestate;
+        I_HandleCapture();
+      }
       return;
+    }
 
   if (!I_StartDisplay())
     return;
@@ -538,11 +549,12 @@ void D_Display (fixed_t frac)
 
   // normal update
   if (!wipe)
-    I_FinishUpdate ();              // page flip or blit buffer
+    dsda_PipelinePresent();         // page flip or blit buffer
   else {
     // wipe update
     wipe_EndScreen();
     D_Wipe();
+    dsda_PipelineSkipFrame();
   }
 
   // e6y
@@ -588,12 +600,14 @@ static void D_DoomLoop(void)
       G_BuildTiccmd (&local_cmds[consoleplayer][maketic%BACKUPTICS]);
       if (advancedemo)
         D_DoAdvanceDemo ();
+      dsda_PipelineTicStart();
       M_Ticker ();
       G_Ticker ();
       gametic++;
       maketic++;
+      dsda_PipelineTicEnd();
     }
-    else
+    else if (!dsda_PipelineRanTics()) // tics already run while presenting
       TryRunTics (); // will run at least one tic
 
     // killough 3/16/98: change consoleplayer to displayplayer
@@ -893,6 +907,19 @@ void D_AddFile (const char *file, wad_source_t source)
     AddDefaultExtension(strcpy(Z_Malloc(strlen(file)+5), file), ".wad");
   wadfiles[numwadfiles].src = source; // Ty 08/29/98
   wadfiles[numwadfiles].handle = 0;
+  wadfiles[numwadfiles].archive = NULL;
+  wadfiles[numwadfiles].archive_offset = 0;
+
+  {
+    const char *archive;
+    int64_t offset;
+
+    if (dsda_ZipStoredWad(wadfiles[numwadfiles].name, &archive, &offset))
+    {
+      wadfiles[numwadfiles].archive = Z_Strdup(archive);
+      wadfiles[numwadfiles].archive_offset = offset;
+    }
+  }
 
   // No Rest For The Living
   len=strlen(wadfiles[numwadfiles].name);
@@ -1374,24 +1401,40 @@ static void D_ProcessDehAutoloadQueue(deh_queue_t *queue)
 
 // Load all WAD files from the given directory.
 
+// Wads read in place from a zip aren't in the directory, so they are
+// merged into the listing in the same order.
+
 static void LoadWADsAtPath(const char *path, wad_source_t source)
 {
     glob_t *glob;
     const char *filename;
+    const char **stored;
+    int stored_count, stored_index = 0;
+
+    stored = dsda_ZipStoredWadsAtPath(path, &stored_count);
 
     glob = I_StartMultiGlob(path, GLOB_FLAG_NOCASE|GLOB_FLAG_SORTED,
                             "*.wad", "*.lmp", NULL);
+    filename = I_NextGlob(glob);
     for (;;)
     {
-        filename = I_NextGlob(glob);
+        if (stored_index < stored_count &&
+            (filename == NULL || strcasecmp(stored[stored_index], filename) < 0))
+        {
+            D_AddFile(stored[stored_index++], source);
+            continue;
+        }
+
         if (filename == NULL)
         {
             break;
         }
         D_AddFile(filename, source);
+        filename = I_NextGlob(glob);
     }
 
     I_EndGlob(glob);
+    Z_Free(stored);
 }
 
 static void LoadDehackedFilesAtPath(const char *path, dboolean defer_loading, deh_queue_t *deh_queue)
@@ -1929,6 +1972,13 @@ static void D_DoomMainSetup(void)
     I_SafeExit(0);
   }
 
+  arg = dsda_Arg(dsda_arg_recover_demo);
+  if (arg->found)
+  {
+    dsda_RecoverDemo(arg->value.v_string);
+    I_SafeExit(0);
+  }
+
   // CPhipps - autoloading of wads
   autoload = !dsda_Flag(dsda_arg_noautoload);
 
@@ -2245,6 +2295,8 @@ static void D_DoomMainSetup(void)
   // do not try to interpolate during timedemo
   M_ChangeUncappedFrameRate();
 
+  dsda_InitPipeline();
+
   lprintf(LO_DEBUG, "\n"); // Separator after setup
 }
 
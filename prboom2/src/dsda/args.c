@@ -698,6 +698,111 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "single thread span drawers",
     arg_null,
   },
+  [dsda_arg_simd] = {
+    "-simd", NULL, NULL,
+    "forces the software drawer instruction set (none, sse4.1, avx2)",
+    arg_string,
+  },
+  [dsda_arg_build_reject] = {
+    "-buildreject", NULL, NULL,
+    "builds a REJECT table in the background for maps without one",
+    arg_null,
+  },
+  [dsda_arg_acs_profile] = {
+    "-acsprofile", NULL, NULL,
+    "reports the ACS instruction throughput on exit",
+    arg_null,
+  },
+  [dsda_arg_opl_benchmark] = {
+    "-oplbenchmark", NULL, NULL,
+    "renders every song lump through the OPL synth and reports timings",
+    arg_null,
+  },
+  [dsda_arg_span_benchmark] = {
+    "-spanbenchmark", NULL, NULL,
+    "times the vectorized span drawers against the scalar one and reports the results",
+    arg_null,
+  },
+  [dsda_arg_demo_journal] = {
+    "-demojournal", NULL, NULL,
+    "streams the demo being recorded to a crash-safe journal file",
+    arg_null,
+  },
+  [dsda_arg_recover_demo] = {
+    "-recoverdemo", NULL, NULL,
+    "rebuilds a playable demo from a demo journal file and exits",
+    arg_string,
+  },
+  [dsda_arg_level_profile] = {
+    "-levelprofile", NULL, NULL,
+    "reports how long each stage of level loading takes",
+    arg_null,
+  },
+  [dsda_arg_present_sim] = {
+    "-presentsim", NULL, NULL,
+    "simulates due tics while the finished frame is presented",
+    arg_null,
+  },
+  [dsda_arg_pipeline_report] = {
+    "-pipelinereport", NULL, NULL,
+    "reports frame throughput and input latency on exit",
+    arg_null,
+  },
+  [dsda_arg_frame_times] = {
+    "-frametimes", NULL, NULL,
+    "writes the frame times of each level to <name>-<map>.csv",
+    arg_string,
+  },
+  [dsda_arg_threads] = {
+    "-threads", NULL, NULL,
+    "sets the number of threads used for parallel work, including the main thread",
+    arg_int, 1, 64,
+  },
+  [dsda_arg_benchmark] = {
+    "-benchmark", NULL, NULL,
+    "runs the timed demos listed in the given manifest and writes the results as json",
+    arg_string,
+  },
+  [dsda_arg_benchmark_baseline] = {
+    "-benchmarkbaseline", NULL, NULL,
+    "compares the benchmark results against the given results file",
+    arg_string,
+  },
+  [dsda_arg_benchmark_threshold] = {
+    "-benchmarkthreshold", NULL, NULL,
+    "sets the slowdown in percent that counts as a benchmark regression (default 5)",
+    arg_int, 0, 1000,
+  },
+  [dsda_arg_benchmark_run] = {
+    "-benchmarkrun", NULL, NULL,
+    "writes per-level frame time statistics of a timed demo to the given file",
+    arg_string,
+  },
+  [dsda_arg_frame_dump] = {
+    "-framedump", NULL, NULL,
+    "writes every presented frame as an image to the given directory",
+    arg_string,
+  },
+  [dsda_arg_frame_dump_format] = {
+    "-framedumpformat", NULL, NULL,
+    "sets the frame dump format: bmp, tga, png or raw (8-bit indexed with palette)",
+    arg_string,
+  },
+  [dsda_arg_render_jobs] = {
+    "-renderjobs", NULL, NULL,
+    "renders the -viddump video of a -timedemo in the given number of parallel processes",
+    arg_int, 2, 64,
+  },
+  [dsda_arg_render_dir] = {
+    "-renderdir", NULL, NULL,
+    "keeps the key frames and segments of a parallel render in the given directory",
+    arg_string,
+  },
+  [dsda_arg_render_segment] = {
+    "-rendersegment", NULL, NULL,
+    "renders the given segment of the parallel render in -renderdir",
+    arg_int, 0, 63,
+  },
 };
 
 static dsda_arg_t arg_value[dsda_arg_count];
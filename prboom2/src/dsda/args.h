@@ -154,6 +154,27 @@ typedef enum {
   dsda_arg_reset_monsterspawner_params_after_loading,
   dsda_arg_debug_mapinfo,
   dsda_arg_singlethreaded,
+  dsda_arg_simd,
+  dsda_arg_build_reject,
+  dsda_arg_acs_profile,
+  dsda_arg_opl_benchmark,
+  dsda_arg_span_benchmark,
+  dsda_arg_demo_journal,
+  dsda_arg_recover_demo,
+  dsda_arg_level_profile,
+  dsda_arg_present_sim,
+  dsda_arg_pipeline_report,
+  dsda_arg_frame_times,
+  dsda_arg_threads,
+  dsda_arg_benchmark,
+  dsda_arg_benchmark_baseline,
+  dsda_arg_benchmark_threshold,
+  dsda_arg_benchmark_run,
+  dsda_arg_frame_dump,
+  dsda_arg_frame_dump_format,
+  dsda_arg_render_jobs,
+  dsda_arg_render_dir,
+  dsda_arg_render_segment,
   dsda_arg_count,
 } dsda_arg_identifier_t;
 
@@ -0,0 +1,758 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Benchmark
+//
+//  -benchmark <manifest> runs a suite of timed demos and writes the results
+//  next to the manifest as json. Each line of the manifest is one entry of
+//  key=value pairs:
+//
+//    name=sunlust-gl iwad=doom2.wad file=sunlust.wad demo=sl01.lmp
+//      resolution=1920x1080 renderer=gl threads=4 runs=3 warmup=1
+//
+//  Only iwad and demo are required; file may be repeated. Lines starting
+//  with # are comments. Every run is a separate process that plays the demo
+//  with -timedemo and -benchmarkrun, which writes the frame time statistics
+//  of each level. Warmup runs are discarded, and the results hold the median
+//  of the measured runs. With -benchmarkbaseline, the mean and 99th
+//  percentile frame times of each level are compared against an earlier
+//  results file, and a slowdown beyond -benchmarkthreshold percent is
+//  reported as a regression.
+//
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "i_main.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/utility.h"
+
+#include "benchmark.h"
+
+#define BENCHMARK_MAX_RUNS 32
+#define BENCHMARK_DEFAULT_RUNS 3
+#define BENCHMARK_DEFAULT_WARMUP 1
+#define BENCHMARK_DEFAULT_THRESHOLD 5
+
+typedef enum {
+  benchmark_mean,
+  benchmark_median,
+  benchmark_p90,
+  benchmark_p99,
+  benchmark_p999,
+  benchmark_sim,
+  benchmark_render,
+  benchmark_present,
+  benchmark_stat_count,
+} benchmark_stat_t;
+
+static const char* benchmark_stat_names[benchmark_stat_count] = {
+  [benchmark_mean] = "mean_ms",
+  [benchmark_median] = "median_ms",
+  [benchmark_p90] = "p90_ms",
+  [benchmark_p99] = "p99_ms",
+  [benchmark_p999] = "p999_ms",
+  [benchmark_sim] = "sim_ms",
+  [benchmark_render] = "render_ms",
+  [benchmark_present] = "present_ms",
+};
+
+// Only these are compared against the baseline
+static const benchmark_stat_t benchmark_compared_stats[] = {
+  benchmark_mean,
+  benchmark_p99,
+};
+
+typedef struct {
+  char* map;
+  int frames;
+  double stat[benchmark_stat_count];
+} benchmark_level_t;
+
+typedef struct {
+  char* map;
+  int frames;
+  int runs;
+  double stat[benchmark_stat_count][BENCHMARK_MAX_RUNS];
+} benchmark_level_result_t;
+
+typedef struct {
+  const char* name;
+  const char* iwad;
+  const char* demo;
+  const char* resolution;
+  const char* renderer;
+  const char** files;
+  int file_count;
+  int threads;
+  int runs;
+  int warmup;
+
+  benchmark_level_result_t* levels;
+  int level_count;
+  double fps[BENCHMARK_MAX_RUNS];
+  int completed_runs;
+  int failed_runs;
+} benchmark_entry_t;
+
+typedef struct {
+  char* name;
+  char* map;
+  double stat[benchmark_stat_count];
+} benchmark_baseline_t;
+
+// Levels of the timed demo played in this process
+static benchmark_level_t* run_levels;
+static int run_level_count;
+
+static benchmark_entry_t* entries;
+static int entry_count;
+
+static benchmark_baseline_t* baseline;
+static int baseline_count;
+
+void dsda_AddBenchmarkLevel(const char* map, const dsda_frame_time_stats_t* stats) {
+  benchmark_level_t* level;
+
+  run_levels = Z_Realloc(run_levels, (run_level_count + 1) * sizeof(*run_levels));
+  level = &run_levels[run_level_count++];
+
+  level->map = Z_Strdup(map);
+  level->frames = stats->frames;
+  level->stat[benchmark_mean] = stats->average_ms;
+  level->stat[benchmark_median] = stats->median_ms;
+  level->stat[benchmark_p90] = stats->p90_ms;
+  level->stat[benchmark_p99] = stats->p99_ms;
+  level->stat[benchmark_p999] = stats->p999_ms;
+  level->stat[benchmark_sim] = stats->sim_ms;
+  level->stat[benchmark_render] = stats->render_ms;
+  level->stat[benchmark_present] = stats->present_ms;
+}
+
+// Each line is "total <gametics> <realtics>" or
+//   "level <map> <frames> <stats...>" in the order of benchmark_stat_t
+void dsda_WriteBenchmarkRun(int gametics, int realtics) {
+  dsda_arg_t* arg;
+  FILE* file;
+  int i, j;
+
+  arg = dsda_Arg(dsda_arg_benchmark_run);
+
+  if (!arg->found)
+    return;
+
+  file = M_OpenFile(arg->value.v_string, "wb");
+
+  if (!file) {
+    lprintf(LO_WARN, "dsda_WriteBenchmarkRun: unable to write %s\n", arg->value.v_string);
+    return;
+  }
+
+  fprintf(file, "total %d %d\n", gametics, realtics);
+
+  for (i = 0; i < run_level_count; i++) {
+    fprintf(file, "level %s %d", run_levels[i].map, run_levels[i].frames);
+
+    for (j = 0; j < benchmark_stat_count; j++)
+      fprintf(file, " %.4f", run_levels[i].stat[j]);
+
+    fprintf(file, "\n");
+  }
+
+  fclose(file);
+}
+
+static int dsda_CompareDoubles(const void* a, const void* b) {
+  double x = *(const double*) a;
+  double y = *(const double*) b;
+
+  return (x > y) - (x < y);
+}
+
+static double dsda_MedianOfRuns(const double* values, int count) {
+  double sorted[BENCHMARK_MAX_RUNS];
+
+  if (!count)
+    return 0;
+
+  memcpy(sorted, values, count * sizeof(*sorted));
+  qsort(sorted, count, sizeof(*sorted), dsda_CompareDoubles);
+
+  if (count & 1)
+    return sorted[count / 2];
+
+  return (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+static int dsda_BenchmarkArgInt(const char* key, const char* value, int min, int max) {
+  int result;
+
+  if (sscanf(value, "%d", &result) != 1 || result < min || result > max)
+    I_Error("dsda_RunBenchmark: %s must be between %d and %d", key, min, max);
+
+  return result;
+}
+
+static void dsda_ParseBenchmarkEntry(char* line) {
+  benchmark_entry_t* entry;
+  char** tokens;
+  int i;
+
+  entries = Z_Realloc(entries, (entry_count + 1) * sizeof(*entries));
+  entry = &entries[entry_count++];
+  memset(entry, 0, sizeof(*entry));
+
+  entry->runs = BENCHMARK_DEFAULT_RUNS;
+  entry->warmup = BENCHMARK_DEFAULT_WARMUP;
+
+  tokens = dsda_SplitString(line, " ");
+
+  for (i = 0; tokens[i]; i++) {
+    char* key = tokens[i];
+    char* value;
+
+    value = strchr(key, '=');
+
+    if (!value)
+      I_Error("dsda_RunBenchmark: expected key=value, found \"%s\"", key);
+
+    *value++ = '\0';
+
+    if (!strcmp(key, "name"))
+      entry->name = value;
+    else if (!strcmp(key, "iwad"))
+      entry->iwad = value;
+    else if (!strcmp(key, "file")) {
+      entry->files = Z_Realloc(entry->files, (entry->file_count + 1) * sizeof(*entry->files));
+      entry->files[entry->file_count++] = value;
+    }
+    else if (!strcmp(key, "demo"))
+      entry->demo = value;
+    else if (!strcmp(key, "resolution"))
+      entry->resolution = value;
+    else if (!strcmp(key, "renderer"))
+      entry->renderer = value;
+    else if (!strcmp(key, "threads"))
+      entry->threads = dsda_BenchmarkArgInt(key, value, 1, 64);
+    else if (!strcmp(key, "runs"))
+      entry->runs = dsda_BenchmarkArgInt(key, value, 1, BENCHMARK_MAX_RUNS);
+    else if (!strcmp(key, "warmup"))
+      entry->warmup = dsda_BenchmarkArgInt(key, value, 0, BENCHMARK_MAX_RUNS);
+    else
+      I_Error("dsda_RunBenchmark: unknown key \"%s\"", key);
+  }
+
+  Z_Free(tokens);
+
+  if (!entry->iwad || !entry->demo)
+    I_Error("dsda_RunBenchmark: entry %d needs an iwad and a demo", entry_count);
+
+  if (!entry->name)
+    entry->name = dsda_BaseName(entry->demo);
+}
+
+static void dsda_ParseBenchmarkManifest(char* text) {
+  char** lines;
+  int i;
+
+  lines = dsda_SplitString(text, "\n");
+
+  for (i = 0; lines[i]; i++) {
+    char* line = lines[i];
+    char* end;
+
+    while (isspace((unsigned char) *line))
+      line++;
+
+    end = line + strlen(line);
+    while (end > line && isspace((unsigned char) end[-1]))
+      *--end = '\0';
+
+    if (!*line || *line == '#')
+      continue;
+
+    for (end = line; *end; end++)
+      if (*end == '\t')
+        *end = ' ';
+
+    dsda_ParseBenchmarkEntry(line);
+  }
+
+  Z_Free(lines);
+}
+
+static int dsda_RunBenchmarkProcess(const benchmark_entry_t* entry, const char* run_file) {
+  extern char** dsda_argv;
+
+  char** argv;
+  char threads[16];
+  int argc = 0;
+  int i, result;
+
+  argv = Z_Calloc(16 + entry->file_count, sizeof(*argv));
+
+  argv[argc++] = dsda_argv[0];
+  argv[argc++] = "-iwad";
+  argv[argc++] = (char*) entry->iwad;
+
+  if (entry->file_count) {
+    argv[argc++] = "-file";
+
+    for (i = 0; i < entry->file_count; i++)
+      argv[argc++] = (char*) entry->files[i];
+  }
+
+  argv[argc++] = "-timedemo";
+  argv[argc++] = (char*) entry->demo;
+
+  if (entry->resolution) {
+    argv[argc++] = "-geom";
+    argv[argc++] = (char*) entry->resolution;
+  }
+
+  if (entry->renderer) {
+    argv[argc++] = "-vidmode";
+    argv[argc++] = (char*) entry->renderer;
+  }
+
+  if (entry->threads) {
+    snprintf(threads, sizeof(threads), "%d", entry->threads);
+    argv[argc++] = "-threads";
+    argv[argc++] = threads;
+  }
+
+  argv[argc++] = "-nosound";
+  argv[argc++] = "-benchmarkrun";
+  argv[argc++] = (char*) run_file;
+
+  result = I_RunProcess(argv);
+
+  Z_Free(argv);
+
+  return result;
+}
+
+static benchmark_level_result_t* dsda_BenchmarkLevelResult(benchmark_entry_t* entry, const char* map) {
+  benchmark_level_result_t* level;
+  int i;
+
+  for (i = 0; i < entry->level_count; i++)
+    if (!strcmp(entry->levels[i].map, map))
+      return &entry->levels[i];
+
+  entry->levels = Z_Realloc(entry->levels, (entry->level_count + 1) * sizeof(*entry->levels));
+  level = &entry->levels[entry->level_count++];
+  memset(level, 0, sizeof(*level));
+  level->map = Z_Strdup(map);
+
+  return level;
+}
+
+static dboolean dsda_ReadBenchmarkRun(benchmark_entry_t* entry, const char* run_file) {
+  char* text;
+  char** lines;
+  dboolean valid = false;
+  int i, j;
+
+  if (M_ReadFileToString(run_file, &text) < 0)
+    return false;
+
+  lines = dsda_SplitString(text, "\n");
+
+  for (i = 0; lines[i]; i++) {
+    double stat[benchmark_stat_count];
+    char map[64];
+    int frames, gametics, realtics;
+
+    if (sscanf(lines[i], "total %d %d", &gametics, &realtics) == 2) {
+      entry->fps[entry->completed_runs] = realtics ? (double) gametics * TICRATE / realtics : 0;
+      valid = true;
+    }
+    else if (sscanf(lines[i], "level %63s %d %lf %lf %lf %lf %lf %lf %lf %lf",
+                    map, &frames, &stat[0], &stat[1], &stat[2], &stat[3],
+                    &stat[4], &stat[5], &stat[6], &stat[7]) == 2 + benchmark_stat_count) {
+      benchmark_level_result_t* level;
+
+      level = dsda_BenchmarkLevelResult(entry, map);
+
+      if (level->runs < BENCHMARK_MAX_RUNS) {
+        for (j = 0; j < benchmark_stat_count; j++)
+          level->stat[j][level->runs] = stat[j];
+
+        level->frames = frames;
+        level->runs++;
+      }
+    }
+  }
+
+  Z_Free(lines);
+  Z_Free(text);
+
+  return valid;
+}
+
+static void dsda_RunBenchmarkEntry(benchmark_entry_t* entry, const char* run_file) {
+  int run;
+
+  for (run = 0; run < entry->warmup + entry->runs; run++) {
+    dboolean warmup = run < entry->warmup;
+    int result;
+
+    lprintf(LO_INFO, "Benchmark %s: %s run %d\n", entry->name,
+            warmup ? "warmup" : "measured", warmup ? run + 1 : run - entry->warmup + 1);
+
+    M_remove(run_file);
+
+    result = dsda_RunBenchmarkProcess(entry, run_file);
+
+    if (warmup)
+      continue;
+
+    if (result || !dsda_ReadBenchmarkRun(entry, run_file)) {
+      lprintf(LO_WARN, "Benchmark %s: run failed (exit code %d)\n", entry->name, result);
+      entry->failed_runs++;
+      continue;
+    }
+
+    entry->completed_runs++;
+  }
+
+  M_remove(run_file);
+}
+
+// Reads the values back out of a results file written by this module,
+//   relying on the order of the keys rather than parsing the json
+static void dsda_LoadBenchmarkBaseline(const char* path) {
+  char* text;
+  char* p;
+  char* name = NULL;
+  benchmark_baseline_t* current = NULL;
+
+  if (M_ReadFileToString(path, &text) < 0)
+    I_Error("dsda_RunBenchmark: unable to read baseline %s", path);
+
+  p = text;
+
+  while ((p = strchr(p, '"'))) {
+    char* key = p + 1;
+    char* end;
+
+    end = strchr(key, '"');
+    if (!end)
+      break;
+
+    *end = '\0';
+    p = end + 1;
+
+    while (isspace((unsigned char) *p))
+      p++;
+
+    // Not a key, but a string in an array
+    if (*p != ':')
+      continue;
+
+    p++;
+    while (isspace((unsigned char) *p))
+      p++;
+
+    if (*p == '"') {
+      char* value = p + 1;
+
+      end = strchr(value, '"');
+      if (!end)
+        break;
+
+      *end = '\0';
+      p = end + 1;
+
+      if (!strcmp(key, "name")) {
+        name = value;
+        current = NULL;
+      }
+      else if (!strcmp(key, "map") && name) {
+        baseline = Z_Realloc(baseline, (baseline_count + 1) * sizeof(*baseline));
+        current = &baseline[baseline_count++];
+        memset(current, 0, sizeof(*current));
+        current->name = Z_Strdup(name);
+        current->map = Z_Strdup(value);
+      }
+    }
+    else if (current) {
+      double value;
+      int i;
+
+      value = strtod(p, &end);
+      if (end == p)
+        continue;
+
+      p = end;
+
+      for (i = 0; i < benchmark_stat_count; i++)
+        if (!strcmp(key, benchmark_stat_names[i]))
+          current->stat[i] = value;
+    }
+  }
+
+  Z_Free(text);
+}
+
+static const benchmark_baseline_t* dsda_FindBenchmarkBaseline(const char* name, const char* map) {
+  int i;
+
+  for (i = 0; i < baseline_count; i++)
+    if (!strcmp(baseline[i].name, name) && !strcmp(baseline[i].map, map))
+      return &baseline[i];
+
+  return NULL;
+}
+
+static void dsda_WriteJSONString(FILE* file, const char* str) {
+  fputc('"', file);
+
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\')
+      fprintf(file, "\\%c", *str);
+    else if ((unsigned char) *str < 0x20)
+      fprintf(file, "\\u%04x", (unsigned char) *str);
+    else
+      fputc(*str, file);
+  }
+
+  fputc('"', file);
+}
+
+static void dsda_WriteJSONField(FILE* file, int indent, const char* key, const char* value) {
+  fprintf(file, "%*s\"%s\": ", indent, "", key);
+
+  if (value)
+    dsda_WriteJSONString(file, value);
+  else
+    fprintf(file, "null");
+
+  fprintf(file, ",\n");
+}
+
+static void dsda_WriteBenchmarkLevel(FILE* file, const benchmark_level_result_t* level) {
+  int i, j;
+
+  fprintf(file, "        {\n");
+  dsda_WriteJSONField(file, 10, "map", level->map);
+  fprintf(file, "          \"frames\": %d,\n", level->frames);
+  fprintf(file, "          \"runs\": %d,\n", level->runs);
+
+  for (i = 0; i < benchmark_stat_count; i++)
+    fprintf(file, "          \"%s\": %.4f,\n", benchmark_stat_names[i],
+            dsda_MedianOfRuns(level->stat[i], level->runs));
+
+  fprintf(file, "          \"run_mean_ms\": [");
+  for (j = 0; j < level->runs; j++)
+    fprintf(file, "%s%.4f", j ? ", " : "", level->stat[benchmark_mean][j]);
+  fprintf(file, "]\n");
+
+  fprintf(file, "        }");
+}
+
+static void dsda_WriteBenchmarkEntry(FILE* file, const benchmark_entry_t* entry) {
+  int i;
+
+  fprintf(file, "    {\n");
+  dsda_WriteJSONField(file, 6, "name", entry->name);
+  dsda_WriteJSONField(file, 6, "iwad", entry->iwad);
+
+  fprintf(file, "      \"files\": [");
+  for (i = 0; i < entry->file_count; i++) {
+    fprintf(file, "%s", i ? ", " : "");
+    dsda_WriteJSONString(file, entry->files[i]);
+  }
+  fprintf(file, "],\n");
+
+  dsda_WriteJSONField(file, 6, "demo", entry->demo);
+  dsda_WriteJSONField(file, 6, "resolution", entry->resolution);
+  dsda_WriteJSONField(file, 6, "renderer", entry->renderer);
+  fprintf(file, "      \"threads\": %d,\n", entry->threads);
+  fprintf(file, "      \"warmup\": %d,\n", entry->warmup);
+  fprintf(file, "      \"runs\": %d,\n", entry->completed_runs);
+  fprintf(file, "      \"failed_runs\": %d,\n", entry->failed_runs);
+  fprintf(file, "      \"fps\": %.2f,\n", dsda_MedianOfRuns(entry->fps, entry->completed_runs));
+  fprintf(file, "      \"maps\": [\n");
+
+  for (i = 0; i < entry->level_count; i++) {
+    dsda_WriteBenchmarkLevel(file, &entry->levels[i]);
+    fprintf(file, "%s\n", i < entry->level_count - 1 ? "," : "");
+  }
+
+  fprintf(file, "      ]\n");
+  fprintf(file, "    }");
+}
+
+static int dsda_CompareBenchmarkBaseline(FILE* file, int threshold) {
+  int regressions = 0;
+  int i, j, k;
+
+  for (i = 0; i < entry_count; i++) {
+    const benchmark_entry_t* entry = &entries[i];
+
+    for (j = 0; j < entry->level_count; j++) {
+      const benchmark_level_result_t* level = &entry->levels[j];
+      const benchmark_baseline_t* base;
+
+      base = dsda_FindBenchmarkBaseline(entry->name, level->map);
+
+      if (!base)
+        continue;
+
+      for (k = 0; k < (int) (sizeof(benchmark_compared_stats) / sizeof(*benchmark_compared_stats)); k++) {
+        benchmark_stat_t stat = benchmark_compared_stats[k];
+        double current, change;
+
+        current = dsda_MedianOfRuns(level->stat[stat], level->runs);
+
+        if (base->stat[stat] <= 0)
+          continue;
+
+        change = (current / base->stat[stat] - 1) * 100;
+
+        if (change <= threshold)
+          continue;
+
+        lprintf(LO_WARN, "Benchmark regression: %s %s %s %.3f -> %.3f (%+.1f%%)\n",
+                entry->name, level->map, benchmark_stat_names[stat],
+                base->stat[stat], current, change);
+
+        fprintf(file, "%s\n    {\n", regressions ? "," : "");
+        dsda_WriteJSONField(file, 6, "name", entry->name);
+        dsda_WriteJSONField(file, 6, "map", level->map);
+        dsda_WriteJSONField(file, 6, "stat", benchmark_stat_names[stat]);
+        fprintf(file, "      \"baseline\": %.4f,\n", base->stat[stat]);
+        fprintf(file, "      \"current\": %.4f,\n", current);
+        fprintf(file, "      \"change_pct\": %.2f\n", change);
+        fprintf(file, "    }");
+
+        regressions++;
+      }
+    }
+  }
+
+  return regressions;
+}
+
+static void dsda_PrintBenchmarkSummary(void) {
+  int i, j;
+
+  for (i = 0; i < entry_count; i++) {
+    const benchmark_entry_t* entry = &entries[i];
+
+    lprintf(LO_INFO, "%s: %.1f fps over %d runs\n", entry->name,
+            dsda_MedianOfRuns(entry->fps, entry->completed_runs), entry->completed_runs);
+
+    for (j = 0; j < entry->level_count; j++) {
+      const benchmark_level_result_t* level = &entry->levels[j];
+
+      lprintf(LO_INFO, "  %-8s mean %7.3f  p99 %7.3f  p99.9 %7.3f  sim %6.3f  render %6.3f  present %6.3f\n",
+              level->map,
+              dsda_MedianOfRuns(level->stat[benchmark_mean], level->runs),
+              dsda_MedianOfRuns(level->stat[benchmark_p99], level->runs),
+              dsda_MedianOfRuns(level->stat[benchmark_p999], level->runs),
+              dsda_MedianOfRuns(level->stat[benchmark_sim], level->runs),
+              dsda_MedianOfRuns(level->stat[benchmark_render], level->runs),
+              dsda_MedianOfRuns(level->stat[benchmark_present], level->runs));
+    }
+  }
+}
+
+void dsda_RunBenchmark(void) {
+  dsda_string_t results_path;
+  dsda_string_t run_file;
+  dsda_arg_t* baseline_arg;
+  const char* manifest;
+  char* manifest_text;
+  char* base_name;
+  FILE* file;
+  int threshold;
+  int regressions = 0;
+  int i;
+
+  manifest = dsda_Arg(dsda_arg_benchmark)->value.v_string;
+
+  if (M_ReadFileToString(manifest, &manifest_text) < 0)
+    I_Error("dsda_RunBenchmark: unable to read %s", manifest);
+
+  dsda_ParseBenchmarkManifest(manifest_text);
+
+  if (!entry_count)
+    I_Error("dsda_RunBenchmark: %s has no entries", manifest);
+
+  threshold = dsda_Flag(dsda_arg_benchmark_threshold) ?
+              dsda_Arg(dsda_arg_benchmark_threshold)->value.v_int :
+              BENCHMARK_DEFAULT_THRESHOLD;
+
+  baseline_arg = dsda_Arg(dsda_arg_benchmark_baseline);
+  if (baseline_arg->found)
+    dsda_LoadBenchmarkBaseline(baseline_arg->value.v_string);
+
+  base_name = Z_Strdup(manifest);
+  dsda_CutExtension(base_name);
+  dsda_StringPrintF(&results_path, "%s.json", base_name);
+  dsda_StringPrintF(&run_file, "%s.run", base_name);
+  Z_Free(base_name);
+
+  for (i = 0; i < entry_count; i++)
+    dsda_RunBenchmarkEntry(&entries[i], run_file.string);
+
+  file = M_OpenFile(results_path.string, "wb");
+
+  if (!file)
+    I_Error("dsda_RunBenchmark: unable to write %s", results_path.string);
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"threshold_pct\": %d,\n", threshold);
+  fprintf(file, "  \"entries\": [\n");
+
+  for (i = 0; i < entry_count; i++) {
+    dsda_WriteBenchmarkEntry(file, &entries[i]);
+    fprintf(file, "%s\n", i < entry_count - 1 ? "," : "");
+  }
+
+  fprintf(file, "  ],\n");
+  fprintf(file, "  \"regressions\": [");
+
+  if (baseline_count)
+    regressions = dsda_CompareBenchmarkBaseline(file, threshold);
+
+  fprintf(file, "%s]\n", regressions ? "\n  " : "");
+  fprintf(file, "}\n");
+
+  fclose(file);
+
+  dsda_PrintBenchmarkSummary();
+
+  lprintf(LO_INFO, "Benchmark results written to %s\n", results_path.string);
+
+  if (baseline_arg->found)
+    lprintf(LO_INFO, "%d regressions beyond %d%% against %s\n",
+            regressions, threshold, baseline_arg->value.v_string);
+
+  dsda_FreeString(&run_file);
+  dsda_FreeString(&results_path);
+
+  I_SafeExit(regressions ? 1 : 0);
+}
@@ -0,0 +1,27 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Benchmark
+//
+
+#ifndef __DSDA_BENCHMARK__
+#define __DSDA_BENCHMARK__
+
+#include "dsda/frame_times.h"
+
+void dsda_AddBenchmarkLevel(const char* map, const dsda_frame_time_stats_t* stats);
+void dsda_WriteBenchmarkRun(int gametics, int realtics);
+void dsda_RunBenchmark(void);
+
+#endif
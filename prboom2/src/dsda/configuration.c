@@ -129,6 +129,7 @@ void M_ChangeApplyPalette(void);
 void M_ChangeStretch(void);
 void M_ChangeAspectRatio(void);
 void dsda_RefreshLinearSky(void);
+void dsda_ResetDynamicResolution(void);
 void deh_changeCompTranslucency(void);
 void dsda_InitGameControllerParameters(void);
 void dsda_InitExHud(void);
@@ -358,6 +359,10 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "dsda_show_fps", dsda_config_show_fps,
     CONF_BOOL(0), NULL, NOT_STRICT, dsda_RefreshExHudFPS
   },
+  [dsda_config_show_frame_times] = {
+    "dsda_show_frame_times", dsda_config_show_frame_times,
+    CONF_BOOL(0), NULL, NOT_STRICT, dsda_RefreshExHudFrameTimes
+  },
   [dsda_config_show_minimap] = {
     "dsda_show_minimap", dsda_config_show_minimap,
     CONF_BOOL(0), NULL, STRICT_INT(0), dsda_RefreshExHudMinimap
@@ -707,6 +712,10 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "startup_delay_ms", dsda_config_startup_delay_ms,
     dsda_config_int, 0, 1000, { 0 }
   },
+  [dsda_config_mus_render_cache] = {
+    "mus_render_cache", dsda_config_mus_render_cache,
+    CONF_BOOL(0)
+  },
   [dsda_config_pitched_sounds] = {
     "pitched_sounds", dsda_config_pitched_sounds,
     CONF_BOOL(0), NULL, NOT_STRICT, I_InitSoundParams
@@ -735,6 +744,10 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "mus_pause_opt", dsda_config_mus_pause_opt,
     dsda_config_int, 0, 2, { 1 }
   },
+  [dsda_config_mus_render_ahead_ms] = {
+    "mus_render_ahead_ms", dsda_config_mus_render_ahead_ms,
+    dsda_config_int, 0, 1000, { 0 }
+  },
   [dsda_config_snd_channels] = {
     "snd_channels", dsda_config_snd_channels,
     dsda_config_int, 1, MAX_CHANNELS, { 32 }, NULL, NOT_STRICT, S_Init
@@ -827,6 +840,10 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "cap_muxcommand", dsda_config_cap_muxcommand,
     CONF_STRING("ffmpeg -i temp_v.nut -i temp_a.nut -r %r -c copy -y %f")
   },
+  [dsda_config_cap_concatcommand] = {
+    "cap_concatcommand", dsda_config_cap_concatcommand,
+    CONF_STRING("ffmpeg -f concat -safe 0 -i %l -c copy -y temp_v.nut")
+  },
   [dsda_config_cap_tempfile1] = {
     "cap_tempfile1", dsda_config_cap_tempfile1,
     CONF_STRING("temp_a.nut")
@@ -1254,6 +1271,22 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "render_parallel", dsda_config_render_parallel,
     CONF_BOOL(1), NULL, NOT_STRICT
   },
+  [dsda_config_render_dynamic_resolution] = {
+    "render_dynamic_resolution", dsda_config_render_dynamic_resolution,
+    CONF_BOOL(0), NULL, NOT_STRICT, dsda_ResetDynamicResolution
+  },
+  [dsda_config_render_dynamic_resolution_target] = {
+    "render_dynamic_resolution_target", dsda_config_render_dynamic_resolution_target,
+    dsda_config_int, 20, 500, { 60 }, NULL, NOT_STRICT, dsda_ResetDynamicResolution
+  },
+  [dsda_config_render_dynamic_resolution_min] = {
+    "render_dynamic_resolution_min", dsda_config_render_dynamic_resolution_min,
+    dsda_config_int, 25, 100, { 50 }, NULL, NOT_STRICT, dsda_ResetDynamicResolution
+  },
+  [dsda_config_render_dynamic_resolution_filter] = {
+    "render_dynamic_resolution_filter", dsda_config_render_dynamic_resolution_filter,
+    CONF_BOOL(0)
+  },
   [dsda_config_aspect_ratio_correction] = {
     "aspect_ratio_correction", dsda_config_aspect_ratio_correction,
     CONF_BOOL(1), NULL, NOT_STRICT
@@ -1262,6 +1295,10 @@ dsda_config_t dsda_config[dsda_config_count] = {
     "gl_fade_mode", dsda_config_gl_fade_mode,
     dsda_config_int, 0, 1, { 0 }
   },
+  [dsda_config_gl_flats_cache] = {
+    "gl_flats_cache", dsda_config_gl_flats_cache,
+    CONF_BOOL(0)
+  },
   [dsda_config_translucent_sprites] = {
     "boom_translucent_sprites", dsda_config_translucent_sprites,
     dsda_config_int, 0, 2, { 1 }, NULL, STRICT_INT(1), deh_changeCompTranslucency
@@ -62,6 +62,7 @@ typedef enum {
   dsda_config_coordinate_display,
   dsda_config_show_minimap,
   dsda_config_show_fps,
+  dsda_config_show_frame_times,
   dsda_config_show_level_splits,
   dsda_config_exhud,
   dsda_config_free_text,
@@ -131,6 +132,7 @@ typedef enum {
   dsda_config_gl_health_bar,
   dsda_config_gl_usevbo,
   dsda_config_gl_fade_mode,
+  dsda_config_gl_flats_cache,
   dsda_config_use_mouse,
   dsda_config_mouse_sensitivity_horiz,
   dsda_config_mouse_sensitivity_vert,
@@ -156,6 +158,8 @@ typedef enum {
   dsda_config_sfx_volume,
   dsda_config_music_volume,
   dsda_config_mus_pause_opt,
+  dsda_config_mus_render_ahead_ms,
+  dsda_config_mus_render_cache,
   dsda_config_snd_channels,
   dsda_config_snd_midiplayer,
   dsda_config_snd_mididev,
@@ -179,6 +183,7 @@ typedef enum {
   dsda_config_cap_soundcommand,
   dsda_config_cap_videocommand,
   dsda_config_cap_muxcommand,
+  dsda_config_cap_concatcommand,
   dsda_config_cap_tempfile1,
   dsda_config_cap_tempfile2,
   dsda_config_cap_remove_tempfiles,
@@ -285,6 +290,10 @@ typedef enum {
   dsda_config_render_stretchsky,
   dsda_config_render_linearsky,
   dsda_config_render_parallel,
+  dsda_config_render_dynamic_resolution,
+  dsda_config_render_dynamic_resolution_target,
+  dsda_config_render_dynamic_resolution_min,
+  dsda_config_render_dynamic_resolution_filter,
   dsda_config_aspect_ratio_correction,
   dsda_config_translucent_sprites,
   dsda_config_translucent_ghosts,
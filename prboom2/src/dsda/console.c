@@ -21,7 +21,9 @@
 #include "hu_lib.h"
 #include "hu_stuff.h"
 #include "i_main.h"
+#include "i_sound.h"
 #include "i_system.h"
+#include "i_video.h"
 #include "lprintf.h"
 #include "m_cheat.h"
 #include "m_file.h"
@@ -186,6 +188,32 @@ static dboolean console_LevelExit(const char* command, const char* args) {
   return true;
 }
 
+static dboolean console_LevelBenchmarkBlockmap(const char* command, const char* args) {
+  int runs;
+
+  if (gamestate != GS_LEVEL)
+    return false;
+
+  if (sscanf(args, "%i", &runs) != 1)
+    runs = 10;
+
+  if (runs <= 0)
+    return false;
+
+  P_BenchmarkBlockMap(runs);
+
+  return true;
+}
+
+static dboolean console_MusicUnderruns(const char* command, const char* args) {
+  int count, frames;
+
+  I_GetMusicUnderruns(&count, &frames);
+  doom_printf("Music underruns: %d (%d frames)", count, frames);
+
+  return true;
+}
+
 static dboolean console_LevelSecretExit(const char* command, const char* args) {
   void G_SecretExitLevel(int position);
 
@@ -640,6 +668,23 @@ static dboolean console_GameDescribe(const char* command, const char* args) {
   return true;
 }
 
+static dboolean console_VideoBenchmarkPalette(const char* command, const char* args) {
+  int frames;
+
+  if (!V_IsSoftwareMode())
+    return false;
+
+  if (sscanf(args, "%i", &frames) != 1)
+    frames = 100;
+
+  if (frames <= 0)
+    return false;
+
+  I_BenchmarkPaletteConversion(frames);
+
+  return true;
+}
+
 static dboolean console_TrackerAddLine(const char* command, const char* args) {
   int id;
 
@@ -2286,6 +2331,8 @@ static console_command_entry_t console_commands[] = {
 
   { "level.exit", console_LevelExit, CF_NEVER },
   { "level.secret_exit", console_LevelSecretExit, CF_NEVER },
+  { "level.benchmark_blockmap", console_LevelBenchmarkBlockmap, CF_ALWAYS },
+  { "music.underruns", console_MusicUnderruns, CF_ALWAYS },
 
   { "script.run", console_ScriptRun, CF_ALWAYS },
   { "check", console_Check, CF_ALWAYS },
@@ -2437,6 +2484,7 @@ static console_command_entry_t console_commands[] = {
 
   { "game.quit", console_GameQuit, CF_ALWAYS },
   { "game.describe", console_GameDescribe, CF_ALWAYS },
+  { "video.benchmark_palette", console_VideoBenchmarkPalette, CF_ALWAYS },
 
   // cheats
   { "idchoppers", console_BasicCheat, CF_DEMO },
@@ -32,6 +32,7 @@
 #include "dsda/args.h"
 #include "dsda/configuration.h"
 #include "dsda/data_organizer.h"
+#include "dsda/demo_journal.h"
 #include "dsda/excmd.h"
 #include "dsda/exdemo.h"
 #include "dsda/features.h"
@@ -54,7 +55,11 @@ static byte* dsda_demo_write_buffer_p;
 static int dsda_demo_write_buffer_length;
 static int dsda_extra_demo_header_data_offset;
 static int largest_real_offset;
+static int journal_offset;
+static int journal_tics;
+static dboolean journal_rewound;
 static int compatibility_level_unspecified;
+static const byte* known_demo_marker;
 
 #define DSDA_UDMF_VERSION 1
 #define DSDA_DEMO_VERSION 3
@@ -73,6 +78,9 @@ static dsda_demo_header_data_t dsda_demo_header_data;
 
 #define DEMOMARKER 0x80
 
+// Tics batched in memory before they are handed to the demo journal
+#define JOURNAL_BATCH_TICS 35
+
 #define DF_FROM_KEYFRAME   0x01
 #define DF_CASUAL_FEATURES 0x02
 
@@ -311,6 +319,13 @@ void dsda_InitDemoRecording(void) {
   dsda_demo_write_buffer_length = INITIAL_DEMO_BUFFER_SIZE;
 
   demo_tics = 0;
+
+  journal_offset = 0;
+  journal_tics = 0;
+  journal_rewound = false;
+
+  if (dsda_Flag(dsda_arg_demo_journal))
+    dsda_OpenDemoJournal(dsda_demo_name_base ? dsda_demo_name_base : "null");
 }
 
 static void dsda_SetDemoBufferOffset(int offset) {
@@ -327,9 +342,32 @@ static void dsda_SetDemoBufferOffset(int offset) {
   if (current_offset > largest_real_offset)
     largest_real_offset = current_offset;
 
+  // The next journal record replaces everything past this point
+  if (offset < journal_offset) {
+    journal_offset = offset;
+    journal_rewound = true;
+  }
+
   dsda_demo_write_buffer_p = dsda_demo_write_buffer + offset;
 }
 
+static void dsda_FlushDemoJournal(void) {
+  int offset;
+
+  offset = dsda_DemoBufferOffset();
+
+  if (offset == journal_offset && !journal_rewound)
+    return;
+
+  dsda_AppendDemoJournal(dsda_demo_write_buffer + journal_offset, journal_offset,
+                         offset - journal_offset, demo_tics,
+                         dsda_demo_version ? dsda_extra_demo_header_data_offset : -1);
+
+  journal_offset = offset;
+  journal_tics = 0;
+  journal_rewound = false;
+}
+
 void dsda_WriteToDemo(const void* buffer, size_t length) {
   dsda_EnsureDemoBufferSpace(length);
 
@@ -350,6 +388,9 @@ void dsda_WriteQueueToDemo(const void* buffer, size_t length) {
 void dsda_WriteTicToDemo(const void* buffer, size_t length) {
   dsda_WriteToDemo(buffer, length);
   ++demo_tics;
+
+  if (dsda_DemoJournalActive() && ++journal_tics >= JOURNAL_BATCH_TICS)
+    dsda_FlushDemoJournal();
 }
 
 static void dsda_WriteIntToHeader(byte** p, int value) {
@@ -570,6 +611,9 @@ void dsda_EndDemoRecording(void) {
 
   dsda_ExportDemoToFile(demo_name);
 
+  // The demo is safely on disk now
+  dsda_CloseDemoJournal(true);
+
   dsda_FreeDemoBuffer();
 
   Z_Free(demo_name);
@@ -599,6 +643,44 @@ void dsda_ExportDemo(const char* name) {
   lprintf(LO_INFO, "Demo recording exported\n");
 }
 
+// Rebuild a demo from the journal of a recording that never finished
+void dsda_RecoverDemo(const char* journal_name) {
+  byte* demo;
+  byte* header_p;
+  char* base_name;
+  char* demo_name;
+  unsigned int counter = 2;
+  int length, tics, header_offset;
+
+  demo = dsda_ReadDemoJournal(journal_name, &length, &tics, &header_offset);
+
+  if (!demo || !length)
+    I_Error("dsda_RecoverDemo: nothing to recover in %s", journal_name);
+
+  demo = Z_Realloc(demo, length + 1);
+  demo[length] = DEMOMARKER;
+
+  // The extended header is normally filled in when the demo is exported
+  if (header_offset >= 0 && header_offset + 8 <= length) {
+    header_p = demo + header_offset;
+    dsda_WriteIntToHeader(&header_p, length);
+    dsda_WriteIntToHeader(&header_p, tics);
+  }
+
+  base_name = Z_Strdup(journal_name);
+  dsda_CutExtension(base_name);
+  demo_name = dsda_GenerateDemoName(&counter, base_name);
+
+  if (!M_WriteFile(demo_name, demo, length + 1))
+    I_Error("dsda_RecoverDemo: failed to write %s", demo_name);
+
+  lprintf(LO_INFO, "Recovered demo: %s (%d tics)\n", demo_name, tics);
+
+  Z_Free(demo_name);
+  Z_Free(base_name);
+  Z_Free(demo);
+}
+
 int dsda_DemoDataSize(byte complete) {
   int buffer_size;
 
@@ -828,6 +910,15 @@ int dsda_DemoTicsCount(const byte* p, const byte* demobuffer, int demolength) {
   if (dsda_demo_version)
     return dsda_demo_header_data.demo_tics;
 
+  // The marker was already found when the demo was loaded; avoid touching
+  // every page of the tic stream a second time
+  if (
+    known_demo_marker > p &&
+    known_demo_marker < demobuffer + demolength &&
+    (known_demo_marker - p) % bytes_per_tic == 0
+  )
+    return (known_demo_marker - p) / bytes_per_tic / demo_playerscount;
+
   do {
     count++;
     p += bytes_per_tic;
@@ -836,13 +927,24 @@ int dsda_DemoTicsCount(const byte* p, const byte* demobuffer, int demolength) {
   return count / demo_playerscount;
 }
 
+// The buffer the marker points into is going away
+void dsda_ForgetDemoMarker(void) {
+  known_demo_marker = NULL;
+}
+
 const byte* dsda_DemoMarkerPosition(byte* buffer, size_t file_size) {
   const byte* p;
 
+  known_demo_marker = NULL;
+
   // read demo header
   p = G_ReadDemoHeaderEx(buffer, file_size, RDH_SKIP_HEADER);
 
   if (dsda_demo_version) {
+    if (dsda_demo_header_data.end_marker_location < 0 ||
+        (size_t) dsda_demo_header_data.end_marker_location >= file_size)
+      return NULL;
+
     p = (const byte*) (buffer + dsda_demo_header_data.end_marker_location);
 
     if (*p != DEMOMARKER)
@@ -855,8 +957,11 @@ const byte* dsda_DemoMarkerPosition(byte* buffer, size_t file_size) {
   while (p < buffer + file_size && *p != DEMOMARKER)
     p += bytes_per_tic;
 
-  if (*p != DEMOMARKER)
+  // The buffer may be a mapping that ends exactly at the file
+  if (p >= buffer + file_size)
     return NULL;
 
+  known_demo_marker = p;
+
   return p;
 }
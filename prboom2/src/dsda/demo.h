@@ -27,6 +27,7 @@ void dsda_SetDemoBaseName(const char* name);
 dboolean dsda_StartDemoSegment(const char* demo_name);
 const byte* dsda_EvaluateDemoStartPoint(const byte* demo_p);
 void dsda_ExportDemo(const char* name);
+void dsda_RecoverDemo(const char* journal_name);
 void dsda_MarkCompatibilityLevelUnspecified(void);
 int dsda_BytesPerTic(void);
 int dsda_DemoTic(void);
@@ -52,6 +53,7 @@ int dsda_DemoDataSize(byte complete);
 void dsda_StoreDemoData(byte complete);
 void dsda_RestoreDemoData(byte complete);
 int dsda_DemoTicsCount(const byte* p, const byte* demobuffer, int demolength);
+void dsda_ForgetDemoMarker(void);
 const byte* dsda_DemoMarkerPosition(byte* buffer, size_t file_size);
 
 #endif
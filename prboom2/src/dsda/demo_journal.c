@@ -0,0 +1,314 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Demo Journal
+//
+//  While recording with -demojournal, the demo buffer is mirrored to an
+//  append-only journal file next to the demo. Each record replaces the
+//  buffer from its offset onwards, which also covers rewinds from key
+//  frames. A background thread writes the records and syncs the file to
+//  disk about once a second, so a crash loses at most the last moments of
+//  the recording. The journal is removed once the demo is written.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "SDL.h"
+
+#include "lprintf.h"
+#include "m_file.h"
+#include "z_zone.h"
+
+#include "demo_journal.h"
+
+#define JOURNAL_MAGIC "DSDAJNL"
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 8
+#define JOURNAL_RECORD_HEADER_SIZE 16 // offset, length, tics, header offset
+#define JOURNAL_SYNC_MS 1000
+
+typedef struct {
+  byte* data;
+  size_t size;
+  size_t capacity;
+} journal_buffer_t;
+
+static FILE* journal_file;
+static char* journal_name;
+static SDL_Thread* journal_thread;
+static SDL_mutex* journal_mutex;
+static SDL_cond* journal_cond;
+static journal_buffer_t journal_pending;
+static dboolean journal_quit;
+
+static void dsda_WriteJournalInt(byte* p, int value) {
+  p[0] = (byte)( value        & 0xff);
+  p[1] = (byte)((value >>  8) & 0xff);
+  p[2] = (byte)((value >> 16) & 0xff);
+  p[3] = (byte)((value >> 24) & 0xff);
+}
+
+static int dsda_ReadJournalInt(const byte* p) {
+  return (int)((unsigned int) p[0] |
+               (unsigned int) p[1] << 8 |
+               (unsigned int) p[2] << 16 |
+               (unsigned int) p[3] << 24);
+}
+
+// FNV-1a, to reject a record that was only partly written
+static unsigned int dsda_JournalChecksum(const byte* data, size_t length) {
+  unsigned int hash = 2166136261u;
+
+  while (length--) {
+    hash ^= *data++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+// The pending buffer is shared with the journal thread, so it avoids the zone
+static void dsda_AppendToJournalBuffer(journal_buffer_t* buffer, const void* data, size_t length) {
+  if (buffer->size + length > buffer->capacity) {
+    while (buffer->size + length > buffer->capacity)
+      buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 0x10000;
+
+    buffer->data = realloc(buffer->data, buffer->capacity);
+
+    if (!buffer->data)
+      I_Error("dsda_AppendToJournalBuffer: out of memory!");
+  }
+
+  memcpy(buffer->data + buffer->size, data, length);
+  buffer->size += length;
+}
+
+static void dsda_SyncJournalFile(void) {
+  fflush(journal_file);
+
+#ifdef _WIN32
+  _commit(_fileno(journal_file));
+#else
+  fsync(fileno(journal_file));
+#endif
+}
+
+static int SDLCALL dsda_JournalThread(void* data) {
+  journal_buffer_t batch = { 0 };
+  dboolean quit;
+
+  do {
+    journal_buffer_t swap;
+
+    // Records pile up in the pending buffer between syncs
+    SDL_LockMutex(journal_mutex);
+
+    if (!journal_quit)
+      SDL_CondWaitTimeout(journal_cond, journal_mutex, JOURNAL_SYNC_MS);
+
+    swap = batch;
+    batch = journal_pending;
+    journal_pending = swap;
+    journal_pending.size = 0;
+    quit = journal_quit;
+
+    SDL_UnlockMutex(journal_mutex);
+
+    if (batch.size) {
+      if (fwrite(batch.data, 1, batch.size, journal_file) != batch.size)
+        lprintf(LO_WARN, "dsda_JournalThread: failed to write %s\n", journal_name);
+
+      dsda_SyncJournalFile();
+      batch.size = 0;
+    }
+  } while (!quit);
+
+  free(batch.data);
+
+  return 0;
+}
+
+dboolean dsda_DemoJournalActive(void) {
+  return journal_file != NULL;
+}
+
+void dsda_OpenDemoJournal(const char* base_name) {
+  byte header[JOURNAL_HEADER_SIZE] = JOURNAL_MAGIC;
+  size_t length;
+  int i;
+
+  if (journal_file)
+    dsda_CloseDemoJournal(false);
+
+  // Never reuse the journal of an earlier attempt, it may need recovering
+  length = strlen(base_name) + 11; // "-12345.jnl\0"
+  journal_name = Z_Malloc(length);
+  snprintf(journal_name, length, "%s.jnl", base_name);
+
+  for (i = 2; i <= 99999 && M_FileExists(journal_name); i++)
+    snprintf(journal_name, length, "%s-%05d.jnl", base_name, i);
+
+  journal_file = M_OpenFile(journal_name, "wb");
+
+  if (!journal_file) {
+    lprintf(LO_WARN, "dsda_OpenDemoJournal: unable to open %s\n", journal_name);
+    Z_Free(journal_name);
+    journal_name = NULL;
+    return;
+  }
+
+  header[JOURNAL_HEADER_SIZE - 1] = JOURNAL_VERSION;
+  fwrite(header, 1, sizeof(header), journal_file);
+
+  journal_quit = false;
+  journal_mutex = SDL_CreateMutex();
+  journal_cond = SDL_CreateCond();
+  journal_thread = SDL_CreateThread(dsda_JournalThread, "demo journal", NULL);
+
+  if (!journal_thread)
+    I_Error("dsda_OpenDemoJournal: unable to create thread (%s)", SDL_GetError());
+
+  lprintf(LO_INFO, "Journaling demo to %s\n", journal_name);
+}
+
+void dsda_AppendDemoJournal(const byte* data, int offset, int length,
+                            int demo_tics, int header_offset) {
+  byte record[JOURNAL_RECORD_HEADER_SIZE];
+  byte checksum[4];
+  unsigned int hash;
+
+  if (!journal_file)
+    return;
+
+  dsda_WriteJournalInt(record, offset);
+  dsda_WriteJournalInt(record + 4, length);
+  dsda_WriteJournalInt(record + 8, demo_tics);
+  dsda_WriteJournalInt(record + 12, header_offset);
+
+  hash = dsda_JournalChecksum(record, sizeof(record));
+  hash ^= dsda_JournalChecksum(data, length);
+  dsda_WriteJournalInt(checksum, hash);
+
+  SDL_LockMutex(journal_mutex);
+  dsda_AppendToJournalBuffer(&journal_pending, record, sizeof(record));
+  dsda_AppendToJournalBuffer(&journal_pending, data, length);
+  dsda_AppendToJournalBuffer(&journal_pending, checksum, sizeof(checksum));
+  SDL_UnlockMutex(journal_mutex);
+}
+
+void dsda_CloseDemoJournal(dboolean remove) {
+  if (!journal_file)
+    return;
+
+  SDL_LockMutex(journal_mutex);
+  journal_quit = true;
+  SDL_CondSignal(journal_cond);
+  SDL_UnlockMutex(journal_mutex);
+
+  SDL_WaitThread(journal_thread, NULL);
+  journal_thread = NULL;
+
+  SDL_DestroyCond(journal_cond);
+  SDL_DestroyMutex(journal_mutex);
+  journal_cond = NULL;
+  journal_mutex = NULL;
+
+  free(journal_pending.data);
+  memset(&journal_pending, 0, sizeof(journal_pending));
+
+  fclose(journal_file);
+  journal_file = NULL;
+
+  if (remove)
+    M_remove(journal_name);
+
+  Z_Free(journal_name);
+  journal_name = NULL;
+}
+
+byte* dsda_ReadDemoJournal(const char* name, int* length, int* demo_tics, int* header_offset) {
+  byte* journal = NULL;
+  byte* demo = NULL;
+  const byte* p;
+  const byte* end;
+  int journal_length;
+  int capacity = 0;
+  int records = 0;
+
+  *length = 0;
+  *demo_tics = 0;
+  *header_offset = -1;
+
+  journal_length = M_ReadFile(name, &journal);
+
+  if (journal_length < JOURNAL_HEADER_SIZE ||
+      memcmp(journal, JOURNAL_MAGIC, JOURNAL_HEADER_SIZE - 1) ||
+      journal[JOURNAL_HEADER_SIZE - 1] != JOURNAL_VERSION) {
+    lprintf(LO_WARN, "dsda_ReadDemoJournal: %s is not a demo journal\n", name);
+    Z_Free(journal);
+    return NULL;
+  }
+
+  p = journal + JOURNAL_HEADER_SIZE;
+  end = journal + journal_length;
+
+  while (end - p >= JOURNAL_RECORD_HEADER_SIZE + 4) {
+    int offset, record_length;
+    unsigned int hash;
+
+    offset = dsda_ReadJournalInt(p);
+    record_length = dsda_ReadJournalInt(p + 4);
+
+    if (offset < 0 || offset > *length || record_length < 0 ||
+        end - p - JOURNAL_RECORD_HEADER_SIZE - 4 < record_length)
+      break;
+
+    hash = dsda_JournalChecksum(p, JOURNAL_RECORD_HEADER_SIZE);
+    hash ^= dsda_JournalChecksum(p + JOURNAL_RECORD_HEADER_SIZE, record_length);
+
+    if (hash != (unsigned int) dsda_ReadJournalInt(p + JOURNAL_RECORD_HEADER_SIZE + record_length))
+      break;
+
+    if (offset + record_length > capacity) {
+      capacity = MAX(offset + record_length, capacity * 2);
+      demo = Z_Realloc(demo, capacity);
+    }
+
+    memcpy(demo + offset, p + JOURNAL_RECORD_HEADER_SIZE, record_length);
+    *length = offset + record_length;
+    *demo_tics = dsda_ReadJournalInt(p + 8);
+    *header_offset = dsda_ReadJournalInt(p + 12);
+
+    p += JOURNAL_RECORD_HEADER_SIZE + record_length + 4;
+    records++;
+  }
+
+  if (p != end)
+    lprintf(LO_WARN, "dsda_ReadDemoJournal: discarding %d trailing bytes\n", (int)(end - p));
+
+  lprintf(LO_INFO, "dsda_ReadDemoJournal: %d records, %d bytes, %d tics\n",
+          records, *length, *demo_tics);
+
+  Z_Free(journal);
+
+  return demo;
+}
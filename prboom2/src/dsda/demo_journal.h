@@ -0,0 +1,30 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Demo Journal
+//
+
+#ifndef __DSDA_DEMO_JOURNAL__
+#define __DSDA_DEMO_JOURNAL__
+
+#include "doomtype.h"
+
+dboolean dsda_DemoJournalActive(void);
+void dsda_OpenDemoJournal(const char* base_name);
+void dsda_AppendDemoJournal(const byte* data, int offset, int length,
+                            int demo_tics, int header_offset);
+void dsda_CloseDemoJournal(dboolean remove);
+byte* dsda_ReadDemoJournal(const char* name, int* length, int* demo_tics, int* header_offset);
+
+#endif
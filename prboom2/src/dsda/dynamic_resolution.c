@@ -0,0 +1,285 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Dynamic Resolution
+//
+//  The software renderer can draw the 3d view into a smaller buffer and
+//  upscale it into the view window, leaving the hud and status bar at
+//  the native resolution. The scale is picked from recent frames: the
+//  cost of the view is taken to follow its pixel count, and the rest of
+//  the frame's work is assumed to stay the same, so the view gets what
+//  remains of the target frame time.
+//
+
+#include <math.h>
+#include <string.h>
+
+#include "z_zone.h"
+
+#include "core/thread_pool.h"
+
+#include "dsda/configuration.h"
+
+#include "dynamic_resolution.h"
+
+#define DYNRES_STEP 5           // scales are multiples of this percent
+#define DYNRES_SETTLE_FRAMES 8  // frames to measure after a change
+#define DYNRES_HEADROOM 90      // percent of the target frame time to fill
+#define DYNRES_MAX_JOBS 8
+#define DYNRES_WEIGHT_BITS 3    // bilinear weights are in eighths
+
+typedef struct {
+  const screeninfo_t* src;
+  screeninfo_t* dest;
+  int width;
+  int first;
+  int last;
+} upscale_job_t;
+
+static int scale = 100;
+static int settle_frames;
+static double view_us_avg;
+static double work_us_avg;
+static unsigned long long frame_view_us;
+
+static byte* buffer;
+static int buffer_size;
+
+// Source position of each destination column and row: the left or top
+//   sample and its weight for bilinear filtering, and the covering sample
+static int* x_map;
+static byte* x_weight;
+static int* x_nearest;
+static int map_width;
+static int* y_map;
+static byte* y_weight;
+static int* y_nearest;
+static int map_height;
+static int map_src_width;
+static int map_src_height;
+
+dboolean dsda_DynamicResolutionActive(void) {
+  return dsda_IntConfig(dsda_config_render_dynamic_resolution) && V_IsSoftwareMode();
+}
+
+int dsda_DynamicResolutionScale(void) {
+  return scale;
+}
+
+void dsda_ResetDynamicResolution(void) {
+  scale = 100;
+  settle_frames = 0;
+  view_us_avg = 0;
+  work_us_avg = 0;
+  frame_view_us = 0;
+}
+
+// The buffer is shared by every scale, so it only grows
+void dsda_DynamicResolutionScreen(screeninfo_t* scrn, int width, int height) {
+  if (width * height > buffer_size) {
+    buffer_size = width * height;
+    buffer = Z_Realloc(buffer, buffer_size);
+  }
+
+  scrn->data = buffer;
+  scrn->not_on_heap = true;
+  scrn->width = width;
+  scrn->height = height;
+  scrn->pitch = width;
+}
+
+// Sample centers line up, so the edges of the view stay in place
+static void dsda_BuildUpscaleMap(int* map, byte* weight, int* nearest, int src, int dest) {
+  int i;
+
+  for (i = 0; i < dest; i++) {
+    long long pos;
+
+    // The source pixel covering the destination center
+    nearest[i] = (int) ((2ll * i + 1) * src / (2 * dest));
+
+    // The source center to its left, for bilinear filtering
+    pos = ((2ll * i + 1) * src << FRACBITS) / (2 * dest) - FRACUNIT / 2;
+    if (pos < 0)
+      pos = 0;
+
+    map[i] = (int) (pos >> FRACBITS);
+    weight[i] = (pos >> (FRACBITS - DYNRES_WEIGHT_BITS)) & ((1 << DYNRES_WEIGHT_BITS) - 1);
+
+    if (map[i] >= src - 1) {
+      map[i] = src - 1;
+      weight[i] = 0;
+    }
+  }
+}
+
+static void dsda_UpdateUpscaleMaps(int src_width, int src_height, int dest_width, int dest_height) {
+  if (dest_width != map_width || src_width != map_src_width) {
+    x_map = Z_Realloc(x_map, dest_width * sizeof(*x_map));
+    x_weight = Z_Realloc(x_weight, dest_width * sizeof(*x_weight));
+    x_nearest = Z_Realloc(x_nearest, dest_width * sizeof(*x_nearest));
+    dsda_BuildUpscaleMap(x_map, x_weight, x_nearest, src_width, dest_width);
+    map_width = dest_width;
+    map_src_width = src_width;
+  }
+
+  if (dest_height != map_height || src_height != map_src_height) {
+    y_map = Z_Realloc(y_map, dest_height * sizeof(*y_map));
+    y_weight = Z_Realloc(y_weight, dest_height * sizeof(*y_weight));
+    y_nearest = Z_Realloc(y_nearest, dest_height * sizeof(*y_nearest));
+    dsda_BuildUpscaleMap(y_map, y_weight, y_nearest, src_height, dest_height);
+    map_height = dest_height;
+    map_src_height = src_height;
+  }
+}
+
+// Nearest sampling, which is an exact pixel repeat at integer ratios.
+//   Rows that sample the same source row are copied.
+static void dsda_UpscaleNearestJob(void* data) {
+  upscale_job_t* job = data;
+  int x, y;
+
+  for (y = job->first; y < job->last; y++) {
+    byte* dest = job->dest->data + y * job->dest->pitch;
+
+    if (y > job->first && y_nearest[y] == y_nearest[y - 1]) {
+      memcpy(dest, dest - job->dest->pitch, job->width);
+    }
+    else {
+      const byte* src = job->src->data + y_nearest[y] * job->src->pitch;
+
+      for (x = 0; x < job->width; x++)
+        dest[x] = src[x_nearest[x]];
+    }
+  }
+}
+
+// Blends the four nearest source pixels in rgb through the translucency
+//   tables, then maps the result back to the palette
+static void dsda_UpscaleBilinearJob(void* data) {
+  upscale_job_t* job = data;
+  const int one = 1 << DYNRES_WEIGHT_BITS;
+  int x, y;
+
+  for (y = job->first; y < job->last; y++) {
+    byte* dest = job->dest->data + y * job->dest->pitch;
+    const byte* src0 = job->src->data + y_map[y] * job->src->pitch;
+    const byte* src1 = y_weight[y] ? src0 + job->src->pitch : src0;
+    int wy = y_weight[y];
+
+    for (x = 0; x < job->width; x++) {
+      int x0 = x_map[x];
+      int x1 = x0 + (x_weight[x] != 0);
+      int wx = x_weight[x];
+      unsigned int c;
+
+      c = Col2RGB8[(one - wx) * (one - wy)][src0[x0]] +
+          Col2RGB8[wx * (one - wy)][src0[x1]] +
+          Col2RGB8[(one - wx) * wy][src1[x0]] +
+          Col2RGB8[wx * wy][src1[x1]];
+      c |= 0x1f07c1f;
+      dest[x] = RGB32k[0][0][c & (c >> 15)];
+    }
+  }
+}
+
+void dsda_UpscaleDynamicResolution(const screeninfo_t* src, int src_width, int src_height,
+                                   screeninfo_t* dest, int dest_width, int dest_height) {
+  upscale_job_t jobs[DYNRES_MAX_JOBS];
+  dsdacthunk_t upscale;
+  int job_count;
+  int i;
+
+  dsda_UpdateUpscaleMaps(src_width, src_height, dest_width, dest_height);
+
+  if (dsda_IntConfig(dsda_config_render_dynamic_resolution_filter)) {
+    V_InitFlexTranTable();
+    upscale = dsda_UpscaleBilinearJob;
+  }
+  else
+    upscale = dsda_UpscaleNearestJob;
+
+  job_count = MIN(dest_height, DYNRES_MAX_JOBS);
+
+  for (i = 0; i < job_count; i++) {
+    jobs[i].src = src;
+    jobs[i].dest = dest;
+    jobs[i].width = dest_width;
+    jobs[i].first = dest_height * i / job_count;
+    jobs[i].last = dest_height * (i + 1) / job_count;
+  }
+
+  if (job_count == 1)
+    upscale(&jobs[0]);
+  else
+    I_ThreadPoolRun(upscale, jobs, sizeof(*jobs), job_count);
+}
+
+void dsda_AddDynamicResolutionView(unsigned long long view_us) {
+  frame_view_us += view_us;
+}
+
+// Called once per presented frame with the time spent simulating and
+//   rendering it, which leaves out waiting for the display
+void dsda_UpdateDynamicResolution(unsigned long long work_us) {
+  double target_us, budget_us, desired;
+  int next;
+
+  if (!frame_view_us)
+    return;
+
+  if (!view_us_avg) {
+    view_us_avg = frame_view_us;
+    work_us_avg = work_us;
+  }
+  else {
+    view_us_avg += (frame_view_us - view_us_avg) / 8;
+    work_us_avg += (work_us - work_us_avg) / 8;
+  }
+
+  frame_view_us = 0;
+
+  if (++settle_frames < DYNRES_SETTLE_FRAMES)
+    return;
+
+  target_us = 1000000.0 * DYNRES_HEADROOM / 100 /
+              dsda_IntConfig(dsda_config_render_dynamic_resolution_target);
+  budget_us = target_us - MAX(work_us_avg - view_us_avg, 0);
+
+  if (budget_us <= 0)
+    desired = 0;
+  else
+    desired = scale * sqrt(budget_us / view_us_avg);
+
+  // Drop as far as needed at once, but climb one step at a time and only
+  //   with room for two, so the scale doesn't bounce between steps
+  if (desired < scale)
+    next = (int) desired / DYNRES_STEP * DYNRES_STEP;
+  else if (desired >= scale + 2 * DYNRES_STEP)
+    next = scale + DYNRES_STEP;
+  else
+    next = scale;
+
+  next = BETWEEN(dsda_IntConfig(dsda_config_render_dynamic_resolution_min), 100, next);
+
+  if (next != scale) {
+    // The view cost follows the pixel count
+    double next_view_us = view_us_avg * next * next / (scale * scale);
+
+    work_us_avg += next_view_us - view_us_avg;
+    view_us_avg = next_view_us;
+    scale = next;
+    settle_frames = 0;
+  }
+}
@@ -0,0 +1,32 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Dynamic Resolution
+//
+
+#ifndef __DSDA_DYNAMIC_RESOLUTION__
+#define __DSDA_DYNAMIC_RESOLUTION__
+
+#include "v_video.h"
+
+dboolean dsda_DynamicResolutionActive(void);
+int dsda_DynamicResolutionScale(void);
+void dsda_ResetDynamicResolution(void);
+void dsda_DynamicResolutionScreen(screeninfo_t* scrn, int width, int height);
+void dsda_UpscaleDynamicResolution(const screeninfo_t* src, int src_width, int src_height,
+                                   screeninfo_t* dest, int dest_width, int dest_height);
+void dsda_AddDynamicResolutionView(unsigned long long view_us);
+void dsda_UpdateDynamicResolution(unsigned long long work_us);
+
+#endif
@@ -42,6 +42,8 @@ typedef struct {
   byte* footer;
   size_t demo_size;
   size_t footer_size;
+  size_t file_size;
+  dboolean mapped;
   byte features[FEATURE_SLOTS];
   int is_signed;
 } exdemo_t;
@@ -54,7 +56,9 @@ static exdemo_t exdemo;
 
 static void ForgetExDemo(void) {
   if (exdemo.demo)
-    Z_Free(exdemo.demo);
+    M_UnmapFile(exdemo.demo, exdemo.file_size, exdemo.mapped);
+
+  dsda_ForgetDemoMarker();
 
   memset(&exdemo, 0, sizeof(exdemo));
 }
@@ -489,7 +493,9 @@ static void DemoEx_AddPort(wadtbl_t* wadtbl) {
 static void PartitionDemo(const char* filename) {
   size_t file_size;
 
-  file_size = M_ReadFile(filename, &exdemo.demo);
+  // Mapped, so that huge demos don't have to be resident while playing
+  file_size = M_MapFile(filename, &exdemo.demo, &exdemo.mapped);
+  exdemo.file_size = file_size;
 
   if (file_size > 0) {
     const byte* p;
@@ -575,6 +581,17 @@ void dsda_LoadExDemo(const char* filename) {
       DemoEx_GetParams(header);
     }
   }
+
+  // Scanning for the footer and the checksum touched every page
+  if (exdemo.mapped)
+    M_EvictMappedRange(exdemo.demo, exdemo.demo_size);
+}
+
+void dsda_EvictExDemo(const byte* start, const byte* end) {
+  if (!exdemo.mapped || start < exdemo.demo || end > exdemo.demo + exdemo.demo_size || end <= start)
+    return;
+
+  M_EvictMappedRange(exdemo.demo + (start - exdemo.demo), end - start);
 }
 
 int dsda_CopyExDemo(const byte** buffer, int* length) {
@@ -70,6 +70,7 @@ typedef enum {
   exhud_weapon_text,
   exhud_render_stats,
   exhud_fps,
+  exhud_frame_times,
   exhud_attempts,
   exhud_local_time,
   exhud_coordinate_display,
@@ -220,6 +221,14 @@ exhud_component_t components_template[exhud_component_count] = {
     .default_vpt = VPT_EX_TEXT,
     .off_by_default = true,
   },
+  [exhud_frame_times] = {
+    dsda_InitFrameTimesHC,
+    dsda_UpdateFrameTimesHC,
+    dsda_DrawFrameTimesHC,
+    "frame_times",
+    .default_vpt = VPT_EX_TEXT,
+    .off_by_default = true,
+  },
   [exhud_attempts] = {
     dsda_InitAttemptsHC,
     dsda_UpdateAttemptsHC,
@@ -622,6 +631,7 @@ static void dsda_RefreshHUD(void) {
     dsda_TurnComponentOn(exhud_render_stats);
 
   dsda_RefreshExHudFPS();
+  dsda_RefreshExHudFrameTimes();
   dsda_RefreshExHudMinimap();
   dsda_RefreshExHudLevelSplits();
   dsda_RefreshExHudCoordinateDisplay();
@@ -759,6 +769,10 @@ void dsda_RefreshExHudFPS(void) {
   dsda_BasicRefresh(dsda_ShowFPS, exhud_fps);
 }
 
+void dsda_RefreshExHudFrameTimes(void) {
+  dsda_BasicRefresh(dsda_ShowFrameTimes, exhud_frame_times);
+}
+
 void dsda_RefreshExHudMinimap(void) {
   if (!dsda_HUDActive())
     return;
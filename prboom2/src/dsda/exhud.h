@@ -24,6 +24,7 @@ void dsda_DrawExHud(void);
 void dsda_DrawExIntermission(void);
 void dsda_ToggleRenderStats(void);
 void dsda_RefreshExHudFPS(void);
+void dsda_RefreshExHudFrameTimes(void);
 void dsda_RefreshExHudMinimap(void);
 void dsda_RefreshExHudLevelSplits(void);
 void dsda_RefreshExHudCoordinateDisplay(void);
@@ -0,0 +1,227 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Frame Times
+//
+//  Every presented frame in a level is recorded with the wall time since
+//  the previous present, split into the time spent simulating, rendering
+//  and presenting. The hud reads the lows and the graph from a window of
+//  recent frames. With -frametimes, all frames of a level are kept and
+//  written to a csv when the level is completed or a timed demo ends.
+//  A benchmark run keeps them as well, to summarize each level.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/benchmark.h"
+#include "dsda/mapinfo.h"
+#include "dsda/settings.h"
+#include "dsda/utility.h"
+
+#include "frame_times.h"
+
+#define FRAME_TIMES_WINDOW 1024
+
+typedef struct {
+  float frame_ms;
+  float sim_ms;
+  float render_ms;
+  float present_ms;
+} frame_time_t;
+
+static frame_time_t window[FRAME_TIMES_WINDOW];
+static int window_count;
+static int window_next;
+
+static frame_time_t* level_frames;
+static int level_frame_count;
+static int level_frame_max;
+
+static dboolean dsda_KeepLevelFrameTimes(void) {
+  return dsda_Flag(dsda_arg_frame_times) || dsda_Flag(dsda_arg_benchmark_run);
+}
+
+dboolean dsda_FrameTimesActive(void) {
+  return dsda_ShowFrameTimes() || dsda_KeepLevelFrameTimes();
+}
+
+void dsda_AddFrameTime(unsigned long long frame_us, unsigned long long sim_us,
+                       unsigned long long render_us, unsigned long long present_us) {
+  frame_time_t frame;
+
+  if (gamestate != GS_LEVEL)
+    return;
+
+  frame.frame_ms = frame_us / 1000.f;
+  frame.sim_ms = sim_us / 1000.f;
+  frame.render_ms = render_us / 1000.f;
+  frame.present_ms = present_us / 1000.f;
+
+  window[window_next] = frame;
+  window_next = (window_next + 1) % FRAME_TIMES_WINDOW;
+  if (window_count < FRAME_TIMES_WINDOW)
+    window_count++;
+
+  if (!dsda_KeepLevelFrameTimes())
+    return;
+
+  if (level_frame_count == level_frame_max) {
+    level_frame_max = level_frame_max ? level_frame_max * 2 : 4096;
+    level_frames = Z_Realloc(level_frames, level_frame_max * sizeof(*level_frames));
+  }
+
+  level_frames[level_frame_count++] = frame;
+}
+
+static int dsda_CompareFrameTimes(const void* a, const void* b) {
+  float x = *(const float*) a;
+  float y = *(const float*) b;
+
+  return (x > y) - (x < y);
+}
+
+static float dsda_FrameTimePercentile(const float* sorted, int count, double percentile) {
+  int i;
+
+  i = (int) (count * percentile);
+  if (i >= count)
+    i = count - 1;
+
+  return sorted[i];
+}
+
+// The order of the frames doesn't matter, so the window needs no unwrapping
+static void dsda_ComputeFrameTimeStats(const frame_time_t* frames, int count, float* sorted,
+                                       dsda_frame_time_stats_t* stats) {
+  double frame = 0, sim = 0, render = 0, present = 0;
+  int i;
+
+  memset(stats, 0, sizeof(*stats));
+
+  if (!count)
+    return;
+
+  for (i = 0; i < count; i++) {
+    sorted[i] = frames[i].frame_ms;
+    frame += frames[i].frame_ms;
+    sim += frames[i].sim_ms;
+    render += frames[i].render_ms;
+    present += frames[i].present_ms;
+  }
+
+  qsort(sorted, count, sizeof(*sorted), dsda_CompareFrameTimes);
+
+  stats->frames = count;
+  stats->average_ms = frame / count;
+  stats->median_ms = dsda_FrameTimePercentile(sorted, count, 0.5);
+  stats->p90_ms = dsda_FrameTimePercentile(sorted, count, 0.9);
+  stats->p99_ms = dsda_FrameTimePercentile(sorted, count, 0.99);
+  stats->p999_ms = dsda_FrameTimePercentile(sorted, count, 0.999);
+  stats->sim_ms = sim / count;
+  stats->render_ms = render / count;
+  stats->present_ms = present / count;
+}
+
+void dsda_FrameTimeStats(dsda_frame_time_stats_t* stats) {
+  static float sorted[FRAME_TIMES_WINDOW];
+
+  dsda_ComputeFrameTimeStats(window, window_count, sorted, stats);
+}
+
+static void dsda_LevelFrameTimeStats(dsda_frame_time_stats_t* stats) {
+  float* sorted;
+
+  sorted = Z_Malloc(MAX(level_frame_count, 1) * sizeof(*sorted));
+  dsda_ComputeFrameTimeStats(level_frames, level_frame_count, sorted, stats);
+  Z_Free(sorted);
+}
+
+// Copies up to count of the most recent frame times, oldest first
+int dsda_RecentFrameTimes(float* dest, int count) {
+  int i, start;
+
+  if (count > window_count)
+    count = window_count;
+
+  start = window_next - count + FRAME_TIMES_WINDOW;
+
+  for (i = 0; i < count; i++)
+    dest[i] = window[(start + i) % FRAME_TIMES_WINDOW].frame_ms;
+
+  return count;
+}
+
+void dsda_ResetFrameTimes(void) {
+  window_count = 0;
+  window_next = 0;
+  level_frame_count = 0;
+}
+
+static void dsda_WriteFrameTimesCSV(void) {
+  dsda_arg_t* arg;
+  dsda_string_t path;
+  FILE* file;
+  int i;
+
+  arg = dsda_Arg(dsda_arg_frame_times);
+
+  if (!arg->found)
+    return;
+
+  dsda_StringPrintF(&path, "%s-%s.csv", arg->value.v_string,
+                    dsda_MapLumpName(gameepisode, gamemap));
+
+  file = M_OpenFile(path.string, "wb");
+
+  if (file) {
+    fprintf(file, "frame,time_ms,sim_ms,render_ms,present_ms\n");
+
+    for (i = 0; i < level_frame_count; i++)
+      fprintf(file, "%d,%.3f,%.3f,%.3f,%.3f\n", i,
+              level_frames[i].frame_ms, level_frames[i].sim_ms,
+              level_frames[i].render_ms, level_frames[i].present_ms);
+
+    fclose(file);
+
+    lprintf(LO_INFO, "Wrote %d frame times to %s\n", level_frame_count, path.string);
+  }
+  else
+    lprintf(LO_WARN, "dsda_WriteFrameTimes: unable to write %s\n", path.string);
+
+  dsda_FreeString(&path);
+}
+
+void dsda_WriteFrameTimes(void) {
+  if (!level_frame_count)
+    return;
+
+  if (dsda_Flag(dsda_arg_benchmark_run)) {
+    dsda_frame_time_stats_t stats;
+
+    dsda_LevelFrameTimeStats(&stats);
+    dsda_AddBenchmarkLevel(dsda_MapLumpName(gameepisode, gamemap), &stats);
+  }
+
+  dsda_WriteFrameTimesCSV();
+
+  level_frame_count = 0;
+}
@@ -0,0 +1,43 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Frame Times
+//
+
+#ifndef __DSDA_FRAME_TIMES__
+#define __DSDA_FRAME_TIMES__
+
+#include "doomtype.h"
+
+typedef struct {
+  int frames;
+  float average_ms;
+  float median_ms;
+  float p90_ms;
+  float p99_ms;  // the 1% low
+  float p999_ms; // the 0.1% low
+  float sim_ms;
+  float render_ms;
+  float present_ms;
+} dsda_frame_time_stats_t;
+
+dboolean dsda_FrameTimesActive(void);
+void dsda_AddFrameTime(unsigned long long frame_us, unsigned long long sim_us,
+                       unsigned long long render_us, unsigned long long present_us);
+void dsda_FrameTimeStats(dsda_frame_time_stats_t* stats);
+int dsda_RecentFrameTimes(float* dest, int count);
+void dsda_ResetFrameTimes(void);
+void dsda_WriteFrameTimes(void);
+
+#endif
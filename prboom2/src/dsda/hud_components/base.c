@@ -136,6 +136,10 @@ void dsda_DrawBasicText(dsda_text_t* component) {
 void dsda_RefreshHudText(dsda_text_t* component) {
   const char* s;
 
+  // Unchanged text keeps its glyph layout
+  if (!strcmp(component->text.l, component->msg))
+    return;
+
   HUlib_clearTextLine(&component->text);
 
   s = component->msg;
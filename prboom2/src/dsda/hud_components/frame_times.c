@@ -0,0 +1,160 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Frame Times HUD Component
+//
+
+#include "dsda/frame_times.h"
+
+#include "base.h"
+
+#include "frame_times.h"
+
+#define GRAPH_MAX_WIDTH 320
+
+typedef struct {
+  dsda_text_t component[4];
+  int x, y, width, height, scale, vpt;
+  byte good_color;
+  byte spike_color;
+  float average_ms;
+} local_component_t;
+
+static local_component_t* local;
+
+// A frame that takes twice the average is what shows up as a stutter
+static const char* dsda_FrameTimeColor(float ms, float average_ms) {
+  return ms > 2 * average_ms ? dsda_TextColor(dsda_tc_exhud_render_bad) :
+                               dsda_TextColor(dsda_tc_exhud_render_good);
+}
+
+static void dsda_UpdateComponentText(dsda_frame_time_stats_t* stats) {
+  snprintf(
+    local->component[0].msg, sizeof(local->component[0].msg),
+    "%sAVG %s%5.1f MS",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->average_ms
+  );
+
+  snprintf(
+    local->component[1].msg, sizeof(local->component[1].msg),
+    "%s1%%  %s%5.1f MS",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_FrameTimeColor(stats->p99_ms, stats->average_ms),
+    stats->p99_ms
+  );
+
+  snprintf(
+    local->component[2].msg, sizeof(local->component[2].msg),
+    "%s.1%% %s%5.1f MS",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_FrameTimeColor(stats->p999_ms, stats->average_ms),
+    stats->p999_ms
+  );
+
+  snprintf(
+    local->component[3].msg, sizeof(local->component[3].msg),
+    "%sS%s%4.1f %sR%s%4.1f %sP%s%4.1f",
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->sim_ms,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->render_ms,
+    dsda_TextColor(dsda_tc_exhud_render_label),
+    dsda_TextColor(dsda_tc_exhud_render_good),
+    stats->present_ms
+  );
+}
+
+void dsda_InitFrameTimesHC(int x_offset, int y_offset, int vpt, int* args, int arg_count, void** data) {
+  int i;
+
+  *data = Z_Calloc(1, sizeof(local_component_t));
+  local = *data;
+
+  for (i = 0; i < 4; i++)
+    dsda_InitTextHC(&local->component[i], x_offset, y_offset + 8 * i, vpt);
+
+  local->width = args[0];
+  local->height = args[1];
+  local->scale = args[2];
+
+  if (local->width <= 0 || local->width > GRAPH_MAX_WIDTH)
+    local->width = 96;
+
+  if (local->height <= 0 || local->height > 200)
+    local->height = 24;
+
+  if (local->scale <= 0)
+    local->scale = 33;
+
+  // The graph sits past the last line of text, growing away from the edge
+  local->x = x_offset;
+  if (BOTTOM_ALIGNMENT(vpt & VPT_ALIGN_MASK))
+    local->y = dsda_HudComponentY(y_offset + 26 + local->height, vpt, 0);
+  else
+    local->y = dsda_HudComponentY(y_offset + 34, vpt, 0);
+  local->vpt = vpt;
+
+  local->good_color = V_BestColor(V_GetPlaypal(), 0, 192, 0);
+  local->spike_color = V_BestColor(V_GetPlaypal(), 224, 0, 0);
+}
+
+void dsda_UpdateFrameTimesHC(void* data) {
+  dsda_frame_time_stats_t stats;
+  int i;
+
+  local = data;
+
+  dsda_FrameTimeStats(&stats);
+  local->average_ms = stats.average_ms;
+
+  dsda_UpdateComponentText(&stats);
+
+  for (i = 0; i < 4; i++)
+    dsda_RefreshHudText(&local->component[i]);
+}
+
+void dsda_DrawFrameTimesHC(void* data) {
+  float frames[GRAPH_MAX_WIDTH];
+  int count;
+  int i;
+
+  local = data;
+
+  for (i = 0; i < 4; i++)
+    dsda_DrawBasicText(&local->component[i]);
+
+  // One column per frame, newest on the right
+  count = dsda_RecentFrameTimes(frames, local->width);
+
+  for (i = 0; i < count; i++) {
+    int height;
+
+    height = (int) (frames[i] * local->height / local->scale + 0.5f);
+
+    if (height <= 0)
+      continue;
+
+    if (height > local->height)
+      height = local->height;
+
+    V_FillRectVPT(0, local->x + local->width - count + i, local->y + local->height - height,
+                  1, height,
+                  frames[i] > 2 * local->average_ms ? local->spike_color : local->good_color,
+                  local->vpt);
+  }
+}
@@ -0,0 +1,564 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Palette Tables
+//
+//  Tables that map colors to their nearest palette entry (translucency
+//  maps, the rgb lookup of the flex translucency) are generated on the
+//  thread pool, with a vectorized nearest color search where the cpu has
+//  one. All of them live in a single cache file per PLAYPAL checksum, which
+//  is mapped on load. Each table also records a digest of the palette it
+//  was derived from, since some follow the active palette rather than
+//  PLAYPAL. Tables generated during a session are merged into the file on
+//  exit.
+//
+
+#include <limits.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PALETTE_HAVE_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PALETTE_TARGET_SSE41
+#define PALETTE_TARGET_AVX2
+#else
+#define PALETTE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define PALETTE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "md5.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "core/thread_pool.h"
+
+#include "dsda/data_organizer.h"
+#include "dsda/utility.h"
+
+#include "palette_tables.h"
+
+#define PALETTE_CACHE_MAGIC "DSDAPTB1"
+#define PALETTE_TABLE_NAME_SIZE 16
+#define PALETTE_TABLE_ALIGN 64
+#define PALETTE_MAX_JOBS 32
+
+#define TSC 12 /* number of fixed point digits in filter percent */
+#define RGB32K_COLOR(a) (((a) << 3) | ((a) >> 2))
+
+typedef struct {
+  char name[PALETTE_TABLE_NAME_SIZE];
+  byte source[16];
+  int offset;
+  int length;
+} palette_table_header_t;
+
+typedef struct {
+  char name[PALETTE_TABLE_NAME_SIZE];
+  byte source[16]; // digest of the palette the table derives from
+  int length;
+  const byte* data;
+} palette_table_t;
+
+// The nearest color minimizes tot - r * tr - g * tg - b * tb over the
+//   palette, with the scale and the doubling of the target chosen by the table
+typedef struct palette_search_s {
+  const byte* palette;
+  int tot[256];
+  int r[256];
+  int g[256];
+  int b[256];
+  dboolean reversed; // ties go to the last color instead of the first
+  int (*nearest)(const struct palette_search_s* search, int r, int g, int b);
+} palette_search_t;
+
+typedef void (*palette_fill_t)(const palette_search_t* search, byte* buffer,
+                               int first, int last, int param);
+
+typedef struct {
+  int length;
+  int units;  // independent slices of the table, for splitting into jobs
+  int shift;  // scale of tot, matching the scale of the targets
+  dboolean reversed;
+  palette_fill_t fill;
+} palette_table_desc_t;
+
+typedef struct {
+  const palette_search_t* search;
+  palette_fill_t fill;
+  byte* buffer;
+  int first;
+  int last;
+  int param;
+} palette_job_t;
+
+static palette_table_t* tables;
+static int table_count;
+
+static dboolean cache_loaded;
+static dboolean cache_dirty;
+static byte* cache_data;
+static int cache_length;
+static dboolean cache_mapped;
+static char* cache_path;
+
+static int dsda_NearestColorScalar(const palette_search_t* search, int r, int g, int b) {
+  int best = INT_MAX;
+  int best_i = 0;
+  int i;
+
+  for (i = 0; i < 256; i++) {
+    int err = search->tot[i] - search->r[i] * r - search->g[i] * g - search->b[i] * b;
+
+    if (err < best) {
+      best = err;
+      best_i = i;
+    }
+  }
+
+  return search->reversed ? 255 - best_i : best_i;
+}
+
+#ifdef PALETTE_HAVE_SIMD
+// Each lane keeps its first best color, so the lowest index wins ties overall
+static int dsda_ReduceNearestColor(const palette_search_t* search,
+                                   const int* err, const int* index, int lanes) {
+  int best = 0;
+  int i;
+
+  for (i = 1; i < lanes; i++)
+    if (err[i] < err[best] || (err[i] == err[best] && index[i] < index[best]))
+      best = i;
+
+  return search->reversed ? 255 - index[best] : index[best];
+}
+
+PALETTE_TARGET_SSE41
+static int dsda_NearestColorSSE41(const palette_search_t* search, int r, int g, int b) {
+  __m128i vr = _mm_set1_epi32(r);
+  __m128i vg = _mm_set1_epi32(g);
+  __m128i vb = _mm_set1_epi32(b);
+  __m128i best = _mm_set1_epi32(INT_MAX);
+  __m128i best_index = _mm_setzero_si128();
+  __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+  __m128i step = _mm_set1_epi32(4);
+  int err[4], lane_index[4];
+  int i;
+
+  for (i = 0; i < 256; i += 4) {
+    __m128i e, better;
+
+    e = _mm_loadu_si128((const __m128i*) &search->tot[i]);
+    e = _mm_sub_epi32(e, _mm_mullo_epi32(_mm_loadu_si128((const __m128i*) &search->r[i]), vr));
+    e = _mm_sub_epi32(e, _mm_mullo_epi32(_mm_loadu_si128((const __m128i*) &search->g[i]), vg));
+    e = _mm_sub_epi32(e, _mm_mullo_epi32(_mm_loadu_si128((const __m128i*) &search->b[i]), vb));
+
+    better = _mm_cmpgt_epi32(best, e);
+    best = _mm_blendv_epi8(best, e, better);
+    best_index = _mm_blendv_epi8(best_index, index, better);
+    index = _mm_add_epi32(index, step);
+  }
+
+  _mm_storeu_si128((__m128i*) err, best);
+  _mm_storeu_si128((__m128i*) lane_index, best_index);
+
+  return dsda_ReduceNearestColor(search, err, lane_index, 4);
+}
+
+PALETTE_TARGET_AVX2
+static int dsda_NearestColorAVX2(const palette_search_t* search, int r, int g, int b) {
+  __m256i vr = _mm256_set1_epi32(r);
+  __m256i vg = _mm256_set1_epi32(g);
+  __m256i vb = _mm256_set1_epi32(b);
+  __m256i best = _mm256_set1_epi32(INT_MAX);
+  __m256i best_index = _mm256_setzero_si256();
+  __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i step = _mm256_set1_epi32(8);
+  int err[8], lane_index[8];
+  int i;
+
+  for (i = 0; i < 256; i += 8) {
+    __m256i e, better;
+
+    e = _mm256_loadu_si256((const __m256i*) &search->tot[i]);
+    e = _mm256_sub_epi32(e, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*) &search->r[i]), vr));
+    e = _mm256_sub_epi32(e, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*) &search->g[i]), vg));
+    e = _mm256_sub_epi32(e, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*) &search->b[i]), vb));
+
+    better = _mm256_cmpgt_epi32(best, e);
+    best = _mm256_blendv_epi8(best, e, better);
+    best_index = _mm256_blendv_epi8(best_index, index, better);
+    index = _mm256_add_epi32(index, step);
+  }
+
+  _mm256_storeu_si256((__m256i*) err, best);
+  _mm256_storeu_si256((__m256i*) lane_index, best_index);
+
+  return dsda_ReduceNearestColor(search, err, lane_index, 8);
+}
+#endif
+
+static void dsda_InitPaletteSearch(palette_search_t* search, const byte* palette,
+                                   const palette_table_desc_t* desc) {
+  int i;
+
+  search->palette = palette;
+  search->reversed = desc->reversed;
+
+  for (i = 0; i < 256; i++) {
+    const byte* p = palette + 3 * (desc->reversed ? 255 - i : i);
+
+    search->r[i] = p[0];
+    search->g[i] = p[1];
+    search->b[i] = p[2];
+    search->tot[i] = (p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) << desc->shift;
+  }
+
+  search->nearest = dsda_NearestColorScalar;
+
+#ifdef PALETTE_HAVE_SIMD
+  if (I_SIMDLevel() >= simd_avx2)
+    search->nearest = dsda_NearestColorAVX2;
+  else if (I_SIMDLevel() >= simd_sse41)
+    search->nearest = dsda_NearestColorSSE41;
+#endif
+}
+
+//
+// By Lee Killough 2/21/98
+//
+// The blend of each pair of colors, scaled by 1 << TSC, is matched against
+//   the palette with tot scaled by 1 << (TSC - 1), as the original filter did
+//
+static void dsda_FillTranMap(const palette_search_t* search, byte* buffer,
+                             int first, int last, int alpha) {
+  const byte* playpal = search->palette;
+  int w1, w2;
+  int i, j;
+
+  w1 = (alpha << TSC) / 100;
+  w2 = (1l << TSC) - w1;
+
+  for (i = first; i < last; i++) {
+    int r1 = playpal[3 * i + 0] * w2;
+    int g1 = playpal[3 * i + 1] * w2;
+    int b1 = playpal[3 * i + 2] * w2;
+    byte* tp = buffer + 256 * i;
+
+    for (j = 0; j < 256; j++)
+      tp[j] = search->nearest(search,
+                              playpal[3 * j + 0] * w1 + r1,
+                              playpal[3 * j + 1] * w1 + g1,
+                              playpal[3 * j + 2] * w1 + b1);
+  }
+}
+
+// Matches V_BestColor, which minimizes the squared distance
+static void dsda_FillRGB32k(const palette_search_t* search, byte* buffer,
+                            int first, int last, int param) {
+  int r, g, b;
+
+  for (r = first; r < last; r++)
+    for (g = 0; g < 32; g++)
+      for (b = 0; b < 32; b++)
+        buffer[(r * 32 + g) * 32 + b] = search->nearest(search,
+                                                        2 * RGB32K_COLOR(r),
+                                                        2 * RGB32K_COLOR(g),
+                                                        2 * RGB32K_COLOR(b));
+}
+
+static const palette_table_desc_t tranmap_desc = {
+  PALETTE_TRANMAP_LENGTH, 256, TSC - 1, true, dsda_FillTranMap
+};
+
+static const palette_table_desc_t rgb32k_desc = {
+  PALETTE_RGB32K_LENGTH, 32, 0, false, dsda_FillRGB32k
+};
+
+static void dsda_PaletteTableJob(void* data) {
+  palette_job_t* job = data;
+
+  job->fill(job->search, job->buffer, job->first, job->last, job->param);
+}
+
+// Runs on the pool, so the buffer is allocated before the jobs start
+static void dsda_GeneratePaletteTable(byte* buffer, const byte* palette,
+                                      const palette_table_desc_t* desc, int param) {
+  palette_search_t search;
+  palette_job_t jobs[PALETTE_MAX_JOBS];
+  int job_count;
+  int i;
+
+  dsda_InitPaletteSearch(&search, palette, desc);
+
+  job_count = MIN(desc->units, PALETTE_MAX_JOBS);
+
+  for (i = 0; i < job_count; i++) {
+    jobs[i].search = &search;
+    jobs[i].fill = desc->fill;
+    jobs[i].buffer = buffer;
+    jobs[i].first = desc->units * i / job_count;
+    jobs[i].last = desc->units * (i + 1) / job_count;
+    jobs[i].param = param;
+  }
+
+  if (job_count == 1)
+    dsda_PaletteTableJob(&jobs[0]);
+  else
+    I_ThreadPoolRun(dsda_PaletteTableJob, jobs, sizeof(*jobs), job_count);
+}
+
+static void dsda_PaletteDigest(const byte* palette, byte* digest) {
+  struct MD5Context md5;
+
+  MD5Init(&md5);
+  MD5Update(&md5, palette, 256 * 3);
+  MD5Final(digest, &md5);
+}
+
+static palette_table_t* dsda_FindPaletteTable(const char* name, const byte* source, int length) {
+  int i;
+
+  for (i = 0; i < table_count; i++)
+    if (!strcmp(tables[i].name, name) && !memcmp(tables[i].source, source, 16) &&
+        tables[i].length == length)
+      return &tables[i];
+
+  return NULL;
+}
+
+static void dsda_AddPaletteTable(const char* name, const byte* source, int length, const byte* data) {
+  palette_table_t* table;
+
+  tables = Z_Realloc(tables, (table_count + 1) * sizeof(*tables));
+  table = &tables[table_count++];
+
+  memset(table->name, 0, sizeof(table->name));
+  strncpy(table->name, name, sizeof(table->name) - 1);
+  memcpy(table->source, source, 16);
+  table->length = length;
+  table->data = data;
+}
+
+static void dsda_InitPaletteCachePath(void) {
+  struct MD5Context md5;
+  dsda_cksum_t cksum;
+  dsda_string_t path;
+  int lump;
+
+  if (!dsda_DataRoot())
+    return;
+
+  lump = W_GetNumForName("PLAYPAL");
+
+  MD5Init(&md5);
+  MD5Update(&md5, W_LumpByNum(lump), W_LumpLength(lump));
+  MD5Final(cksum.bytes, &md5);
+  dsda_TranslateCheckSum(&cksum);
+
+  dsda_StringPrintF(&path, "%s/palette_tables", dsda_DataRoot());
+  M_MakeDir(path.string, false);
+  dsda_StringCatF(&path, "/%s.bin", cksum.string);
+
+  cache_path = Z_Strdup(path.string);
+  dsda_FreeString(&path);
+}
+
+// Returns the number of table headers, or -1 if the cache is invalid
+static int dsda_PaletteCacheHeaders(const byte* data, int length,
+                                    const palette_table_header_t** headers) {
+  int count;
+
+  if (length < 12 || memcmp(data, PALETTE_CACHE_MAGIC, 8))
+    return -1;
+
+  memcpy(&count, data + 8, sizeof(count));
+  *headers = (const palette_table_header_t*) (data + 12);
+
+  if (count < 0 || 12 + count * sizeof(**headers) > length)
+    return -1;
+
+  return count;
+}
+
+// Adds the cached tables that aren't known yet, leaving the known ones alone
+static void dsda_AddCachedPaletteTables(const byte* data, int length) {
+  const palette_table_header_t* headers;
+  int count;
+  int i;
+
+  count = dsda_PaletteCacheHeaders(data, length, &headers);
+
+  if (count < 0) {
+    lprintf(LO_WARN, "dsda_AddCachedPaletteTables: ignoring invalid cache %s\n", cache_path);
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    palette_table_header_t header;
+
+    memcpy(&header, &headers[i], sizeof(header));
+    header.name[PALETTE_TABLE_NAME_SIZE - 1] = '\0';
+
+    if (header.offset < 0 || header.length < 0 || header.offset > length - header.length)
+      continue;
+
+    if (!dsda_FindPaletteTable(header.name, header.source, header.length))
+      dsda_AddPaletteTable(header.name, header.source, header.length, data + header.offset);
+  }
+}
+
+static void dsda_LoadPaletteCache(void) {
+  cache_loaded = true;
+
+  dsda_InitPaletteCachePath();
+
+  if (!cache_path)
+    return;
+
+  cache_length = M_MapFile(cache_path, &cache_data, &cache_mapped);
+
+  if (cache_length < 0) {
+    cache_data = NULL;
+    return;
+  }
+
+  dsda_AddCachedPaletteTables(cache_data, cache_length);
+}
+
+// Other instances may have the cache mapped, so it is never rewritten in
+//   place: the new file is written next to it and renamed over it
+static void dsda_SavePaletteCache(void) {
+  palette_table_header_t* headers;
+  dsda_string_t temp_path;
+  byte* saved_data = NULL;
+  byte* buffer;
+  int saved_length;
+  int offset;
+  int i;
+
+  if (!cache_dirty || !cache_path)
+    return;
+
+  cache_dirty = false;
+
+#ifdef _WIN32
+  // A mapped file can't be replaced here
+  if (M_FileExists(cache_path))
+    return;
+#endif
+
+  // Keep the tables other instances saved since the cache was loaded
+  saved_length = M_ReadFile(cache_path, &saved_data);
+
+  if (saved_length >= 0)
+    dsda_AddCachedPaletteTables(saved_data, saved_length);
+
+  offset = 12 + table_count * sizeof(*headers);
+
+  for (i = 0; i < table_count; i++) {
+    offset = (offset + PALETTE_TABLE_ALIGN - 1) & ~(PALETTE_TABLE_ALIGN - 1);
+    offset += tables[i].length;
+  }
+
+  buffer = Z_Calloc(offset, 1);
+  memcpy(buffer, PALETTE_CACHE_MAGIC, 8);
+  memcpy(buffer + 8, &table_count, sizeof(table_count));
+  headers = (palette_table_header_t*) (buffer + 12);
+
+  offset = 12 + table_count * sizeof(*headers);
+
+  for (i = 0; i < table_count; i++) {
+    palette_table_header_t header;
+
+    offset = (offset + PALETTE_TABLE_ALIGN - 1) & ~(PALETTE_TABLE_ALIGN - 1);
+
+    memcpy(header.name, tables[i].name, sizeof(header.name));
+    memcpy(header.source, tables[i].source, sizeof(header.source));
+    header.offset = offset;
+    header.length = tables[i].length;
+    memcpy(&headers[i], &header, sizeof(header));
+
+    memcpy(buffer + offset, tables[i].data, tables[i].length);
+    offset += tables[i].length;
+  }
+
+  dsda_StringPrintF(&temp_path, "%s.%d.tmp", cache_path, (int) getpid());
+
+  if (!M_WriteFile(temp_path.string, buffer, offset) ||
+      M_rename(temp_path.string, cache_path)) {
+    lprintf(LO_WARN, "dsda_SavePaletteCache: unable to write %s\n", cache_path);
+    M_remove(temp_path.string);
+  }
+
+  dsda_FreeString(&temp_path);
+  Z_Free(buffer);
+
+  if (saved_data)
+    Z_Free(saved_data);
+}
+
+static const byte* dsda_PaletteTable(const char* name, const byte* palette,
+                                     const palette_table_desc_t* desc, int param) {
+  palette_table_t* table;
+  byte source[16];
+  byte* buffer;
+
+  if (!cache_loaded)
+    dsda_LoadPaletteCache();
+
+  dsda_PaletteDigest(palette, source);
+
+  table = dsda_FindPaletteTable(name, source, desc->length);
+
+  if (table)
+    return table->data;
+
+  buffer = Z_Malloc(desc->length);
+  dsda_GeneratePaletteTable(buffer, palette, desc, param);
+  dsda_AddPaletteTable(name, source, desc->length, buffer);
+
+  if (!cache_dirty) {
+    cache_dirty = true;
+    I_AtExit(dsda_SavePaletteCache, false, "dsda_SavePaletteCache", exit_priority_normal);
+  }
+
+  return buffer;
+}
+
+const byte* dsda_TranMapTable(unsigned int alpha) {
+  char name[PALETTE_TABLE_NAME_SIZE];
+
+  if (alpha > 99)
+    return NULL;
+
+  snprintf(name, sizeof(name), "tranmap_%02u", alpha);
+
+  return dsda_PaletteTable(name, W_LumpByName("PLAYPAL"), &tranmap_desc, alpha);
+}
+
+const byte* dsda_RGB32kTable(const byte* palette) {
+  return dsda_PaletteTable("rgb32k", palette, &rgb32k_desc, 0);
+}
@@ -0,0 +1,29 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Palette Tables
+//
+
+#ifndef __DSDA_PALETTE_TABLES__
+#define __DSDA_PALETTE_TABLES__
+
+#include "doomtype.h"
+
+#define PALETTE_TRANMAP_LENGTH (256 * 256)
+#define PALETTE_RGB32K_LENGTH (32 * 32 * 32)
+
+const byte* dsda_TranMapTable(unsigned int alpha);
+const byte* dsda_RGB32kTable(const byte* palette);
+
+#endif
@@ -0,0 +1,401 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Parallel Render
+//
+//  -renderjobs <n> renders the -viddump video of a -timedemo in n processes.
+//  A first process plays the demo without drawing, captures the sound of
+//  the whole demo and exports a key frame at the start of each segment.
+//  The segments then run side by side: each restores its key frame and
+//  captures the video up to the start of the next one. Segment starts are
+//  picked inside a level, away from screen wipes, so every process makes
+//  the same frames the single process capture would. The video segments
+//  are joined in order with cap_concatcommand and muxed with the sound.
+//
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "doomstat.h"
+#include "e6y.h"
+#include "g_game.h"
+#include "i_capture.h"
+#include "i_main.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/configuration.h"
+#include "dsda/key_frame.h"
+#include "dsda/messenger.h"
+
+#include "parallel_render.h"
+
+#define MAX_SEGMENTS 64
+#define MANIFEST_NAME "segments.txt"
+#define SEGMENT_LIST_NAME "segments.ffconcat"
+
+static int segment_start[MAX_SEGMENTS];
+static int segment_count;
+static int segment_end;
+static dboolean segment_started;
+
+static const char* dsda_RenderDir(void) {
+  return dsda_Arg(dsda_arg_render_dir)->value.v_string;
+}
+
+parallel_render_pass_t dsda_ParallelRenderPass(void) {
+  if (!dsda_Flag(dsda_arg_render_dir))
+    return parallel_render_none;
+
+  return dsda_Flag(dsda_arg_render_segment) ? parallel_render_segment :
+                                              parallel_render_key_frames;
+}
+
+static void dsda_SegmentPath(dsda_string_t* path, const char* dir, int segment, const char* suffix) {
+  dsda_StringPrintF(path, "%s/segment_%03d%s", dir, segment, suffix);
+}
+
+void dsda_ParallelRenderFile(dsda_string_t* path, const char* suffix) {
+  dsda_SegmentPath(path, dsda_RenderDir(), dsda_Arg(dsda_arg_render_segment)->value.v_int, suffix);
+}
+
+// Segments keep the container of the video temp file
+const char* dsda_ParallelRenderVideoSuffix(void) {
+  const char* ext;
+
+  ext = strrchr(dsda_StringConfig(dsda_config_cap_tempfile2), '.');
+
+  return ext ? ext : "";
+}
+
+static void dsda_WriteSegmentManifest(void) {
+  dsda_string_t path;
+  dsda_string_t text;
+  int i;
+
+  dsda_InitString(&text, NULL);
+  for (i = 0; i < segment_count; i++)
+    dsda_StringCatF(&text, "%d\n", segment_start[i]);
+
+  dsda_StringPrintF(&path, "%s/%s", dsda_RenderDir(), MANIFEST_NAME);
+
+  if (!M_WriteFile(path.string, text.string, strlen(text.string)))
+    I_Error("dsda_UpdateParallelRender: unable to write %s", path.string);
+
+  dsda_FreeString(&path);
+  dsda_FreeString(&text);
+}
+
+static void dsda_ReadSegmentManifest(const char* dir) {
+  dsda_string_t path;
+  char* text;
+  char** lines;
+  int i;
+
+  dsda_StringPrintF(&path, "%s/%s", dir, MANIFEST_NAME);
+
+  if (M_ReadFileToString(path.string, &text) < 0)
+    I_Error("dsda_ParallelRender: unable to read %s", path.string);
+
+  segment_count = 0;
+  lines = dsda_SplitString(text, "\n");
+
+  for (i = 0; lines[i] && segment_count < MAX_SEGMENTS; i++)
+    if (sscanf(lines[i], "%d", &segment_start[segment_count]) == 1)
+      segment_count++;
+
+  if (!segment_count)
+    I_Error("dsda_ParallelRender: %s has no segments", path.string);
+
+  Z_Free(lines);
+  Z_Free(text);
+  dsda_FreeString(&path);
+}
+
+static void dsda_StoreSegmentKeyFrame(int segment) {
+  dsda_key_frame_t key_frame = { 0 };
+  dsda_string_t path;
+
+  dsda_StoreKeyFrame(&key_frame, false, false);
+
+  dsda_SegmentPath(&path, dsda_RenderDir(), segment, ".kf");
+
+  if (!M_WriteFile(path.string, key_frame.buffer, key_frame.buffer_length))
+    I_Error("dsda_UpdateParallelRender: unable to write %s", path.string);
+
+  Z_Free(key_frame.buffer);
+  dsda_FreeString(&path);
+}
+
+static void dsda_RestoreSegmentKeyFrame(void) {
+  dsda_key_frame_t key_frame = { 0 };
+  dsda_string_t path;
+
+  dsda_ParallelRenderFile(&path, ".kf");
+
+  if (M_ReadFile(path.string, &key_frame.buffer) < 0)
+    I_Error("dsda_UpdateParallelRender: unable to read %s", path.string);
+
+  dsda_RestoreKeyFrame(&key_frame, true);
+
+  // The restore message isn't part of the demo
+  dsda_InitMessenger();
+
+  Z_Free(key_frame.buffer);
+  dsda_FreeString(&path);
+}
+
+// Follows the capture loop of D_DoomLoop, which runs one tic per pass
+//   under -timedemo, so a segment continues the frame timing of the last
+static int dsda_CaptureFracAt(int tic) {
+  int step = TICRATE * FRACUNIT / cap_fps;
+  int frac = 0;
+
+  while (tic-- > 0) {
+    frac += step;
+    while (frac <= FRACUNIT)
+      frac += step;
+    frac -= FRACUNIT + step;
+  }
+
+  return frac;
+}
+
+static void dsda_UpdateKeyFramePass(void) {
+  int jobs;
+
+  if (!segment_count) {
+    if (!capturing_video)
+      I_Error("dsda_UpdateParallelRender: sound capture failed to start");
+
+    segment_start[segment_count++] = 0;
+    dsda_WriteSegmentManifest();
+  }
+
+  jobs = MIN(dsda_SimpleIntArg(dsda_arg_render_jobs), MAX_SEGMENTS);
+
+  // Segments start where the level is already on screen,
+  //   so no process begins in the middle of a wipe
+  if (
+    segment_count < jobs &&
+    true_logictic >= (long long) demo_tics_count * segment_count / jobs &&
+    gamestate == GS_LEVEL &&
+    leveltime > 0 &&
+    gameaction == ga_nothing
+  ) {
+    dsda_StoreSegmentKeyFrame(segment_count);
+    segment_start[segment_count++] = true_logictic;
+    dsda_WriteSegmentManifest();
+  }
+}
+
+static void dsda_UpdateSegmentPass(void) {
+  if (!segment_started) {
+    int segment;
+
+    segment_started = true;
+
+    if (!capturing_video)
+      I_Error("dsda_UpdateParallelRender: video capture failed to start");
+
+    segment = dsda_Arg(dsda_arg_render_segment)->value.v_int;
+    dsda_ReadSegmentManifest(dsda_RenderDir());
+
+    if (segment >= segment_count)
+      I_Error("dsda_UpdateParallelRender: there are only %d segments", segment_count);
+
+    segment_end = segment + 1 < segment_count ? segment_start[segment + 1] : INT_MAX;
+
+    if (segment > 0) {
+      dsda_RestoreSegmentKeyFrame();
+
+      if (true_logictic != segment_start[segment])
+        I_Error("dsda_UpdateParallelRender: key frame %d is at tic %d instead of %d",
+                segment, true_logictic, segment_start[segment]);
+    }
+
+    cap_frac = dsda_CaptureFracAt(segment_start[segment]);
+  }
+
+  // The frames of this tic belong to the next segment
+  if (true_logictic >= segment_end)
+    I_SafeExit(0);
+}
+
+// Called at the start of each demo tic
+void dsda_UpdateParallelRender(void) {
+  switch (dsda_ParallelRenderPass()) {
+    case parallel_render_key_frames:
+      dsda_UpdateKeyFramePass();
+      break;
+    case parallel_render_segment:
+      dsda_UpdateSegmentPass();
+      break;
+    default:
+      break;
+  }
+}
+
+static intptr_t dsda_StartRenderProcess(const char* dir, int segment, int threads) {
+  extern int dsda_argc;
+  extern char** dsda_argv;
+
+  char** argv;
+  char segment_arg[16];
+  char threads_arg[16];
+  int argc = 0;
+  int i;
+  intptr_t result;
+
+  argv = Z_Calloc(dsda_argc + 9, sizeof(*argv));
+
+  for (i = 0; i < dsda_argc; i++)
+    argv[argc++] = dsda_argv[i];
+
+  argv[argc++] = "-renderdir";
+  argv[argc++] = (char*) dir;
+
+  if (segment < 0) {
+    if (!dsda_Flag(dsda_arg_nodraw))
+      argv[argc++] = "-nodraw";
+  }
+  else {
+    snprintf(segment_arg, sizeof(segment_arg), "%d", segment);
+    argv[argc++] = "-rendersegment";
+    argv[argc++] = segment_arg;
+
+    if (!dsda_Flag(dsda_arg_nosound))
+      argv[argc++] = "-nosound";
+
+    if (!dsda_Flag(dsda_arg_threads)) {
+      snprintf(threads_arg, sizeof(threads_arg), "%d", threads);
+      argv[argc++] = "-threads";
+      argv[argc++] = threads_arg;
+    }
+  }
+
+  result = I_StartProcess(argv);
+
+  Z_Free(argv);
+
+  return result;
+}
+
+static void dsda_WriteSegmentList(const char* path) {
+  FILE* file;
+  int i;
+
+  file = M_OpenFile(path, "wb");
+
+  if (!file)
+    I_Error("dsda_RunParallelRender: unable to write %s", path);
+
+  // Names are relative to the list
+  fprintf(file, "ffconcat version 1.0\n");
+  for (i = 0; i < segment_count; i++)
+    fprintf(file, "file 'segment_%03d%s'\n", i, dsda_ParallelRenderVideoSuffix());
+
+  fclose(file);
+}
+
+static void dsda_RemoveSegmentFiles(const char* dir) {
+  dsda_string_t path;
+  int i;
+
+  for (i = 0; i < segment_count; i++) {
+    dsda_SegmentPath(&path, dir, i, ".kf");
+    M_remove(path.string);
+    dsda_FreeString(&path);
+
+    dsda_SegmentPath(&path, dir, i, dsda_ParallelRenderVideoSuffix());
+    M_remove(path.string);
+    dsda_FreeString(&path);
+  }
+
+  dsda_StringPrintF(&path, "%s/%s", dir, MANIFEST_NAME);
+  M_remove(path.string);
+  dsda_FreeString(&path);
+
+  dsda_StringPrintF(&path, "%s/%s", dir, SEGMENT_LIST_NAME);
+  M_remove(path.string);
+  dsda_FreeString(&path);
+}
+
+void dsda_RunParallelRender(void) {
+  intptr_t processes[MAX_SEGMENTS];
+  dsda_string_t dir;
+  dsda_string_t path;
+  const char* video;
+  int threads;
+  int failed = 0;
+  int i;
+
+  if (!dsda_Flag(dsda_arg_timedemo) || !dsda_Flag(dsda_arg_viddump))
+    I_Error("dsda_RunParallelRender: -renderjobs needs -timedemo and -viddump");
+
+  // Wipes are captured in real time, so their frames can't be split
+  if (dsda_IntConfig(dsda_config_cap_wipescreen))
+    I_Error("dsda_RunParallelRender: -renderjobs needs cap_wipescreen off");
+
+  video = dsda_Arg(dsda_arg_viddump)->value.v_string;
+
+  dsda_StringPrintF(&dir, "%s.parts", video);
+  M_MakeDir(dir.string, true);
+
+  dsda_StringPrintF(&path, "%s/%s", dir.string, MANIFEST_NAME);
+  M_remove(path.string);
+  dsda_FreeString(&path);
+
+  lprintf(LO_INFO, "dsda_RunParallelRender: capturing sound and key frames\n");
+
+  if (I_WaitProcess(dsda_StartRenderProcess(dir.string, -1, 0)))
+    I_Error("dsda_RunParallelRender: the key frame pass failed");
+
+  dsda_ReadSegmentManifest(dir.string);
+
+  threads = MAX(1, SDL_GetCPUCount() / segment_count);
+
+  lprintf(LO_INFO, "dsda_RunParallelRender: rendering %d segments\n", segment_count);
+
+  for (i = 0; i < segment_count; i++)
+    processes[i] = dsda_StartRenderProcess(dir.string, i, threads);
+
+  for (i = 0; i < segment_count; i++)
+    if (I_WaitProcess(processes[i])) {
+      lprintf(LO_ERROR, "dsda_RunParallelRender: segment %d failed\n", i);
+      ++failed;
+    }
+
+  if (failed)
+    I_Error("dsda_RunParallelRender: %d of %d segments failed", failed, segment_count);
+
+  dsda_StringPrintF(&path, "%s/%s", dir.string, SEGMENT_LIST_NAME);
+  dsda_WriteSegmentList(path.string);
+
+  I_CaptureJoinSegments(video, path.string);
+
+  if (dsda_IntConfig(dsda_config_cap_remove_tempfiles))
+    dsda_RemoveSegmentFiles(dir.string);
+
+  dsda_FreeString(&path);
+  dsda_FreeString(&dir);
+
+  I_SafeExit(0);
+}
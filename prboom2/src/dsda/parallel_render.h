@@ -0,0 +1,35 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Parallel Render
+//
+
+#ifndef __DSDA_PARALLEL_RENDER__
+#define __DSDA_PARALLEL_RENDER__
+
+#include "dsda/utility.h"
+
+typedef enum {
+  parallel_render_none,
+  parallel_render_key_frames, // stores key frames and captures the sound
+  parallel_render_segment,    // captures the video of one segment
+} parallel_render_pass_t;
+
+parallel_render_pass_t dsda_ParallelRenderPass(void);
+void dsda_ParallelRenderFile(dsda_string_t* path, const char* suffix);
+const char* dsda_ParallelRenderVideoSuffix(void);
+void dsda_UpdateParallelRender(void);
+void dsda_RunParallelRender(void);
+
+#endif
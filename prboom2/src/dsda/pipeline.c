@@ -0,0 +1,325 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Pipeline
+//
+//  With -presentsim, tics that are already due when a frame is finished
+//  are simulated on a pool thread while the main thread presents that
+//  frame. The frame being presented is a finished image, so the simulation
+//  never races the renderer. The renderer starts on the next frame only
+//  after those tics are done. This only overlaps the present (the texture
+//  upload, the swap and any vsync wait), not the rendering of the view,
+//  so it gains little when presenting doesn't wait for the display. Tics
+//  that change the game state (level loads, reborns, demo ends) are left
+//  to the serial loop, which also handles everything that must run on the
+//  main thread.
+//
+//  -pipelinereport prints the frame throughput and the latency from the
+//  start of a tic to the present of the first frame showing it. It works
+//  with and without -presentsim, so the two loops can be compared. The
+//  same measurements feed the frame times of each presented frame.
+//
+
+#include <string.h>
+
+#include "d_main.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "i_capture.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "lprintf.h"
+#include "m_menu.h"
+#include "r_fps.h"
+#include "z_zone.h"
+
+#include "core/thread_pool.h"
+
+#include "dsda/args.h"
+#include "dsda/brute_force.h"
+#include "dsda/build.h"
+#include "dsda/dynamic_resolution.h"
+#include "dsda/frame_times.h"
+#include "dsda/playback.h"
+#include "dsda/skip.h"
+#include "dsda/time.h"
+
+#include "pipeline.h"
+
+typedef struct {
+  int runtics;
+  int ran;
+  unsigned long long first_tic_us;
+  unsigned long long sim_us;
+} pipeline_job_t;
+
+typedef struct {
+  int frames;
+  int tics;
+  int overlapped_tics;
+  int latency_samples;
+  unsigned long long first_present_us;
+  unsigned long long last_present_us;
+  unsigned long long render_us;
+  unsigned long long present_us;
+  unsigned long long sim_us;
+  unsigned long long latency_us;
+  unsigned long long max_latency_us;
+} pipeline_report_t;
+
+static dboolean present_sim;
+static dboolean pipeline_report;
+static dboolean pipeline_timed;
+static int present_sim_gametic = -1;
+
+static pipeline_report_t report;
+static pipeline_job_t job;
+static unsigned long long render_start_us;
+static unsigned long long tic_start_us;
+static unsigned long long pending_tic_us;
+static dboolean tic_pending;
+static unsigned long long frame_sim_us;
+static unsigned long long last_present_us;
+
+// Frame times and dynamic resolution both need each frame's timings
+static dboolean dsda_PipelineTimed(void) {
+  return pipeline_report || dsda_FrameTimesActive() || dsda_DynamicResolutionActive();
+}
+
+static unsigned long long dsda_PipelineTime(void) {
+  return dsda_ElapsedTime(dsda_timer_pipeline);
+}
+
+static void dsda_PrintPipelineReport(void) {
+  double seconds;
+
+  if (!report.frames)
+    return;
+
+  seconds = (report.last_present_us - report.first_present_us) / 1000000.0;
+
+  lprintf(LO_INFO, "Frame pipeline report (%s loop):\n",
+          present_sim ? "present overlapped" : "serial");
+  lprintf(LO_INFO, "  %d frames in %.2f s (%.1f fps)\n",
+          report.frames, seconds, seconds > 0 ? (report.frames - 1) / seconds : 0.0);
+  lprintf(LO_INFO, "  %d tics, %d simulated during present\n",
+          report.tics, report.overlapped_tics);
+  lprintf(LO_INFO, "  render %.2f ms, present %.2f ms per frame, simulation %.2f ms per tic\n",
+          report.render_us / 1000.0 / report.frames,
+          report.present_us / 1000.0 / report.frames,
+          report.tics ? report.sim_us / 1000.0 / report.tics : 0.0);
+
+  if (report.latency_samples)
+    lprintf(LO_INFO, "  latency %.2f ms average, %.2f ms max\n",
+            report.latency_us / 1000.0 / report.latency_samples,
+            report.max_latency_us / 1000.0);
+}
+
+void dsda_InitPipeline(void) {
+  present_sim = dsda_Flag(dsda_arg_present_sim);
+  pipeline_report = dsda_Flag(dsda_arg_pipeline_report);
+  pipeline_timed = dsda_PipelineTimed();
+
+  dsda_StartTimer(dsda_timer_pipeline);
+
+  if (pipeline_report)
+    I_AtExit(dsda_PrintPipelineReport, false, "dsda_PrintPipelineReport", exit_priority_normal);
+}
+
+static void dsda_MarkTicStart(unsigned long long now) {
+  if (!tic_pending) {
+    tic_pending = true;
+    pending_tic_us = now;
+  }
+}
+
+void dsda_PipelineTicStart(void) {
+  if (!pipeline_timed)
+    return;
+
+  tic_start_us = dsda_PipelineTime();
+  dsda_MarkTicStart(tic_start_us);
+}
+
+void dsda_PipelineTicEnd(void) {
+  unsigned long long sim_us;
+
+  if (!pipeline_timed)
+    return;
+
+  sim_us = dsda_PipelineTime() - tic_start_us;
+  frame_sim_us += sim_us;
+  report.sim_us += sim_us;
+  report.tics++;
+}
+
+void dsda_PipelineFrameStart(void) {
+  if (pipeline_timed)
+    render_start_us = dsda_PipelineTime();
+}
+
+// Frames presented elsewhere (wipes) are not timed, and neither is the gap
+void dsda_PipelineSkipFrame(void) {
+  last_present_us = 0;
+  frame_sim_us = 0;
+}
+
+// True if the last present ran the due tics and none ran since, so the
+//   state those tics produced hasn't been drawn yet
+dboolean dsda_PipelineRanTics(void) {
+  dboolean result = present_sim_gametic == gametic;
+
+  present_sim_gametic = -1;
+
+  return result;
+}
+
+// Anything that reloads the level, ends the demo or needs the main thread
+//   keeps the tic in the serial loop
+static dboolean dsda_PipelineTicAllowed(void) {
+  int i;
+
+  if (gamestate != GS_LEVEL || gamestate != wipegamestate ||
+      gameaction != ga_nothing || advancedemo)
+    return false;
+
+  if (dsda_SkipMode() || dsda_BruteForce() || dsda_BuildMode())
+    return false;
+
+  if (demoplayback && dsda_PlaybackStreamEnded())
+    return false;
+
+  for (i = 0; i < g_maxplayers; i++)
+    if (playeringame[i] && players[i].playerstate == PST_REBORN)
+      return false;
+
+  return true;
+}
+
+// G_Ticker can reach the zone here, for instance through a music change
+//   or a key frame. That is only safe because the main thread stays out of
+//   the zone until the job finishes: it only presents a finished frame,
+//   with no capture queued. The zone checks this in debug builds.
+static void dsda_PipelineTicsJob(void* data) {
+  pipeline_job_t* job = data;
+
+  Z_EnterThread();
+
+  while (job->ran < job->runtics && dsda_PipelineTicAllowed()) {
+    unsigned long long start;
+
+    start = pipeline_timed ? dsda_PipelineTime() : 0;
+    if (!job->ran)
+      job->first_tic_us = start;
+
+    M_Ticker();
+    G_Ticker();
+    gametic++;
+    job->ran++;
+
+    if (pipeline_timed)
+      job->sim_us += dsda_PipelineTime() - start;
+  }
+
+  Z_LeaveThread();
+}
+
+void dsda_PipelinePresent(void) {
+  unsigned long long present_start = 0;
+  unsigned long long present_end;
+  unsigned long long shown_tic_us = 0;
+  dboolean shown_tic = false;
+
+  memset(&job, 0, sizeof(job));
+
+  if (pipeline_timed) {
+    present_start = dsda_PipelineTime();
+    report.render_us += present_start - render_start_us;
+
+    // This frame shows every tic started so far
+    shown_tic = tic_pending;
+    shown_tic_us = pending_tic_us;
+    tic_pending = false;
+  }
+
+  // The zone is not thread safe, so nothing that presents a capture
+  //   may run next to the simulation. Extra frames drawn while waiting
+  //   for a tic are left alone, so the loop that waits runs the tics.
+  if (present_sim && !isExtraDDisplay && !capturing_video && !I_FrameCaptureQueued() &&
+      maketic > gametic && dsda_PipelineTicAllowed()) {
+    thread_pool_task_t* task;
+
+    job.runtics = maketic - gametic;
+
+    // A palette set before this frame goes up now, and one set by the
+    //   tics waits for the next present
+    I_UpdatePalette();
+    I_HoldPalette(true);
+
+    task = I_ThreadPoolStart(dsda_PipelineTicsJob, &job);
+    I_FinishUpdate();
+    I_ThreadPoolFinish(task);
+
+    I_HoldPalette(false);
+
+    if (job.ran)
+      present_sim_gametic = gametic;
+  }
+  else
+    I_FinishUpdate();
+
+  // Timing starts and stops between frames, never inside a tic
+  if (!pipeline_timed) {
+    pipeline_timed = dsda_PipelineTimed();
+    last_present_us = 0;
+    return;
+  }
+
+  present_end = dsda_PipelineTime();
+
+  if (!report.frames)
+    report.first_present_us = present_end;
+
+  report.frames++;
+  report.last_present_us = present_end;
+  report.present_us += present_end - present_start;
+
+  if (shown_tic) {
+    unsigned long long latency = present_end - shown_tic_us;
+
+    report.latency_us += latency;
+    report.latency_samples++;
+
+    if (latency > report.max_latency_us)
+      report.max_latency_us = latency;
+  }
+
+  if (job.ran) {
+    report.tics += job.ran;
+    report.overlapped_tics += job.ran;
+    report.sim_us += job.sim_us;
+    frame_sim_us += job.sim_us;
+    dsda_MarkTicStart(job.first_tic_us);
+  }
+
+  if (last_present_us)
+    dsda_AddFrameTime(present_end - last_present_us, frame_sim_us,
+                      present_start - render_start_us, present_end - present_start);
+
+  dsda_UpdateDynamicResolution(frame_sim_us + present_start - render_start_us);
+
+  last_present_us = present_end;
+  frame_sim_us = 0;
+  pipeline_timed = dsda_PipelineTimed();
+}
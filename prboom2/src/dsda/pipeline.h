@@ -0,0 +1,31 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Pipeline
+//
+
+#ifndef __DSDA_PIPELINE__
+#define __DSDA_PIPELINE__
+
+#include "doomtype.h"
+
+void dsda_InitPipeline(void);
+void dsda_PipelineFrameStart(void);
+void dsda_PipelinePresent(void);
+void dsda_PipelineSkipFrame(void);
+dboolean dsda_PipelineRanTics(void);
+void dsda_PipelineTicStart(void);
+void dsda_PipelineTicEnd(void);
+
+#endif
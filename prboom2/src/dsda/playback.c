@@ -31,8 +31,12 @@
 
 #include "playback.h"
 
+// Played back tic data is dropped from memory in steps of this size
+#define PLAYBACK_EVICT_SIZE 0x40000
+
 static const byte* playback_origin_p;
 static const byte* playback_p;
+static const byte* playback_evicted_p;
 static int playback_length;
 static int playback_behaviour;
 
@@ -180,6 +184,7 @@ void dsda_InitDemoPlayback(void) {
 void dsda_AttachPlaybackStream(const byte* demo_p, int length, int behaviour) {
   playback_origin_p = demo_p;
   playback_p = demo_p;
+  playback_evicted_p = demo_p;
   playback_length = length;
   playback_behaviour = behaviour;
   demo_tics = 0;
@@ -198,6 +203,7 @@ void dsda_RestorePlaybackPosition(void) {
 void dsda_ClearPlaybackStream(void) {
   playback_origin_p = NULL;
   playback_p = NULL;
+  playback_evicted_p = NULL;
   playback_length = 0;
   playback_behaviour = 0;
   demo_tics = 0;
@@ -211,6 +217,10 @@ static dboolean dsda_EndOfPlaybackStream(void) {
          playback_p + dsda_BytesPerTic() > playback_origin_p + playback_length;
 }
 
+dboolean dsda_PlaybackStreamEnded(void) {
+  return playback_p && dsda_EndOfPlaybackStream();
+}
+
 void dsda_JoinDemo(ticcmd_t* cmd) {
   if (!demoplayback)
     return;
@@ -243,6 +253,14 @@ void dsda_TryPlaybackOneTick(ticcmd_t* cmd) {
     G_ReadOneTick(cmd, &playback_p);
 
     ++demo_tics;
+
+    // Keep resident memory flat for long demos; rewinds fault pages back in
+    if (playback_p - playback_evicted_p >= PLAYBACK_EVICT_SIZE) {
+      dsda_EvictExDemo(playback_evicted_p, playback_p);
+      playback_evicted_p = playback_p;
+    }
+    else if (playback_p < playback_evicted_p)
+      playback_evicted_p = playback_p;
   }
 
   if (ended) {
@@ -31,5 +31,6 @@ void dsda_InitDemoPlayback(void);
 void dsda_AttachPlaybackStream(const byte* demo_p, int length, int behaviour);
 void dsda_StorePlaybackPosition(void);
 void dsda_RestorePlaybackPosition(void);
+dboolean dsda_PlaybackStreamEnded(void);
 void dsda_JoinDemo(ticcmd_t* cmd);
 void dsda_TryPlaybackOneTick(ticcmd_t* cmd);
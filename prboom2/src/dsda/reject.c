@@ -0,0 +1,756 @@
+//
+// Copyright(C) 2026 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Reject Builder
+//
+//  Many maps ship an empty REJECT, so every sight check falls through to
+//  the full BSP traversal. This builds a conservative sector to sector
+//  visibility matrix on a background thread after the level is loaded,
+//  by flowing through the two-sided lines (portals) between sectors and
+//  clipping each portal to what can be seen through the previous ones.
+//
+//  A pair of sectors is only rejected if no straight line can pass between
+//  them, so the result only skips traversals that would fail anyway. Even
+//  so, it is never consulted while recording or playing back a demo, or in
+//  a netgame.
+//
+//  The matrix is written to the cache when the build finishes and is only
+//  used from the next time the map is loaded, so the table sight checks
+//  see never changes in the middle of a level.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "md5.h"
+#include "r_defs.h"
+#include "r_state.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/data_organizer.h"
+#include "dsda/utility.h"
+
+#include "reject.h"
+
+// Bump when the builder changes, to invalidate old cache files
+#define REJECT_BUILDER_VERSION 2
+
+// Slack in map units when clipping, so that touching counts as passing
+#define REJECT_EPSILON (1.0 / 64)
+
+// Give up on precise flow from a sector after this many portal steps
+#define REJECT_STEP_LIMIT 200000
+#define REJECT_DEPTH_LIMIT 256
+
+// Larger maps are skipped, to bound the matrix and the build time
+#define REJECT_MAX_SECTORS 16384
+
+typedef struct {
+  double x1, y1, x2, y2;
+} reject_seg_t;
+
+typedef struct {
+  reject_seg_t seg;
+  int sector[2]; // front, back
+} reject_portal_t;
+
+typedef struct {
+  double a, b, c; // a*x + b*y + c >= 0 is allowed
+} reject_plane_t;
+
+typedef struct {
+  int numsectors;
+  int numportals;
+  reject_portal_t* portals;
+  int* sector_portals_start; // numsectors + 1 entries
+  int* sector_portals;       // portal * 2 + side of the sector
+  int* component;
+
+  // flow state
+  byte* visible;
+  byte* in_chain;
+  reject_plane_t* planes;
+  int steps;
+
+  byte* matrix;
+  size_t matrix_size;
+  SDL_atomic_t cancel;
+} reject_build_t;
+
+static reject_build_t* build;
+static SDL_Thread* build_thread;
+static const byte* built_reject;
+static dsda_cksum_t build_cksum;
+
+static double dsda_PlaneDistance(const reject_plane_t* plane, double x, double y) {
+  return plane->a * x + plane->b * y + plane->c;
+}
+
+static dboolean dsda_PlaneThroughPoints(reject_plane_t* plane,
+                                        double x1, double y1, double x2, double y2) {
+  double dx = x2 - x1;
+  double dy = y2 - y1;
+  double length = sqrt(dx * dx + dy * dy);
+
+  if (length < REJECT_EPSILON)
+    return false;
+
+  // Positive distance on the left of (x1, y1) -> (x2, y2)
+  plane->a = -dy / length;
+  plane->b = dx / length;
+  plane->c = -(plane->a * x1 + plane->b * y1);
+
+  return true;
+}
+
+// Keeps the part of the segment on the allowed side of the plane
+static dboolean dsda_ClipSeg(reject_seg_t* seg, const reject_plane_t* plane) {
+  double d1 = dsda_PlaneDistance(plane, seg->x1, seg->y1) + REJECT_EPSILON;
+  double d2 = dsda_PlaneDistance(plane, seg->x2, seg->y2) + REJECT_EPSILON;
+  double t;
+
+  if (d1 >= 0 && d2 >= 0)
+    return true;
+
+  if (d1 < 0 && d2 < 0)
+    return false;
+
+  t = d1 / (d1 - d2);
+
+  if (d1 < 0) {
+    seg->x1 = seg->x1 + t * (seg->x2 - seg->x1);
+    seg->y1 = seg->y1 + t * (seg->y2 - seg->y1);
+  }
+  else {
+    seg->x2 = seg->x1 + t * (seg->x2 - seg->x1);
+    seg->y2 = seg->y1 + t * (seg->y2 - seg->y1);
+  }
+
+  return true;
+}
+
+// The side of the portal a ray is on after passing through it from side
+static void dsda_PortalPlane(reject_plane_t* plane, const reject_portal_t* portal, int side) {
+  if (!dsda_PlaneThroughPoints(plane, portal->seg.x1, portal->seg.y1,
+                                      portal->seg.x2, portal->seg.y2)) {
+    plane->a = plane->b = 0;
+    plane->c = 1;
+    return;
+  }
+
+  // Doom's front side is on the right, where the distance is negative
+  if (side == 1) {
+    plane->a = -plane->a;
+    plane->b = -plane->b;
+    plane->c = -plane->c;
+  }
+}
+
+// Clip the target to the lines which pass through both the source and the
+// pass segments. For each separating line through one endpoint of each,
+// the target must be on the same side as the pass segment's other endpoint.
+static dboolean dsda_ClipToSeparators(reject_seg_t* target,
+                                      const reject_seg_t* source, const reject_seg_t* pass) {
+  const double sx[2] = { source->x1, source->x2 }, sy[2] = { source->y1, source->y2 };
+  const double px[2] = { pass->x1, pass->x2 }, py[2] = { pass->y1, pass->y2 };
+  int i, j;
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++) {
+      reject_plane_t plane;
+      double ds, dp;
+
+      if (!dsda_PlaneThroughPoints(&plane, sx[i], sy[i], px[j], py[j]))
+        continue;
+
+      ds = dsda_PlaneDistance(&plane, sx[!i], sy[!i]);
+      dp = dsda_PlaneDistance(&plane, px[!j], py[!j]);
+
+      if (ds > REJECT_EPSILON && dp < -REJECT_EPSILON) {
+        plane.a = -plane.a;
+        plane.b = -plane.b;
+        plane.c = -plane.c;
+      }
+      else if (!(ds < -REJECT_EPSILON && dp > REJECT_EPSILON))
+        continue;
+
+      if (!dsda_ClipSeg(target, &plane))
+        return false;
+    }
+
+  return true;
+}
+
+static void dsda_MarkComponentVisible(reject_build_t* b, int source) {
+  int i;
+
+  for (i = 0; i < b->numsectors; i++)
+    if (b->component[i] == b->component[source])
+      b->visible[i] = 1;
+}
+
+// Returns false if the step budget ran out
+static dboolean dsda_FlowThroughSector(reject_build_t* b, int sector, int depth,
+                                       const reject_seg_t* source, const reject_seg_t* pass) {
+  int i;
+
+  if (++b->steps > REJECT_STEP_LIMIT || depth >= REJECT_DEPTH_LIMIT)
+    return false;
+
+  if (SDL_AtomicGet(&b->cancel))
+    return true;
+
+  for (i = b->sector_portals_start[sector]; i < b->sector_portals_start[sector + 1]; i++) {
+    int portal_index = b->sector_portals[i] >> 1;
+    int side = b->sector_portals[i] & 1;
+    const reject_portal_t* portal = &b->portals[portal_index];
+    reject_seg_t target = portal->seg;
+    reject_seg_t next_source;
+    reject_plane_t near_side;
+    int k;
+
+    if (b->in_chain[portal_index])
+      continue;
+
+    // A straight line stays on the far side of every portal it has crossed
+    for (k = 0; k < depth; k++)
+      if (!dsda_ClipSeg(&target, &b->planes[k]))
+        break;
+
+    if (k < depth)
+      continue;
+
+    if (pass && !dsda_ClipToSeparators(&target, source, pass))
+      continue;
+
+    // The source must be crossed before the target
+    next_source = *source;
+    dsda_PortalPlane(&near_side, portal, !side);
+    if (!dsda_ClipSeg(&next_source, &near_side))
+      continue;
+
+    b->visible[portal->sector[!side]] = 1;
+
+    b->in_chain[portal_index] = 1;
+    dsda_PortalPlane(&b->planes[depth], portal, side);
+
+    if (!dsda_FlowThroughSector(b, portal->sector[!side], depth + 1, &next_source, &target)) {
+      b->in_chain[portal_index] = 0;
+      return false;
+    }
+
+    b->in_chain[portal_index] = 0;
+  }
+
+  return true;
+}
+
+static void dsda_BuildRejectRow(reject_build_t* b, int source) {
+  int i;
+
+  memset(b->visible, 0, b->numsectors);
+  b->visible[source] = 1;
+  b->steps = 0;
+
+  for (i = b->sector_portals_start[source]; i < b->sector_portals_start[source + 1]; i++) {
+    int portal_index = b->sector_portals[i] >> 1;
+    int side = b->sector_portals[i] & 1;
+    const reject_portal_t* portal = &b->portals[portal_index];
+
+    b->visible[portal->sector[!side]] = 1;
+
+    b->in_chain[portal_index] = 1;
+    dsda_PortalPlane(&b->planes[0], portal, side);
+
+    if (!dsda_FlowThroughSector(b, portal->sector[!side], 1, &portal->seg, NULL)) {
+      b->in_chain[portal_index] = 0;
+      dsda_MarkComponentVisible(b, source);
+      return;
+    }
+
+    b->in_chain[portal_index] = 0;
+  }
+}
+
+static int dsda_FindComponent(int* parent, int i) {
+  while (parent[i] != i)
+    i = parent[i] = parent[parent[i]];
+
+  return i;
+}
+
+static void dsda_MarkRowVisible(reject_build_t* b, int source) {
+  int i;
+
+  // Sight is symmetric, so only reject if neither direction can see
+  for (i = 0; i < b->numsectors; i++)
+    if (b->visible[i]) {
+      size_t pnum1 = (size_t) source * b->numsectors + i;
+      size_t pnum2 = (size_t) i * b->numsectors + source;
+
+      b->matrix[pnum1 >> 3] &= ~(1 << (pnum1 & 7));
+      b->matrix[pnum2 >> 3] &= ~(1 << (pnum2 & 7));
+    }
+}
+
+static int SDLCALL dsda_RejectBuilderThread(void* data) {
+  reject_build_t* b = data;
+  int i;
+
+  b->component = malloc(b->numsectors * sizeof(*b->component));
+  b->visible = malloc(b->numsectors);
+  b->in_chain = calloc(b->numportals + 1, 1);
+  b->planes = malloc(REJECT_DEPTH_LIMIT * sizeof(*b->planes));
+  b->matrix_size = ((size_t) b->numsectors * b->numsectors + 7) / 8;
+  b->matrix = malloc(b->matrix_size);
+
+  if (!b->component || !b->visible || !b->in_chain || !b->planes || !b->matrix) {
+    free(b->matrix);
+    b->matrix = NULL;
+  }
+  else {
+    // union the sectors joined by portals, for the fallback
+    for (i = 0; i < b->numsectors; i++)
+      b->component[i] = i;
+    for (i = 0; i < b->numportals; i++) {
+      int s1 = dsda_FindComponent(b->component, b->portals[i].sector[0]);
+      int s2 = dsda_FindComponent(b->component, b->portals[i].sector[1]);
+
+      b->component[s1] = s2;
+    }
+    for (i = 0; i < b->numsectors; i++)
+      b->component[i] = dsda_FindComponent(b->component, i);
+
+    memset(b->matrix, 0xff, b->matrix_size);
+
+    for (i = 0; i < b->numsectors && !SDL_AtomicGet(&b->cancel); i++) {
+      dsda_BuildRejectRow(b, i);
+      dsda_MarkRowVisible(b, i);
+    }
+
+    if (SDL_AtomicGet(&b->cancel)) {
+      free(b->matrix);
+      b->matrix = NULL;
+    }
+  }
+
+  free(b->planes);
+  free(b->in_chain);
+  free(b->visible);
+  free(b->component);
+
+  return 0;
+}
+
+typedef struct {
+  int sector;
+  fixed_t x, y;
+} sector_vertex_t;
+
+static int dsda_CompareSectorVertex(const void* a, const void* b) {
+  const sector_vertex_t* v1 = a;
+  const sector_vertex_t* v2 = b;
+
+  if (v1->sector != v2->sector)
+    return v1->sector < v2->sector ? -1 : 1;
+
+  if (v1->x != v2->x)
+    return v1->x < v2->x ? -1 : 1;
+
+  if (v1->y != v2->y)
+    return v1->y < v2->y ? -1 : 1;
+
+  return 0;
+}
+
+// The flow treats each sector as one region bounded by its lines. That
+// doesn't hold if a sector's boundary isn't closed or subsectors disagree
+// with their segs about the sector, since sight can then leak between
+// sectors without crossing a line.
+static dboolean dsda_RejectGeometryIsClosed(void) {
+  sector_vertex_t* ends;
+  int count = 0;
+  int i;
+  dboolean closed = true;
+
+  for (i = 0; i < numsubsectors; i++) {
+    int j;
+    const seg_t* seg = &segs[subsectors[i].firstline];
+
+    for (j = 0; j < subsectors[i].numlines; j++, seg++)
+      if (seg->sidedef && seg->frontsector != subsectors[i].sector)
+        return false;
+  }
+
+  ends = Z_Malloc(numlines * 4 * sizeof(*ends));
+
+  for (i = 0; i < numlines; i++) {
+    const line_t* line = &lines[i];
+    int side;
+
+    if (line->frontsector == line->backsector)
+      continue;
+
+    for (side = 0; side < 2; side++) {
+      const sector_t* sector = side ? line->backsector : line->frontsector;
+
+      if (!sector)
+        continue;
+
+      ends[count].sector = sector->iSectorID;
+      ends[count].x = line->v1->x;
+      ends[count].y = line->v1->y;
+      count++;
+      ends[count].sector = sector->iSectorID;
+      ends[count].x = line->v2->x;
+      ends[count].y = line->v2->y;
+      count++;
+    }
+  }
+
+  // Every vertex on a closed boundary is shared by an even number of lines
+  qsort(ends, count, sizeof(*ends), dsda_CompareSectorVertex);
+
+  for (i = 0; i < count; ) {
+    int j = i + 1;
+
+    while (j < count && !dsda_CompareSectorVertex(&ends[i], &ends[j]))
+      j++;
+
+    if ((j - i) & 1) {
+      closed = false;
+      break;
+    }
+
+    i = j;
+  }
+
+  Z_Free(ends);
+
+  return closed;
+}
+
+typedef struct {
+  int vertex;
+  int sector;
+} vertex_sector_t;
+
+static int dsda_CompareVertexSector(const void* a, const void* b) {
+  const vertex_sector_t* v1 = a;
+  const vertex_sector_t* v2 = b;
+
+  if (v1->vertex != v2->vertex)
+    return v1->vertex < v2->vertex ? -1 : 1;
+
+  if (v1->sector != v2->sector)
+    return v1->sector < v2->sector ? -1 : 1;
+
+  return 0;
+}
+
+// P_CheckSight can pass a line of sight exactly through a vertex, between
+// sectors that only meet there. Every pair of sectors around a vertex gets
+// a zero length portal at it, which never clips the flow through it.
+static vertex_sector_t* dsda_SortVertexSectors(int* count) {
+  vertex_sector_t* list;
+  int i, j;
+
+  list = malloc(numlines * 4 * sizeof(*list) + 1);
+  if (!list)
+    return NULL;
+
+  *count = 0;
+
+  for (i = 0; i < numlines; i++) {
+    const line_t* line = &lines[i];
+    int side;
+
+    for (side = 0; side < 2; side++) {
+      const sector_t* sector = side ? line->backsector : line->frontsector;
+
+      if (!sector)
+        continue;
+
+      list[*count].vertex = line->v1 - vertexes;
+      list[*count].sector = sector->iSectorID;
+      (*count)++;
+      list[*count].vertex = line->v2 - vertexes;
+      list[*count].sector = sector->iSectorID;
+      (*count)++;
+    }
+  }
+
+  qsort(list, *count, sizeof(*list), dsda_CompareVertexSector);
+
+  // drop duplicates
+  for (i = 0, j = 0; i < *count; i++)
+    if (!j || dsda_CompareVertexSector(&list[j - 1], &list[i]))
+      list[j++] = list[i];
+
+  *count = j;
+
+  return list;
+}
+
+static void dsda_FreeRejectBuild(reject_build_t* b);
+
+static reject_build_t* dsda_SnapshotRejectGeometry(void) {
+  reject_build_t* b;
+  vertex_sector_t* vertex_sectors;
+  int vertex_sector_count;
+  int point_portals = 0;
+  int i, j, k;
+
+  vertex_sectors = dsda_SortVertexSectors(&vertex_sector_count);
+  if (!vertex_sectors)
+    return NULL;
+
+  for (i = 0; i < vertex_sector_count; i = j) {
+    for (j = i + 1; j < vertex_sector_count && vertex_sectors[j].vertex == vertex_sectors[i].vertex; j++);
+
+    point_portals += (j - i) * (j - i - 1) / 2;
+  }
+
+  b = calloc(1, sizeof(*b));
+  if (!b) {
+    free(vertex_sectors);
+    return NULL;
+  }
+
+  b->numsectors = numsectors;
+  b->portals = malloc((numlines + point_portals) * sizeof(*b->portals) + 1);
+  b->sector_portals_start = calloc(numsectors + 1, sizeof(*b->sector_portals_start));
+
+  if (!b->portals || !b->sector_portals_start) {
+    free(vertex_sectors);
+    dsda_FreeRejectBuild(b);
+    return NULL;
+  }
+
+  for (i = 0; i < numlines; i++) {
+    const line_t* line = &lines[i];
+    reject_portal_t* portal;
+
+    if (!line->backsector || !line->frontsector || line->backsector == line->frontsector)
+      continue;
+
+    portal = &b->portals[b->numportals++];
+    portal->seg.x1 = (double) line->v1->x / FRACUNIT;
+    portal->seg.y1 = (double) line->v1->y / FRACUNIT;
+    portal->seg.x2 = (double) line->v2->x / FRACUNIT;
+    portal->seg.y2 = (double) line->v2->y / FRACUNIT;
+    portal->sector[0] = line->frontsector->iSectorID;
+    portal->sector[1] = line->backsector->iSectorID;
+  }
+
+  for (i = 0; i < vertex_sector_count; i = j) {
+    const vertex_t* v = &vertexes[vertex_sectors[i].vertex];
+
+    for (j = i + 1; j < vertex_sector_count && vertex_sectors[j].vertex == vertex_sectors[i].vertex; j++);
+
+    for (k = i; k < j; k++) {
+      int m;
+
+      for (m = k + 1; m < j; m++) {
+        reject_portal_t* portal = &b->portals[b->numportals++];
+
+        portal->seg.x1 = portal->seg.x2 = (double) v->x / FRACUNIT;
+        portal->seg.y1 = portal->seg.y2 = (double) v->y / FRACUNIT;
+        portal->sector[0] = vertex_sectors[k].sector;
+        portal->sector[1] = vertex_sectors[m].sector;
+      }
+    }
+  }
+
+  free(vertex_sectors);
+
+  b->sector_portals = malloc(2 * b->numportals * sizeof(*b->sector_portals) + 1);
+  if (!b->sector_portals) {
+    dsda_FreeRejectBuild(b);
+    return NULL;
+  }
+
+  for (i = 0; i < b->numportals; i++) {
+    b->sector_portals_start[b->portals[i].sector[0] + 1]++;
+    b->sector_portals_start[b->portals[i].sector[1] + 1]++;
+  }
+
+  for (i = 0; i < numsectors; i++)
+    b->sector_portals_start[i + 1] += b->sector_portals_start[i];
+
+  {
+    int* fill = malloc((numsectors + 1) * sizeof(*fill));
+
+    if (!fill) {
+      dsda_FreeRejectBuild(b);
+      return NULL;
+    }
+
+    memcpy(fill, b->sector_portals_start, numsectors * sizeof(*fill));
+
+    for (i = 0; i < b->numportals; i++) {
+      b->sector_portals[fill[b->portals[i].sector[0]]++] = i << 1;
+      b->sector_portals[fill[b->portals[i].sector[1]]++] = (i << 1) | 1;
+    }
+
+    free(fill);
+  }
+
+  lprintf(LO_DEBUG, "dsda_SnapshotRejectGeometry: %d sectors, %d portals\n",
+          numsectors, b->numportals);
+
+  return b;
+}
+
+static void dsda_FreeRejectBuild(reject_build_t* b) {
+  free(b->portals);
+  free(b->sector_portals_start);
+  free(b->sector_portals);
+  free(b->matrix);
+  free(b);
+}
+
+static void dsda_GetRejectCheckSum(const reject_build_t* b, dsda_cksum_t* cksum) {
+  struct MD5Context md5;
+  int header[3];
+
+  header[0] = REJECT_BUILDER_VERSION;
+  header[1] = b->numsectors;
+  header[2] = b->numportals;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const byte*) header, sizeof(header));
+  MD5Update(&md5, (const byte*) b->portals, b->numportals * sizeof(*b->portals));
+  MD5Final(cksum->bytes, &md5);
+
+  dsda_TranslateCheckSum(cksum);
+}
+
+static char* dsda_RejectCacheFile(const dsda_cksum_t* cksum) {
+  dsda_string_t path;
+
+  dsda_StringPrintF(&path, "%s/reject", dsda_DataRoot());
+  M_MakeDir(path.string, false);
+  dsda_StringCatF(&path, "/%s.lmp", cksum->string);
+
+  return path.string;
+}
+
+void dsda_StopRejectBuilder(void) {
+  if (build_thread) {
+    SDL_AtomicSet(&build->cancel, 1);
+    SDL_WaitThread(build_thread, NULL);
+    build_thread = NULL;
+  }
+
+  if (build) {
+    if (build->matrix) {
+      char* filename = dsda_RejectCacheFile(&build_cksum);
+
+      M_WriteFile(filename, build->matrix, build->matrix_size);
+      Z_Free(filename);
+    }
+
+    dsda_FreeRejectBuild(build);
+    build = NULL;
+  }
+
+  if (built_reject)
+    Z_Free((void*) built_reject);
+
+  built_reject = NULL;
+}
+
+static void dsda_ExitRejectBuilder(void) {
+  dsda_StopRejectBuilder();
+}
+
+void dsda_StartRejectBuilder(dboolean reject_lump_empty) {
+  static dboolean registered_exit;
+  char* filename;
+  byte* buffer = NULL;
+  size_t required;
+  int length;
+
+  dsda_StopRejectBuilder();
+
+  if (!dsda_Flag(dsda_arg_build_reject) || !reject_lump_empty)
+    return;
+
+  if (!allow_incompatibility || netgame || compatibility_level == doom_12_compatibility)
+    return;
+
+  if (numsectors > REJECT_MAX_SECTORS) {
+    lprintf(LO_DEBUG, "dsda_StartRejectBuilder: too many sectors, skipping\n");
+    return;
+  }
+
+  if (numsectors < 2 || !dsda_RejectGeometryIsClosed()) {
+    lprintf(LO_DEBUG, "dsda_StartRejectBuilder: map geometry is not closed, skipping\n");
+    return;
+  }
+
+  if (!registered_exit) {
+    registered_exit = true;
+    I_AtExit(dsda_ExitRejectBuilder, true, "dsda_ExitRejectBuilder", exit_priority_normal);
+  }
+
+  build = dsda_SnapshotRejectGeometry();
+  if (!build) {
+    lprintf(LO_WARN, "dsda_StartRejectBuilder: out of memory, skipping\n");
+    return;
+  }
+
+  dsda_GetRejectCheckSum(build, &build_cksum);
+
+  required = ((size_t) numsectors * numsectors + 7) / 8;
+  filename = dsda_RejectCacheFile(&build_cksum);
+  length = M_ReadFile(filename, &buffer);
+  Z_Free(filename);
+
+  if (buffer && length == required) {
+    dsda_FreeRejectBuild(build);
+    build = NULL;
+
+    built_reject = buffer;
+
+    return;
+  }
+
+  if (buffer)
+    Z_Free(buffer);
+
+  // The result is only cached here, and used from the next load of the map
+  build_thread = SDL_CreateThread(dsda_RejectBuilderThread, "dsda_RejectBuilder", build);
+  if (!build_thread) {
+    lprintf(LO_WARN, "dsda_StartRejectBuilder: failed to create thread: %s\n", SDL_GetError());
+    dsda_FreeRejectBuild(build);
+    build = NULL;
+  }
+}
+
+const byte* dsda_BuiltReject(void) {
+  if (!allow_incompatibility || netgame)
+    return NULL;
+
+  return built_reject;
+}
@@ -207,6 +207,10 @@ dboolean dsda_ShowFPS(void) {
   return dsda_IntConfig(dsda_config_show_fps);
 }
 
+dboolean dsda_ShowFrameTimes(void) {
+  return dsda_IntConfig(dsda_config_show_frame_times);
+}
+
 dboolean dsda_ShowMinimap(void) {
   return dsda_IntConfig(dsda_config_show_minimap);
 }
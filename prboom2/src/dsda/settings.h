@@ -50,6 +50,7 @@ dboolean dsda_ShowSplitData(void);
 dboolean dsda_CommandDisplay(void);
 dboolean dsda_CoordinateDisplay(void);
 dboolean dsda_ShowFPS(void);
+dboolean dsda_ShowFrameTimes(void);
 dboolean dsda_ShowMinimap(void);
 dboolean dsda_ShowLevelSplits(void);
 dboolean dsda_ShowDemoAttempts(void);
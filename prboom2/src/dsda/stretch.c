@@ -218,6 +218,8 @@ void dsda_SetupStretchParams(void) {
 
   stretch_params = stretch_params_table[render_stretch_hud];
 
+  V_FreePatchCache();
+
   video.xstep = ((320 << FRACBITS) / 320 / patches_scalex) + 1;
   video.ystep = ((200 << FRACBITS) / 200 / patches_scaley) + 1;
   video_stretch.xstep = ((320 << FRACBITS) / WIDE_SCREENWIDTH) + 1;
@@ -75,6 +75,17 @@ unsigned long long dsda_ElapsedTimeMS(int timer) {
   return dsda_ElapsedTime(timer) / 1000;
 }
 
+unsigned long long dsda_ElapsedTimeNS(int timer) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (unsigned long long) (
+           (signed long long) (now.tv_nsec - dsda_time[timer].tv_nsec) +
+           (signed long long) (now.tv_sec - dsda_time[timer].tv_sec) * 1000000000
+         );
+}
+
 void dsda_PrintElapsedTime(int timer, const char* message) {
   unsigned long long result;
 
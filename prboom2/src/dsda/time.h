@@ -25,6 +25,10 @@ typedef enum {
   dsda_timer_brute_force,
   dsda_timer_render_stats,
   dsda_timer_temp,
+  dsda_timer_acs,
+  dsda_timer_level_load,
+  dsda_timer_pipeline,
+  dsda_timer_dynamic_resolution,
   DSDA_TIMER_COUNT
 } dsda_timer_t;
 
@@ -34,6 +38,7 @@ extern unsigned long long (*dsda_TickElapsedTime)(void);
 void dsda_StartTimer(int timer);
 unsigned long long dsda_ElapsedTime(int timer);
 unsigned long long dsda_ElapsedTimeMS(int timer);
+unsigned long long dsda_ElapsedTimeNS(int timer);
 void dsda_PrintElapsedTime(int timer, const char* message);
 void dsda_LimitFPS(void);
 int dsda_GetTickRealTime(void);
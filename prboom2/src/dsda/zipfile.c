@@ -16,6 +16,7 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 #include <zip.h>
 
 #include "i_system.h"
@@ -27,6 +28,27 @@
 
 static char **temp_dirs;
 
+// Wads stored without compression are read in place from the archive.
+// Nothing is written to the temp dir for them, the directory listing adds
+// them back under the path they would have been extracted to.
+typedef struct {
+  char *path;
+  char *archive;
+  int64_t offset;
+} stored_wad_t;
+
+static stored_wad_t *stored_wads;
+static int stored_wads_count;
+
+// Archives and their members may be larger than 2GB
+#ifdef _WIN32
+#define dsda_ZipSeek _fseeki64
+#define dsda_ZipTell _ftelli64
+#else
+#define dsda_ZipSeek fseeko
+#define dsda_ZipTell ftello
+#endif
+
 /* Allow a maximum of 1GB to be uncompressed to prevent zip-bombs */
 #define UNZIPPED_BYTES_LIMIT 1000000000ULL
 
@@ -56,14 +78,252 @@ static void dsda_WriteContentToFile(zip_file_t *input_file, FILE *dest_file, zip
   }
 }
 
-static void dsda_WriteZippedFilesToDest(zip_t *archive, const char *destination_directory) {
+#define ZIP_EOCD_SIG        0x06054b50
+#define ZIP_EOCD_SIZE       22
+#define ZIP64_LOCATOR_SIG   0x07064b50
+#define ZIP64_LOCATOR_SIZE  20
+#define ZIP64_EOCD_SIG      0x06064b50
+#define ZIP64_EOCD_SIZE     56
+#define ZIP64_EXTRA_ID      0x0001
+#define ZIP_CDIR_SIG        0x02014b50
+#define ZIP_CDIR_SIZE       46
+#define ZIP_LOCAL_SIG       0x04034b50
+#define ZIP_LOCAL_SIZE      30
+#define ZIP_MAX_COMMENT     65535
+#define ZIP_MAX_CDIR_SIZE   0x10000000
+
+static unsigned int dsda_ZipLE16(const byte *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned int dsda_ZipLE32(const byte *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static zip_uint64_t dsda_ZipLE64(const byte *p) {
+  return dsda_ZipLE32(p) | ((zip_uint64_t) dsda_ZipLE32(p + 4) << 32);
+}
+
+static dboolean dsda_ZipRead(FILE *file, zip_uint64_t offset, void *buffer, size_t size) {
+  return !dsda_ZipSeek(file, offset, SEEK_SET) && fread(buffer, 1, size, file) == size;
+}
+
+// Archives over 4GB keep the central directory position in a zip64 record,
+// found through a locator just before the end of central directory
+static dboolean dsda_ReadZip64Directory(FILE *file, zip_uint64_t eocd_offset,
+                                        zip_uint64_t *size, zip_uint64_t *offset) {
+  byte locator[ZIP64_LOCATOR_SIZE];
+  byte eocd[ZIP64_EOCD_SIZE];
+
+  if (eocd_offset < ZIP64_LOCATOR_SIZE ||
+      !dsda_ZipRead(file, eocd_offset - ZIP64_LOCATOR_SIZE, locator, sizeof(locator)) ||
+      dsda_ZipLE32(locator) != ZIP64_LOCATOR_SIG)
+    return false;
+
+  if (!dsda_ZipRead(file, dsda_ZipLE64(locator + 8), eocd, sizeof(eocd)) ||
+      dsda_ZipLE32(eocd) != ZIP64_EOCD_SIG)
+    return false;
+
+  *size = dsda_ZipLE64(eocd + 40);
+  *offset = dsda_ZipLE64(eocd + 48);
+
+  return true;
+}
+
+static byte *dsda_ReadCentralDirectory(FILE *file, size_t *cdir_size) {
+  byte *tail, *cdir = NULL;
+  int64_t file_size, tail_size, i;
+
+  if (dsda_ZipSeek(file, 0, SEEK_END) || (file_size = dsda_ZipTell(file)) < ZIP_EOCD_SIZE)
+    return NULL;
+
+  tail_size = MIN(file_size, ZIP_EOCD_SIZE + ZIP_MAX_COMMENT);
+  tail = Z_Malloc(tail_size);
+
+  if (dsda_ZipRead(file, file_size - tail_size, tail, tail_size)) {
+    for (i = tail_size - ZIP_EOCD_SIZE; i >= 0; i--)
+      if (dsda_ZipLE32(tail + i) == ZIP_EOCD_SIG)
+        break;
+
+    if (i >= 0) {
+      zip_uint64_t size = dsda_ZipLE32(tail + i + 12);
+      zip_uint64_t offset = dsda_ZipLE32(tail + i + 16);
+      dboolean valid = true;
+
+      if (size == 0xffffffff || offset == 0xffffffff)
+        valid = dsda_ReadZip64Directory(file, file_size - tail_size + i, &size, &offset);
+
+      if (valid && size <= ZIP_MAX_CDIR_SIZE && offset + size <= (zip_uint64_t) file_size) {
+        cdir = Z_Malloc(size);
+        if (!dsda_ZipRead(file, offset, cdir, size)) {
+          Z_Free(cdir);
+          cdir = NULL;
+        }
+        *cdir_size = size;
+      }
+    }
+  }
+
+  Z_Free(tail);
+
+  return cdir;
+}
+
+// The local header offset of a central directory entry, which is in the
+// zip64 extra field when it doesn't fit in 32 bits
+static zip_uint64_t dsda_ZipLocalHeaderOffset(const byte *entry, const byte *extra,
+                                              unsigned int extra_length) {
+  zip_uint64_t offset = dsda_ZipLE32(entry + 42);
+  unsigned int pos = 0;
+
+  if (offset != 0xffffffff)
+    return offset;
+
+  while (pos + 4 <= extra_length) {
+    unsigned int id = dsda_ZipLE16(extra + pos);
+    unsigned int size = dsda_ZipLE16(extra + pos + 2);
+    unsigned int field = pos + 4;
+
+    if (field + size > extra_length)
+      break;
+
+    if (id == ZIP64_EXTRA_ID) {
+      // The sizes come first, but only if they overflowed too
+      if (dsda_ZipLE32(entry + 24) == 0xffffffff)
+        field += 8;
+      if (dsda_ZipLE32(entry + 20) == 0xffffffff)
+        field += 8;
+
+      if (field + 8 <= pos + 4 + size)
+        return dsda_ZipLE64(extra + field);
+
+      break;
+    }
+
+    pos = field + size;
+  }
+
+  return 0xffffffff;
+}
+
+// libzip doesn't expose where a member's data starts, so look it up in the
+// central directory and skip the member's local header. Returns -1 if the
+// member can't be read in place.
+static int64_t dsda_StoredMemberOffset(FILE *file, const byte *cdir, size_t cdir_size,
+                                       const char *member_name) {
+  size_t pos = 0;
+  size_t name_length = strlen(member_name);
+
+  while (pos + ZIP_CDIR_SIZE <= cdir_size && dsda_ZipLE32(cdir + pos) == ZIP_CDIR_SIG) {
+    const byte *entry = cdir + pos;
+    unsigned int entry_name_length = dsda_ZipLE16(entry + 28);
+    unsigned int extra_length = dsda_ZipLE16(entry + 30);
+
+    if (pos + ZIP_CDIR_SIZE + entry_name_length + extra_length > cdir_size)
+      break;
+
+    if (entry_name_length == name_length &&
+        !memcmp(entry + ZIP_CDIR_SIZE, member_name, name_length)) {
+      byte local[ZIP_LOCAL_SIZE];
+      zip_uint64_t offset;
+
+      offset = dsda_ZipLocalHeaderOffset(entry, entry + ZIP_CDIR_SIZE + entry_name_length,
+                                         extra_length);
+
+      if (dsda_ZipLE16(entry + 10) != ZIP_CM_STORE || offset == 0xffffffff ||
+          offset > INT64_MAX - ZIP_LOCAL_SIZE - 2 * 0xffff)
+        return -1;
+
+      if (!dsda_ZipRead(file, offset, local, ZIP_LOCAL_SIZE) ||
+          dsda_ZipLE32(local) != ZIP_LOCAL_SIG)
+        return -1;
+
+      return offset + ZIP_LOCAL_SIZE + dsda_ZipLE16(local + 26) + dsda_ZipLE16(local + 28);
+    }
+
+    pos += ZIP_CDIR_SIZE + entry_name_length + extra_length + dsda_ZipLE16(entry + 32);
+  }
+
+  return -1;
+}
+
+static void dsda_SetStoredWad(const char *path, const char *archive, int64_t offset) {
+  int i;
+
+  for (i = 0; i < stored_wads_count; i++)
+    if (!strcmp(stored_wads[i].path, path))
+      break;
+
+  if (offset < 0) {
+    if (i < stored_wads_count)
+      stored_wads[i].offset = -1;
+    return;
+  }
+
+  if (i == stored_wads_count) {
+    stored_wads = Z_Realloc(stored_wads, (stored_wads_count + 1) * sizeof(*stored_wads));
+    stored_wads[i].path = Z_Strdup(path);
+    stored_wads[i].archive = Z_Strdup(archive);
+    stored_wads_count++;
+  }
+
+  stored_wads[i].offset = offset;
+}
+
+dboolean dsda_ZipStoredWad(const char *path, const char **archive, int64_t *offset) {
+  int i;
+
+  for (i = 0; i < stored_wads_count; i++)
+    if (stored_wads[i].offset >= 0 && !strcmp(stored_wads[i].path, path)) {
+      *archive = stored_wads[i].archive;
+      *offset = stored_wads[i].offset;
+      return true;
+    }
+
+  return false;
+}
+
+static int dsda_CompareStoredWadPaths(const void *a, const void *b) {
+  return strcasecmp(*(const char * const *) a, *(const char * const *) b);
+}
+
+const char** dsda_ZipStoredWadsAtPath(const char *directory, int *count) {
+  const char **paths;
+  size_t length = strlen(directory);
+  int i;
+
+  paths = Z_Malloc((stored_wads_count + 1) * sizeof(*paths));
+  *count = 0;
+
+  for (i = 0; i < stored_wads_count; i++)
+    if (stored_wads[i].offset >= 0 &&
+        !strncmp(stored_wads[i].path, directory, length) &&
+        stored_wads[i].path[length] == '/' &&
+        !strchr(stored_wads[i].path + length + 1, '/'))
+      paths[(*count)++] = stored_wads[i].path;
+
+  qsort(paths, *count, sizeof(*paths), dsda_CompareStoredWadPaths);
+
+  return paths;
+}
+
+static void dsda_WriteZippedFilesToDest(zip_t *archive, const char *zipped_file_name,
+                                        const char *destination_directory) {
   zip_int64_t i;
+  FILE *raw_file;
+  byte *cdir = NULL;
+  size_t cdir_size = 0;
+
+  raw_file = M_OpenFile(zipped_file_name, "rb");
+  if (raw_file)
+    cdir = dsda_ReadCentralDirectory(raw_file, &cdir_size);
 
   for (i = 0; i < zip_get_num_entries(archive, ZIP_FL_UNCHANGED); i++) {
     dsda_string_t full_path;
     zip_file_t *zipped_file;
     zip_stat_t stat;
     FILE *dest_file;
+    int64_t stored_offset = -1;
     const char *file_name = dsda_BaseName(zip_get_name(archive, i, ZIP_FL_UNCHANGED));
 
     /* Intermediate directories have a trailing '/', so their base name is empty */
@@ -77,20 +337,36 @@ static void dsda_WriteZippedFilesToDest(zip_t *archive, const char *destination_
     if ((stat.valid & ZIP_STAT_SIZE) == 0)
       I_Error("dsda_WriteZippedFilesToDest: Failed to read size of zipped file %s.", file_name);
 
-    zipped_file = zip_fopen_index(archive, i, ZIP_FL_UNCHANGED);
-    if (zipped_file == NULL)
-      I_Error("dsda_WriteZippedFilesToDest: Failed to open zipped file %s.", file_name);
+    if (cdir && dsda_HasFileExt(file_name, ".wad") &&
+        (stat.valid & ZIP_STAT_COMP_METHOD) && stat.comp_method == ZIP_CM_STORE &&
+        (stat.valid & ZIP_STAT_ENCRYPTION_METHOD) && stat.encryption_method == ZIP_EM_NONE)
+      stored_offset = dsda_StoredMemberOffset(raw_file, cdir, cdir_size,
+                                              zip_get_name(archive, i, ZIP_FL_UNCHANGED));
+
+    dsda_SetStoredWad(full_path.string, zipped_file_name, stored_offset);
 
-    dest_file = M_OpenFile(full_path.string, "wb");
-    if (dest_file == NULL)
-      I_Error("dsda_WriteZippedFilesToDest: Failed to open destination file %s.", full_path.string);
+    if (stored_offset < 0) {
+      dest_file = M_OpenFile(full_path.string, "wb");
+      if (dest_file == NULL)
+        I_Error("dsda_WriteZippedFilesToDest: Failed to open destination file %s.", full_path.string);
 
-    dsda_WriteContentToFile(zipped_file, dest_file, stat.size);
+      zipped_file = zip_fopen_index(archive, i, ZIP_FL_UNCHANGED);
+      if (zipped_file == NULL)
+        I_Error("dsda_WriteZippedFilesToDest: Failed to open zipped file %s.", file_name);
+
+      dsda_WriteContentToFile(zipped_file, dest_file, stat.size);
+
+      zip_fclose(zipped_file);
+      fclose(dest_file);
+    }
 
-    zip_fclose(zipped_file);
-    fclose(dest_file);
     dsda_FreeString(&full_path);
   }
+
+  if (cdir)
+    Z_Free(cdir);
+  if (raw_file)
+    fclose(raw_file);
 }
 
 static void dsda_UnzipFileToDestination(const char *zipped_file_name, const char *destination_directory) {
@@ -105,7 +381,7 @@ static void dsda_UnzipFileToDestination(const char *zipped_file_name, const char
     I_Error("dsda_UnzipFileToDestination: Unable to open %s: %s.\n", zipped_file_name, zip_error_strerror(&error));
   }
 
-  dsda_WriteZippedFilesToDest(archive_handle, destination_directory);
+  dsda_WriteZippedFilesToDest(archive_handle, zipped_file_name, destination_directory);
 
   zip_close(archive_handle);
 }
@@ -156,4 +432,12 @@ void dsda_CleanZipTempDirs(void) {
     Z_Free(temp_dirs[i]);
   }
   Z_Free(temp_dirs);
+
+  for (i = 0; i < stored_wads_count; i++) {
+    Z_Free(stored_wads[i].path);
+    Z_Free(stored_wads[i].archive);
+  }
+  Z_Free(stored_wads);
+  stored_wads = NULL;
+  stored_wads_count = 0;
 }
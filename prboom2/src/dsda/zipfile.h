@@ -18,8 +18,12 @@
 #ifndef __DSDA_ZIPFILE__
 #define __DSDA_ZIPFILE__
 
+#include "doomtype.h"
+
 const char* dsda_UnzipFile(const char *zipped_file_name);
 const char* dsda_ReadUnzippedFile(const char *zipped_file_name);
+dboolean dsda_ZipStoredWad(const char *path, const char **archive, int64_t *offset);
+const char** dsda_ZipStoredWadsAtPath(const char *directory, int *count);
 
 void dsda_CleanZipTempDirs(void);
 
@@ -96,7 +96,9 @@
 #include "dsda/demo.h"
 #include "dsda/excmd.h"
 #include "dsda/exdemo.h"
+#include "dsda/benchmark.h"
 #include "dsda/features.h"
+#include "dsda/frame_times.h"
 #include "dsda/key_frame.h"
 #include "dsda/mapinfo.h"
 #include "dsda/messenger.h"
@@ -107,6 +109,7 @@
 #include "dsda/mapinfo.h"
 #include "dsda/mouse.h"
 #include "dsda/options.h"
+#include "dsda/parallel_render.h"
 #include "dsda/pause.h"
 #include "dsda/playback.h"
 #include "dsda/skill_info.h"
@@ -1190,6 +1193,8 @@ static void G_DoLoadLevel (void)
 {
   int i;
 
+  dsda_ResetFrameTimes();
+
   // Set the sky map.
   // First thing, we have a dummy sky texture name,
   //  a flat. The data is in the WAD only because
@@ -1570,6 +1575,9 @@ void G_Ticker (void)
         dsda_UpdatePlaybackKeyFrames();
     }
 
+    if (demoplayback)
+      dsda_UpdateParallelRender();
+
     if (dsda_BruteForce())
     {
       dsda_UpdateBruteForce();
@@ -2163,6 +2171,8 @@ void G_DoCompleted (void)
   int i;
   int completed_behaviour;
 
+  dsda_WriteFrameTimes();
+
   R_ResetColorMap();
 
   if (hexen)
@@ -4044,11 +4054,15 @@ dboolean G_CheckDemoStatus (void)
 
     M_SaveDefaults();
 
+    dsda_WriteFrameTimes();
+
     lprintf(LO_INFO, "Timed %u gametics in %u realtics = %-.1f frames per second\n",
              (unsigned) gametic,realtics,
              (unsigned) gametic * (double) TICRATE / realtics);
 
-    if (dsda_IntConfig(dsda_config_demo_end_quit))
+    dsda_WriteBenchmarkRun(gametic, realtics);
+
+    if (dsda_IntConfig(dsda_config_demo_end_quit) || dsda_Flag(dsda_arg_benchmark_run))
       I_SafeExit(0);
     else
     {
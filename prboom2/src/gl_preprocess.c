@@ -43,6 +43,8 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
 
 #include "gl_opengl.h"
 
@@ -54,6 +56,14 @@
 #include "r_main.h"
 #include "am_map.h"
 #include "lprintf.h"
+#include "m_file.h"
+#include "md5.h"
+
+#include "core/thread_pool.h"
+
+#include "dsda/configuration.h"
+#include "dsda/data_organizer.h"
+#include "dsda/utility.h"
 
 static FILE *levelinfo;
 
@@ -125,6 +135,196 @@ static void gld_SetupSubsectorLoop(subsector_t *ssec, int iSubsectorID, int nume
   ((*loop)[(*loopcount) - 1]).vertexindex = gld_num_vertexes;
 }
 
+/*****************************
+ *
+ * FLAT JOBS
+ *
+ *****************************/
+
+// Flats are triangulated on the thread pool. Closed sectors are tessellated
+// in batches and the BSP is carved in subtrees. Each job collects its loops
+// and vertexes privately, and the results are appended to the global arrays
+// in the order the serial code produced them, so the output is the same.
+// Jobs stick to malloc and leave error reporting to the main thread; their
+// levelinfo messages are kept with the output and written in that order too.
+
+typedef struct
+{
+  int owner;       // sector (tessellation) or subsector (carving)
+  GLenum mode;
+  int vertexindex; // first vertex in the job's vertexes
+  int vertexcount;
+} flat_loop_t;
+
+typedef struct
+{
+  flat_loop_t *loops;
+  int numloops;
+  int maxloops;
+  vbo_xyz_uv_t *vertexes;
+  int numvertexes;
+  int maxvertexes;
+  int current;     // sector being tessellated
+  char *log;       // levelinfo messages, written when the job is merged
+  size_t loglength;
+  size_t logsize;
+  const char *error;
+} flat_output_t;
+
+static void gld_FlatOutputLoop(flat_output_t *out, int owner, GLenum mode)
+{
+  flat_loop_t *loop;
+
+  if (out->error)
+    return;
+
+  if (out->numloops == out->maxloops)
+  {
+    int maxloops = out->maxloops ? out->maxloops * 2 : 256;
+
+    loop = realloc(out->loops, maxloops * sizeof(*loop));
+    if (!loop)
+    {
+      out->error = "Not enough memory for flat loops";
+      return;
+    }
+
+    out->loops = loop;
+    out->maxloops = maxloops;
+  }
+
+  loop = &out->loops[out->numloops++];
+  loop->owner = owner;
+  loop->mode = mode;
+  loop->vertexindex = out->numvertexes;
+  loop->vertexcount = 0;
+}
+
+static void gld_FlatOutputVertex(flat_output_t *out, fixed_t x, fixed_t y)
+{
+  vbo_xyz_uv_t *vbo;
+
+  if (out->error || !out->numloops)
+    return;
+
+  if (out->numvertexes == out->maxvertexes)
+  {
+    int maxvertexes = out->maxvertexes ? out->maxvertexes * 2 : 1024;
+
+    vbo = realloc(out->vertexes, maxvertexes * sizeof(*vbo));
+    if (!vbo)
+    {
+      out->error = "Not enough memory for flat vertexes";
+      return;
+    }
+
+    out->vertexes = vbo;
+    out->maxvertexes = maxvertexes;
+  }
+
+  vbo = &out->vertexes[out->numvertexes++];
+  vbo->u = ( (float)x/(float)FRACUNIT)/64.0f;
+  vbo->v = (-(float)y/(float)FRACUNIT)/64.0f;
+  vbo->x = -(float)x/MAP_SCALE;
+  vbo->y = 0.0f;
+  vbo->z =  (float)y/MAP_SCALE;
+
+  out->loops[out->numloops - 1].vertexcount++;
+}
+
+static void gld_FlatOutputLog(flat_output_t *out, const char *format, ...)
+{
+  va_list args;
+  int length;
+
+  va_start(args, format);
+  length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+
+  if (length < 0)
+    return;
+
+  if (out->loglength + length + 1 > out->logsize)
+  {
+    size_t logsize = out->logsize ? out->logsize : 4096;
+    char *log;
+
+    while (out->loglength + length + 1 > logsize)
+      logsize *= 2;
+
+    log = realloc(out->log, logsize);
+    if (!log)
+      return;
+
+    out->log = log;
+    out->logsize = logsize;
+  }
+
+  va_start(args, format);
+  vsnprintf(out->log + out->loglength, length + 1, format, args);
+  va_end(args);
+
+  out->loglength += length;
+}
+
+static void gld_FreeFlatOutput(flat_output_t *out)
+{
+  free(out->loops);
+  free(out->vertexes);
+  free(out->log);
+  memset(out, 0, sizeof(*out));
+}
+
+// Appends tessellated loops to their sectors
+static void gld_MergeSectorLoops(const flat_output_t *out)
+{
+  int i;
+
+  if (levelinfo && out->log)
+    fputs(out->log, levelinfo);
+
+  for (i = 0; i < out->numloops; i++)
+  {
+    const flat_loop_t *loop = &out->loops[i];
+    GLSector *sector = &sectorloops[loop->owner];
+    GLLoopDef *def;
+
+    sector->loopcount++;
+    sector->loops = Z_Realloc(sector->loops, sizeof(GLLoopDef)*sector->loopcount);
+
+    def = &sector->loops[sector->loopcount - 1];
+    def->index = -1;
+    def->mode = loop->mode;
+    def->vertexcount = loop->vertexcount;
+    def->vertexindex = gld_num_vertexes;
+
+    gld_AddGlobalVertexes(loop->vertexcount);
+    memcpy(&flats_vbo[gld_num_vertexes], &out->vertexes[loop->vertexindex],
+           loop->vertexcount * sizeof(flats_vbo[0]));
+    gld_num_vertexes += loop->vertexcount;
+  }
+}
+
+// Appends carved loops to their sectors or subsectors
+static void gld_MergeSubsectorLoops(const flat_output_t *out)
+{
+  int i;
+
+  if (levelinfo && out->log)
+    fputs(out->log, levelinfo);
+
+  for (i = 0; i < out->numloops; i++)
+  {
+    const flat_loop_t *loop = &out->loops[i];
+
+    gld_AddGlobalVertexes(loop->vertexcount);
+    gld_SetupSubsectorLoop(&subsectors[loop->owner], loop->owner, loop->vertexcount);
+    memcpy(&flats_vbo[gld_num_vertexes], &out->vertexes[loop->vertexindex],
+           loop->vertexcount * sizeof(flats_vbo[0]));
+    gld_num_vertexes += loop->vertexcount;
+  }
+}
+
 /*****************************
  *
  * FLATS
@@ -159,7 +359,8 @@ static void gld_CalcIntersectionVertex(vertex_t *s, vertex_t *e, divline_t *d, v
 
 // Returns a pointer to the list of points. It must be used.
 //
-static vertex_t *gld_FlatEdgeClipper(int *numpoints, vertex_t *points, int numclippers, divline_t *clippers)
+static vertex_t *gld_FlatEdgeClipper(int *numpoints, vertex_t *points, int numclippers, divline_t *clippers,
+                                     flat_output_t *out)
 {
   unsigned char sidelist[MAX_CC_SIDES];
   int       i, k, num = *numpoints;
@@ -184,13 +385,22 @@ static vertex_t *gld_FlatEdgeClipper(int *numpoints, vertex_t *points, int numcl
       if(sidelist[startIdx] != sidelist[endIdx])
       {
         vertex_t newvert;
+        vertex_t *newpoints;
 
         gld_CalcIntersectionVertex(&points[startIdx], &points[endIdx], curclip, &newvert);
 
         // Add the new vertex. Also modify the sidelist.
-        points = (vertex_t*)Z_Realloc(points,(++num)*sizeof(vertex_t));
-        if(num >= MAX_CC_SIDES)
-          I_Error("gld_FlatEdgeClipper: Too many points in carver");
+        newpoints = (vertex_t*)realloc(points,(++num)*sizeof(vertex_t));
+        if (!newpoints)
+          out->error = "gld_FlatEdgeClipper: Not enough memory";
+        else if(num >= MAX_CC_SIDES)
+          out->error = "gld_FlatEdgeClipper: Too many points in carver";
+        if (out->error)
+        {
+          *numpoints = 0;
+          return newpoints ? newpoints : points;
+        }
+        points = newpoints;
 
         // Make room for the new vertex.
         memmove(&points[endIdx+1], &points[endIdx],
@@ -233,7 +443,7 @@ static vertex_t *gld_FlatEdgeClipper(int *numpoints, vertex_t *points, int numcl
   return points;
 }
 
-static void gld_FlatConvexCarver(int ssidx, int num, divline_t *list)
+static void gld_FlatConvexCarver(int ssidx, int num, divline_t *list, flat_output_t *out)
 {
   subsector_t *ssec=&subsectors[ssidx];
   int numclippers = num+ssec->numlines;
@@ -241,7 +451,7 @@ static void gld_FlatConvexCarver(int ssidx, int num, divline_t *list)
   int i, numedgepoints;
   vertex_t *edgepoints;
 
-  clippers=(divline_t*)Z_Malloc(numclippers*sizeof(divline_t));
+  clippers=(divline_t*)malloc(numclippers*sizeof(divline_t));
   if (!clippers)
     return;
   for(i=0; i<num; i++)
@@ -262,7 +472,12 @@ static void gld_FlatConvexCarver(int ssidx, int num, divline_t *list)
 
   // Setup the 'worldwide' polygon.
   numedgepoints = 4;
-  edgepoints = (vertex_t*)Z_Malloc(numedgepoints*sizeof(vertex_t));
+  edgepoints = (vertex_t*)malloc(numedgepoints*sizeof(vertex_t));
+  if (!edgepoints)
+  {
+    free(clippers);
+    return;
+  }
 
   edgepoints[0].x = INT_MIN;
   edgepoints[0].y = INT_MAX;
@@ -277,45 +492,36 @@ static void gld_FlatConvexCarver(int ssidx, int num, divline_t *list)
   edgepoints[3].y = INT_MIN;
 
   // Do some clipping, <snip> <snip>
-  edgepoints = gld_FlatEdgeClipper(&numedgepoints, edgepoints, numclippers, clippers);
+  edgepoints = gld_FlatEdgeClipper(&numedgepoints, edgepoints, numclippers, clippers, out);
 
   if(!numedgepoints)
   {
-    if (levelinfo) fprintf(levelinfo, "All carved away: subsector %lli - sector %i\n", (long long)(ssec-subsectors), ssec->sector->iSectorID);
+    if (levelinfo) gld_FlatOutputLog(out, "All carved away: subsector %lli - sector %i\n", (long long)(ssec-subsectors), ssec->sector->iSectorID);
   }
   else
   {
     if (numedgepoints >= 3)
     {
-      gld_AddGlobalVertexes(numedgepoints);
+      gld_FlatOutputLoop(out, ssidx, GL_TRIANGLE_FAN);
 
-      if (flats_vbo)
-      {
-        gld_SetupSubsectorLoop(ssec, ssidx, numedgepoints);
-
-        for(i = 0;  i < numedgepoints; i++)
-        {
-          flats_vbo[gld_num_vertexes].u = ( (float)edgepoints[i].x/(float)FRACUNIT)/64.0f;
-          flats_vbo[gld_num_vertexes].v = (-(float)edgepoints[i].y/(float)FRACUNIT)/64.0f;
-          flats_vbo[gld_num_vertexes].x = -(float)edgepoints[i].x/MAP_SCALE;
-          flats_vbo[gld_num_vertexes].y = 0.0f;
-          flats_vbo[gld_num_vertexes].z =  (float)edgepoints[i].y/MAP_SCALE;
-          gld_num_vertexes++;
-        }
-      }
+      for(i = 0;  i < numedgepoints; i++)
+        gld_FlatOutputVertex(out, edgepoints[i].x, edgepoints[i].y);
     }
   }
   // We're done, free the edgepoints memory.
-  Z_Free(edgepoints);
-  Z_Free(clippers);
+  free(edgepoints);
+  free(clippers);
 }
 
-static void gld_CarveFlats(int bspnode, int numdivlines, divline_t *divlines)
+static void gld_CarveFlats(int bspnode, int numdivlines, divline_t *divlines, flat_output_t *out)
 {
   node_t    *nod;
   divline_t *childlist, *dl;
   int     childlistsize = numdivlines+1;
 
+  if (out->error)
+    return;
+
   // If this is a subsector we are dealing with, begin carving with the
   // given list.
   if (bspnode & NF_SUBSECTOR)
@@ -326,7 +532,7 @@ static void gld_CarveFlats(int bspnode, int numdivlines, divline_t *divlines)
     int ssidx = (numnodes != 0) ? bspnode & (~NF_SUBSECTOR) : 0;
 
     if (gld_TriangulateSubsector(&subsectors[ssidx]))
-      gld_FlatConvexCarver(ssidx, numdivlines, divlines);
+      gld_FlatConvexCarver(ssidx, numdivlines, divlines, out);
 
     return;
   }
@@ -335,7 +541,12 @@ static void gld_CarveFlats(int bspnode, int numdivlines, divline_t *divlines)
   nod = nodes + bspnode;
 
   // Allocate a new list for each child.
-  childlist = (divline_t*)Z_Malloc(childlistsize*sizeof(divline_t));
+  childlist = (divline_t*)malloc(childlistsize*sizeof(divline_t));
+  if (!childlist)
+  {
+    out->error = "gld_CarveFlats: Not enough memory";
+    return;
+  }
 
   // Copy the previous lines.
   if(divlines) memcpy(childlist,divlines,numdivlines*sizeof(divline_t));
@@ -346,63 +557,159 @@ static void gld_CarveFlats(int bspnode, int numdivlines, divline_t *divlines)
   // The right child gets the original line (LEFT side clipped).
   dl->dx = nod->dx;
   dl->dy = nod->dy;
-  gld_CarveFlats(nod->children[0],childlistsize,childlist);
+  gld_CarveFlats(nod->children[0],childlistsize,childlist,out);
 
   // The left side. We must reverse the line, otherwise the wrong
   // side would get clipped.
   dl->dx = -nod->dx;
   dl->dy = -nod->dy;
-  gld_CarveFlats(nod->children[1],childlistsize,childlist);
+  gld_CarveFlats(nod->children[1],childlistsize,childlist,out);
 
   // We are finishing with this node, free the allocated list.
+  free(childlist);
+}
+
+// Subtrees below this depth are carved by one job each
+#define CARVE_JOB_DEPTH 6
+
+typedef struct
+{
+  int bspnode;
+  int numdivlines;
+  divline_t *divlines;
+  flat_output_t out;
+} carve_job_t;
+
+typedef struct
+{
+  carve_job_t *jobs;
+  int numjobs;
+  int maxjobs;
+} carve_job_list_t;
+
+static void gld_CarveFlatsJob(void *data)
+{
+  carve_job_t *job = data;
+
+  gld_CarveFlats(job->bspnode, job->numdivlines, job->divlines, &job->out);
+}
+
+// Walks the top of the BSP the way gld_CarveFlats does, so that the jobs
+// come out in the order their subsectors would have been carved
+static void gld_CollectCarveJobs(carve_job_list_t *list, int bspnode,
+                                 int numdivlines, divline_t *divlines, int depth)
+{
+  node_t    *nod;
+  divline_t *childlist, *dl;
+  int     childlistsize = numdivlines+1;
+
+  if ((bspnode & NF_SUBSECTOR) || depth == CARVE_JOB_DEPTH)
+  {
+    carve_job_t *job;
+
+    if (list->numjobs == list->maxjobs)
+    {
+      list->maxjobs = list->maxjobs ? list->maxjobs * 2 : 64;
+      list->jobs = Z_Realloc(list->jobs, list->maxjobs * sizeof(*list->jobs));
+    }
+
+    job = &list->jobs[list->numjobs++];
+    memset(job, 0, sizeof(*job));
+    job->bspnode = bspnode;
+    job->numdivlines = numdivlines;
+    if (numdivlines)
+    {
+      job->divlines = Z_Malloc(numdivlines*sizeof(divline_t));
+      memcpy(job->divlines, divlines, numdivlines*sizeof(divline_t));
+    }
+
+    return;
+  }
+
+  nod = nodes + bspnode;
+
+  childlist = (divline_t*)Z_Malloc(childlistsize*sizeof(divline_t));
+  if(divlines) memcpy(childlist,divlines,numdivlines*sizeof(divline_t));
+
+  dl = childlist + numdivlines;
+  dl->x = nod->x;
+  dl->y = nod->y;
+  dl->dx = nod->dx;
+  dl->dy = nod->dy;
+  gld_CollectCarveJobs(list, nod->children[0], childlistsize, childlist, depth + 1);
+
+  dl->dx = -nod->dx;
+  dl->dy = -nod->dy;
+  gld_CollectCarveJobs(list, nod->children[1], childlistsize, childlist, depth + 1);
+
   Z_Free(childlist);
 }
 
-static int currentsector; // the sector which is currently tesselated
+static void gld_CarveAllFlats(void)
+{
+  carve_job_list_t list = { 0 };
+  int i;
+
+  gld_CollectCarveJobs(&list, numnodes-1, 0, NULL, 0);
+
+  if (list.numjobs == 1)
+    gld_CarveFlatsJob(&list.jobs[0]);
+  else
+    I_ThreadPoolRun(gld_CarveFlatsJob, list.jobs, sizeof(*list.jobs), list.numjobs);
+
+  for (i = 0; i < list.numjobs; i++)
+  {
+    carve_job_t *job = &list.jobs[i];
+
+    if (job->out.error)
+      I_Error("%s", job->out.error);
+
+    gld_MergeSubsectorLoops(&job->out);
+    gld_FreeFlatOutput(&job->out);
+    Z_Free(job->divlines);
+  }
+
+  Z_Free(list.jobs);
+}
+
+// The tesselation callbacks receive the output of the job which runs
+// the tesselator (passed to gluTessBeginPolygon)
 
 // ntessBegin
 //
 // called when the tesselation of a new loop starts
 
-static void CALLBACK ntessBegin( GLenum type )
+static void CALLBACK ntessBegin( GLenum type, flat_output_t *out )
 {
 #ifdef PRBOOM_DEBUG
   if (levelinfo)
   {
     if (type==GL_TRIANGLES)
-      fprintf(levelinfo, "\t\tBegin: GL_TRIANGLES\n");
+      gld_FlatOutputLog(out, "\t\tBegin: GL_TRIANGLES\n");
     else
     if (type==GL_TRIANGLE_FAN)
-      fprintf(levelinfo, "\t\tBegin: GL_TRIANGLE_FAN\n");
+      gld_FlatOutputLog(out, "\t\tBegin: GL_TRIANGLE_FAN\n");
     else
     if (type==GL_TRIANGLE_STRIP)
-      fprintf(levelinfo, "\t\tBegin: GL_TRIANGLE_STRIP\n");
+      gld_FlatOutputLog(out, "\t\tBegin: GL_TRIANGLE_STRIP\n");
     else
-      fprintf(levelinfo, "\t\tBegin: unknown\n");
+      gld_FlatOutputLog(out, "\t\tBegin: unknown\n");
   }
 #endif
-  // increase loopcount for currentsector
-  sectorloops[ currentsector ].loopcount++;
-  // reallocate to get space for another loop
-  sectorloops[ currentsector ].loops=Z_Realloc(sectorloops[currentsector].loops,sizeof(GLLoopDef)*sectorloops[currentsector].loopcount);
-  // set initial values for current loop
-  // currentloop is -> sectorloops[currentsector].loopcount-1
-  sectorloops[ currentsector ].loops[ sectorloops[currentsector].loopcount-1 ].index=-1;
-  sectorloops[ currentsector ].loops[ sectorloops[currentsector].loopcount-1 ].mode=type;
-  sectorloops[ currentsector ].loops[ sectorloops[currentsector].loopcount-1 ].vertexcount=0;
-  sectorloops[ currentsector ].loops[ sectorloops[currentsector].loopcount-1 ].vertexindex=gld_num_vertexes;
+  // start a new loop for the current sector
+  gld_FlatOutputLoop(out, out->current, type);
 }
 
 // ntessError
 //
 // called when the tesselation failes (DEBUG only)
 
-static void CALLBACK ntessError(GLenum error)
+static void CALLBACK ntessError(GLenum error, flat_output_t *out)
 {
 #ifdef PRBOOM_DEBUG
   const GLubyte *estring;
   estring = gluErrorString(error);
-  fprintf(levelinfo, "\t\tTessellation Error: %s\n", estring);
+  if (levelinfo) gld_FlatOutputLog(out, "\t\tTessellation Error: %s\n", estring);
 #endif
 }
 
@@ -410,16 +717,16 @@ static void CALLBACK ntessError(GLenum error)
 //
 // called when the two or more vertexes are on the same coordinate
 
-static void CALLBACK ntessCombine( GLdouble coords[3], vertex_t *vert[4], GLfloat w[4], void **dataOut )
+static void CALLBACK ntessCombine( GLdouble coords[3], vertex_t *vert[4], GLfloat w[4], void **dataOut, flat_output_t *out )
 {
 #ifdef PRBOOM_DEBUG
   if (levelinfo)
   {
-    fprintf(levelinfo, "\t\tVertexCombine Coords: x %10.5f, y %10.5f z %10.5f\n", coords[0], coords[1], coords[2]);
-    if (vert[0]) fprintf(levelinfo, "\t\tVertexCombine Vert1 : x %10i, y %10i p %p\n", vert[0]->x>>FRACBITS, vert[0]->y>>FRACBITS, vert[0]);
-    if (vert[1]) fprintf(levelinfo, "\t\tVertexCombine Vert2 : x %10i, y %10i p %p\n", vert[1]->x>>FRACBITS, vert[1]->y>>FRACBITS, vert[1]);
-    if (vert[2]) fprintf(levelinfo, "\t\tVertexCombine Vert3 : x %10i, y %10i p %p\n", vert[2]->x>>FRACBITS, vert[2]->y>>FRACBITS, vert[2]);
-    if (vert[3]) fprintf(levelinfo, "\t\tVertexCombine Vert4 : x %10i, y %10i p %p\n", vert[3]->x>>FRACBITS, vert[3]->y>>FRACBITS, vert[3]);
+    gld_FlatOutputLog(out, "\t\tVertexCombine Coords: x %10.5f, y %10.5f z %10.5f\n", coords[0], coords[1], coords[2]);
+    if (vert[0]) gld_FlatOutputLog(out, "\t\tVertexCombine Vert1 : x %10i, y %10i p %p\n", vert[0]->x>>FRACBITS, vert[0]->y>>FRACBITS, vert[0]);
+    if (vert[1]) gld_FlatOutputLog(out, "\t\tVertexCombine Vert2 : x %10i, y %10i p %p\n", vert[1]->x>>FRACBITS, vert[1]->y>>FRACBITS, vert[1]);
+    if (vert[2]) gld_FlatOutputLog(out, "\t\tVertexCombine Vert3 : x %10i, y %10i p %p\n", vert[2]->x>>FRACBITS, vert[2]->y>>FRACBITS, vert[2]);
+    if (vert[3]) gld_FlatOutputLog(out, "\t\tVertexCombine Vert4 : x %10i, y %10i p %p\n", vert[3]->x>>FRACBITS, vert[3]->y>>FRACBITS, vert[3]);
   }
 #endif
   // just return the first vertex, because all vertexes are on the same coordinate
@@ -430,35 +737,25 @@ static void CALLBACK ntessCombine( GLdouble coords[3], vertex_t *vert[4], GLfloa
 //
 // called when a vertex is found
 
-static void CALLBACK ntessVertex( vertex_t *vert )
+static void CALLBACK ntessVertex( vertex_t *vert, flat_output_t *out )
 {
 #ifdef PRBOOM_DEBUG
   if (levelinfo)
-    fprintf(levelinfo, "\t\tVertex : x %10i, y %10i\n", vert->x>>FRACBITS, vert->y>>FRACBITS);
+    gld_FlatOutputLog(out, "\t\tVertex : x %10i, y %10i\n", vert->x>>FRACBITS, vert->y>>FRACBITS);
 #endif
-  // increase vertex count
-  sectorloops[ currentsector ].loops[ sectorloops[currentsector].loopcount-1 ].vertexcount++;
-
-  // increase vertex count
-  gld_AddGlobalVertexes(1);
   // add the new vertex (vert is the second argument of gluTessVertex)
-  flats_vbo[gld_num_vertexes].u=( (float)vert->x/(float)FRACUNIT)/64.0f;
-  flats_vbo[gld_num_vertexes].v=(-(float)vert->y/(float)FRACUNIT)/64.0f;
-  flats_vbo[gld_num_vertexes].x=-(float)vert->x/MAP_SCALE;
-  flats_vbo[gld_num_vertexes].y=0.0f;
-  flats_vbo[gld_num_vertexes].z= (float)vert->y/MAP_SCALE;
-  gld_num_vertexes++;
+  gld_FlatOutputVertex(out, vert->x, vert->y);
 }
 
 // ntessEnd
 //
 // called when the tesselation of a the current loop ends (DEBUG only)
 
-static void CALLBACK ntessEnd( void )
+static void CALLBACK ntessEnd( flat_output_t *out )
 {
 #ifdef PRBOOM_DEBUG
-  if (levelinfo)
-    fprintf(levelinfo, "\t\tEnd loopcount %i vertexcount %i\n", sectorloops[currentsector].loopcount, sectorloops[ currentsector ].loops[ sectorloops[currentsector].loopcount-1 ].vertexcount);
+  if (levelinfo && out->numloops)
+    gld_FlatOutputLog(out, "\t\tEnd loopcount %i vertexcount %i\n", out->numloops, out->loops[out->numloops-1].vertexcount);
 #endif
 }
 
@@ -483,7 +780,7 @@ static void CALLBACK ntessEnd( void )
 // There is no more HOM at the starting area on MAP16 @ Eternal.wad
 // I hope nothing was broken
 
-static void gld_PrecalculateSector(int num)
+static void gld_PrecalculateSector(int num, flat_output_t *out)
 {
   int i;
   dboolean *lineadded=NULL;
@@ -503,28 +800,27 @@ static void gld_PrecalculateSector(int num)
   int maxvertexnum;
   int vertexnum;
 
-  currentsector=num;
-  lineadded=Z_Malloc(sectors[num].linecount*sizeof(dboolean));
+  out->current=num;
+  lineadded=malloc(sectors[num].linecount*sizeof(dboolean));
   if (!lineadded)
   {
-    if (levelinfo) fclose(levelinfo);
+    out->error = "gld_PrecalculateSector: Not enough memory";
     return;
   }
   // init tesselator
   tess=gluNewTess();
   if (!tess)
   {
-    if (levelinfo) fclose(levelinfo);
-    Z_Free(lineadded);
+    free(lineadded);
     return;
   }
   // set callbacks
-  gluTessCallback(tess, GLU_TESS_BEGIN, (void(CALLBACK*)())ntessBegin);
-  gluTessCallback(tess, GLU_TESS_VERTEX, (void(CALLBACK*)())ntessVertex);
-  gluTessCallback(tess, GLU_TESS_ERROR, (void(CALLBACK*)())ntessError);
-  gluTessCallback(tess, GLU_TESS_COMBINE, (void(CALLBACK*)())ntessCombine);
-  gluTessCallback(tess, GLU_TESS_END, (void(CALLBACK*)())ntessEnd);
-  if (levelinfo) fprintf(levelinfo, "sector %i, %i lines in sector\n", num, sectors[num].linecount);
+  gluTessCallback(tess, GLU_TESS_BEGIN_DATA, (void(CALLBACK*)())ntessBegin);
+  gluTessCallback(tess, GLU_TESS_VERTEX_DATA, (void(CALLBACK*)())ntessVertex);
+  gluTessCallback(tess, GLU_TESS_ERROR_DATA, (void(CALLBACK*)())ntessError);
+  gluTessCallback(tess, GLU_TESS_COMBINE_DATA, (void(CALLBACK*)())ntessCombine);
+  gluTessCallback(tess, GLU_TESS_END_DATA, (void(CALLBACK*)())ntessEnd);
+  if (levelinfo) gld_FlatOutputLog(out, "sector %i, %i lines in sector\n", num, sectors[num].linecount);
   // remove any line which has both sides in the same sector (i.e. Doom2 Map01 Sector 1)
   for (i=0; i<sectors[num].linecount; i++)
   {
@@ -535,7 +831,7 @@ static void gld_PrecalculateSector(int num)
           ==sides[sectors[num].lines[i]->sidenum[1]].sector)
         {
           lineadded[i]=true;
-          if (levelinfo) fprintf(levelinfo, "line %4i (iLineID %4i) has both sides in same sector (removed)\n", i, sectors[num].lines[i]->iLineID);
+          if (levelinfo) gld_FlatOutputLog(out, "line %4i (iLineID %4i) has both sides in same sector (removed)\n", i, sectors[num].lines[i]->iLineID);
         }
   }
   // e6y
@@ -567,9 +863,9 @@ static void gld_PrecalculateSector(int num)
   vertexnum=0;
   maxvertexnum=0;
   // start tesselator
-  if (levelinfo) fprintf(levelinfo, "gluTessBeginPolygon\n");
-  gluTessBeginPolygon(tess, NULL);
-  if (levelinfo) fprintf(levelinfo, "\tgluTessBeginContour\n");
+  if (levelinfo) gld_FlatOutputLog(out, "gluTessBeginPolygon\n");
+  gluTessBeginPolygon(tess, out);
+  if (levelinfo) gld_FlatOutputLog(out, "\tgluTessBeginContour\n");
   gluTessBeginContour(tess);
   while (linecount)
   {
@@ -586,14 +882,14 @@ static void gld_PrecalculateSector(int num)
             startvertex=sectors[num].lines[currentline]->v1;
           else
             startvertex=sectors[num].lines[currentline]->v2;
-          if (levelinfo) fprintf(levelinfo, "\tNew Loop %3i\n", currentloop);
+          if (levelinfo) gld_FlatOutputLog(out, "\tNew Loop %3i\n", currentloop);
           if (oldline!=0)
           {
-            if (levelinfo) fprintf(levelinfo, "\tgluTessEndContour\n");
+            if (levelinfo) gld_FlatOutputLog(out, "\tgluTessEndContour\n");
             gluTessEndContour(tess);
-//            if (levelinfo) fprintf(levelinfo, "\tgluNextContour\n");
+//            if (levelinfo) gld_FlatOutputLog(out, "\tgluNextContour\n");
 //            gluNextContour(tess, GLU_CW);
-            if (levelinfo) fprintf(levelinfo, "\tgluTessBeginContour\n");
+            if (levelinfo) gld_FlatOutputLog(out, "\tgluTessBeginContour\n");
             gluTessBeginContour(tess);
           }
           break;
@@ -616,7 +912,7 @@ static void gld_PrecalculateSector(int num)
       //if (lineangle>=180)
       //  lineangle=lineangle-360;
 
-      if (levelinfo) fprintf(levelinfo, "\t\tAdded Line %4i to Loop, iLineID %5i, Angle: %4i, flipped false\n", currentline, sectors[num].lines[currentline]->iLineID, lineangle);
+      if (levelinfo) gld_FlatOutputLog(out, "\t\tAdded Line %4i to Loop, iLineID %5i, Angle: %4i, flipped false\n", currentline, sectors[num].lines[currentline]->iLineID, lineangle);
     }
     else // ... or on the back side
     {
@@ -630,12 +926,20 @@ static void gld_PrecalculateSector(int num)
       //if (lineangle>=180)
       //  lineangle=lineangle-360;
 
-      if (levelinfo) fprintf(levelinfo, "\t\tAdded Line %4i to Loop, iLineID %5i, Angle: %4i, flipped true\n", currentline, sectors[num].lines[currentline]->iLineID, lineangle);
+      if (levelinfo) gld_FlatOutputLog(out, "\t\tAdded Line %4i to Loop, iLineID %5i, Angle: %4i, flipped true\n", currentline, sectors[num].lines[currentline]->iLineID, lineangle);
     }
     if (vertexnum>=maxvertexnum)
     {
+      double *newv;
+
       maxvertexnum+=512;
-      v=Z_Realloc(v,maxvertexnum*3*sizeof(double));
+      newv=realloc(v,maxvertexnum*3*sizeof(double));
+      if (!newv)
+      {
+        out->error = "gld_PrecalculateSector: Not enough memory";
+        break;
+      }
+      v=newv;
     }
     // calculate coordinates for the glu tesselation functions
     v[vertexnum*3+0]=-(double)currentvertex->x/(double)MAP_SCALE;
@@ -643,7 +947,7 @@ static void gld_PrecalculateSector(int num)
     v[vertexnum*3+2]= (double)currentvertex->y/(double)MAP_SCALE;
     // add the vertex to the tesselator, currentvertex is the pointer to the vertexlist of doom
     // v[vertexnum] is the GLdouble array of the current vertex
-    if (levelinfo) fprintf(levelinfo, "\t\tgluTessVertex(%i, %i)\n",currentvertex->x>>FRACBITS,currentvertex->y>>FRACBITS);
+    if (levelinfo) gld_FlatOutputLog(out, "\t\tgluTessVertex(%i, %i)\n",currentvertex->x>>FRACBITS,currentvertex->y>>FRACBITS);
     gluTessVertex(tess, &v[vertexnum*3], currentvertex);
     // increase vertexindex
     vertexnum++;
@@ -711,18 +1015,71 @@ static void gld_PrecalculateSector(int num)
     {
       currentline=bestline;
       if (bestlinecount>1)
-        if (levelinfo) fprintf(levelinfo, "\t\tBestlinecount: %4i\n", bestlinecount);
+        if (levelinfo) gld_FlatOutputLog(out, "\t\tBestlinecount: %4i\n", bestlinecount);
     }
   }
   // let the tesselator calculate the loops
-  if (levelinfo) fprintf(levelinfo, "\tgluTessEndContour\n");
+  if (levelinfo) gld_FlatOutputLog(out, "\tgluTessEndContour\n");
   gluTessEndContour(tess);
-  if (levelinfo) fprintf(levelinfo, "gluTessEndPolygon\n");
+  if (levelinfo) gld_FlatOutputLog(out, "gluTessEndPolygon\n");
   gluTessEndPolygon(tess);
   // clean memory
   gluDeleteTess(tess);
-  Z_Free(v);
-  Z_Free(lineadded);
+  free(v);
+  free(lineadded);
+}
+
+// Sectors are tesselated in batches of this size
+#define TESS_JOB_SECTORS 32
+#define MAX_TESS_JOBS 64
+
+typedef struct
+{
+  int start;
+  int end;
+  const dboolean *closed;
+  flat_output_t out;
+} tess_job_t;
+
+static void gld_PrecalculateSectorsJob(void *data)
+{
+  tess_job_t *job = data;
+  int i;
+
+  for (i = job->start; i < job->end && !job->out.error; i++)
+    if (job->closed[i])
+      gld_PrecalculateSector(i, &job->out);
+}
+
+static void gld_PrecalculateSectors(const dboolean *closed)
+{
+  tess_job_t jobs[MAX_TESS_JOBS];
+  int njobs;
+  int i;
+
+  njobs = BETWEEN(1, MAX_TESS_JOBS, numsectors / TESS_JOB_SECTORS);
+
+  memset(jobs, 0, sizeof(jobs));
+  for (i = 0; i < njobs; i++)
+  {
+    jobs[i].start = numsectors * i / njobs;
+    jobs[i].end = numsectors * (i + 1) / njobs;
+    jobs[i].closed = closed;
+  }
+
+  if (njobs == 1)
+    gld_PrecalculateSectorsJob(&jobs[0]);
+  else
+    I_ThreadPoolRun(gld_PrecalculateSectorsJob, jobs, sizeof(*jobs), njobs);
+
+  for (i = 0; i < njobs; i++)
+  {
+    if (jobs[i].out.error)
+      I_Error("%s", jobs[i].out.error);
+
+    gld_MergeSectorLoops(&jobs[i].out);
+    gld_FreeFlatOutput(&jobs[i].out);
+  }
 }
 
 /********************************************
@@ -852,10 +1209,326 @@ static void gld_MarkSectorsForClamp(void)
   }
 }
 
+/*****************************
+ *
+ * FLATS CACHE
+ *
+ *****************************/
+
+// With gl_flats_cache, the triangulated flats are stored in the data root,
+// keyed by the digest of the geometry they were built from. Clamping is not
+// part of the cache, it runs after the flats are loaded.
+//
+// Loops and vertexes are stored as raw structs, so the header records the
+// format version, the byte order and the struct sizes, and a file written
+// by a different build layout is rebuilt rather than loaded.
+
+#define FLATS_CACHE_MAGIC "DSDAFLAT"
+#define FLATS_CACHE_VERSION 2
+#define FLATS_CACHE_BYTE_ORDER 0x01020304
+
+enum
+{
+  flats_cache_version,
+  flats_cache_byte_order,
+  flats_cache_loop_size,
+  flats_cache_vertex_size,
+  flats_cache_sectors,
+  flats_cache_subsectors,
+  flats_cache_vertexes,
+  flats_cache_header_size
+};
+
+static void gld_HashInt(struct MD5Context *md5, int value)
+{
+  byte bytes[4];
+
+  bytes[0] = (byte)( value        & 0xff);
+  bytes[1] = (byte)((value >>  8) & 0xff);
+  bytes[2] = (byte)((value >> 16) & 0xff);
+  bytes[3] = (byte)((value >> 24) & 0xff);
+
+  MD5Update(md5, bytes, sizeof(bytes));
+}
+
+static void gld_FlatsCacheKey(dsda_cksum_t *cksum)
+{
+  struct MD5Context md5;
+  int i, j;
+
+  MD5Init(&md5);
+
+  gld_HashInt(&md5, use_gl_nodes);
+  gld_HashInt(&md5, numvertexes);
+  gld_HashInt(&md5, numlines);
+  gld_HashInt(&md5, numsides);
+  gld_HashInt(&md5, numsectors);
+  gld_HashInt(&md5, numsegs);
+  gld_HashInt(&md5, numsubsectors);
+  gld_HashInt(&md5, numnodes);
+
+  for (i = 0; i < numvertexes; i++)
+  {
+    gld_HashInt(&md5, vertexes[i].x);
+    gld_HashInt(&md5, vertexes[i].y);
+  }
+
+  for (i = 0; i < numlines; i++)
+  {
+    gld_HashInt(&md5, lines[i].v1 - vertexes);
+    gld_HashInt(&md5, lines[i].v2 - vertexes);
+    gld_HashInt(&md5, lines[i].sidenum[0]);
+    gld_HashInt(&md5, lines[i].sidenum[1]);
+    gld_HashInt(&md5, lines[i].frontsector ? lines[i].frontsector - sectors : -1);
+    gld_HashInt(&md5, lines[i].backsector ? lines[i].backsector - sectors : -1);
+  }
+
+  for (i = 0; i < numsides; i++)
+    gld_HashInt(&md5, sides[i].sector - sectors);
+
+  for (i = 0; i < numsectors; i++)
+  {
+    gld_HashInt(&md5, sectors[i].linecount);
+    for (j = 0; j < sectors[i].linecount; j++)
+      gld_HashInt(&md5, sectors[i].lines[j] - lines);
+  }
+
+  for (i = 0; i < numsegs; i++)
+  {
+    gld_HashInt(&md5, segs[i].v1->x);
+    gld_HashInt(&md5, segs[i].v1->y);
+    gld_HashInt(&md5, segs[i].v2->x);
+    gld_HashInt(&md5, segs[i].v2->y);
+  }
+
+  for (i = 0; i < numsubsectors; i++)
+  {
+    gld_HashInt(&md5, subsectors[i].firstline);
+    gld_HashInt(&md5, subsectors[i].numlines);
+    gld_HashInt(&md5, subsectors[i].sector - sectors);
+  }
+
+  for (i = 0; i < numnodes; i++)
+  {
+    gld_HashInt(&md5, nodes[i].x);
+    gld_HashInt(&md5, nodes[i].y);
+    gld_HashInt(&md5, nodes[i].dx);
+    gld_HashInt(&md5, nodes[i].dy);
+    gld_HashInt(&md5, nodes[i].children[0]);
+    gld_HashInt(&md5, nodes[i].children[1]);
+  }
+
+  MD5Final(cksum->bytes, &md5);
+
+  dsda_TranslateCheckSum(cksum);
+}
+
+static char *gld_FlatsCacheFile(const dsda_cksum_t *cksum)
+{
+  dsda_string_t path;
+
+  dsda_StringPrintF(&path, "%s/gl_flats", dsda_DataRoot());
+  M_MakeDir(path.string, false);
+  dsda_StringCatF(&path, "/%s.bin", cksum->string);
+
+  return path.string;
+}
+
+static void gld_WriteFlatsCacheLoops(FILE *file, int loopcount, const GLLoopDef *loops)
+{
+  fwrite(&loopcount, sizeof(loopcount), 1, file);
+  if (loopcount)
+    fwrite(loops, sizeof(*loops), loopcount, file);
+}
+
+static void gld_SaveFlatsCache(const dsda_cksum_t *cksum)
+{
+  char *filename;
+  FILE *file;
+  int header[flats_cache_header_size];
+  int i;
+
+  filename = gld_FlatsCacheFile(cksum);
+  file = M_OpenFile(filename, "wb");
+
+  if (!file)
+  {
+    lprintf(LO_WARN, "gld_SaveFlatsCache: unable to write %s\n", filename);
+    Z_Free(filename);
+    return;
+  }
+
+  header[flats_cache_version] = FLATS_CACHE_VERSION;
+  header[flats_cache_byte_order] = FLATS_CACHE_BYTE_ORDER;
+  header[flats_cache_loop_size] = sizeof(GLLoopDef);
+  header[flats_cache_vertex_size] = sizeof(flats_vbo[0]);
+  header[flats_cache_sectors] = numsectors;
+  header[flats_cache_subsectors] = numsubsectors;
+  header[flats_cache_vertexes] = gld_num_vertexes;
+
+  fwrite(FLATS_CACHE_MAGIC, 1, 8, file);
+  fwrite(header, sizeof(header), 1, file);
+  if (gld_num_vertexes)
+    fwrite(flats_vbo, sizeof(flats_vbo[0]), gld_num_vertexes, file);
+
+  for (i = 0; i < numsectors; i++)
+    gld_WriteFlatsCacheLoops(file, sectorloops[i].loopcount, sectorloops[i].loops);
+
+  for (i = 0; i < numsubsectors; i++)
+    gld_WriteFlatsCacheLoops(file, subsectorloops[i].loopcount, subsectorloops[i].loops);
+
+  if (ferror(file))
+    lprintf(LO_WARN, "gld_SaveFlatsCache: failed to write %s\n", filename);
+
+  fclose(file);
+  Z_Free(filename);
+}
+
+// Sector loops are either tessellated (index -1) or carved from one of the
+// sector's own subsectors, and subsector loops belong to their subsector;
+// pass -1 for whichever of sectornum and subsectornum doesn't apply
+static dboolean gld_ValidFlatsCacheLoopIndex(int index, int sectornum, int subsectornum)
+{
+  if (subsectornum >= 0)
+    return index == subsectornum;
+
+  if (index == -1)
+    return true;
+
+  return index >= 0 && index < numsubsectors &&
+         subsectors[index].sector == &sectors[sectornum];
+}
+
+static dboolean gld_ReadFlatsCacheLoops(const byte **p, const byte *end,
+                                        int sectornum, int subsectornum,
+                                        int *loopcount, GLLoopDef **loops)
+{
+  int count, i;
+
+  if (end - *p < (int)sizeof(count))
+    return false;
+
+  memcpy(&count, *p, sizeof(count));
+  *p += sizeof(count);
+
+  if (count < 0 || (end - *p) / (int)sizeof(GLLoopDef) < count)
+    return false;
+
+  if (!count)
+    return true;
+
+  *loops = Z_Malloc(count * sizeof(GLLoopDef));
+  memcpy(*loops, *p, count * sizeof(GLLoopDef));
+  *p += count * sizeof(GLLoopDef);
+  *loopcount = count;
+
+  for (i = 0; i < count; i++)
+  {
+    const GLLoopDef *loop = &(*loops)[i];
+
+    if (!gld_ValidFlatsCacheLoopIndex(loop->index, sectornum, subsectornum) ||
+        (loop->mode != GL_TRIANGLES && loop->mode != GL_TRIANGLE_FAN &&
+         loop->mode != GL_TRIANGLE_STRIP) ||
+        loop->vertexindex < 0 || loop->vertexcount < 0 ||
+        loop->vertexcount > gld_num_vertexes - loop->vertexindex)
+      return false;
+  }
+
+  return true;
+}
+
+static void gld_ClearFlats(void)
+{
+  int i;
+
+  for (i = 0; i < numsectors; i++)
+  {
+    Z_Free(sectorloops[i].loops);
+    sectorloops[i].loops = NULL;
+    sectorloops[i].loopcount = 0;
+  }
+
+  for (i = 0; i < numsubsectors; i++)
+  {
+    Z_Free(subsectorloops[i].loops);
+    subsectorloops[i].loops = NULL;
+    subsectorloops[i].loopcount = 0;
+  }
+
+  gld_num_vertexes = 0;
+}
+
+static dboolean gld_LoadFlatsCache(const dsda_cksum_t *cksum)
+{
+  char *filename;
+  byte *buffer = NULL;
+  const byte *p, *end;
+  int length;
+  int header[flats_cache_header_size];
+  int i;
+  dboolean valid = false;
+
+  filename = gld_FlatsCacheFile(cksum);
+  length = M_FileExists(filename) ? M_ReadFile(filename, &buffer) : -1;
+  Z_Free(filename);
+
+  if (length < 8 + (int)sizeof(header) || memcmp(buffer, FLATS_CACHE_MAGIC, 8))
+  {
+    Z_Free(buffer);
+    return false;
+  }
+
+  p = buffer + 8;
+  end = buffer + length;
+
+  memcpy(header, p, sizeof(header));
+  p += sizeof(header);
+
+  if (header[flats_cache_version] == FLATS_CACHE_VERSION &&
+      header[flats_cache_byte_order] == FLATS_CACHE_BYTE_ORDER &&
+      header[flats_cache_loop_size] == (int)sizeof(GLLoopDef) &&
+      header[flats_cache_vertex_size] == (int)sizeof(flats_vbo[0]) &&
+      header[flats_cache_sectors] == numsectors &&
+      header[flats_cache_subsectors] == numsubsectors &&
+      header[flats_cache_vertexes] >= 0 &&
+      (end - p) / (int)sizeof(flats_vbo[0]) >= header[flats_cache_vertexes])
+  {
+    int vertexcount = header[flats_cache_vertexes];
+
+    gld_AddGlobalVertexes(vertexcount);
+    if (vertexcount)
+      memcpy(flats_vbo, p, vertexcount * sizeof(flats_vbo[0]));
+    gld_num_vertexes = vertexcount;
+    p += vertexcount * sizeof(flats_vbo[0]);
+
+    valid = true;
+
+    for (i = 0; valid && i < numsectors; i++)
+      valid = gld_ReadFlatsCacheLoops(&p, end, i, -1,
+                                      &sectorloops[i].loopcount, &sectorloops[i].loops);
+
+    for (i = 0; valid && i < numsubsectors; i++)
+      valid = gld_ReadFlatsCacheLoops(&p, end, -1, i,
+                                      &subsectorloops[i].loopcount, &subsectorloops[i].loops);
+
+    valid = valid && p == end;
+
+    if (!valid)
+      gld_ClearFlats();
+  }
+
+  Z_Free(buffer);
+
+  return valid;
+}
+
 static void gld_PreprocessSectors(void)
 {
   char *vertexcheck = NULL;
   char *vertexcheck2 = NULL;
+  dboolean *closed = NULL;
+  dboolean use_cache;
+  dsda_cksum_t cksum;
   int v1num;
   int v2num;
   int i;
@@ -902,8 +1575,8 @@ static void gld_PreprocessSectors(void)
 
   if (numvertexes)
   {
-    vertexcheck=Z_Malloc(numvertexes*sizeof(vertexcheck[0]));
-    vertexcheck2=Z_Malloc(numvertexes*sizeof(vertexcheck2[0]));
+    vertexcheck=Z_Calloc(numvertexes, sizeof(vertexcheck[0]));
+    vertexcheck2=Z_Calloc(numvertexes, sizeof(vertexcheck2[0]));
     if (!vertexcheck || !vertexcheck2)
     {
       if (levelinfo) fclose(levelinfo);
@@ -912,10 +1585,13 @@ static void gld_PreprocessSectors(void)
     }
   }
 
+  if (numsectors)
+    closed=Z_Calloc(numsectors, sizeof(closed[0]));
+
+  // The vertex checks only touch the vertexes of the sector's own lines,
+  // and are cleared again after each sector
   for (i=0; i<numsectors; i++)
   {
-    memset(vertexcheck,0,numvertexes*sizeof(vertexcheck[0]));
-    memset(vertexcheck2,0,numvertexes*sizeof(vertexcheck2[0]));
     for (j=0; j<sectors[i].linecount; j++)
     {
       line_t *l = sectors[i].lines[j];
@@ -952,15 +1628,23 @@ static void gld_PreprocessSectors(void)
     else
     {
       sectors[i].flags |= SECTOR_IS_CLOSED;
-      for (j=0; j<numvertexes; j++)
+      for (j=0; j<sectors[i].linecount; j++)
       {
-        if ((vertexcheck[j]==1) || (vertexcheck[j]==2))
+        line_t *l = sectors[i].lines[j];
+        int k;
+
+        for (k=0; k<2; k++)
         {
+          int vnum = (k ? l->v2 : l->v1) - vertexes;
+
+          if ((vertexcheck[vnum]==1) || (vertexcheck[vnum]==2))
+          {
 #ifdef PRBOOM_DEBUG
-          lprintf(LO_ERROR, "sector %i is not closed at vertex %i ! %i lines in sector\n", i, j, sectors[i].linecount);
+            lprintf(LO_ERROR, "sector %i is not closed at vertex %i ! %i lines in sector\n", i, vnum, sectors[i].linecount);
 #endif
-          if (levelinfo) fprintf(levelinfo, "sector %i is not closed at vertex %i ! %i lines in sector\n", i, j, sectors[i].linecount);
-          sectors[i].flags &= ~SECTOR_IS_CLOSED;
+            if (levelinfo) fprintf(levelinfo, "sector %i is not closed at vertex %i ! %i lines in sector\n", i, vnum, sectors[i].linecount);
+            sectors[i].flags &= ~SECTOR_IS_CLOSED;
+          }
         }
       }
     }
@@ -976,23 +1660,44 @@ static void gld_PreprocessSectors(void)
       }
     }
 
+    for (j=0; j<sectors[i].linecount; j++)
+    {
+      v1num = sectors[i].lines[j]->v1 - vertexes;
+      v2num = sectors[i].lines[j]->v2 - vertexes;
+      vertexcheck[v1num] = vertexcheck[v2num] = 0;
+      vertexcheck2[v1num] = vertexcheck2[v2num] = 0;
+    }
+
     // figgi -- adapted for glnodes
-    if (sectors[i].flags & SECTOR_IS_CLOSED)
-      gld_PrecalculateSector(i);
+    closed[i] = !!(sectors[i].flags & SECTOR_IS_CLOSED);
   }
   Z_Free(vertexcheck);
   Z_Free(vertexcheck2);
 
-  // figgi -- adapted for glnodes
-  if (numnodes)
+  use_cache = dsda_IntConfig(dsda_config_gl_flats_cache) && numsectors && numsubsectors;
+
+  if (use_cache)
+    gld_FlatsCacheKey(&cksum);
+
+  if (!use_cache || !gld_LoadFlatsCache(&cksum))
   {
-    if (!use_gl_nodes)
-      gld_CarveFlats(numnodes-1, 0, 0);
-    else
-      gld_GetSubSectorVertices();
-  }
+    gld_PrecalculateSectors(closed);
 
-  gld_ProcessTexturedMap();
+    // figgi -- adapted for glnodes
+    if (numnodes)
+    {
+      if (!use_gl_nodes)
+        gld_CarveAllFlats();
+      else
+        gld_GetSubSectorVertices();
+    }
+
+    gld_ProcessTexturedMap();
+
+    if (use_cache)
+      gld_SaveFlatsCache(&cksum);
+  }
+  Z_Free(closed);
 
   if (levelinfo) fclose(levelinfo);
 
@@ -1120,7 +1825,7 @@ void gld_ProcessTexturedMap(void)
     gld_TurnOnSubsectorTriangulation();
 
     if (!use_gl_nodes)
-      gld_CarveFlats(numnodes-1, 0, 0);
+      gld_CarveAllFlats();
     else
       gld_GetSubSectorVertices();
 
@@ -22,6 +22,7 @@
 #include "sounds.h"
 #include "w_wad.h"
 #include "lprintf.h"
+#include "i_system.h"
 #include "r_main.h"
 #include "p_tick.h"
 #include "p_spec.h"
@@ -31,8 +32,10 @@
 #include "hexen/po_man.h"
 #include "hexen/sn_sonix.h"
 
+#include "dsda/args.h"
 #include "dsda/id_list.h"
 #include "dsda/map_format.h"
+#include "dsda/time.h"
 
 #include "p_acs.h"
 
@@ -64,6 +67,25 @@ typedef struct {
 #pragma pack(pop)
 #endif //_MSC_VER
 
+// Last operand is a lump offset to branch to
+#define ACS_BRANCH 1
+// Execution never continues with the following instruction
+#define ACS_NOFALL 2
+
+typedef struct {
+    int (*cmd) (void);
+    int argc;
+    int flags;
+} acsCmd_t;
+
+// The p-code is decoded once into a stream of words: each instruction is
+// its handler followed by its operands, already byte swapped and bounds
+// checked, so the interpreter only has to call through the next word.
+typedef union {
+    int (*cmd) (void);
+    int value;
+} acsWord_t;
+
 static void StartOpenACS(int number, int infoIndex, int offset);
 static void ScriptFinished(int number);
 static dboolean TagBusy(int tag);
@@ -177,6 +199,10 @@ static int CmdSetLineSpecial(void);
 static int CmdThingSound(void);
 static int CmdEndPrintBold(void);
 
+static int CmdResume(void);
+static int CmdInvalid(void);
+static int CmdEndOfLump(void);
+
 static void ThingCount(int type, int tid);
 
 int ACScriptCount;
@@ -187,9 +213,22 @@ int MapVars[MAX_ACS_MAP_VARS];
 int WorldVars[MAX_ACS_WORLD_VARS];
 acsstore_t ACSStore[MAX_ACS_STORE + 1]; // +1 for termination marker
 
-static char EvalContext[64];
+static int ACSLump;
 static acs_t *ACScript;
 static unsigned int PCodeOffset;
+static acsWord_t *PCode;
+static int *PCodeWordOffset;    // lump offset of each decoded word
+static int *PCodeOffsetWord;    // decoded instruction at each lump offset
+static int PCodeSize;
+static int PCodeCapacity;
+static int PCodePos;
+static int PCodeInsn = -1;      // instruction being executed, for errors
+static int *DecodeQueue;
+static int DecodeQueueSize;
+static int DecodeQueueCapacity;
+static dboolean ACSProfile;
+static unsigned long long ACSProfileInstructions;
+static unsigned long long ACSProfileTime;
 static int SpecArgs[8];
 static int ACStringCount;
 static const char **ACStrings;
@@ -200,114 +239,141 @@ static acs_t *NewScript;
 // run game setup when ACS scripts are first loaded
 static dboolean newgame = false;
 
-static int (*PCodeCmds[]) (void) =
-{
-        CmdNOP,
-        CmdTerminate,
-        CmdSuspend,
-        CmdPushNumber,
-        CmdLSpec1,
-        CmdLSpec2,
-        CmdLSpec3,
-        CmdLSpec4,
-        CmdLSpec5,
-        CmdLSpec1Direct,
-        CmdLSpec2Direct,
-        CmdLSpec3Direct,
-        CmdLSpec4Direct,
-        CmdLSpec5Direct,
-        CmdAdd,
-        CmdSubtract,
-        CmdMultiply,
-        CmdDivide,
-        CmdModulus,
-        CmdEQ,
-        CmdNE,
-        CmdLT,
-        CmdGT,
-        CmdLE,
-        CmdGE,
-        CmdAssignScriptVar,
-        CmdAssignMapVar,
-        CmdAssignWorldVar,
-        CmdPushScriptVar,
-        CmdPushMapVar,
-        CmdPushWorldVar,
-        CmdAddScriptVar,
-        CmdAddMapVar,
-        CmdAddWorldVar,
-        CmdSubScriptVar,
-        CmdSubMapVar,
-        CmdSubWorldVar,
-        CmdMulScriptVar,
-        CmdMulMapVar,
-        CmdMulWorldVar,
-        CmdDivScriptVar,
-        CmdDivMapVar,
-        CmdDivWorldVar,
-        CmdModScriptVar,
-        CmdModMapVar,
-        CmdModWorldVar,
-        CmdIncScriptVar,
-        CmdIncMapVar,
-        CmdIncWorldVar,
-        CmdDecScriptVar,
-        CmdDecMapVar,
-        CmdDecWorldVar,
-        CmdGoto,
-        CmdIfGoto,
-        CmdDrop,
-        CmdDelay,
-        CmdDelayDirect,
-        CmdRandom,
-        CmdRandomDirect,
-        CmdThingCount,
-        CmdThingCountDirect,
-        CmdTagWait,
-        CmdTagWaitDirect,
-        CmdPolyWait,
-        CmdPolyWaitDirect,
-        CmdChangeFloor,
-        CmdChangeFloorDirect,
-        CmdChangeCeiling,
-        CmdChangeCeilingDirect,
-        CmdRestart,
-        CmdAndLogical,
-        CmdOrLogical,
-        CmdAndBitwise,
-        CmdOrBitwise,
-        CmdEorBitwise,
-        CmdNegateLogical,
-        CmdLShift,
-        CmdRShift,
-        CmdUnaryMinus,
-        CmdIfNotGoto,
-        CmdLineSide,
-        CmdScriptWait,
-        CmdScriptWaitDirect,
-        CmdClearLineSpecial,
-        CmdCaseGoto,
-        CmdBeginPrint,
-        CmdEndPrint,
-        CmdPrintString,
-        CmdPrintNumber,
-        CmdPrintCharacter,
-        CmdPlayerCount,
-        CmdGameType,
-        CmdGameSkill,
-        CmdTimer,
-        CmdSectorSound,
-        CmdAmbientSound,
-        CmdSoundSequence,
-        CmdSetLineTexture,
-        CmdSetLineBlocking,
-        CmdSetLineSpecial,
-        CmdThingSound,
-        CmdEndPrintBold,
+static const acsCmd_t PCodeCmds[] =
+{
+        { CmdNOP, 0, 0 },
+        { CmdTerminate, 0, ACS_NOFALL },
+        { CmdSuspend, 0, 0 },
+        { CmdPushNumber, 1, 0 },
+        { CmdLSpec1, 1, 0 },
+        { CmdLSpec2, 1, 0 },
+        { CmdLSpec3, 1, 0 },
+        { CmdLSpec4, 1, 0 },
+        { CmdLSpec5, 1, 0 },
+        { CmdLSpec1Direct, 2, 0 },
+        { CmdLSpec2Direct, 3, 0 },
+        { CmdLSpec3Direct, 4, 0 },
+        { CmdLSpec4Direct, 5, 0 },
+        { CmdLSpec5Direct, 6, 0 },
+        { CmdAdd, 0, 0 },
+        { CmdSubtract, 0, 0 },
+        { CmdMultiply, 0, 0 },
+        { CmdDivide, 0, 0 },
+        { CmdModulus, 0, 0 },
+        { CmdEQ, 0, 0 },
+        { CmdNE, 0, 0 },
+        { CmdLT, 0, 0 },
+        { CmdGT, 0, 0 },
+        { CmdLE, 0, 0 },
+        { CmdGE, 0, 0 },
+        { CmdAssignScriptVar, 1, 0 },
+        { CmdAssignMapVar, 1, 0 },
+        { CmdAssignWorldVar, 1, 0 },
+        { CmdPushScriptVar, 1, 0 },
+        { CmdPushMapVar, 1, 0 },
+        { CmdPushWorldVar, 1, 0 },
+        { CmdAddScriptVar, 1, 0 },
+        { CmdAddMapVar, 1, 0 },
+        { CmdAddWorldVar, 1, 0 },
+        { CmdSubScriptVar, 1, 0 },
+        { CmdSubMapVar, 1, 0 },
+        { CmdSubWorldVar, 1, 0 },
+        { CmdMulScriptVar, 1, 0 },
+        { CmdMulMapVar, 1, 0 },
+        { CmdMulWorldVar, 1, 0 },
+        { CmdDivScriptVar, 1, 0 },
+        { CmdDivMapVar, 1, 0 },
+        { CmdDivWorldVar, 1, 0 },
+        { CmdModScriptVar, 1, 0 },
+        { CmdModMapVar, 1, 0 },
+        { CmdModWorldVar, 1, 0 },
+        { CmdIncScriptVar, 1, 0 },
+        { CmdIncMapVar, 1, 0 },
+        { CmdIncWorldVar, 1, 0 },
+        { CmdDecScriptVar, 1, 0 },
+        { CmdDecMapVar, 1, 0 },
+        { CmdDecWorldVar, 1, 0 },
+        { CmdGoto, 1, ACS_BRANCH | ACS_NOFALL },
+        { CmdIfGoto, 1, ACS_BRANCH },
+        { CmdDrop, 0, 0 },
+        { CmdDelay, 0, 0 },
+        { CmdDelayDirect, 1, 0 },
+        { CmdRandom, 0, 0 },
+        { CmdRandomDirect, 2, 0 },
+        { CmdThingCount, 0, 0 },
+        { CmdThingCountDirect, 2, 0 },
+        { CmdTagWait, 0, 0 },
+        { CmdTagWaitDirect, 1, 0 },
+        { CmdPolyWait, 0, 0 },
+        { CmdPolyWaitDirect, 1, 0 },
+        { CmdChangeFloor, 0, 0 },
+        { CmdChangeFloorDirect, 2, 0 },
+        { CmdChangeCeiling, 0, 0 },
+        { CmdChangeCeilingDirect, 2, 0 },
+        { CmdRestart, 0, ACS_NOFALL },
+        { CmdAndLogical, 0, 0 },
+        { CmdOrLogical, 0, 0 },
+        { CmdAndBitwise, 0, 0 },
+        { CmdOrBitwise, 0, 0 },
+        { CmdEorBitwise, 0, 0 },
+        { CmdNegateLogical, 0, 0 },
+        { CmdLShift, 0, 0 },
+        { CmdRShift, 0, 0 },
+        { CmdUnaryMinus, 0, 0 },
+        { CmdIfNotGoto, 1, ACS_BRANCH },
+        { CmdLineSide, 0, 0 },
+        { CmdScriptWait, 0, 0 },
+        { CmdScriptWaitDirect, 1, 0 },
+        { CmdClearLineSpecial, 0, 0 },
+        { CmdCaseGoto, 2, ACS_BRANCH },
+        { CmdBeginPrint, 0, 0 },
+        { CmdEndPrint, 0, 0 },
+        { CmdPrintString, 0, 0 },
+        { CmdPrintNumber, 0, 0 },
+        { CmdPrintCharacter, 0, 0 },
+        { CmdPlayerCount, 0, 0 },
+        { CmdGameType, 0, 0 },
+        { CmdGameSkill, 0, 0 },
+        { CmdTimer, 0, 0 },
+        { CmdSectorSound, 0, 0 },
+        { CmdAmbientSound, 0, 0 },
+        { CmdSoundSequence, 0, 0 },
+        { CmdSetLineTexture, 0, 0 },
+        { CmdSetLineBlocking, 0, 0 },
+        { CmdSetLineSpecial, 0, 0 },
+        { CmdThingSound, 0, 0 },
+        { CmdEndPrintBold, 0, 0 },
 };
 
+// Only built when an assertion fails, so that the interpreter does not pay
+// for formatting it on every instruction.
+static void GetEvalContext(char *buf, size_t size)
+{
+    int offset;
+
+    if (PCodeInsn < 0)
+    {
+        snprintf(buf, size, "header parsing of lump #%d", ACSLump);
+        return;
+    }
+
+    offset = PCodeWordOffset[PCodeInsn];
+    if (offset >= 0 && offset + 3 < ActionCodeSize)
+    {
+        snprintf(buf, size, "script %d @0x%x, cmd=%d",
+                 ACSInfo[ACScript->infoIndex].number, offset + 4,
+                 (int) LittleLong(*(const int *) (ActionCodeBase + offset)));
+    }
+    else
+    {
+        snprintf(buf, size, "script %d @0x%x",
+                 ACSInfo[ACScript->infoIndex].number, offset);
+    }
+}
+
 static void ACSAssert(int condition, const char *fmt, ...)
 {
+    char context[64];
     char buf[128];
     va_list args;
 
@@ -319,7 +385,8 @@ static void ACSAssert(int condition, const char *fmt, ...)
     va_start(args, fmt);
     vsnprintf(buf, sizeof(buf), fmt, args);
     va_end(args);
-    I_Error("ACS assertion failure: in %s: %s", EvalContext, buf);
+    GetEvalContext(context, sizeof(context));
+    I_Error("ACS assertion failure: in %s: %s", context, buf);
 }
 
 static int ReadCodeInt(void)
@@ -337,9 +404,14 @@ static int ReadCodeInt(void)
     return result;
 }
 
+static int ReadOperand(void)
+{
+    return PCode[PCodePos++].value;
+}
+
 static int ReadScriptVar(void)
 {
-    int var = ReadCodeInt();
+    int var = ReadOperand();
     ACSAssert(var >= 0, "negative script variable: %d < 0", var);
     ACSAssert(var < MAX_ACS_SCRIPT_VARS,
               "invalid script variable: %d >= %d", var, MAX_ACS_SCRIPT_VARS);
@@ -348,7 +420,7 @@ static int ReadScriptVar(void)
 
 static int ReadMapVar(void)
 {
-    int var = ReadCodeInt();
+    int var = ReadOperand();
     ACSAssert(var >= 0, "negative map variable: %d < 0", var);
     ACSAssert(var < MAX_ACS_MAP_VARS,
               "invalid map variable: %d >= %d", var, MAX_ACS_MAP_VARS);
@@ -357,7 +429,7 @@ static int ReadMapVar(void)
 
 static int ReadWorldVar(void)
 {
-    int var = ReadCodeInt();
+    int var = ReadOperand();
     ACSAssert(var >= 0, "negative world variable: %d < 0", var);
     ACSAssert(var < MAX_ACS_WORLD_VARS,
               "invalid world variable: %d >= %d", var, MAX_ACS_WORLD_VARS);
@@ -382,6 +454,175 @@ static int ReadOffset(void)
     return offset;
 }
 
+static void EmitWord(acsWord_t word, int offset)
+{
+    if (PCodeSize == PCodeCapacity)
+    {
+        PCodeCapacity = PCodeCapacity ? PCodeCapacity * 2 : 1024;
+        PCode = Z_ReallocLevel(PCode, PCodeCapacity * sizeof(*PCode));
+        PCodeWordOffset = Z_ReallocLevel(PCodeWordOffset,
+                                         PCodeCapacity * sizeof(*PCodeWordOffset));
+    }
+
+    PCode[PCodeSize] = word;
+    PCodeWordOffset[PCodeSize] = offset;
+    ++PCodeSize;
+}
+
+static void EmitCmd(int (*cmd) (void), int offset)
+{
+    acsWord_t word;
+
+    word.cmd = cmd;
+    EmitWord(word, offset);
+}
+
+static void EmitValue(int value, int offset)
+{
+    acsWord_t word;
+
+    word.value = value;
+    EmitWord(word, offset);
+}
+
+static dboolean IsDecoded(int offset)
+{
+    return offset >= 0 && offset < ActionCodeSize &&
+           PCodeOffsetWord[offset] >= 0;
+}
+
+static void QueueDecode(int offset)
+{
+    if (offset < 0 || offset >= ActionCodeSize || IsDecoded(offset))
+    {
+        return;
+    }
+
+    if (DecodeQueueSize == DecodeQueueCapacity)
+    {
+        DecodeQueueCapacity = DecodeQueueCapacity ? DecodeQueueCapacity * 2 : 64;
+        DecodeQueue = Z_ReallocLevel(DecodeQueue,
+                                     DecodeQueueCapacity * sizeof(*DecodeQueue));
+    }
+
+    DecodeQueue[DecodeQueueSize++] = offset;
+}
+
+//
+// DecodeRun
+//
+// Decodes straight-line code starting at offset until control can no longer
+// fall through, or until it joins code that was already decoded. Invalid
+// instructions are decoded into traps that raise the same assertions the
+// interpreter used to, so that they only fire if the code is executed.
+//
+
+static int DecodeRun(int offset)
+{
+    int start = PCodeSize;
+
+    while (!IsDecoded(offset))
+    {
+        const acsCmd_t *info;
+        int cmd;
+        int i;
+
+        if (offset < 0 || offset + 3 >= ActionCodeSize)
+        {
+            EmitCmd(CmdEndOfLump, offset);
+            return start;
+        }
+
+        PCodeOffsetWord[offset] = PCodeSize;
+        cmd = LittleLong(*(const int *) (ActionCodeBase + offset));
+
+        if (cmd < 0 || cmd >= arrlen(PCodeCmds))
+        {
+            EmitCmd(CmdInvalid, offset);
+            EmitValue(cmd, offset);
+            return start;
+        }
+
+        info = &PCodeCmds[cmd];
+        if (offset + 4 * info->argc + 3 >= ActionCodeSize)
+        {
+            EmitCmd(CmdEndOfLump, offset);
+            return start;
+        }
+
+        EmitCmd(info->cmd, offset);
+        for (i = 0; i < info->argc; ++i)
+        {
+            offset += 4;
+            EmitValue(LittleLong(*(const int *) (ActionCodeBase + offset)),
+                      offset);
+        }
+        offset += 4;
+
+        if (info->flags & ACS_BRANCH)
+        {
+            QueueDecode(PCode[PCodeSize - 1].value);
+        }
+
+        if (info->flags & ACS_NOFALL)
+        {
+            break;
+        }
+    }
+
+    // Continues at offset; this also gives a script that stops on the last
+    // instruction of the run the right lump offset to resume from.
+    EmitCmd(CmdResume, offset);
+
+    return start;
+}
+
+//
+// DecodedPos
+//
+// Returns the word where the instruction at the given lump offset starts,
+// decoding it and everything it can branch to first if necessary.
+//
+
+static int DecodedPos(int offset)
+{
+    int pos;
+
+    if (IsDecoded(offset))
+    {
+        return PCodeOffsetWord[offset];
+    }
+
+    pos = DecodeRun(offset);
+    while (DecodeQueueSize > 0)
+    {
+        offset = DecodeQueue[--DecodeQueueSize];
+        if (!IsDecoded(offset))
+        {
+            DecodeRun(offset);
+        }
+    }
+
+    return pos;
+}
+
+static int ReadBranch(void)
+{
+    int offset = ReadOperand();
+    ACSAssert(offset >= 0, "negative lump offset %d", offset);
+    ACSAssert(offset < ActionCodeSize, "invalid lump offset: %d >= %d",
+              offset, ActionCodeSize);
+    return DecodedPos(offset);
+}
+
+static void P_ACSPrintProfile(void)
+{
+    lprintf(LO_INFO, "ACS: %llu instructions in %llu us (%.1f M/s)\n",
+            ACSProfileInstructions, ACSProfileTime / 1000,
+            ACSProfileTime ?
+            (double) ACSProfileInstructions * 1000 / ACSProfileTime : 0.0);
+}
+
 void P_LoadACScripts(int lump)
 {
     int i, offset;
@@ -394,10 +635,24 @@ void P_LoadACScripts(int lump)
         newgame = false;
     }
 
+    if (!ACSProfile && dsda_Flag(dsda_arg_acs_profile))
+    {
+        ACSProfile = true;
+        I_AtExit(P_ACSPrintProfile, true, "P_ACSPrintProfile", exit_priority_normal);
+    }
+
     ActionCodeBase = W_LumpByNum(lump);
     ActionCodeSize = W_LumpLength(lump);
+    ACSLump = lump;
+    PCodeInsn = -1;
 
-    snprintf(EvalContext, sizeof(EvalContext), "header parsing of lump #%d", lump);
+    PCode = NULL;
+    PCodeWordOffset = NULL;
+    PCodeSize = PCodeCapacity = 0;
+    DecodeQueue = NULL;
+    DecodeQueueSize = DecodeQueueCapacity = 0;
+    PCodeOffsetWord = Z_MallocLevel(ActionCodeSize * sizeof(*PCodeOffsetWord));
+    memset(PCodeOffsetWord, -1, ActionCodeSize * sizeof(*PCodeOffsetWord));
 
     header = (const acsHeader_t *) ActionCodeBase;
     PCodeOffset = LittleLong(header->infoOffset);
@@ -451,6 +706,11 @@ void P_LoadACScripts(int lump)
                   "string %d missing terminating NUL", i);
     }
 
+    for (i = 0; i < ACScriptCount; i++)
+    {
+        DecodedPos(ACSInfo[i].offset);
+    }
+
     memset(MapVars, 0, sizeof(MapVars));
 }
 
@@ -656,8 +916,8 @@ void P_ACSInitNewGame(void)
 
 void T_InterpretACS(acs_t * script)
 {
-    int cmd;
     int action;
+    int count;
 
     if (ACSInfo[script->infoIndex].state == ASTE_TERMINATING)
     {
@@ -676,24 +936,30 @@ void T_InterpretACS(acs_t * script)
         return;
     }
     ACScript = script;
-    PCodeOffset = ACScript->ip;
+
+    if (ACSProfile)
+    {
+        dsda_StartTimer(dsda_timer_acs);
+    }
+
+    PCodePos = DecodedPos(ACScript->ip);
+    count = 0;
 
     do
     {
-        snprintf(EvalContext, sizeof(EvalContext), "script %d @0x%x",
-                 ACSInfo[script->infoIndex].number, PCodeOffset);
-        cmd = ReadCodeInt();
-        snprintf(EvalContext, sizeof(EvalContext), "script %d @0x%x, cmd=%d",
-                 ACSInfo[script->infoIndex].number, PCodeOffset, cmd);
-        ACSAssert(cmd >= 0, "negative ACS instruction %d", cmd);
-        ACSAssert(cmd < arrlen(PCodeCmds),
-                  "invalid ACS instruction %d (maybe this WAD is designed "
-                  "for an advanced source port and is not vanilla "
-                  "compatible)", cmd);
-        action = PCodeCmds[cmd]();
+        PCodeInsn = PCodePos;
+        action = PCode[PCodePos++].cmd();
+        ++count;
     } while (action == SCRIPT_CONTINUE);
 
-    ACScript->ip = PCodeOffset;
+    PCodeInsn = -1;
+    ACScript->ip = PCodeWordOffset[PCodePos];
+
+    if (ACSProfile)
+    {
+        ACSProfileTime += dsda_ElapsedTimeNS(dsda_timer_acs);
+        ACSProfileInstructions += count;
+    }
 
     if (action == SCRIPT_TERMINATE)
     {
@@ -835,7 +1101,7 @@ static int CmdSuspend(void)
 
 static int CmdPushNumber(void)
 {
-    Push(ReadCodeInt());
+    Push(ReadOperand());
     return SCRIPT_CONTINUE;
 }
 
@@ -843,7 +1109,7 @@ static int CmdLSpec1(void)
 {
     int special;
 
-    special = ReadCodeInt();
+    special = ReadOperand();
     SpecArgs[0] = Pop();
     map_format.execute_line_special(special, SpecArgs, ACScript->line,
                                     ACScript->side, ACScript->activator);
@@ -854,7 +1120,7 @@ static int CmdLSpec2(void)
 {
     int special;
 
-    special = ReadCodeInt();
+    special = ReadOperand();
     SpecArgs[1] = Pop();
     SpecArgs[0] = Pop();
     map_format.execute_line_special(special, SpecArgs, ACScript->line,
@@ -866,7 +1132,7 @@ static int CmdLSpec3(void)
 {
     int special;
 
-    special = ReadCodeInt();
+    special = ReadOperand();
     SpecArgs[2] = Pop();
     SpecArgs[1] = Pop();
     SpecArgs[0] = Pop();
@@ -879,7 +1145,7 @@ static int CmdLSpec4(void)
 {
     int special;
 
-    special = ReadCodeInt();
+    special = ReadOperand();
     SpecArgs[3] = Pop();
     SpecArgs[2] = Pop();
     SpecArgs[1] = Pop();
@@ -893,7 +1159,7 @@ static int CmdLSpec5(void)
 {
     int special;
 
-    special = ReadCodeInt();
+    special = ReadOperand();
     SpecArgs[4] = Pop();
     SpecArgs[3] = Pop();
     SpecArgs[2] = Pop();
@@ -908,8 +1174,8 @@ static int CmdLSpec1Direct(void)
 {
     int special;
 
-    special = ReadCodeInt();
-    SpecArgs[0] = ReadCodeInt();
+    special = ReadOperand();
+    SpecArgs[0] = ReadOperand();
     map_format.execute_line_special(special, SpecArgs, ACScript->line,
                                     ACScript->side, ACScript->activator);
     return SCRIPT_CONTINUE;
@@ -919,9 +1185,9 @@ static int CmdLSpec2Direct(void)
 {
     int special;
 
-    special = ReadCodeInt();
-    SpecArgs[0] = ReadCodeInt();
-    SpecArgs[1] = ReadCodeInt();
+    special = ReadOperand();
+    SpecArgs[0] = ReadOperand();
+    SpecArgs[1] = ReadOperand();
     map_format.execute_line_special(special, SpecArgs, ACScript->line,
                                     ACScript->side, ACScript->activator);
     return SCRIPT_CONTINUE;
@@ -931,10 +1197,10 @@ static int CmdLSpec3Direct(void)
 {
     int special;
 
-    special = ReadCodeInt();
-    SpecArgs[0] = ReadCodeInt();
-    SpecArgs[1] = ReadCodeInt();
-    SpecArgs[2] = ReadCodeInt();
+    special = ReadOperand();
+    SpecArgs[0] = ReadOperand();
+    SpecArgs[1] = ReadOperand();
+    SpecArgs[2] = ReadOperand();
     map_format.execute_line_special(special, SpecArgs, ACScript->line,
                                     ACScript->side, ACScript->activator);
     return SCRIPT_CONTINUE;
@@ -944,11 +1210,11 @@ static int CmdLSpec4Direct(void)
 {
     int special;
 
-    special = ReadCodeInt();
-    SpecArgs[0] = ReadCodeInt();
-    SpecArgs[1] = ReadCodeInt();
-    SpecArgs[2] = ReadCodeInt();
-    SpecArgs[3] = ReadCodeInt();
+    special = ReadOperand();
+    SpecArgs[0] = ReadOperand();
+    SpecArgs[1] = ReadOperand();
+    SpecArgs[2] = ReadOperand();
+    SpecArgs[3] = ReadOperand();
     map_format.execute_line_special(special, SpecArgs, ACScript->line,
                                     ACScript->side, ACScript->activator);
     return SCRIPT_CONTINUE;
@@ -958,12 +1224,12 @@ static int CmdLSpec5Direct(void)
 {
     int special;
 
-    special = ReadCodeInt();
-    SpecArgs[0] = ReadCodeInt();
-    SpecArgs[1] = ReadCodeInt();
-    SpecArgs[2] = ReadCodeInt();
-    SpecArgs[3] = ReadCodeInt();
-    SpecArgs[4] = ReadCodeInt();
+    special = ReadOperand();
+    SpecArgs[0] = ReadOperand();
+    SpecArgs[1] = ReadOperand();
+    SpecArgs[2] = ReadOperand();
+    SpecArgs[3] = ReadOperand();
+    SpecArgs[4] = ReadOperand();
     map_format.execute_line_special(special, SpecArgs, ACScript->line,
                                     ACScript->side, ACScript->activator);
     return SCRIPT_CONTINUE;
@@ -1220,7 +1486,7 @@ static int CmdDecWorldVar(void)
 
 static int CmdGoto(void)
 {
-    PCodeOffset = ReadOffset();
+    PCodePos = ReadBranch();
     return SCRIPT_CONTINUE;
 }
 
@@ -1228,11 +1494,11 @@ static int CmdIfGoto(void)
 {
     int offset;
 
-    offset = ReadOffset();
+    offset = ReadBranch();
 
     if (Pop() != 0)
     {
-        PCodeOffset = offset;
+        PCodePos = offset;
     }
     return SCRIPT_CONTINUE;
 }
@@ -1251,7 +1517,7 @@ static int CmdDelay(void)
 
 static int CmdDelayDirect(void)
 {
-    ACScript->delayCount = ReadCodeInt();
+    ACScript->delayCount = ReadOperand();
     return SCRIPT_STOP;
 }
 
@@ -1271,8 +1537,8 @@ static int CmdRandomDirect(void)
     int low;
     int high;
 
-    low = ReadCodeInt();
-    high = ReadCodeInt();
+    low = ReadOperand();
+    high = ReadOperand();
     Push(low + (P_Random(pr_hexen) % (high - low + 1)));
     return SCRIPT_CONTINUE;
 }
@@ -1290,8 +1556,8 @@ static int CmdThingCountDirect(void)
 {
     int type;
 
-    type = ReadCodeInt();
-    ThingCount(type, ReadCodeInt());
+    type = ReadOperand();
+    ThingCount(type, ReadOperand());
     return SCRIPT_CONTINUE;
 }
 
@@ -1361,7 +1627,7 @@ static int CmdTagWait(void)
 
 static int CmdTagWaitDirect(void)
 {
-    ACSInfo[ACScript->infoIndex].waitValue = ReadCodeInt();
+    ACSInfo[ACScript->infoIndex].waitValue = ReadOperand();
     ACSInfo[ACScript->infoIndex].state = ASTE_WAITINGFORTAG;
     return SCRIPT_STOP;
 }
@@ -1375,7 +1641,7 @@ static int CmdPolyWait(void)
 
 static int CmdPolyWaitDirect(void)
 {
-    ACSInfo[ACScript->infoIndex].waitValue = ReadCodeInt();
+    ACSInfo[ACScript->infoIndex].waitValue = ReadOperand();
     ACSInfo[ACScript->infoIndex].state = ASTE_WAITINGFORPOLY;
     return SCRIPT_STOP;
 }
@@ -1401,8 +1667,8 @@ static int CmdChangeFloorDirect(void)
     int flat;
     const int *id_p;
 
-    tag = ReadCodeInt();
-    flat = R_FlatNumForName(StringLookup(ReadCodeInt()));
+    tag = ReadOperand();
+    flat = R_FlatNumForName(StringLookup(ReadOperand()));
     FIND_SECTORS(id_p, tag)
     {
         sectors[*id_p].floorpic = flat;
@@ -1431,8 +1697,8 @@ static int CmdChangeCeilingDirect(void)
     int flat;
     const int *id_p;
 
-    tag = ReadCodeInt();
-    flat = R_FlatNumForName(StringLookup(ReadCodeInt()));
+    tag = ReadOperand();
+    flat = R_FlatNumForName(StringLookup(ReadOperand()));
     FIND_SECTORS(id_p, tag)
     {
         sectors[*id_p].ceilingpic = flat;
@@ -1442,7 +1708,7 @@ static int CmdChangeCeilingDirect(void)
 
 static int CmdRestart(void)
 {
-    PCodeOffset = ACSInfo[ACScript->infoIndex].offset;
+    PCodePos = DecodedPos(ACSInfo[ACScript->infoIndex].offset);
     return SCRIPT_CONTINUE;
 }
 
@@ -1510,11 +1776,11 @@ static int CmdIfNotGoto(void)
 {
     int offset;
 
-    offset = ReadOffset();
+    offset = ReadBranch();
 
     if (Pop() == 0)
     {
-        PCodeOffset = offset;
+        PCodePos = offset;
     }
     return SCRIPT_CONTINUE;
 }
@@ -1534,7 +1800,7 @@ static int CmdScriptWait(void)
 
 static int CmdScriptWaitDirect(void)
 {
-    ACSInfo[ACScript->infoIndex].waitValue = ReadCodeInt();
+    ACSInfo[ACScript->infoIndex].waitValue = ReadOperand();
     ACSInfo[ACScript->infoIndex].state = ASTE_WAITINGFORSCRIPT;
     return SCRIPT_STOP;
 }
@@ -1553,12 +1819,12 @@ static int CmdCaseGoto(void)
     int value;
     int offset;
 
-    value = ReadCodeInt();
-    offset = ReadOffset();
+    value = ReadOperand();
+    offset = ReadBranch();
 
     if (Top() == value)
     {
-        PCodeOffset = offset;
+        PCodePos = offset;
         Drop();
     }
 
@@ -1601,6 +1867,30 @@ static int CmdEndPrintBold(void)
     return SCRIPT_CONTINUE;
 }
 
+static int CmdResume(void)
+{
+    PCodePos = DecodedPos(PCodeWordOffset[PCodePos - 1]);
+    return SCRIPT_CONTINUE;
+}
+
+static int CmdInvalid(void)
+{
+    int cmd = ReadOperand();
+
+    ACSAssert(cmd >= 0, "negative ACS instruction %d", cmd);
+    ACSAssert(cmd < arrlen(PCodeCmds),
+              "invalid ACS instruction %d (maybe this WAD is designed "
+              "for an advanced source port and is not vanilla "
+              "compatible)", cmd);
+    return SCRIPT_TERMINATE;
+}
+
+static int CmdEndOfLump(void)
+{
+    ACSAssert(false, "unexpectedly reached end of ACS lump");
+    return SCRIPT_TERMINATE;
+}
+
 static int CmdPrintString(void)
 {
     M_StringConcat(PrintBuffer, StringLookup(Pop()), sizeof(PrintBuffer));
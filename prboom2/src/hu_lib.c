@@ -66,6 +66,7 @@ void HUlib_clearTextLine(hu_textline_t* t)
   t->linelen =         // killough 1/23 98: support multiple lines
     t->len = 0;
   t->l[0] = 0;
+  t->layout_valid = false;
 }
 
 //
@@ -115,35 +116,36 @@ dboolean HUlib_addCharToTextLine
 
     t->l[t->len++] = ch;
     t->l[t->len] = 0;
+    t->layout_valid = false;
     return true;
   }
 
 }
 
 //
-// HUlib_drawTextLine()
+// HUlib_layoutTextLine()
 //
-// Draws a hu_textline_t widget
+// Turns the text of a hu_textline_t widget into a run of glyphs relative to
+// its y, so that unchanged text is drawn without parsing it again. Text with
+// more glyphs than fit in the run is drawn as it goes and is not kept.
 //
-// Passed the hu_textline_t and flag whether to draw a cursor
+// Passed the hu_textline_t
 // Returns nothing
 //
-void HUlib_drawTextLine
-( hu_textline_t* l,
-  dboolean drawcursor )
+static void HUlib_layoutTextLine(hu_textline_t* l)
 {
-
   int     i;
   int     w;
   int     x;
   unsigned char c;
-  int oc = l->cm; //jff 2/17/98 remember default color
+  int cm = l->cm; //jff 2/17/98 color changes only last for this text
   int y;          // killough 1/18/98 -- support multiple lines
+  dboolean overflow = false;
 
-  // draw the new stuff
+  l->glyph_count = 0;
 
   x = l->x;
-  y = l->y;
+  y = 0;
   for (i=0;i<l->len;i++)
   {
     c = toupper(l->l[i]); //jff insure were not getting a cheap toupper conv.
@@ -160,7 +162,7 @@ void HUlib_drawTextLine
       if (++i < l->len)
       {
         if (l->l[i] >= HU_COLOR && l->l[i] < HU_COLOR + CR_HUD_LIMIT)
-          l->cm = l->l[i] - HU_COLOR;
+          cm = l->l[i] - HU_COLOR;
         else if (l->l[i] < HU_COLOR)
           x += l->l[i];
       }
@@ -170,9 +172,19 @@ void HUlib_drawTextLine
       w = l->f[c - l->sc].width;
       if (x+w-l->f[c - l->sc].leftoffset > BASE_WIDTH)
         break;
-      // killough 1/18/98 -- support multiple lines:
-      // CPhipps - patch drawing updated
-      V_DrawNumPatch(x, y, FG, l->f[c - l->sc].lumpnum, l->cm, VPT_TRANS | l->flags);
+
+      if (l->glyph_count == HU_MAXGLYPHS)
+      {
+        V_DrawPatchRun(l->glyphs, l->glyph_count, 0, l->y, FG, VPT_TRANS | l->flags);
+        l->glyph_count = 0;
+        overflow = true;
+      }
+
+      l->glyphs[l->glyph_count].lump = l->f[c - l->sc].lumpnum;
+      l->glyphs[l->glyph_count].x = x;
+      l->glyphs[l->glyph_count].y = y;
+      l->glyphs[l->glyph_count].cm = cm;
+      l->glyph_count++;
       x += w;
     }
     else
@@ -182,14 +194,39 @@ void HUlib_drawTextLine
       break;
     }
   }
-  l->cm = oc; //jff 2/17/98 restore original color
+
+  l->end_x = x;
+  l->end_y = y;
+  l->layout_x = l->x;
+  l->layout_cm = l->cm;
+  l->layout_valid = !overflow;
+}
+
+//
+// HUlib_drawTextLine()
+//
+// Draws a hu_textline_t widget
+//
+// Passed the hu_textline_t and flag whether to draw a cursor
+// Returns nothing
+//
+void HUlib_drawTextLine
+( hu_textline_t* l,
+  dboolean drawcursor )
+{
+  if (!l->layout_valid || l->layout_x != l->x || l->layout_cm != l->cm)
+    HUlib_layoutTextLine(l);
+
+  // killough 1/18/98 -- support multiple lines:
+  // CPhipps - patch drawing updated
+  V_DrawPatchRun(l->glyphs, l->glyph_count, 0, l->y, FG, VPT_TRANS | l->flags);
 
   // draw the cursor if requested
-  if (drawcursor && x + l->f['_' - l->sc].width <= BASE_WIDTH)
+  if (drawcursor && l->end_x + l->f['_' - l->sc].width <= BASE_WIDTH)
   {
     // killough 1/18/98 -- support multiple lines
     // CPhipps - patch drawing updated
-    V_DrawNumPatch(x, y, FG, l->f['_' - l->sc].lumpnum, CR_DEFAULT, VPT_NONE | l->flags);
+    V_DrawNumPatch(l->end_x, l->y + l->end_y, FG, l->f['_' - l->sc].lumpnum, CR_DEFAULT, VPT_NONE | l->flags);
   }
 }
 
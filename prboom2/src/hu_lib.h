@@ -69,6 +69,16 @@ typedef struct
 
   int line_height;
   int space_width;
+
+  // glyphs laid out by the last draw, kept until the text, x or color change
+  #define HU_MAXGLYPHS 200
+  patch_run_t glyphs[HU_MAXGLYPHS];
+  int   glyph_count;
+  dboolean layout_valid;
+  int   layout_x;
+  int   layout_cm;
+  int   end_x;                          // cursor position after the text
+  int   end_y;                          // relative to y
 } hu_textline_t;
 
 //
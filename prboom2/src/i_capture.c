@@ -33,6 +33,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "i_sound.h"
 #include "i_video.h"
 #include "lprintf.h"
@@ -41,9 +42,16 @@
 #include "i_capture.h"
 
 #include "dsda/configuration.h"
+#include "dsda/parallel_render.h"
+#include "dsda/utility.h"
 
 int capturing_video = 0;
 static const char *vid_fname;
+static const char *list_fname;
+
+// a parallel render captures the sound and the video in separate processes
+static dboolean cap_sound;
+static dboolean cap_video;
 
 typedef struct
 { // information on a running pipe
@@ -72,6 +80,7 @@ int cap_wipescreen;
 // %h video height (px)
 // %s sound rate (hz)
 // %f filename passed to -viddump
+// %l segment list passed to cap_concatcommand
 // %% single percent sign
 // TODO: add aspect ratio information
 //
@@ -84,13 +93,14 @@ static int parsecommand (char *out, const char *in, int len)
   {
     if (*in == '%')
     {
-      I_UpdateRenderSize(); // Handle potential resolution scaling - DTIED
       switch (in[1])
       {
         case 'w':
+          I_UpdateRenderSize(); // Handle potential resolution scaling - DTIED
           i = snprintf (out, len, "%u", renderW);
           break;
         case 'h':
+          I_UpdateRenderSize();
           i = snprintf (out, len, "%u", renderH);
           break;
         case 's':
@@ -102,6 +112,9 @@ static int parsecommand (char *out, const char *in, int len)
         case 'r':
           i = snprintf (out, len, "%u", cap_fps);
           break;
+        case 'l':
+          i = snprintf (out, len, "%s", list_fname ? list_fname : "");
+          break;
         case '%':
           i = snprintf (out, len, "%%");
           break;
@@ -488,13 +501,88 @@ static int threadstderrproc (void *data)
 }
 
 
+// a segment of a parallel render writes its own file in place of cap_tempfile2
+static int I_SegmentVideoCommand (char *out, const char *in, int len)
+{
+  const char *tempfile = dsda_StringConfig(dsda_config_cap_tempfile2);
+  const char *match = *tempfile ? strstr (in, tempfile) : NULL;
+  dsda_string_t command;
+  dsda_string_t segment;
+  int result;
+
+  if (!match)
+  {
+    lprintf (LO_ERROR, "I_CapturePrep: cap_videocommand must write cap_tempfile2 (%s)\n", tempfile);
+    return 0;
+  }
+
+  dsda_ParallelRenderFile (&segment, dsda_ParallelRenderVideoSuffix ());
+
+  dsda_InitString (&command, NULL);
+  dsda_StringCatF (&command, "%.*s\"%s\"%s", (int) (match - in), in, segment.string, match + strlen (tempfile));
+
+  result = parsecommand (out, command.string, len);
+
+  dsda_FreeString (&command);
+  dsda_FreeString (&segment);
+
+  return result;
+}
+
+// runs a command to completion, dumping its output
+static int I_RunCapturePipe (pipeinfo_t *p, const char *stdoutdumpname, const char *stderrdumpname)
+{
+  int s;
+
+  if (!my_popen3 (p))
+    return 0;
+
+  p->stdoutdumpname = stdoutdumpname;
+  p->stderrdumpname = stderrdumpname;
+  p->outthread = SDL_CreateThread (threadstdoutproc, "capture.outthread", p);
+  p->errthread = SDL_CreateThread (threadstderrproc, "capture.errthread", p);
+
+  my_pclose3 (p);
+  SDL_WaitThread (p->outthread, &s);
+  SDL_WaitThread (p->errthread, &s);
+
+  return 1;
+}
+
+// mux the sound and video temp files into the final output
+static void I_CaptureMux (void)
+{
+  lprintf (LO_INFO, "I_CaptureFinish: opening pipe \"%s\"\n", muxpipe.command);
+
+  if (!I_RunCapturePipe (&muxpipe, "mux_stdout.txt", "mux_stderr.txt"))
+  {
+    lprintf (LO_ERROR, "I_CaptureFinish: finalize pipe failed\n");
+    return;
+  }
+
+  // unlink any files user wants gone
+  if (dsda_IntConfig(dsda_config_cap_remove_tempfiles))
+  {
+    const char* cap_tempfile1;
+    const char* cap_tempfile2;
+
+    cap_tempfile1 = dsda_StringConfig(dsda_config_cap_tempfile1);
+    cap_tempfile2 = dsda_StringConfig(dsda_config_cap_tempfile2);
+
+    M_remove (cap_tempfile1);
+    M_remove (cap_tempfile2);
+  }
+}
+
 // init and open sound, video pipes
 // fn is filename passed from command line, typically final output file
 void I_CapturePrep (const char *fn)
 {
+  static dsda_string_t video_stdout, video_stderr;
   const char* cap_soundcommand;
   const char* cap_videocommand;
   const char* cap_muxcommand;
+  parallel_render_pass_t pass;
 
   cap_soundcommand = dsda_StringConfig(dsda_config_cap_soundcommand);
   cap_videocommand = dsda_StringConfig(dsda_config_cap_videocommand);
@@ -504,53 +592,90 @@ void I_CapturePrep (const char *fn)
 
   vid_fname = fn;
 
-  if (!parsecommand (soundpipe.command, cap_soundcommand, sizeof(soundpipe.command)))
+  pass = dsda_ParallelRenderPass ();
+  cap_sound = pass != parallel_render_segment;
+  cap_video = pass != parallel_render_key_frames;
+
+  if (cap_sound && !parsecommand (soundpipe.command, cap_soundcommand, sizeof(soundpipe.command)))
   {
     lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", cap_soundcommand);
     capturing_video = 0;
     return;
   }
-  if (!parsecommand (videopipe.command, cap_videocommand, sizeof(videopipe.command)))
+  if (pass == parallel_render_segment)
+  {
+    if (!I_SegmentVideoCommand (videopipe.command, cap_videocommand, sizeof(videopipe.command)))
+    {
+      capturing_video = 0;
+      return;
+    }
+  }
+  else if (cap_video && !parsecommand (videopipe.command, cap_videocommand, sizeof(videopipe.command)))
   {
     lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", cap_videocommand);
     capturing_video = 0;
     return;
   }
-  if (!parsecommand (muxpipe.command, cap_muxcommand, sizeof(muxpipe.command)))
+  if (pass == parallel_render_none && !parsecommand (muxpipe.command, cap_muxcommand, sizeof(muxpipe.command)))
   {
     lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", cap_muxcommand);
     capturing_video = 0;
     return;
   }
 
-  lprintf (LO_INFO, "I_CapturePrep: opening pipe \"%s\"\n", soundpipe.command);
-  if (!my_popen3 (&soundpipe))
+  if (cap_sound)
   {
-    lprintf (LO_ERROR, "I_CapturePrep: sound pipe failed\n");
-    capturing_video = 0;
-    return;
+    lprintf (LO_INFO, "I_CapturePrep: opening pipe \"%s\"\n", soundpipe.command);
+    if (!my_popen3 (&soundpipe))
+    {
+      lprintf (LO_ERROR, "I_CapturePrep: sound pipe failed\n");
+      capturing_video = 0;
+      return;
+    }
   }
-  lprintf (LO_INFO, "I_CapturePrep: opening pipe \"%s\"\n", videopipe.command);
-  if (!my_popen3 (&videopipe))
+  if (cap_video)
   {
-    lprintf (LO_ERROR, "I_CapturePrep: video pipe failed\n");
-    my_pclose3 (&soundpipe);
-    capturing_video = 0;
-    return;
+    lprintf (LO_INFO, "I_CapturePrep: opening pipe \"%s\"\n", videopipe.command);
+    if (!my_popen3 (&videopipe))
+    {
+      lprintf (LO_ERROR, "I_CapturePrep: video pipe failed\n");
+      if (cap_sound)
+        my_pclose3 (&soundpipe);
+      capturing_video = 0;
+      return;
+    }
   }
-  I_SetSoundCap ();
+  if (cap_sound)
+    I_SetSoundCap ();
   lprintf (LO_INFO, "I_CapturePrep: video capture started\n");
   capturing_video = 1;
 
   // start reader threads
-  soundpipe.stdoutdumpname = "sound_stdout.txt";
-  soundpipe.stderrdumpname = "sound_stderr.txt";
-  soundpipe.outthread = SDL_CreateThread (threadstdoutproc, "soundpipe.outthread", &soundpipe);
-  soundpipe.errthread = SDL_CreateThread (threadstderrproc, "soundpipe.errthread", &soundpipe);
-  videopipe.stdoutdumpname = "video_stdout.txt";
-  videopipe.stderrdumpname = "video_stderr.txt";
-  videopipe.outthread = SDL_CreateThread (threadstdoutproc, "videopipe.outthread", &videopipe);
-  videopipe.errthread = SDL_CreateThread (threadstderrproc, "videopipe.errthread", &videopipe);
+  if (cap_sound)
+  {
+    soundpipe.stdoutdumpname = "sound_stdout.txt";
+    soundpipe.stderrdumpname = "sound_stderr.txt";
+    soundpipe.outthread = SDL_CreateThread (threadstdoutproc, "soundpipe.outthread", &soundpipe);
+    soundpipe.errthread = SDL_CreateThread (threadstderrproc, "soundpipe.errthread", &soundpipe);
+  }
+  if (cap_video)
+  {
+    // segments run side by side, so each keeps its own output
+    if (pass == parallel_render_segment)
+    {
+      dsda_ParallelRenderFile (&video_stdout, "_stdout.txt");
+      dsda_ParallelRenderFile (&video_stderr, "_stderr.txt");
+      videopipe.stdoutdumpname = video_stdout.string;
+      videopipe.stderrdumpname = video_stderr.string;
+    }
+    else
+    {
+      videopipe.stdoutdumpname = "video_stdout.txt";
+      videopipe.stderrdumpname = "video_stderr.txt";
+    }
+    videopipe.outthread = SDL_CreateThread (threadstdoutproc, "videopipe.outthread", &videopipe);
+    videopipe.errthread = SDL_CreateThread (threadstderrproc, "videopipe.errthread", &videopipe);
+  }
 
   I_AtExit (I_CaptureFinish, true, "I_CaptureFinish", exit_priority_normal);
 }
@@ -563,36 +688,34 @@ void I_CapturePrep (const char *fn)
 void I_CaptureFrame (void)
 {
   unsigned char *snd;
-  unsigned char *vid;
   static int partsof35 = 0; // correct for sync when samplerate % 35 != 0
   int nsampreq;
 
   if (!capturing_video)
     return;
 
-  nsampreq = snd_samplerate / cap_fps;
-  partsof35 += snd_samplerate % cap_fps;
-  if (partsof35 >= cap_fps)
+  if (cap_sound)
   {
-    partsof35 -= cap_fps;
-    nsampreq++;
-  }
+    nsampreq = snd_samplerate / cap_fps;
+    partsof35 += snd_samplerate % cap_fps;
+    if (partsof35 >= cap_fps)
+    {
+      partsof35 -= cap_fps;
+      nsampreq++;
+    }
 
-  snd = I_GrabSound (nsampreq);
-  if (snd)
-  {
-    if (fwrite (snd, nsampreq * 4, 1, soundpipe.f_stdin) != 1)
-      lprintf(LO_WARN, "I_CaptureFrame: error writing soundpipe.\n");
-    //Z_Free (snd); // static buffer
-  }
-  vid = I_GrabScreen ();
-  if (vid)
-  {
-    if (fwrite (vid, renderW * renderH * 3, 1, videopipe.f_stdin) != 1)
-      lprintf(LO_WARN, "I_CaptureFrame: error writing videopipe.\n");
-    //Z_Free (vid); // static buffer
+    snd = I_GrabSound (nsampreq);
+    if (snd)
+    {
+      if (fwrite (snd, nsampreq * 4, 1, soundpipe.f_stdin) != 1)
+        lprintf(LO_WARN, "I_CaptureFrame: error writing soundpipe.\n");
+      //Z_Free (snd); // static buffer
+    }
   }
 
+  // encoded on the screenshot worker, in order
+  if (cap_video)
+    I_QueueScreenStream (videopipe.f_stdin);
 }
 
 
@@ -605,49 +728,67 @@ void I_CaptureFinish (void)
     return;
   capturing_video = 0;
 
+  // write out the frames still queued before the pipes close
+  I_FlushScreenShots ();
+
   // on linux, we have to close videopipe first, because it has a copy of the write
   // end of soundpipe_stdin (so that stream will never see EOF).
   // is there a better way to do this?
 
   // (on windows, it doesn't matter what order we do it in)
-  my_pclose3 (&videopipe);
-  SDL_WaitThread (videopipe.outthread, &s);
-  SDL_WaitThread (videopipe.errthread, &s);
-
-  my_pclose3 (&soundpipe);
-  SDL_WaitThread (soundpipe.outthread, &s);
-  SDL_WaitThread (soundpipe.errthread, &s);
-
-  // muxing and temp file cleanup
-
-  lprintf (LO_INFO, "I_CaptureFinish: opening pipe \"%s\"\n", muxpipe.command);
+  if (cap_video)
+  {
+    my_pclose3 (&videopipe);
+    SDL_WaitThread (videopipe.outthread, &s);
+    SDL_WaitThread (videopipe.errthread, &s);
+  }
 
-  if (!my_popen3 (&muxpipe))
+  if (cap_sound)
   {
-    lprintf (LO_ERROR, "I_CaptureFinish: finalize pipe failed\n");
-    return;
+    my_pclose3 (&soundpipe);
+    SDL_WaitThread (soundpipe.outthread, &s);
+    SDL_WaitThread (soundpipe.errthread, &s);
   }
 
-  muxpipe.stdoutdumpname = "mux_stdout.txt";
-  muxpipe.stderrdumpname = "mux_stderr.txt";
-  muxpipe.outthread = SDL_CreateThread (threadstdoutproc, "muxpipe.outthread", &muxpipe);
-  muxpipe.errthread = SDL_CreateThread (threadstderrproc, "muxpipe.errthread", &muxpipe);
+  // a parallel render muxes once every segment is done
+  if (cap_sound && cap_video)
+    I_CaptureMux ();
+}
 
-  my_pclose3 (&muxpipe);
-  SDL_WaitThread (muxpipe.outthread, &s);
-  SDL_WaitThread (muxpipe.errthread, &s);
 
+// join the video segments of a parallel render in the order of the list file,
+// then mux them with the sound into fn
+void I_CaptureJoinSegments (const char *fn, const char *list)
+{
+  const char* cap_concatcommand;
+  const char* cap_muxcommand;
+  pipeinfo_t concatpipe = { 0 };
 
-  // unlink any files user wants gone
-  if (dsda_IntConfig(dsda_config_cap_remove_tempfiles))
+  cap_concatcommand = dsda_StringConfig(dsda_config_cap_concatcommand);
+  cap_muxcommand = dsda_StringConfig(dsda_config_cap_muxcommand);
+  cap_fps = dsda_IntConfig(dsda_config_cap_fps);
+
+  vid_fname = fn;
+  list_fname = list;
+
+  if (!parsecommand (concatpipe.command, cap_concatcommand, sizeof(concatpipe.command)))
   {
-    const char* cap_tempfile1;
-    const char* cap_tempfile2;
+    lprintf (LO_ERROR, "I_CaptureJoinSegments: malformed command %s\n", cap_concatcommand);
+    return;
+  }
+  if (!parsecommand (muxpipe.command, cap_muxcommand, sizeof(muxpipe.command)))
+  {
+    lprintf (LO_ERROR, "I_CaptureJoinSegments: malformed command %s\n", cap_muxcommand);
+    return;
+  }
 
-    cap_tempfile1 = dsda_StringConfig(dsda_config_cap_tempfile1);
-    cap_tempfile2 = dsda_StringConfig(dsda_config_cap_tempfile2);
+  lprintf (LO_INFO, "I_CaptureJoinSegments: opening pipe \"%s\"\n", concatpipe.command);
 
-    M_remove (cap_tempfile1);
-    M_remove (cap_tempfile2);
+  if (!I_RunCapturePipe (&concatpipe, "concat_stdout.txt", "concat_stderr.txt"))
+  {
+    lprintf (LO_ERROR, "I_CaptureJoinSegments: concat pipe failed\n");
+    return;
   }
+
+  I_CaptureMux ();
 }
@@ -49,4 +49,8 @@ void I_CaptureFrame (void);
 // close pipes, call muxcommand, finalize
 void I_CaptureFinish (void);
 
+// join the video segments of a parallel render listed in list,
+// then call muxcommand with fn as the output
+void I_CaptureJoinSegments (const char *fn, const char *list);
+
 #endif
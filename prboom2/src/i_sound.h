@@ -119,6 +119,12 @@ void I_StopSong(int handle);
 // See above (register), then think backwards
 void I_UnRegisterSong(int handle);
 
+// Services the music cache; called from the main loop
+void I_UpdateMusic(void);
+
+// Music render-ahead diagnostics
+void I_GetMusicUnderruns(int *count, int *frames);
+
 // CPhipps - put these in config file
 extern int snd_samplerate;
 
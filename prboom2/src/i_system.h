@@ -43,6 +43,10 @@
 
 #include "m_fixed.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #ifdef _MSC_VER
 #define    F_OK    0    /* Check for file existence */
 #define    W_OK    2    /* Check for write permission */
@@ -57,6 +61,15 @@ fixed_t I_GetTimeFrac (void);
 
 unsigned long I_GetRandomTimeSeed(void); /* cphipps */
 
+typedef enum
+{
+  simd_none,
+  simd_sse41,
+  simd_avx2,
+} simd_level_t;
+
+simd_level_t I_SIMDLevel(void);
+
 void I_uSleep(unsigned long usecs);
 
 /* cphipps - I_GetVersionString
@@ -76,6 +89,10 @@ void I_SwitchToWindow(HWND hwnd);
 // e6y
 const char* I_GetTempDir(void);
 
+intptr_t I_StartProcess(char** argv);
+int I_WaitProcess(intptr_t process);
+int I_RunProcess(char** argv);
+
 const char *I_ExeDir(void); // killough 2/16/98: path to executable's dir
 const char *I_ConfigDir(void); // path to config and autoload dir
 
@@ -97,8 +114,11 @@ char* I_FindZip(const char* wfname);
 /* cph 2001/11/18 - wrapper for read(2) which deals with partial reads */
 void I_Read(int fd, void* buf, size_t sz);
 
+/* Seeks to an absolute position, which may be past 2GB */
+void I_Seek(int fd, int64_t offset);
+
 /* cph 2001/11/18 - Move W_Filelength to i_system.c */
-int I_Filelength(int handle);
+int64_t I_Filelength(int handle);
 
 // Schedule a function to be called when the program exits.
 // If run_if_error is true, the function is called if the exit
@@ -116,4 +136,8 @@ typedef void (*atexit_func_t)(void);
 void I_AtExit(atexit_func_t func, dboolean run_if_error,
               const char* name, exit_priority_t priority);
 
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
 #endif
@@ -68,14 +68,31 @@ void I_SetPalette(int pal); /* CPhipps - pass down palette number */
 
 void I_QueueFrameCapture(void);
 void I_QueueScreenshot(void);
+dboolean I_FrameCaptureQueued(void);
 void I_HandleCapture(void);
 
 void I_FinishUpdate (void);
 
+// Uploading a palette can allocate, so the present leaves palette changes
+// alone while it is held
+void I_UpdatePalette(void);
+void I_HoldPalette(dboolean hold);
+
+// Screenshots and frame dumps are encoded on a worker thread
 int I_ScreenShot (const char *fname);
+void I_QueueScreenStream(FILE *stream);
+void I_FlushScreenShots(void);
+void I_ReportScreenShots(void);
+dboolean I_FrameDumpActive(void);
+void I_DumpFrame(void);
 // NSM expose lower level screen data grab for vidcap
 unsigned char *I_GrabScreen (void);
 
+// Software mode only: current screen as packed RGB24 at SCREENWIDTH x SCREENHEIGHT
+void I_ConvertScreenToRGB24(unsigned char *rgb);
+void I_GetScreenPalette(unsigned char *rgb);
+void I_BenchmarkPaletteConversion(int frames);
+
 /* I_StartTic
  * Called by D_DoomLoop,
  * called before processing each tic in a frame.
@@ -45,6 +45,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if !defined(_WIN32) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
 
 #include <stdlib.h>
 #include <string.h>
@@ -296,6 +299,29 @@ int M_remove(const char *path)
 #endif
 }
 
+int M_rename(const char *oldpath, const char *newpath)
+{
+#ifdef _WIN32
+  wchar_t *woldpath, *wnewpath;
+  int ret = -1;
+
+  woldpath = ConvertUtf8ToWide(oldpath);
+  wnewpath = ConvertUtf8ToWide(newpath);
+
+  if (woldpath && wnewpath)
+    ret = _wrename(woldpath, wnewpath);
+
+  if (woldpath)
+    Z_Free(woldpath);
+  if (wnewpath)
+    Z_Free(wnewpath);
+
+  return ret;
+#else
+  return rename(oldpath, newpath);
+#endif
+}
+
 int M_MakeDir(const char *path, int require) {
   int error;
 
@@ -438,6 +464,125 @@ int M_ReadFile(char const *name, byte **buffer)
   return -1;
 }
 
+/*
+ * M_MapFile
+ *
+ * Like M_ReadFile, but maps the file copy-on-write where the platform allows,
+ * so that reading through a huge file only keeps the pages in use resident.
+ * The buffer must be released with M_UnmapFile.
+ */
+
+int M_MapFile(char const *name, byte **buffer, dboolean *mapped)
+{
+#if defined(_WIN32) && defined(HAVE_CREATE_FILE_MAPPING)
+  wchar_t *wname;
+  HANDLE hnd, hnd_map;
+  LARGE_INTEGER size;
+
+  *mapped = false;
+
+  wname = ConvertUtf8ToWide(name);
+  hnd = CreateFileW(wname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+  Z_Free(wname);
+
+  if (hnd != INVALID_HANDLE_VALUE)
+  {
+    if (GetFileSizeEx(hnd, &size) && size.QuadPart > 0 && size.QuadPart < INT_MAX)
+    {
+      hnd_map = CreateFileMapping(hnd, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+      if (hnd_map)
+      {
+        // the view keeps the mapping alive
+        *buffer = MapViewOfFile(hnd_map, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(hnd_map);
+
+        if (*buffer)
+        {
+          CloseHandle(hnd);
+          *mapped = true;
+          return (int) size.QuadPart;
+        }
+      }
+    }
+
+    CloseHandle(hnd);
+  }
+#elif defined(HAVE_MMAP)
+  int fd;
+  struct stat st;
+
+  *mapped = false;
+
+  fd = M_OpenRB(name);
+
+  if (fd != -1)
+  {
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size < INT_MAX)
+    {
+      void *data;
+
+      data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+      if (data != MAP_FAILED)
+      {
+        close(fd);
+#ifdef MADV_SEQUENTIAL
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+#endif
+        *buffer = data;
+        *mapped = true;
+        return (int) st.st_size;
+      }
+    }
+
+    close(fd);
+  }
+#else
+  *mapped = false;
+#endif
+
+  return M_ReadFile(name, buffer);
+}
+
+void M_UnmapFile(byte *buffer, size_t length, dboolean mapped)
+{
+  if (!mapped)
+  {
+    Z_Free(buffer);
+    return;
+  }
+
+#if defined(_WIN32) && defined(HAVE_CREATE_FILE_MAPPING)
+  UnmapViewOfFile(buffer);
+#elif defined(HAVE_MMAP)
+  munmap(buffer, length);
+#endif
+}
+
+/*
+ * M_EvictMappedRange
+ *
+ * Drops the pages wholly inside a range of a mapped file from memory; they
+ * are read back from the file if touched again. Pages that were written to
+ * lose their changes, so only pass ranges that are read-only in practice.
+ */
+
+void M_EvictMappedRange(byte *start, size_t length)
+{
+#if defined(_WIN32) && defined(HAVE_CREATE_FILE_MAPPING)
+  // unlocking pages that aren't locked trims them from the working set
+  VirtualUnlock(start, length);
+#elif defined(HAVE_MMAP) && defined(MADV_DONTNEED)
+  size_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t first = ((uintptr_t) start + page - 1) & ~(uintptr_t) (page - 1);
+  uintptr_t last = ((uintptr_t) start + length) & ~(uintptr_t) (page - 1);
+
+  if (last > first)
+    madvise((void *) first, last - first, MADV_DONTNEED);
+#endif
+}
+
 // Same as above, but add null terminator
 int M_ReadFileToString(char const *name, char **buffer) {
   FILE *fp;
@@ -48,10 +48,14 @@ int M_OpenRB(const char *name);
 dboolean M_FileExists(const char *name);
 dboolean M_WriteFile (char const* name, const void* source, size_t length);
 int M_ReadFile (char const* name,byte** buffer);
+int M_MapFile(char const *name, byte **buffer, dboolean *mapped);
+void M_UnmapFile(byte *buffer, size_t length, dboolean mapped);
+void M_EvictMappedRange(byte *start, size_t length);
 int M_ReadFileToString(char const *name, char **buffer);
 dboolean M_RemoveFilesAtPath(const char *path);
 
 int M_remove(const char *path);
+int M_rename(const char *oldpath, const char *newpath);
 char *M_getcwd(char *buffer, int len);
 char *M_getenv(const char *name);
 
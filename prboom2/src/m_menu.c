@@ -3211,10 +3211,12 @@ setup_menu_t gen_video_settings[] = {
   { "FPS Limit", S_NUM, m_conf, G_X, dsda_config_fps_limit },
   { "Background FPS Limit", S_NUM, m_conf, G_X, dsda_config_background_fps_limit },
   { "Show FPS", S_YESNO,  m_conf, G_X, dsda_config_show_fps },
+  { "Show Frame Times", S_YESNO,  m_conf, G_X, dsda_config_show_frame_times },
   EMPTY_LINE,
   { "Fake Contrast", S_CHOICE, m_conf, G_X, dsda_config_fake_contrast_mode, 0, fake_contrast_list },
   { "OpenGL Light Fade", S_CHOICE, m_conf, G_X, dsda_config_gl_fade_mode, 0, gl_fade_mode_list },
   { "Parallel Software", S_YESNO, m_conf, G_X, dsda_config_render_parallel },
+  { "Dynamic Resolution", S_YESNO, m_conf, G_X, dsda_config_render_dynamic_resolution },
 
   NEXT_PAGE(gen_audio_settings),
   FINAL_ENTRY
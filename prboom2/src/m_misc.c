@@ -117,6 +117,8 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_sfx_volume),
   MIGRATED_SETTING(dsda_config_music_volume),
   MIGRATED_SETTING(dsda_config_mus_pause_opt),
+  MIGRATED_SETTING(dsda_config_mus_render_ahead_ms),
+  MIGRATED_SETTING(dsda_config_mus_render_cache),
   MIGRATED_SETTING(dsda_config_snd_channels),
   MIGRATED_SETTING(dsda_config_snd_midiplayer),
   MIGRATED_SETTING(dsda_config_snd_mididev),
@@ -168,6 +170,10 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_render_patches_scaley),
   MIGRATED_SETTING(dsda_config_render_stretchsky),
   MIGRATED_SETTING(dsda_config_render_linearsky),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution_target),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution_min),
+  MIGRATED_SETTING(dsda_config_render_dynamic_resolution_filter),
   MIGRATED_SETTING(dsda_config_aspect_ratio_correction),
   MIGRATED_SETTING(dsda_config_freelook),
   MIGRATED_SETTING(dsda_config_extra_level_brightness),
@@ -179,6 +185,7 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_gl_health_bar),
   MIGRATED_SETTING(dsda_config_gl_usevbo),
   MIGRATED_SETTING(dsda_config_gl_fade_mode),
+  MIGRATED_SETTING(dsda_config_gl_flats_cache),
 
   SETTING_HEADING("Mouse settings"),
   MIGRATED_SETTING(dsda_config_use_mouse),
@@ -300,6 +307,7 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_hide_empty_commands),
   MIGRATED_SETTING(dsda_config_coordinate_display),
   MIGRATED_SETTING(dsda_config_show_fps),
+  MIGRATED_SETTING(dsda_config_show_frame_times),
   MIGRATED_SETTING(dsda_config_show_minimap),
   MIGRATED_SETTING(dsda_config_show_level_splits),
   MIGRATED_SETTING(dsda_config_skip_quit_prompt),
@@ -342,6 +350,7 @@ cfg_def_t cfg_defs[] =
   MIGRATED_SETTING(dsda_config_cap_soundcommand),
   MIGRATED_SETTING(dsda_config_cap_videocommand),
   MIGRATED_SETTING(dsda_config_cap_muxcommand),
+  MIGRATED_SETTING(dsda_config_cap_concatcommand),
   MIGRATED_SETTING(dsda_config_cap_tempfile1),
   MIGRATED_SETTING(dsda_config_cap_tempfile2),
   MIGRATED_SETTING(dsda_config_cap_remove_tempfiles),
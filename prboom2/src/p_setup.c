@@ -68,9 +68,11 @@
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
 #include "dsda/preferences.h"
+#include "dsda/reject.h"
 #include "dsda/scroll.h"
 #include "dsda/settings.h"
 #include "dsda/skip.h"
+#include "dsda/time.h"
 #include "dsda/tranmap.h"
 #include "dsda/udmf.h"
 #include "dsda/utility.h"
@@ -80,6 +82,8 @@
 #include "hexen/po_man.h"
 #include "hexen/sn_sonix.h"
 
+#include "core/thread_pool.h"
+
 #include "config.h"
 
 //
@@ -1077,56 +1081,149 @@ static void CheckZNodesOverflow(int *size, int count)
   }
 }
 
-static byte *P_DecompressData(const byte **data, int *len)
+// ZNODES inflation can start on the thread pool as soon as the node format
+// is known, overlapping the rest of the map loading. The job sticks to
+// malloc and leaves error reporting to the main thread.
+
+typedef struct
 {
+  const byte *input;
+  int inlen;
   byte *output;
+  int outlen;
+  const char *error;
+} inflate_job_t;
+
+static inflate_job_t znodes_inflate;
+static thread_pool_task_t *znodes_inflate_task;
+
+static void P_InflateJob(void *data)
+{
+  inflate_job_t *job = data;
   int outlen, err;
-  z_stream *zstream;
+  z_stream zstream;
   union
   {
     const byte* cd;
     byte* d;
-  } u = { *data };
+  } u = { job->input };
+
+  job->output = NULL;
+  job->outlen = 0;
+  job->error = NULL;
 
   // first estimate for compression rate:
   // output buffer size == 2.5 * input size
-  outlen = 2.5 * *len;
-  output = Z_Malloc(outlen);
+  outlen = 2.5 * job->inlen;
+  job->output = malloc(outlen);
+
+  if (!job->output)
+  {
+    job->error = "Out of memory!";
+    return;
+  }
 
   // initialize stream state for decompression
-  zstream = Z_Malloc(sizeof(*zstream));
-  memset(zstream, 0, sizeof(*zstream));
+  memset(&zstream, 0, sizeof(zstream));
 
-  zstream->next_in = u.d;
-  zstream->avail_in = *len;
-  zstream->next_out = output;
-  zstream->avail_out = outlen;
+  zstream.next_in = u.d;
+  zstream.avail_in = job->inlen;
+  zstream.next_out = job->output;
+  zstream.avail_out = outlen;
 
-  if (inflateInit(zstream) != Z_OK)
-      I_Error("P_DecompressData: Error during decompression initialization!");
+  if (inflateInit(&zstream) != Z_OK)
+  {
+    job->error = "Error during decompression initialization!";
+    return;
+  }
 
   // resize if output buffer runs full
-  while ((err = inflate(zstream, Z_SYNC_FLUSH)) == Z_OK)
+  while ((err = inflate(&zstream, Z_SYNC_FLUSH)) == Z_OK)
   {
-      int outlen_old = outlen;
-      outlen = 2 * outlen_old;
-      output = Z_Realloc(output, outlen);
-      zstream->next_out = output + outlen_old;
-      zstream->avail_out = outlen - outlen_old;
+    int outlen_old = outlen;
+    byte *output;
+
+    outlen = 2 * outlen_old;
+    output = realloc(job->output, outlen);
+
+    if (!output)
+    {
+      err = Z_MEM_ERROR;
+      break;
+    }
+
+    job->output = output;
+    zstream.next_out = job->output + outlen_old;
+    zstream.avail_out = outlen - outlen_old;
   }
 
   if (err != Z_STREAM_END)
-      I_Error("P_DecompressData: Error during decompression!");
+    job->error = "Error during decompression!";
 
-  *data = output;
-  *len = zstream->total_out;
+  job->outlen = zstream.total_out;
 
-  if (inflateEnd(zstream) != Z_OK)
-      I_Error("P_DecompressData: Error during decompression shut-down!");
+  if (inflateEnd(&zstream) != Z_OK && !job->error)
+    job->error = "Error during decompression shut-down!";
+}
+
+static void P_StartZNodesInflate(int lump)
+{
+  int len = W_LumpLength(lump);
+
+  if (len < 4)
+    return;
+
+  // a job whose nodes were never read
+  if (znodes_inflate_task)
+  {
+    I_ThreadPoolFinish(znodes_inflate_task);
+    znodes_inflate_task = NULL;
+    free(znodes_inflate.output);
+  }
 
-  Z_Free(zstream);
+  // skip header
+  znodes_inflate.input = (const byte *) W_LumpByNum(lump) + 4;
+  znodes_inflate.inlen = len - 4;
 
-  return output;
+  znodes_inflate_task = I_ThreadPoolStart(P_InflateJob, &znodes_inflate);
+}
+
+// The returned buffer is released with free
+static byte *P_DecompressData(const byte **data, int *len)
+{
+  inflate_job_t *job = &znodes_inflate;
+
+  if (znodes_inflate_task)
+  {
+    I_ThreadPoolFinish(znodes_inflate_task);
+    znodes_inflate_task = NULL;
+
+    // Not the data the job was started for
+    if (job->input != *data || job->inlen != *len)
+    {
+      free(job->output);
+      job->input = NULL;
+    }
+  }
+  else
+  {
+    job->input = NULL;
+  }
+
+  if (!job->input)
+  {
+    job->input = *data;
+    job->inlen = *len;
+    P_InflateJob(job);
+  }
+
+  if (job->error)
+    I_Error("P_DecompressData: %s", job->error);
+
+  *data = job->output;
+  *len = job->outlen;
+
+  return job->output;
 }
 
 // MB 2020-03-01: Fix endianess for 32-bit ZDoom nodes
@@ -1525,7 +1622,7 @@ static void P_LoadZNodes(int lump, int glnodes)
   }
 
   if (output)
-    Z_Free(output);
+    free(output);
 }
 
 static int no_overlapped_sprites;
@@ -2560,75 +2657,244 @@ static void P_LoadUDMFSideDefs(int lump)
                                  // jff 10/8/98 use guardband>0
                                  // jff 10/12/98 0 ok with + 1 in rows,cols
 
-typedef struct linelist_t        // type used to list lines in each block
+//
+// The blockmap is built in two passes over flat arrays: count how many
+// lines touch each block, lay out the lump from the counts, then go over
+// the lines again writing each one into its blocks. Both passes are split
+// into contiguous line ranges which run in parallel; each range has its
+// own counts, and the ranges are laid out highest first so that every
+// block list is 0, its lines in descending order, -1. This is exactly the
+// lump the original linked-list builder produced.
+//
+
+typedef struct
+{
+  int xorg, yorg;                // blockmap origin (lower left)
+  int ncols, nrows;              // blockmap dimensions
+  int nblocks;                   // number of cells = nrows*ncols
+} blockmap_grid_t;
+
+typedef struct
 {
-  long num;
-  struct linelist_t *next;
-} linelist_t;
+  const blockmap_grid_t *grid;
+  int first_line, last_line;     // lines [first_line, last_line)
+  int *count;                    // lines per block, then write cursors
+  int *done;                     // last line added to a block, plus 1
+  int *lump;                     // NULL while counting
+} blockmap_job_t;
 
 //
 // Subroutine to add a line number to a block list
 // It simply returns if the line is already in the block
 //
 
-static void AddBlockLine
-(
-  linelist_t **lists,
-  int *count,
-  int *done,
-  int blockno,
-  long lineno
-)
+static void AddBlockLine(blockmap_job_t *job, int blockno, int lineno)
 {
-  linelist_t *l;
-
-  if (done[blockno])
+  if (job->done[blockno] == lineno + 1)
     return;
 
-  l = Z_Malloc(sizeof(linelist_t));
-  l->num = lineno;
-  l->next = lists[blockno];
-  lists[blockno] = l;
-  count[blockno]++;
-  done[blockno] = 1;
+  job->done[blockno] = lineno + 1;
+
+  if (job->lump)
+    job->lump[job->count[blockno]++] = lineno;
+  else
+    job->count[blockno]++;
 }
 
-blockmap_t original_blockmap;
+//
+// Find the intersection of the linedef with the column and row lines at
+// the left and bottom of each blockmap cell, and add it to all block
+// lists touching the intersection.
+//
 
-static void RememberOriginalBlockMap(void)
+static void P_AddLineToBlockMap(blockmap_job_t *job, int i)
 {
-  original_blockmap.width = bmapwidth;
-  original_blockmap.height = bmapheight;
-  original_blockmap.orgx = bmaporgx;
-  original_blockmap.orgy = bmaporgy;
+  const blockmap_grid_t *grid = job->grid;
+  int xorg = grid->xorg, yorg = grid->yorg;
+  int ncols = grid->ncols, nrows = grid->nrows;
+  int j;
+  int x1 = lines[i].v1->x>>FRACBITS;         // lines[i] map coords
+  int y1 = lines[i].v1->y>>FRACBITS;
+  int x2 = lines[i].v2->x>>FRACBITS;
+  int y2 = lines[i].v2->y>>FRACBITS;
+  int dx = x2-x1;
+  int dy = y2-y1;
+  int vert = !dx;                            // lines[i] slopetype
+  int horiz = !dy;
+  int spos = (dx^dy) > 0;
+  int sneg = (dx^dy) < 0;
+  int bx,by;                                 // block cell coords
+  int minx = x1>x2? x2 : x1;                 // extremal lines[i] coords
+  int maxx = x1>x2? x1 : x2;
+  int miny = y1>y2? y2 : y1;
+  int maxy = y1>y2? y1 : y2;
+
+  // The line always belongs to the blocks containing its endpoints
+
+  bx = (x1-xorg)>>blkshift;
+  by = (y1-yorg)>>blkshift;
+  AddBlockLine(job,by*ncols+bx,i);
+  bx = (x2-xorg)>>blkshift;
+  by = (y2-yorg)>>blkshift;
+  AddBlockLine(job,by*ncols+bx,i);
+
+
+  // For each column, see where the line along its left edge, which
+  // it contains, intersects the Linedef i. Add i to each corresponding
+  // blocklist.
+
+  // Only the columns and rows within the line's extent can be touched,
+  // the others would be skipped below anyway
+
+  if (!vert)    // don't interesect vertical lines with columns
+  {
+    int jmax = MIN(ncols-1, (maxx-xorg)>>blkshift);
+
+    for (j=(minx-xorg+blkmask)>>blkshift;j<=jmax;j++)
+    {
+      // intersection of Linedef with x=xorg+(j<<blkshift)
+      // (y-y1)*dx = dy*(x-x1)
+      // y = dy*(x-x1)+y1*dx;
+
+      int x = xorg+(j<<blkshift);       // (x,y) is intersection
+      int y = (dy*(x-x1))/dx+y1;
+      int yb = (y-yorg)>>blkshift;      // block row number
+      int yp = (y-yorg)&blkmask;        // y position within block
+
+      if (yb<0 || yb>nrows-1)     // outside blockmap, continue
+        continue;
+
+      if (x<minx || x>maxx)       // line doesn't touch column
+        continue;
+
+      // The cell that contains the intersection point is always added
+
+      AddBlockLine(job,ncols*yb+j,i);
+
+      // if the intersection is at a corner it depends on the slope
+      // (and whether the line extends past the intersection) which
+      // blocks are hit
+
+      if (yp==0)        // intersection at a corner
+      {
+        if (sneg)       //   \ - blocks x,y-, x-,y
+        {
+          if (yb>0 && miny<y)
+            AddBlockLine(job,ncols*(yb-1)+j,i);
+          if (j>0 && minx<x)
+            AddBlockLine(job,ncols*yb+j-1,i);
+        }
+        else if (spos)  //   / - block x-,y-
+        {
+          if (yb>0 && j>0 && minx<x)
+            AddBlockLine(job,ncols*(yb-1)+j-1,i);
+        }
+        else if (horiz) //   - - block x-,y
+        {
+          if (j>0 && minx<x)
+            AddBlockLine(job,ncols*yb+j-1,i);
+        }
+      }
+      else if (j>0 && minx<x) // else not at corner: x-,y
+        AddBlockLine(job,ncols*yb+j-1,i);
+    }
+  }
+
+  // For each row, see where the line along its bottom edge, which
+  // it contains, intersects the Linedef i. Add i to all the corresponding
+  // blocklists.
+
+  if (!horiz)
+  {
+    int jmax = MIN(nrows-1, (maxy-yorg)>>blkshift);
+
+    for (j=(miny-yorg+blkmask)>>blkshift;j<=jmax;j++)
+    {
+      // intersection of Linedef with y=yorg+(j<<blkshift)
+      // (x,y) on Linedef i satisfies: (y-y1)*dx = dy*(x-x1)
+      // x = dx*(y-y1)/dy+x1;
+
+      int y = yorg+(j<<blkshift);       // (x,y) is intersection
+      int x = (dx*(y-y1))/dy+x1;
+      int xb = (x-xorg)>>blkshift;      // block column number
+      int xp = (x-xorg)&blkmask;        // x position within block
+
+      if (xb<0 || xb>ncols-1)   // outside blockmap, continue
+        continue;
+
+      if (y<miny || y>maxy)     // line doesn't touch row
+        continue;
+
+      // The cell that contains the intersection point is always added
+
+      AddBlockLine(job,ncols*j+xb,i);
+
+      // if the intersection is at a corner it depends on the slope
+      // (and whether the line extends past the intersection) which
+      // blocks are hit
+
+      if (xp==0)        // intersection at a corner
+      {
+        if (sneg)       //   \ - blocks x,y-, x-,y
+        {
+          if (j>0 && miny<y)
+            AddBlockLine(job,ncols*(j-1)+xb,i);
+          if (xb>0 && minx<x)
+            AddBlockLine(job,ncols*j+xb-1,i);
+        }
+        else if (vert)  //   | - block x,y-
+        {
+          if (j>0 && miny<y)
+            AddBlockLine(job,ncols*(j-1)+xb,i);
+        }
+        else if (spos)  //   / - block x-,y-
+        {
+          if (xb>0 && j>0 && miny<y)
+            AddBlockLine(job,ncols*(j-1)+xb-1,i);
+        }
+      }
+      else if (j>0 && miny<y) // else not on a corner: x,y-
+        AddBlockLine(job,ncols*(j-1)+xb,i);
+    }
+  }
 }
 
-void P_RestoreOriginalBlockMap(void)
+// Lines are visited in descending order so that the fill pass writes
+// each block list the way the original builder's lists grew backwards
+
+static void P_BlockMapJob(void *data)
 {
-  bmapwidth = original_blockmap.width;
-  bmapheight = original_blockmap.height;
-  bmaporgx = original_blockmap.orgx;
-  bmaporgy = original_blockmap.orgy;
+  blockmap_job_t *job = data;
+  int i;
+
+  for (i = job->last_line - 1; i >= job->first_line; i--)
+    P_AddLineToBlockMap(job, i);
 }
 
-//
-// Actually construct the blockmap lump from the level data
-//
-// This finds the intersection of each linedef with the column and
-// row lines at the left and bottom of each blockmap cell. It then
-// adds the line to all block lists touching the intersection.
-//
+static void P_RunBlockMapJobs(blockmap_job_t *jobs, int njobs)
+{
+  if (njobs == 1)
+  {
+    P_BlockMapJob(&jobs[0]);
+    return;
+  }
 
-static void P_CreateBlockMap(void)
+  I_ThreadPoolRun(P_BlockMapJob, jobs, sizeof(*jobs), njobs);
+}
+
+#define BLOCKMAP_JOB_LINES 4096
+#define BLOCKMAP_MAX_JOBS 8
+
+static int P_BlockMapJobCount(void)
+{
+  int njobs = numlines / BLOCKMAP_JOB_LINES;
+
+  return BETWEEN(1, BLOCKMAP_MAX_JOBS, njobs);
+}
+
+static void P_BlockMapGrid(blockmap_grid_t *grid)
 {
-  int xorg,yorg;                 // blockmap origin (lower left)
-  int nrows,ncols;               // blockmap dimensions
-  linelist_t **blocklists=NULL;  // array of pointers to lists of lines
-  int *blockcount=NULL;          // array of counters of line lists
-  int *blockdone=NULL;           // array keeping track of blocks/line
-  int NBlocks;                   // number of cells = nrows*ncols
-  long linetotal=0;              // total length of all blocklists
-  int i,j;
+  int i;
   int map_minx=INT_MAX;          // init for map limits search
   int map_miny=INT_MAX;
   int map_maxx=INT_MIN;
@@ -2664,225 +2930,179 @@ static void P_CreateBlockMap(void)
 
   // set up blockmap area to enclose level plus margin
 
-  xorg = map_minx-blkmargin;
-  yorg = map_miny-blkmargin;
-  ncols = (map_maxx+blkmargin-xorg+1+blkmask)>>blkshift;  //jff 10/12/98
-  nrows = (map_maxy+blkmargin-yorg+1+blkmask)>>blkshift;  //+1 needed for
-  NBlocks = ncols*nrows;                                  //map exactly 1 cell
+  grid->xorg = map_minx-blkmargin;
+  grid->yorg = map_miny-blkmargin;
+  grid->ncols = (map_maxx+blkmargin-grid->xorg+1+blkmask)>>blkshift;  //jff 10/12/98
+  grid->nrows = (map_maxy+blkmargin-grid->yorg+1+blkmask)>>blkshift;  //+1 needed for
+  grid->nblocks = grid->ncols*grid->nrows;                            //map exactly 1 cell
+}
 
-  // create the array of pointers on NBlocks to blocklists
-  // also create an array of linelist counts on NBlocks
-  // finally make an array in which we can mark blocks done per line
+//
+// Build the offsets and block lists of the blockmap lump, leaving the
+// four header entries for the caller. Returns the lump size in ints.
+//
 
-  // CPhipps - calloc's
-  blocklists = Z_Calloc(NBlocks,sizeof(linelist_t *));
-  blockcount = Z_Calloc(NBlocks,sizeof(int));
-  blockdone = Z_Malloc(NBlocks*sizeof(int));
+static int *P_BuildBlockMap(const blockmap_grid_t *grid, int njobs, int *lumpsize)
+{
+  blockmap_job_t *jobs;
+  int *lump;
+  long linetotal;
+  long offs;
+  int i, j;
 
-  // initialize each blocklist, and enter the trailing -1 in all blocklists
-  // note the linked list of lines grows backwards
+  jobs = Z_Calloc(njobs, sizeof(*jobs));
 
-  for (i=0;i<NBlocks;i++)
+  for (j = 0; j < njobs; j++)
   {
-    blocklists[i] = Z_Malloc(sizeof(linelist_t));
-    blocklists[i]->num = -1;
-    blocklists[i]->next = NULL;
-    blockcount[i]++;
+    jobs[j].grid = grid;
+    jobs[j].first_line = (int) ((long long) numlines * j / njobs);
+    jobs[j].last_line = (int) ((long long) numlines * (j + 1) / njobs);
+    jobs[j].count = Z_Calloc(grid->nblocks, sizeof(int));
+    jobs[j].done = Z_Calloc(grid->nblocks, sizeof(int));
   }
 
-  // For each linedef in the wad, determine all blockmap blocks it touches,
-  // and add the linedef number to the blocklists for those blocks
-
-  for (i=0;i<numlines;i++)
-  {
-    int x1 = lines[i].v1->x>>FRACBITS;         // lines[i] map coords
-    int y1 = lines[i].v1->y>>FRACBITS;
-    int x2 = lines[i].v2->x>>FRACBITS;
-    int y2 = lines[i].v2->y>>FRACBITS;
-    int dx = x2-x1;
-    int dy = y2-y1;
-    int vert = !dx;                            // lines[i] slopetype
-    int horiz = !dy;
-    int spos = (dx^dy) > 0;
-    int sneg = (dx^dy) < 0;
-    int bx,by;                                 // block cell coords
-    int minx = x1>x2? x2 : x1;                 // extremal lines[i] coords
-    int maxx = x1>x2? x1 : x2;
-    int miny = y1>y2? y2 : y1;
-    int maxy = y1>y2? y1 : y2;
+  // count the lines in each block
 
-    // no blocks done for this linedef yet
+  P_RunBlockMapJobs(jobs, njobs);
 
-    memset(blockdone,0,NBlocks*sizeof(int));
+  // each list has an initial 0 and a trailing -1
 
-    // The line always belongs to the blocks containing its endpoints
+  linetotal = 2 * grid->nblocks;
+  for (j = 0; j < njobs; j++)
+    for (i = 0; i < grid->nblocks; i++)
+      linetotal += jobs[j].count[i];
 
-    bx = (x1-xorg)>>blkshift;
-    by = (y1-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
-    bx = (x2-xorg)>>blkshift;
-    by = (y2-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+  *lumpsize = 4 + grid->nblocks + linetotal;
+  lump = Z_Malloc(sizeof(*lump) * *lumpsize);
 
+  // offsets to lists, turning the counts into write cursors
 
-    // For each column, see where the line along its left edge, which
-    // it contains, intersects the Linedef i. Add i to each corresponding
-    // blocklist.
+  offs = 4 + grid->nblocks;
+  for (i = 0; i < grid->nblocks; i++)
+  {
+    lump[4 + i] = offs;
+    lump[offs++] = 0;
 
-    if (!vert)    // don't interesect vertical lines with columns
+    for (j = njobs - 1; j >= 0; j--)
     {
-      for (j=0;j<ncols;j++)
-      {
-        // intersection of Linedef with x=xorg+(j<<blkshift)
-        // (y-y1)*dx = dy*(x-x1)
-        // y = dy*(x-x1)+y1*dx;
+      int count = jobs[j].count[i];
 
-        int x = xorg+(j<<blkshift);       // (x,y) is intersection
-        int y = (dy*(x-x1))/dx+y1;
-        int yb = (y-yorg)>>blkshift;      // block row number
-        int yp = (y-yorg)&blkmask;        // y position within block
+      jobs[j].count[i] = offs;
+      offs += count;
+    }
 
-        if (yb<0 || yb>nrows-1)     // outside blockmap, continue
-          continue;
+    lump[offs++] = -1;
+  }
 
-        if (x<minx || x>maxx)       // line doesn't touch column
-          continue;
+  // fill in the block lists
 
-        // The cell that contains the intersection point is always added
+  for (j = 0; j < njobs; j++)
+  {
+    memset(jobs[j].done, 0, grid->nblocks * sizeof(int));
+    jobs[j].lump = lump;
+  }
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j,i);
+  P_RunBlockMapJobs(jobs, njobs);
 
-        // if the intersection is at a corner it depends on the slope
-        // (and whether the line extends past the intersection) which
-        // blocks are hit
+  for (j = 0; j < njobs; j++)
+  {
+    Z_Free(jobs[j].count);
+    Z_Free(jobs[j].done);
+  }
+  Z_Free(jobs);
 
-        if (yp==0)        // intersection at a corner
-        {
-          if (sneg)       //   \ - blocks x,y-, x-,y
-          {
-            if (yb>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j,i);
-            if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
-          }
-          else if (spos)  //   / - block x-,y-
-          {
-            if (yb>0 && j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j-1,i);
-          }
-          else if (horiz) //   - - block x-,y
-          {
-            if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
-          }
-        }
-        else if (j>0 && minx<x) // else not at corner: x-,y
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
-      }
-    }
+  return lump;
+}
 
-    // For each row, see where the line along its bottom edge, which
-    // it contains, intersects the Linedef i. Add i to all the corresponding
-    // blocklists.
+blockmap_t original_blockmap;
 
-    if (!horiz)
-    {
-      for (j=0;j<nrows;j++)
-      {
-        // intersection of Linedef with y=yorg+(j<<blkshift)
-        // (x,y) on Linedef i satisfies: (y-y1)*dx = dy*(x-x1)
-        // x = dx*(y-y1)/dy+x1;
+static void RememberOriginalBlockMap(void)
+{
+  original_blockmap.width = bmapwidth;
+  original_blockmap.height = bmapheight;
+  original_blockmap.orgx = bmaporgx;
+  original_blockmap.orgy = bmaporgy;
+}
 
-        int y = yorg+(j<<blkshift);       // (x,y) is intersection
-        int x = (dx*(y-y1))/dy+x1;
-        int xb = (x-xorg)>>blkshift;      // block column number
-        int xp = (x-xorg)&blkmask;        // x position within block
+void P_RestoreOriginalBlockMap(void)
+{
+  bmapwidth = original_blockmap.width;
+  bmapheight = original_blockmap.height;
+  bmaporgx = original_blockmap.orgx;
+  bmaporgy = original_blockmap.orgy;
+}
 
-        if (xb<0 || xb>ncols-1)   // outside blockmap, continue
-          continue;
+//
+// Actually construct the blockmap lump from the level data
+//
 
-        if (y<miny || y>maxy)     // line doesn't touch row
-          continue;
+static void P_CreateBlockMap(void)
+{
+  blockmap_grid_t grid;
+  int *lump;
+  int lumpsize;
 
-        // The cell that contains the intersection point is always added
+  P_BlockMapGrid(&grid);
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb,i);
+  lump = P_BuildBlockMap(&grid, P_BlockMapJobCount(), &lumpsize);
 
-        // if the intersection is at a corner it depends on the slope
-        // (and whether the line extends past the intersection) which
-        // blocks are hit
+  // Create the blockmap lump
 
-        if (xp==0)        // intersection at a corner
-        {
-          if (sneg)       //   \ - blocks x,y-, x-,y
-          {
-            if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
-            if (xb>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb-1,i);
-          }
-          else if (vert)  //   | - block x,y-
-          {
-            if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
-          }
-          else if (spos)  //   / - block x-,y-
-          {
-            if (xb>0 && j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb-1,i);
-          }
-        }
-        else if (j>0 && miny<y) // else not on a corner: x,y-
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
-      }
-    }
-  }
+  blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * lumpsize);
+  memcpy(blockmaplump, lump, sizeof(*blockmaplump) * lumpsize);
+  Z_Free(lump);
 
-  // Add initial 0 to all blocklists
-  // count the total number of lines (and 0's and -1's)
+  // blockmap header
 
-  memset(blockdone,0,NBlocks*sizeof(int));
-  for (i=0,linetotal=0;i<NBlocks;i++)
-  {
-    AddBlockLine(blocklists,blockcount,blockdone,i,0);
-    linetotal += blockcount[i];
-  }
+  blockmaplump[0] = bmaporgx = grid.xorg << FRACBITS;
+  blockmaplump[1] = bmaporgy = grid.yorg << FRACBITS;
+  blockmaplump[2] = bmapwidth  = grid.ncols;
+  blockmaplump[3] = bmapheight = grid.nrows;
+}
 
-  // Create the blockmap lump
+//
+// P_BenchmarkBlockMap
+//
+// Times building the current map's blockmap on one thread and in
+// parallel, and checks that both produce the same lump.
+//
 
-  blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * (4 + NBlocks + linetotal));
-  // blockmap header
+void P_BenchmarkBlockMap(int runs)
+{
+  blockmap_grid_t grid;
+  int njobs[2] = { 1, BLOCKMAP_MAX_JOBS };
+  int *lumps[2];
+  int lumpsizes[2];
+  int i, k;
 
-  blockmaplump[0] = bmaporgx = xorg << FRACBITS;
-  blockmaplump[1] = bmaporgy = yorg << FRACBITS;
-  blockmaplump[2] = bmapwidth  = ncols;
-  blockmaplump[3] = bmapheight = nrows;
+  if (!numlines || runs <= 0)
+    return;
 
-  // offsets to lists and block lists
+  P_BlockMapGrid(&grid);
 
-  for (i=0;i<NBlocks;i++)
+  for (k = 0; k < 2; k++)
   {
-    linelist_t *bl = blocklists[i];
-    long offs = blockmaplump[4+i] =   // set offset to block's list
-      (i? blockmaplump[4+i-1] : 4+NBlocks) + (i? blockcount[i-1] : 0);
-
-    // add the lines in each block's list to the blockmaplump
-    // delete each list node as we go
+    unsigned long long elapsed;
 
-    while (bl)
+    dsda_StartTimer(dsda_timer_temp);
+    for (i = 0; i < runs; i++)
     {
-      linelist_t *tmp = bl->next;
-      blockmaplump[offs++] = bl->num;
-      Z_Free(bl);
-      bl = tmp;
+      lumps[k] = P_BuildBlockMap(&grid, njobs[k], &lumpsizes[k]);
+      if (i < runs - 1)
+        Z_Free(lumps[k]);
     }
+    elapsed = dsda_ElapsedTime(dsda_timer_temp);
+
+    lprintf(LO_INFO, "P_BenchmarkBlockMap: %d lines, %dx%d blocks, %d job(s): %.3f ms\n",
+            numlines, grid.ncols, grid.nrows, njobs[k], (double) elapsed / 1000 / runs);
   }
 
-  // free all temporary storage
+  if (lumpsizes[0] != lumpsizes[1] ||
+      memcmp(lumps[0] + 4, lumps[1] + 4, sizeof(int) * (lumpsizes[0] - 4)))
+    lprintf(LO_WARN, "P_BenchmarkBlockMap: parallel blockmap differs!\n");
 
-  Z_Free (blocklists);
-  Z_Free (blockcount);
-  Z_Free (blockdone);
+  Z_Free(lumps[0]);
+  Z_Free(lumps[1]);
 }
 
 // jff 10/6/98
@@ -3170,13 +3390,19 @@ static int P_GroupLines (void)
 // P_LoadReject - load the reject table
 //
 
+static dboolean reject_lump_empty;
+
 static void P_LoadReject(int lump)
 {
-  unsigned int length;
+  unsigned int length, i;
 
   length = W_SafeLumpLength(lump);
   rejectmatrix = W_SafeLumpByNum(lump);
 
+  // Nodebuilders write an all zero REJECT when asked not to build one
+  for (i = 0; i < length && !rejectmatrix[i]; i++);
+  reject_lump_empty = (i == length);
+
   //e6y: check for overflow
   RejectOverrun(length, &rejectmatrix, P_GroupLines());
 }
@@ -3289,10 +3515,19 @@ static void P_RemoveSlimeTrails(void)         // killough 10/98
   Z_Free(hit);
 }
 
-static void R_CalcSegsLength(void)
+// Each seg only reads its vertexes, so ranges of segs are independent
+
+typedef struct
+{
+  int first_seg, last_seg;       // segs [first_seg, last_seg)
+} segs_length_job_t;
+
+static void R_CalcSegsLengthJob(void *data)
 {
+  segs_length_job_t *job = data;
   int i;
-  for (i=0; i<numsegs; i++)
+
+  for (i=job->first_seg; i<job->last_seg; i++)
   {
     double length;
     seg_t *li = segs+i;
@@ -3305,6 +3540,30 @@ static void R_CalcSegsLength(void)
   }
 }
 
+#define SEGS_LENGTH_JOB_SEGS 8192
+#define SEGS_LENGTH_MAX_JOBS 8
+
+static void R_CalcSegsLength(void)
+{
+  segs_length_job_t jobs[SEGS_LENGTH_MAX_JOBS];
+  int njobs = BETWEEN(1, SEGS_LENGTH_MAX_JOBS, numsegs / SEGS_LENGTH_JOB_SEGS);
+  int i;
+
+  for (i = 0; i < njobs; i++)
+  {
+    jobs[i].first_seg = (int)((int64_t)numsegs * i / njobs);
+    jobs[i].last_seg = (int)((int64_t)numsegs * (i + 1) / njobs);
+  }
+
+  if (njobs == 1)
+  {
+    R_CalcSegsLengthJob(&jobs[0]);
+    return;
+  }
+
+  I_ThreadPoolRun(R_CalcSegsLengthJob, jobs, sizeof(*jobs), njobs);
+}
+
 //
 // P_CheckLumpsForSameSource
 //
@@ -3644,6 +3903,71 @@ void P_MustRebuildBlockmap(void)
   must_rebuild_blockmap = true;
 }
 
+//
+// Level load profile
+//
+// With -levelprofile, P_SetupLevel reports the time spent in each stage.
+//
+
+#define LEVEL_PROFILE_MAX_STAGES 32
+
+typedef struct
+{
+  const char *name;
+  unsigned long long ns;
+} level_profile_stage_t;
+
+static dboolean level_profile;
+static level_profile_stage_t level_profile_stages[LEVEL_PROFILE_MAX_STAGES];
+static int level_profile_stage_count;
+static unsigned long long level_profile_mark;
+
+static void P_StartLevelProfile(void)
+{
+  level_profile = dsda_Flag(dsda_arg_level_profile);
+
+  if (!level_profile)
+    return;
+
+  level_profile_stage_count = 0;
+  level_profile_mark = 0;
+  dsda_StartTimer(dsda_timer_level_load);
+}
+
+static void P_LevelProfileStage(const char *name)
+{
+  unsigned long long now;
+
+  if (!level_profile)
+    return;
+
+  now = dsda_ElapsedTimeNS(dsda_timer_level_load);
+
+  if (level_profile_stage_count < LEVEL_PROFILE_MAX_STAGES)
+  {
+    level_profile_stages[level_profile_stage_count].name = name;
+    level_profile_stages[level_profile_stage_count].ns = now - level_profile_mark;
+    level_profile_stage_count++;
+  }
+
+  level_profile_mark = now;
+}
+
+static void P_PrintLevelProfile(const char *lumpname)
+{
+  int i;
+
+  if (!level_profile)
+    return;
+
+  lprintf(LO_INFO, "P_SetupLevel: %s loaded in %.3f ms\n",
+          lumpname, (double) level_profile_mark / 1000000);
+
+  for (i = 0; i < level_profile_stage_count; i++)
+    lprintf(LO_INFO, "  %-14s %9.3f ms\n", level_profile_stages[i].name,
+            (double) level_profile_stages[i].ns / 1000000);
+}
+
 //
 // P_SetupLevel
 //
@@ -3655,6 +3979,8 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   char  lumpname[9];
   int   lumpnum;
 
+  P_StartLevelProfile();
+
   //e6y
   totallive = 0;
 
@@ -3679,12 +4005,17 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   snprintf(lumpname, sizeof(lumpname), "%s", dsda_MapLumpName(episode, map));
   lumpnum = W_GetNumForName(lumpname);
 
+  // Start paging in the map lumps while the previous level is torn down
+  W_PrefetchLumps(lumpnum, ML_BEHAVIOR + 1);
+
   // Must process musinfo to get default track before calling S_Start
   S_ParseMusInfo(lumpname);
 
   // Make sure all sounds are stopped before Z_FreeTag.
   S_Start();
 
+  dsda_StopRejectBuilder();
+
   Z_FreeLevel();
 
   mobjcache = NULL;
@@ -3719,6 +4050,23 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   current_map = map;
   current_nodesVersion = nodesVersion;
 
+  // Inflate compressed nodes while the rest of the map loads
+  switch (nodesVersion)
+  {
+    case ZDOOM_ZNOD_NODES:
+      P_StartZNodesInflate(level_components.nodes);
+      break;
+
+    case ZDOOM_ZGLN_NODES:
+    case ZDOOM_ZGL2_NODES:
+    case ZDOOM_ZGL3_NODES:
+      P_StartZNodesInflate(level_components.znodes);
+      break;
+
+    default:
+      break;
+  }
+
   dsda_WatchNewLevel();
 
   if (!samelevel)
@@ -3742,13 +4090,20 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
 
   dsda_ResetHealthGroups();
 
+  P_LevelProfileStage("teardown");
+
   map_loader.load_vertexes(level_components.vertexes);
+  P_LevelProfileStage("vertexes");
+
   map_loader.load_sectors(level_components.sectors);
+  P_LevelProfileStage("sectors");
+
   map_loader.allocate_sidedefs(level_components.sidedefs);
   map_loader.load_linedefs(level_components.linedefs);
   map_loader.load_sidedefs(level_components.sidedefs);
 
   P_PostProcessLineDefs();
+  P_LevelProfileStage("lines");
 
   // e6y: speedup of level reloading
   // Do not reload BlockMap for same level,
@@ -3766,6 +4121,8 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
     memset(blocklinks, 0, bmapwidth*bmapheight*sizeof(*blocklinks));
   }
 
+  P_LevelProfileStage("blockmap");
+
   switch (nodesVersion)
   {
     case ZDOOM_XNOD_NODES:
@@ -3816,13 +4173,18 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   map_subsectors = calloc_IfSameLevel(map_subsectors,
     numsubsectors, sizeof(map_subsectors[0]));
 
+  P_LevelProfileStage("nodes");
+
   // reject loading and underflow padding separated out into new function
   P_LoadReject(level_components.reject);
+  P_LevelProfileStage("reject");
 
   P_RemoveSlimeTrails();    // killough 10/98: remove slime trails from wad
+  P_LevelProfileStage("slime trails");
 
   // should be after P_RemoveSlimeTrails, because it changes vertexes
   R_CalcSegsLength();
+  P_LevelProfileStage("segs length");
 
   {
     void A_ResetPlayerCorpseQueue(void);
@@ -3901,19 +4263,28 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   // clear special respawning que
   iquehead = iquetail = 0;
 
+  P_LevelProfileStage("things");
+
   // set up world state
   P_SpawnSpecials();
 
   dsda_WatchAfterLevelSetup();
+  P_LevelProfileStage("specials");
+
+  AM_BuildSpatialIndex();
+  P_LevelProfileStage("automap");
 
   P_MapEnd();
 
+  dsda_StartRejectBuilder(reject_lump_empty);
+
   dsda_HandleMapPreferences();
 
   dsda_ApplyFadeTable();
 
   // preload graphics
   R_PrecacheLevel();
+  P_LevelProfileStage("precache");
 
   if (V_IsOpenGLMode())
   {
@@ -3925,6 +4296,7 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
     {
       // proff 11/99: calculate all OpenGL specific tables etc.
       gld_PreprocessLevel();
+      P_LevelProfileStage("gl preprocess");
     }
   }
 
@@ -3947,6 +4319,9 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   {
     AM_Start(false);
   }
+
+  P_LevelProfileStage("finish");
+  P_PrintLevelProfile(lumpname);
 }
 
 //
@@ -67,6 +67,7 @@ typedef struct
 extern blockmap_t original_blockmap;
 
 void P_RestoreOriginalBlockMap(void);
+void P_BenchmarkBlockMap(int runs);
 
 typedef struct
 {
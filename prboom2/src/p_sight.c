@@ -43,6 +43,7 @@
 #include "e6y.h" //e6y
 
 #include "dsda/map_format.h"
+#include "dsda/reject.h"
 
 /*
 ==============================================================================
@@ -931,6 +932,14 @@ dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
   if (rejectmatrix[pnum>>3] & (1 << (pnum&7)))   // can't possibly be connected
     return false;
 
+  // A REJECT built in the background for maps that don't have one
+  {
+    const byte *built_reject = dsda_BuiltReject();
+
+    if (built_reject && built_reject[pnum>>3] & (1 << (pnum&7)))
+      return false;
+  }
+
   // killough 4/19/98: make fake floors and ceilings block monster view
 
   if ((s1->heightsec != -1 &&
@@ -128,6 +128,9 @@ R_DrawColumn_f R_GetDrawColumnFunc(enum column_pipeline_e type, enum draw_filter
 // Span blitting for rows, floor/ceiling. No Spectre effect needed.
 void R_DrawSpan(draw_span_vars_t *dsvars);
 
+// Selects the SSE4.1 / AVX2 drawers when the CPU supports them
+void R_InitDrawFunctions(void);
+
 void R_InitBuffer(int width, int height);
 
 void R_InitBuffersRes(void);
@@ -32,6 +32,8 @@
  *---------------------------------------------------------------------
  */
 
+#include <stddef.h>
+
 #include "doomstat.h"
 #include "m_random.h"
 #include "r_defs.h"
@@ -61,20 +63,58 @@ typedef enum
   INTERP_SectorCeiling,
   INTERP_WallPanning,
   INTERP_FloorPanning,
-  INTERP_CeilingPanning
+  INTERP_CeilingPanning,
+  NUM_INTERP_TYPES
 } interpolation_type_e;
 
+// Interpolations are kept in one table per type. Each entry has one or two
+// fixed_t fields ("lanes"), stored side by side in packed arrays, so every
+// pass over a table is a flat loop without per-entry dispatch.
+
+#define MAX_INTERP_LANES 2
+
 typedef struct
 {
-  interpolation_type_e type;
-  void *address;
-} interpolation_t;
-
-static int numinterpolations = 0;
+  int lanes;
+  size_t field[MAX_INTERP_LANES]; // offsets of the interpolated fields
+  size_t index_field;             // offset of the entry index (+1) in the owner
+  dboolean split;                 // sector heights also update the gl splits
+
+  int count;
+  int max;
+  void **address;                 // owner of each entry
+  fixed_t **target;               // count * lanes
+  fixed_t *old;                   // value at the start of the tic
+  fixed_t *cur;                   // value at the end of the tic
+  fixed_t *lerp;                  // value drawn this frame
+} interpolation_table_t;
+
+static interpolation_table_t interpolations[NUM_INTERP_TYPES] = {
+  [INTERP_SectorFloor] = {
+    1, { offsetof(sector_t, floorheight) },
+    offsetof(sector_t, INTERP_SectorFloor), true
+  },
+  [INTERP_SectorCeiling] = {
+    1, { offsetof(sector_t, ceilingheight) },
+    offsetof(sector_t, INTERP_SectorCeiling), true
+  },
+  [INTERP_WallPanning] = {
+    2, { offsetof(side_t, rowoffset), offsetof(side_t, textureoffset) },
+    offsetof(side_t, INTERP_WallPanning), false
+  },
+  [INTERP_FloorPanning] = {
+    2, { offsetof(sector_t, floor_xoffs), offsetof(sector_t, floor_yoffs) },
+    offsetof(sector_t, INTERP_FloorPanning), false
+  },
+  [INTERP_CeilingPanning] = {
+    2, { offsetof(sector_t, ceiling_xoffs), offsetof(sector_t, ceiling_yoffs) },
+    offsetof(sector_t, INTERP_CeilingPanning), false
+  },
+};
 
 tic_vars_t tic_vars;
 
-static void R_DoAnInterpolation (int i, fixed_t smoothratio);
+static void R_DoInterpolations(fixed_t smoothratio);
 
 void D_Display(fixed_t frac);
 
@@ -86,11 +126,6 @@ void M_ChangeUncappedFrameRate(void)
     movement_smooth = (singletics ? false : dsda_IntConfig(dsda_config_uncapped_framerate));
 }
 
-typedef fixed_t fixed2_t[2];
-static fixed2_t *oldipos;
-static fixed2_t *bakipos;
-static interpolation_t *curipos;
-
 static dboolean NoInterpolateView;
 static dboolean didInterp;
 dboolean WasRenderedInTryRunTics;
@@ -208,15 +243,10 @@ void R_InterpolateView(player_t *player, fixed_t frac)
 
   if (R_ViewInterpolation())
   {
-    int i;
-
     didInterp = tic_vars.frac != FRACUNIT;
     if (didInterp)
     {
-      for (i = numinterpolations - 1; i >= 0; i--)
-      {
-        R_DoAnInterpolation (i, tic_vars.frac);
-      }
+      R_DoInterpolations(tic_vars.frac);
     }
   }
 }
@@ -226,242 +256,147 @@ void R_ResetViewInterpolation ()
   NoInterpolateView = true;
 }
 
-static void R_CopyInterpToOld (int i)
+static int *R_InterpolationIndex(const interpolation_table_t *table, void *posptr)
 {
-  switch (curipos[i].type)
-  {
-  case INTERP_SectorFloor:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->floorheight;
-    break;
-  case INTERP_SectorCeiling:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->ceilingheight;
-    break;
-  case INTERP_WallPanning:
-    oldipos[i][0] = ((side_t*)curipos[i].address)->rowoffset;
-    oldipos[i][1] = ((side_t*)curipos[i].address)->textureoffset;
-    break;
-  case INTERP_FloorPanning:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->floor_xoffs;
-    oldipos[i][1] = ((sector_t*)curipos[i].address)->floor_yoffs;
-    break;
-  case INTERP_CeilingPanning:
-    oldipos[i][0] = ((sector_t*)curipos[i].address)->ceiling_xoffs;
-    oldipos[i][1] = ((sector_t*)curipos[i].address)->ceiling_yoffs;
-    break;
-  }
+  return (int *)((byte *)posptr + table->index_field);
 }
 
-static void R_CopyBakToInterp (int i)
+// Packed copy of the live values, in table order
+static void R_GatherInterpolations(const interpolation_table_t *table, fixed_t *dest)
 {
-  switch (curipos[i].type)
-  {
-  case INTERP_SectorFloor:
-    ((sector_t*)curipos[i].address)->floorheight = bakipos[i][0];
-    break;
-  case INTERP_SectorCeiling:
-    ((sector_t*)curipos[i].address)->ceilingheight = bakipos[i][0];
-    break;
-  case INTERP_WallPanning:
-    ((side_t*)curipos[i].address)->rowoffset = bakipos[i][0];
-    ((side_t*)curipos[i].address)->textureoffset = bakipos[i][1];
-    break;
-  case INTERP_FloorPanning:
-    ((sector_t*)curipos[i].address)->floor_xoffs = bakipos[i][0];
-    ((sector_t*)curipos[i].address)->floor_yoffs = bakipos[i][1];
-    break;
-  case INTERP_CeilingPanning:
-    ((sector_t*)curipos[i].address)->ceiling_xoffs = bakipos[i][0];
-    ((sector_t*)curipos[i].address)->ceiling_yoffs = bakipos[i][1];
-    break;
-  }
+  int i, n = table->count * table->lanes;
+
+  for (i = 0; i < n; i++)
+    dest[i] = *table->target[i];
 }
 
-static void R_DoAnInterpolation (int i, fixed_t smoothratio)
+static void R_ScatterInterpolations(const interpolation_table_t *table, const fixed_t *src)
 {
-  fixed_t pos;
-  fixed_t *adr1 = NULL;
-  fixed_t *adr2 = NULL;
+  int i, n = table->count * table->lanes;
 
-  switch (curipos[i].type)
-  {
-  case INTERP_SectorFloor:
-    adr1 = &((sector_t*)curipos[i].address)->floorheight;
-    break;
-  case INTERP_SectorCeiling:
-    adr1 = &((sector_t*)curipos[i].address)->ceilingheight;
-    break;
-  case INTERP_WallPanning:
-    adr1 = &((side_t*)curipos[i].address)->rowoffset;
-    adr2 = &((side_t*)curipos[i].address)->textureoffset;
-    break;
-  case INTERP_FloorPanning:
-    adr1 = &((sector_t*)curipos[i].address)->floor_xoffs;
-    adr2 = &((sector_t*)curipos[i].address)->floor_yoffs;
-    break;
-  case INTERP_CeilingPanning:
-    adr1 = &((sector_t*)curipos[i].address)->ceiling_xoffs;
-    adr2 = &((sector_t*)curipos[i].address)->ceiling_yoffs;
-    break;
-
- default:
-    return;
-  }
+  for (i = 0; i < n; i++)
+    *table->target[i] = src[i];
+}
 
-  if (adr1)
-  {
-    pos = bakipos[i][0] = *adr1;
-    *adr1 = oldipos[i][0] + FixedMul (pos - oldipos[i][0], smoothratio);
-  }
+// Live values are swapped for the interpolated ones while the frame is drawn,
+// and put back by R_RestoreInterpolations
+static void R_DoInterpolations(fixed_t smoothratio)
+{
+  int type;
 
-  if (adr2)
+  for (type = 0; type < NUM_INTERP_TYPES; type++)
   {
-    pos = bakipos[i][1] = *adr2;
-    *adr2 = oldipos[i][1] + FixedMul (pos - oldipos[i][1], smoothratio);
-  }
+    interpolation_table_t *table = &interpolations[type];
+    int i, n = table->count * table->lanes;
 
-  switch (curipos[i].type)
-  {
-  case INTERP_SectorFloor:
-  case INTERP_SectorCeiling:
-    gld_UpdateSplitData(((sector_t*)curipos[i].address));
-    break;
-  default:
-    break;
+    if (!n)
+      continue;
+
+    R_GatherInterpolations(table, table->cur);
+
+    // No loads or stores through the targets here, so this loop vectorizes
+    for (i = 0; i < n; i++)
+      table->lerp[i] = table->old[i] + FixedMul(table->cur[i] - table->old[i], smoothratio);
+
+    R_ScatterInterpolations(table, table->lerp);
+
+    if (table->split)
+      for (i = 0; i < table->count; i++)
+        gld_UpdateSplitData(table->address[i]);
   }
 }
 
 void R_UpdateInterpolations()
 {
-  int i;
+  int type;
+
   if (!movement_smooth)
     return;
-  for (i = numinterpolations-1; i >= 0; --i)
-    R_CopyInterpToOld (i);
+
+  for (type = 0; type < NUM_INTERP_TYPES; type++)
+    R_GatherInterpolations(&interpolations[type], interpolations[type].old);
 }
 
-int interpolations_max = 0;
+static void R_GrowInterpolationTable(interpolation_table_t *table)
+{
+  int values;
+
+  table->max = table->max ? table->max * 2 : 64;
+  values = table->max * table->lanes;
+
+  table->address = Z_Realloc(table->address, table->max * sizeof(*table->address));
+  table->target = Z_Realloc(table->target, values * sizeof(*table->target));
+  table->old = Z_Realloc(table->old, values * sizeof(*table->old));
+  table->cur = Z_Realloc(table->cur, values * sizeof(*table->cur));
+  table->lerp = Z_Realloc(table->lerp, values * sizeof(*table->lerp));
+}
 
 static void R_SetInterpolation(interpolation_type_e type, void *posptr)
 {
-  int *i;
+  interpolation_table_t *table = &interpolations[type];
+  int *index;
+  int lane, entry;
+
   if (!movement_smooth)
     return;
 
-  if (numinterpolations >= interpolations_max) {
-    int prevmax = interpolations_max;
+  index = R_InterpolationIndex(table, posptr);
 
-    interpolations_max = interpolations_max ? interpolations_max * 2 : 256;
+  if (*index)
+    return;
 
-    if (interpolations_max == prevmax)
-    {
-      return;
-    }
+  if (table->count >= table->max)
+    R_GrowInterpolationTable(table);
 
-    oldipos = (fixed2_t*)Z_Realloc(oldipos, sizeof(*oldipos) * interpolations_max);
-    bakipos = (fixed2_t*)Z_Realloc(bakipos, sizeof(*bakipos) * interpolations_max);
-    curipos = (interpolation_t*)Z_Realloc(curipos, sizeof(*curipos) * interpolations_max);
-  }
+  entry = table->count++;
+  table->address[entry] = posptr;
 
-  i = NULL;
-  switch (type)
+  for (lane = 0; lane < table->lanes; lane++)
   {
-  case INTERP_SectorFloor:
-    i = &(((sector_t*)posptr)->INTERP_SectorFloor);
-    break;
-  case INTERP_SectorCeiling:
-    i = &(((sector_t*)posptr)->INTERP_SectorCeiling);
-    break;
-  case INTERP_WallPanning:
-    i = &(((side_t*)posptr)->INTERP_WallPanning);
-    break;
-  case INTERP_FloorPanning:
-    i = &(((sector_t*)posptr)->INTERP_FloorPanning);
-    break;
-  case INTERP_CeilingPanning:
-    i = &(((sector_t*)posptr)->INTERP_CeilingPanning);
-    break;
-  }
+    int value = entry * table->lanes + lane;
 
-  if (i != NULL && (*i) == 0)
-  {
-    curipos[numinterpolations].address = posptr;
-    curipos[numinterpolations].type = type;
-    R_CopyInterpToOld (numinterpolations);
-    numinterpolations++;
-    (*i) = numinterpolations;
+    table->target[value] = (fixed_t *)((byte *)posptr + table->field[lane]);
+    table->old[value] = *table->target[value];
   }
+
+  // we have +1 in index field of interpolation's parent
+  *index = table->count;
 }
 
 static void R_StopInterpolation(interpolation_type_e type, void *posptr)
 {
-  int *i, *j;
-  void *posptr_last;
+  interpolation_table_t *table = &interpolations[type];
+  int *index;
+  int lane, entry, last;
 
   if (!movement_smooth)
     return;
 
-  i = NULL;
-  switch (type)
-  {
-  case INTERP_SectorFloor:
-    i = &(((sector_t*)posptr)->INTERP_SectorFloor);
-    break;
-  case INTERP_SectorCeiling:
-    i = &(((sector_t*)posptr)->INTERP_SectorCeiling);
-    break;
-  case INTERP_WallPanning:
-    i = &(((side_t*)posptr)->INTERP_WallPanning);
-    break;
-  case INTERP_FloorPanning:
-    i = &(((sector_t*)posptr)->INTERP_FloorPanning);
-    break;
-  case INTERP_CeilingPanning:
-    i = &(((sector_t*)posptr)->INTERP_CeilingPanning);
-    break;
-  }
+  index = R_InterpolationIndex(table, posptr);
 
-  if (i != NULL && (*i) != 0)
-  {
-    numinterpolations--;
-
-    // we have +1 in index field of interpolation's parent
-    oldipos[*i - 1][0] = oldipos[numinterpolations][0];
-    oldipos[*i - 1][1] = oldipos[numinterpolations][1];
-    bakipos[*i - 1][0] = bakipos[numinterpolations][0];
-    bakipos[*i - 1][1] = bakipos[numinterpolations][1];
-    curipos[*i - 1] = curipos[numinterpolations];
-
-    // swap indexes
-    posptr_last = curipos[numinterpolations].address;
-    j = NULL;
-    switch (curipos[numinterpolations].type)
-    {
-    case INTERP_SectorFloor:
-      j = &(((sector_t*)posptr_last)->INTERP_SectorFloor);
-      break;
-    case INTERP_SectorCeiling:
-      j = &(((sector_t*)posptr_last)->INTERP_SectorCeiling);
-      break;
-    case INTERP_WallPanning:
-      j = &(((side_t*)posptr_last)->INTERP_WallPanning);
-      break;
-    case INTERP_FloorPanning:
-      j = &(((sector_t*)posptr_last)->INTERP_FloorPanning);
-      break;
-    case INTERP_CeilingPanning:
-      j = &(((sector_t*)posptr_last)->INTERP_CeilingPanning);
-      break;
-    }
+  if (!*index)
+    return;
 
-    // swap
-    if (j != NULL)
-    {
-      *j = *i;
-    }
+  // move the last entry into the freed slot
+  entry = *index - 1;
+  last = --table->count;
+
+  table->address[entry] = table->address[last];
+
+  for (lane = 0; lane < table->lanes; lane++)
+  {
+    int to = entry * table->lanes + lane;
+    int from = last * table->lanes + lane;
 
-    // reset
-    *i = 0;
+    table->target[to] = table->target[from];
+    table->old[to] = table->old[from];
+    table->cur[to] = table->cur[from];
   }
+
+  *R_InterpolationIndex(table, table->address[entry]) = entry + 1;
+
+  // reset
+  *index = 0;
 }
 
 void R_StopAllInterpolations(void)
@@ -471,15 +406,8 @@ void R_StopAllInterpolations(void)
   if (!movement_smooth)
     return;
 
-  for(i=numinterpolations-1; i>= 0; --i)
-  {
-    numinterpolations--;
-    oldipos[i][0] = oldipos[numinterpolations][0];
-    oldipos[i][1] = oldipos[numinterpolations][1];
-    bakipos[i][0] = bakipos[numinterpolations][0];
-    bakipos[i][1] = bakipos[numinterpolations][1];
-    curipos[i] = curipos[numinterpolations];
-  }
+  for (i = 0; i < NUM_INTERP_TYPES; i++)
+    interpolations[i].count = 0;
 
   for(i = 0; i < numsectors; i++)
   {
@@ -497,7 +425,7 @@ void R_StopAllInterpolations(void)
 
 void R_RestoreInterpolations(void)
 {
-  int i;
+  int type;
 
   if (!movement_smooth)
     return;
@@ -505,10 +433,8 @@ void R_RestoreInterpolations(void)
   if (didInterp)
   {
     didInterp = false;
-    for (i = numinterpolations-1; i >= 0; --i)
-    {
-      R_CopyBakToInterp (i);
-    }
+    for (type = 0; type < NUM_INTERP_TYPES; type++)
+      R_ScatterInterpolations(&interpolations[type], interpolations[type].cur);
   }
 }
 
@@ -62,6 +62,7 @@
 #include "xs_Float.h"
 
 #include "dsda/configuration.h"
+#include "dsda/dynamic_resolution.h"
 #include "dsda/exhud.h"
 #include "dsda/features.h"
 #include "dsda/map_format.h"
@@ -70,6 +71,7 @@
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
 #include "dsda/stretch.h"
+#include "dsda/time.h"
 #include "dsda/gl/render_scale.h"
 
 #include "hexen/a_action.h"
@@ -371,10 +373,8 @@ angle_t R_PointToPseudoAngle (fixed_t x, fixed_t y)
 //
 // killough 5/2/98: reformatted
 
-static void R_InitTextureMapping (void)
+static void R_InitFieldOfView (void)
 {
-  int i,x,angle;
-  double linearskyfactor;
   FieldOfView = FIELDOFVIEW;
 
   // For widescreen displays, increase the FOV so that the middle part of the
@@ -395,6 +395,12 @@ static void R_InitTextureMapping (void)
 
   focallength = FixedDiv(centerxfrac, finetangent[FINEANGLES/4 + FieldOfView/2]);
   focallengthy = Scale(centerxfrac, yaspectmul, finetangent[FINEANGLES/4 + FieldOfView/2]);
+}
+
+static void R_InitTextureMapping (void)
+{
+  int i,x,angle;
+  double linearskyfactor;
 
   for (i=0 ; i<FINEANGLES/2 ; i++)
     {
@@ -649,32 +655,13 @@ void R_BuildModelViewMatrix(void)
 }
 
 //
-// R_ExecuteSetViewSize
+// R_SetupViewProjection
+// Derives the projection from SCREENWIDTH, SCREENHEIGHT and the view size
 //
 
-void R_ExecuteSetViewSize (void)
+static void R_SetupViewProjection (void)
 {
-  int i;
   int cheight;
-  fixed_t cosadj;
-
-  setsizeneeded = false;
-
-  SetRatio(SCREENWIDTH, SCREENHEIGHT);
-
-  if (setblocks == 11)
-  {
-    viewheight = SCREENHEIGHT;
-    freelookviewheight = viewheight;
-  }
-  // proff 09/24/98: Added for high-res
-  else
-  {
-    viewheight = SCREENHEIGHT - ST_SCALED_HEIGHT;
-    freelookviewheight = SCREENHEIGHT;
-  }
-
-  viewwidth = SCREENWIDTH;
 
   viewheightfrac = viewheight<<FRACBITS;//e6y
 
@@ -703,11 +690,9 @@ void R_ExecuteSetViewSize (void)
   // e6y: this is a precalculated value for more precise flats drawing (see R_MapPlane)
   viewfocratio = projectiony / wide_centerx;
 
-  dsda_SetupStretchParams();
-
   R_InitBuffer (SCREENWIDTH, viewheight);
 
-  R_InitTextureMapping();
+  R_InitFieldOfView();
 
   // psprite scales
   // proff 08/17/98: Changed for high-res
@@ -731,6 +716,31 @@ void R_ExecuteSetViewSize (void)
 
   // [RH] Sky height fix for screens not 200 (or 240) pixels tall
   R_InitSkyMap();
+}
+
+//
+// R_SetupViewTables
+// The per-column tables, rebuilt only when the view they cover changes
+//
+
+static int view_tables_width;
+static int view_tables_height;
+static fixed_t view_tables_projection;
+
+static void R_SetupViewTables (void)
+{
+  int i;
+  fixed_t cosadj;
+
+  if (viewwidth == view_tables_width && viewheight == view_tables_height &&
+      projection == view_tables_projection)
+    return;
+
+  view_tables_width = viewwidth;
+  view_tables_height = viewheight;
+  view_tables_projection = projection;
+
+  R_InitTextureMapping();
 
   for (i=0 ; i<viewwidth ; i++)
   {
@@ -740,6 +750,40 @@ void R_ExecuteSetViewSize (void)
     cosadj = D_abs(finecosine[xtoviewangle[i]>>ANGLETOFINESHIFT]);
     distscale[i] = FixedDiv(FRACUNIT,cosadj);
   }
+}
+
+//
+// R_ExecuteSetViewSize
+//
+
+void R_ExecuteSetViewSize (void)
+{
+  int i;
+
+  setsizeneeded = false;
+
+  SetRatio(SCREENWIDTH, SCREENHEIGHT);
+
+  if (setblocks == 11)
+  {
+    viewheight = SCREENHEIGHT;
+    freelookviewheight = viewheight;
+  }
+  // proff 09/24/98: Added for high-res
+  else
+  {
+    viewheight = SCREENHEIGHT - ST_SCALED_HEIGHT;
+    freelookviewheight = SCREENHEIGHT;
+  }
+
+  viewwidth = SCREENWIDTH;
+
+  dsda_SetupStretchParams();
+
+  R_SetupViewProjection();
+
+  view_tables_width = 0;
+  R_SetupViewTables();
 
   // e6y
   // Calculate the light levels to use
@@ -786,6 +830,8 @@ void R_Init (void)
   // CPhipps - R_DrawColumn isn't constant anymore, so must
   //  initialise in code
   // current column draw function
+  lprintf(LO_DEBUG, "\nR_InitDrawFunctions: ");
+  R_InitDrawFunctions();
   lprintf(LO_DEBUG, "\nR_LoadTrigTables: ");
   R_LoadTrigTables();
   lprintf(LO_DEBUG, "\nR_InitData: ");
@@ -1048,9 +1094,9 @@ static void R_RenderBSPNodes(void)
 // R_RenderView
 //
 
-void R_RenderPlayerView (player_t* player)
+static void R_RenderView (player_t* player)
 {
-  r_frame_count++;
+  R_SetupViewTables();
 
   DSDA_ADD_CONTEXT(sf_setup_frame);
   R_SetupFrame (player);
@@ -1110,3 +1156,71 @@ void R_RenderPlayerView (player_t* player)
     DSDA_REMOVE_CONTEXT(sf_draw_scene);
   }
 }
+
+//
+// R_RenderScaledView
+// Draws the view into the dynamic resolution buffer at the given percent
+// of the screen size, then upscales it into the view window
+//
+
+static void R_RenderScaledView (player_t* player, int scale)
+{
+  screeninfo_t native_screen = screens[0];
+  int native_width = SCREENWIDTH;
+  int native_height = SCREENHEIGHT;
+  int native_viewheight = viewheight;
+  int native_freelookviewheight = freelookviewheight;
+  screeninfo_t scaled_screen;
+  int scaled_viewheight;
+
+  SCREENWIDTH = MAX(native_width * scale / 100, 1);
+  SCREENHEIGHT = MAX(native_height * scale / 100, 1);
+  viewwidth = SCREENWIDTH;
+  viewheight = MAX(native_viewheight * scale / 100, 1);
+  freelookviewheight = MAX(native_freelookviewheight * scale / 100, 1);
+
+  dsda_DynamicResolutionScreen(&screens[0], SCREENWIDTH, SCREENHEIGHT);
+  R_SetupViewProjection();
+
+  R_RenderView(player);
+
+  scaled_screen = screens[0];
+  scaled_viewheight = viewheight;
+
+  // Everything drawn after the view (hud, status bar, crosshair) sees the
+  //   native screen and projection again
+  screens[0] = native_screen;
+  SCREENWIDTH = native_width;
+  SCREENHEIGHT = native_height;
+  viewwidth = native_width;
+  viewheight = native_viewheight;
+  freelookviewheight = native_freelookviewheight;
+
+  R_SetupViewProjection();
+  R_SetupFreelook();
+  R_SetupViewport();
+
+  dsda_UpscaleDynamicResolution(&scaled_screen, scaled_screen.width, scaled_viewheight,
+                                &screens[0], viewwidth, viewheight);
+}
+
+void R_RenderPlayerView (player_t* player)
+{
+  r_frame_count++;
+
+  if (dsda_DynamicResolutionActive())
+  {
+    int scale = dsda_DynamicResolutionScale();
+
+    dsda_StartTimer(dsda_timer_dynamic_resolution);
+
+    if (scale < 100)
+      R_RenderScaledView(player, scale);
+    else
+      R_RenderView(player);
+
+    dsda_AddDynamicResolutionView(dsda_ElapsedTime(dsda_timer_dynamic_resolution));
+  }
+  else
+    R_RenderView(player);
+}
@@ -137,8 +137,13 @@ void R_InitPlanesRes(void)
   xtoskyangle  = dsda_IntConfig(dsda_config_render_linearsky) ? linearskyangle : xtoviewangle;
 }
 
+// Visplanes are pooled across frames, so they are sized for the native
+// width even when the view is drawn at a lower dynamic resolution
+static int visplane_width;
+
 void R_InitVisplanesRes(void)
 {
+  visplane_width = SCREENWIDTH;
   freetail = NULL;
   freehead = &freetail;
 
@@ -250,8 +255,8 @@ static visplane_t *new_visplane(unsigned hash)
   if (!check)
   {
     // e6y: resolution limitation is removed
-    check = static_cast<visplane_t*>(Z_Calloc(1, sizeof(*check) + sizeof(*check->top) * (SCREENWIDTH * 2)));
-    check->bottom = &check->top[SCREENWIDTH + 2];
+    check = static_cast<visplane_t*>(Z_Calloc(1, sizeof(*check) + sizeof(*check->top) * (visplane_width * 2)));
+    check->bottom = &check->top[visplane_width + 2];
   }
   else
     if (!(freetail = freetail->next))
@@ -582,14 +582,12 @@ void S_UpdateSounds(void)
   mobj_t *listener;
   int cnum;
 
+  I_UpdateMusic();
+
   //jff 1/22/98 return if sound is not enabled
   if (nosfxparm)
     return;
 
-#ifdef UPDATE_MUSIC
-  I_UpdateMusic();
-#endif
-
   listener = GetSoundListener();
   if (sfx_volume == 0)
     return;
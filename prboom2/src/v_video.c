@@ -59,6 +59,7 @@
 #include "dsda/cr_table.h"
 #include "dsda/global.h"
 #include "dsda/palette.h"
+#include "dsda/palette_tables.h"
 #include "dsda/stretch.h"
 #include "dsda/text_color.h"
 
@@ -102,32 +103,20 @@ int V_BloodColor(int blood)
 unsigned int Col2RGB8[65][256];
 byte RGB32k[32][32][32];
 
-#define MAKECOLOR(a) (((a)<<3)|((a)>>2))
-
 void V_InitFlexTranTable(void)
 {
   static int flexTranInit = false;
 
   if (!flexTranInit)
   {
-    int r, g, b, x, y, pos;
+    int x, y, pos;
     const unsigned char *palette = V_GetPlaypal();
 
     // mark that we've initialized the flex tran table
     flexTranInit = true;
 
     // build RGB table
-    for(r = 0; r < 32; r++)
-    {
-      for(g = 0; g < 32; g++)
-      {
-        for(b = 0; b < 32; b++)
-        {
-          RGB32k[r][g][b] = V_BestColor(palette,
-            MAKECOLOR(r), MAKECOLOR(g), MAKECOLOR(b));
-        }
-      }
-    }
+    memcpy(RGB32k, dsda_RGB32kTable(palette), sizeof(RGB32k));
 
     // build lookup table
     for(x = 0; x < 65; x++)
@@ -260,12 +249,17 @@ static void FUNC_V_CopyRect(int srcscrn, int destscrn,
   }\
 }\
 
+// Flat column of each screen column, for the last horizontal scale
+static int *flat_x_map;
+static int flat_x_map_width;
+static float flat_x_map_ratio;
+
 static void FUNC_V_FillFlat(int lump, int scrn, int x, int y, int width, int height, enum patch_translation_e flags)
 {
   const byte *data;
   byte *dest;
   int sx, sy;
-  int pitch, src_x_offset, src_y_offset;
+  int pitch, src_y_offset, last_y_offset;
   float ratio_x, ratio_y;
   stretch_param_t* stretch;
 
@@ -276,16 +270,33 @@ static void FUNC_V_FillFlat(int lump, int scrn, int x, int y, int width, int hei
   ratio_x = stretch->video->width / 320.f;
   ratio_y = stretch->video->height / 200.f;
 
+  if (width > flat_x_map_width || ratio_x != flat_x_map_ratio)
+  {
+    flat_x_map_width = MAX(width, flat_x_map_width);
+    flat_x_map_ratio = ratio_x;
+    flat_x_map = Z_Realloc(flat_x_map, flat_x_map_width * sizeof(*flat_x_map));
+
+    for (sx = 0; sx < flat_x_map_width; ++sx)
+      flat_x_map[sx] = (int) (sx / ratio_x) % 64;
+  }
+
+  last_y_offset = -1;
+
   for (sy = y; sy < y + height; ++sy)
   {
     src_y_offset = 64 * ((int) (sy / ratio_y) % 64);
     dest = screens[scrn].data + pitch * sy + x;
 
-    for (sx = x; sx < x + width; ++sx)
+    // rows that sample the same flat row as the one above are copies
+    if (src_y_offset == last_y_offset)
+      memcpy(dest, dest - pitch, width);
+    else
     {
-      src_x_offset = (int) ((sx - x) / ratio_x) % 64;
-      *dest++ = data[src_x_offset + src_y_offset];
+      for (sx = 0; sx < width; ++sx)
+        dest[sx] = data[flat_x_map[sx] + src_y_offset];
     }
+
+    last_y_offset = src_y_offset;
   }
 }
 
@@ -341,13 +352,14 @@ void V_Init (void)
 // (indeed, laziness of the people who wrote the 'clones' of the original V_DrawPatch
 //  means that their inner loops weren't so well optimised, so merging code may even speed them).
 //
-static void V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
-        dboolean center, int cm, enum patch_translation_e flags)
+// The setup and the two drawing loops are separate so that V_DrawPatchRun
+// can share them.
+//
+static const byte *V_PreparePatch(int *x, int *y, const rpatch_t *patch,
+        dboolean center, int cm, enum patch_translation_e *flags)
 {
   const byte *trans;
 
-  stretch_param_t *params;
-
   if (cm == CR_DEFAULT)
     trans = &colormaps[0][0];
   else if (cm == CR_DARKEN)
@@ -357,258 +369,564 @@ static void V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
   else
     trans = translationtables + 256*((cm - CR_LIMIT) - 1);
 
-  if (!(flags & VPT_NOOFFSET))
+  if (!(*flags & VPT_NOOFFSET))
   {
-    y -= patch->topoffset;
-    x -= patch->leftoffset;
+    *y -= patch->topoffset;
+    *x -= patch->leftoffset;
   }
 
   // CPhipps - auto-no-stretch if not high-res
-  if ((flags & VPT_STRETCH_MASK) && SCREEN_320x200)
-    flags &= ~VPT_STRETCH_MASK;
-
-  params = dsda_StretchParams(flags);
+  if ((*flags & VPT_STRETCH_MASK) && SCREEN_320x200)
+    *flags &= ~VPT_STRETCH_MASK;
 
   // CPhipps - null translation pointer => no translation
   if (!trans)
-    flags &= ~VPT_TRANS;
+    *flags &= ~VPT_TRANS;
 
   // [FG] automatically center wide patches without horizontal offset
   if (center)
   {
     if (patch->width > 320 && patch->leftoffset == 0)
-      x -= (patch->width - 320) / 2;
+      *x -= (patch->width - 320) / 2;
   }
 
-  if (!(flags & VPT_STRETCH_MASK)) {
-    int             col;
-    byte           *desttop = screens[scrn].data+y*screens[scrn].pitch+x;
-    int    w = patch->width;
+  return trans;
+}
 
-    if (y<0 || y+patch->height > ((flags & VPT_STRETCH) ? 200 :  SCREENHEIGHT)) {
-      // killough 1/19/98: improved error message:
-      lprintf(LO_WARN, "V_DrawMemPatch8: Patch (%d,%d)-(%d,%d) exceeds LFB in vertical direction (horizontal is clipped)\n"
-              "Bad V_DrawMemPatch8 (flags=%u)", x, y, x+patch->width, y+patch->height, flags);
-      return;
+static void V_DrawMemPatchUnstretched(int x, int y, int scrn, const rpatch_t *patch,
+        const byte *trans, enum patch_translation_e flags)
+{
+  int             col;
+  byte           *desttop = screens[scrn].data+y*screens[scrn].pitch+x;
+  int    w = patch->width;
+
+  if (y<0 || y+patch->height > ((flags & VPT_STRETCH) ? 200 :  SCREENHEIGHT)) {
+    // killough 1/19/98: improved error message:
+    lprintf(LO_WARN, "V_DrawMemPatch8: Patch (%d,%d)-(%d,%d) exceeds LFB in vertical direction (horizontal is clipped)\n"
+            "Bad V_DrawMemPatch8 (flags=%u)", x, y, x+patch->width, y+patch->height, flags);
+    return;
+  }
+
+  w--; // CPhipps - note: w = width-1 now, speeds up flipping
+
+  for (col=0 ; col<=w ; desttop++, col++, x++) {
+    int i;
+    const int colindex = (flags & VPT_FLIP) ? (w - col) : (col);
+    const rcolumn_t *column = R_GetPatchColumn(patch, colindex);
+
+    if (x < 0)
+      continue;
+    if (x >= SCREENWIDTH)
+      break;
+
+    // step through the posts in a column
+    for (i=0; i<column->numPosts; i++) {
+      const rpost_t *post = &column->posts[i];
+      // killough 2/21/98: Unrolled and performance-tuned
+
+      const byte *source = column->pixels + post->topdelta;
+      byte *dest = desttop + post->topdelta*screens[scrn].pitch;
+      int count = post->length;
+
+      if (!(flags & VPT_TRANS)) {
+        if ((count-=4)>=0)
+          do {
+            register byte s0,s1;
+            s0 = source[0];
+            s1 = source[1];
+            dest[0] = s0;
+            dest[screens[scrn].pitch] = s1;
+            dest += screens[scrn].pitch*2;
+            s0 = source[2];
+            s1 = source[3];
+            source += 4;
+            dest[0] = s0;
+            dest[screens[scrn].pitch] = s1;
+            dest += screens[scrn].pitch*2;
+          } while ((count-=4)>=0);
+        if (count+=4)
+          do {
+            *dest = *source++;
+            dest += screens[scrn].pitch;
+          } while (--count);
+      } else {
+        // CPhipps - merged translation code here
+        if ((count-=4)>=0)
+          do {
+            register byte s0,s1;
+            s0 = source[0];
+            s1 = source[1];
+            s0 = trans[s0];
+            s1 = trans[s1];
+            dest[0] = s0;
+            dest[screens[scrn].pitch] = s1;
+            dest += screens[scrn].pitch*2;
+            s0 = source[2];
+            s1 = source[3];
+            s0 = trans[s0];
+            s1 = trans[s1];
+            source += 4;
+            dest[0] = s0;
+            dest[screens[scrn].pitch] = s1;
+            dest += screens[scrn].pitch*2;
+          } while ((count-=4)>=0);
+        if (count+=4)
+          do {
+            *dest = trans[*source++];
+            dest += screens[scrn].pitch;
+          } while (--count);
+      }
     }
+  }
+}
+
+// Screen rectangle covered by a stretched patch, returns the vertical offset
+static int V_StretchedPatchRect(int x, int y, const rpatch_t *patch,
+        stretch_param_t *params, enum patch_translation_e flags,
+        int *left, int *right, int *top, int *bottom)
+{
+  int deltay1;
+
+  *left = (x < 0 || x > 320 ? (x * params->video->width) / 320 : params->video->x1lookup[x]);
+  *top =  (y < 0 || y > 200 ? (y * params->video->height) / 200 : params->video->y1lookup[y]);
+
+  if (x + patch->width < 0 || x + patch->width > 320)
+    *right = ( ((x + patch->width) * params->video->width - 1) / 320 );
+  else
+    *right = params->video->x2lookup[x + patch->width - 1];
+
+  if (y + patch->height < 0 || y + patch->height > 200)
+    *bottom = ( ((y + patch->height - 0) * params->video->height) / 200 );
+  else
+    *bottom = params->video->y2lookup[y + patch->height - 1];
+
+  deltay1 = params->deltay1;
+
+  if (TOP_ALIGNMENT(flags & VPT_STRETCH_MASK))
+    deltay1 += global_patch_top_offset;
+
+  *left   += params->deltax1;
+  *right  += params->deltax2;
+  *top    += deltay1;
+  *bottom += deltay1;
+
+  return deltay1;
+}
+
+// The caller points drawvars at the screen and flushes the column buffer
+static void V_DrawMemPatchStretched(int x, int y, const rpatch_t *patch,
+        const byte *trans, stretch_param_t *params, enum patch_translation_e flags)
+{
+  // CPhipps - move stretched patch drawing code here
+  //         - reformat initialisers, move variables into inner blocks
+
+  int   col;
+  int   w = (patch->width << 16) - 1; // CPhipps - -1 for faster flipping
+  int   left, right, top, bottom;
+  int   DXI, DYI;
+  int   deltay1;
+  R_DrawColumn_f colfunc;
+  draw_column_vars_t dcvars;
+
+  R_SetDefaultDrawColumnVars(&dcvars);
+
+  if (flags & VPT_TRANS) {
+    colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLATED, RDRAW_FILTER_NONE);
+    dcvars.translation = trans;
+  } else {
+    colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, RDRAW_FILTER_NONE);
+  }
+
+  DXI = params->video->xstep;
+  DYI = params->video->ystep;
+
+  deltay1 = V_StretchedPatchRect(x, y, patch, params, flags, &left, &right, &top, &bottom);
+
+  dcvars.texheight = patch->height;
+  dcvars.iscale = DYI;
+  dcvars.drawingmasked = MAX(patch->width, patch->height) > 8;
+
+  col = 0;
+
+  for (dcvars.x=left; dcvars.x<=right; dcvars.x++, col+=DXI) {
+    int i;
+    const int colindex = (flags & VPT_FLIP) ? ((w - col)>>16): (col>>16);
+    const rcolumn_t *column = R_GetPatchColumn(patch, colindex);
+    const rcolumn_t *prevcolumn = R_GetPatchColumn(patch, colindex-1);
+    const rcolumn_t *nextcolumn = R_GetPatchColumn(patch, colindex+1);
+
+    // ignore this column if it's to the left of our clampRect
+    if (dcvars.x < 0)
+      continue;
+    if (dcvars.x >= SCREENWIDTH)
+      break;
+
+    // step through the posts in a column
+    for (i=0; i<column->numPosts; i++) {
+      const rpost_t *post = &column->posts[i];
+      int yoffset = 0;
+
+      //e6y
+      if (!(flags & VPT_STRETCH_MASK))
+      {
+        dcvars.yl = y + post->topdelta;
+        dcvars.yh = ((((y + post->topdelta + post->length) << 16) - (FRACUNIT>>1))>>FRACBITS);
+      }
+      else
+      {
+        // e6y
+        // More accurate patch drawing from Eternity.
+        // Predefined arrays are used instead of dynamic calculation
+        // of the top and bottom screen coordinates of a column.
 
-    w--; // CPhipps - note: w = width-1 now, speeds up flipping
+        int tmpy;
 
-    for (col=0 ; col<=w ; desttop++, col++, x++) {
-      int i;
-      const int colindex = (flags & VPT_FLIP) ? (w - col) : (col);
-      const rcolumn_t *column = R_GetPatchColumn(patch, colindex);
+        tmpy = y + post->topdelta;
+        if (tmpy < 0 || tmpy > 200)
+          dcvars.yl = (tmpy * params->video->height) / 200 + deltay1;
+        else
+          dcvars.yl = params->video->y1lookup[tmpy] + deltay1;
 
-      if (x < 0)
+        tmpy = y + post->topdelta + post->length - 1;
+        if (tmpy < 0 || tmpy > 200)
+          dcvars.yh = (tmpy * params->video->height) / 200 + deltay1;
+        else
+          dcvars.yh = params->video->y2lookup[tmpy] + deltay1;
+      }
+      dcvars.edgeslope = post->slope;
+
+      if ((dcvars.yh < 0) || (dcvars.yh < top))
+        continue;
+      if ((dcvars.yl >= SCREENHEIGHT) || (dcvars.yl >= bottom))
         continue;
-      if (x >= SCREENWIDTH)
-        break;
 
-      // step through the posts in a column
-      for (i=0; i<column->numPosts; i++) {
-        const rpost_t *post = &column->posts[i];
-        // killough 2/21/98: Unrolled and performance-tuned
-
-        const byte *source = column->pixels + post->topdelta;
-        byte *dest = desttop + post->topdelta*screens[scrn].pitch;
-        int count = post->length;
-
-        if (!(flags & VPT_TRANS)) {
-          if ((count-=4)>=0)
-            do {
-              register byte s0,s1;
-              s0 = source[0];
-              s1 = source[1];
-              dest[0] = s0;
-              dest[screens[scrn].pitch] = s1;
-              dest += screens[scrn].pitch*2;
-              s0 = source[2];
-              s1 = source[3];
-              source += 4;
-              dest[0] = s0;
-              dest[screens[scrn].pitch] = s1;
-              dest += screens[scrn].pitch*2;
-            } while ((count-=4)>=0);
-          if (count+=4)
-            do {
-              *dest = *source++;
-              dest += screens[scrn].pitch;
-            } while (--count);
-        } else {
-          // CPhipps - merged translation code here
-          if ((count-=4)>=0)
-            do {
-              register byte s0,s1;
-              s0 = source[0];
-              s1 = source[1];
-              s0 = trans[s0];
-              s1 = trans[s1];
-              dest[0] = s0;
-              dest[screens[scrn].pitch] = s1;
-              dest += screens[scrn].pitch*2;
-              s0 = source[2];
-              s1 = source[3];
-              s0 = trans[s0];
-              s1 = trans[s1];
-              source += 4;
-              dest[0] = s0;
-              dest[screens[scrn].pitch] = s1;
-              dest += screens[scrn].pitch*2;
-            } while ((count-=4)>=0);
-          if (count+=4)
-            do {
-              *dest = trans[*source++];
-              dest += screens[scrn].pitch;
-            } while (--count);
-        }
+      if (dcvars.yh >= bottom) {
+        //dcvars.yh = bottom-1;
+        dcvars.edgeslope &= ~RDRAW_EDGESLOPE_BOT_MASK;
+      }
+      if (dcvars.yh >= SCREENHEIGHT) {
+        dcvars.yh = SCREENHEIGHT-1;
+        dcvars.edgeslope &= ~RDRAW_EDGESLOPE_BOT_MASK;
+      }
+
+      if (dcvars.yl < 0) {
+        yoffset = (0-dcvars.yl) * 200/params->video->height;
+        dcvars.yl = 0;
+        dcvars.edgeslope &= ~RDRAW_EDGESLOPE_TOP_MASK;
+      }
+      if (dcvars.yl < top) {
+        yoffset = (top-dcvars.yl) * 200/params->video->height;
+        dcvars.yl = top;
+        dcvars.edgeslope &= ~RDRAW_EDGESLOPE_TOP_MASK;
       }
+
+      dcvars.source = column->pixels + post->topdelta + yoffset;
+      dcvars.prevsource = prevcolumn ? prevcolumn->pixels + post->topdelta + yoffset: dcvars.source;
+      dcvars.nextsource = nextcolumn ? nextcolumn->pixels + post->topdelta + yoffset: dcvars.source;
+
+      dcvars.texturemid = -((dcvars.yl-centery)*dcvars.iscale);
+
+      //e6y
+      dcvars.dy = deltay1;
+      dcvars.flags |= DRAW_COLUMN_ISPATCH;
+
+      colfunc(&dcvars);
     }
   }
-  else {
-    // CPhipps - move stretched patch drawing code here
-    //         - reformat initialisers, move variables into inner blocks
-
-    int   col;
-    int   w = (patch->width << 16) - 1; // CPhipps - -1 for faster flipping
-    int   left, right, top, bottom;
-    int   DXI, DYI;
-    int   deltay1;
-    R_DrawColumn_f colfunc;
-    draw_column_vars_t dcvars;
-    draw_vars_t olddrawvars = drawvars;
-
-    R_SetDefaultDrawColumnVars(&dcvars);
-
-    drawvars.topleft = screens[scrn].data;
-    drawvars.pitch = screens[scrn].pitch;
-
-    if (flags & VPT_TRANS) {
-      colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLATED, RDRAW_FILTER_NONE);
-      dcvars.translation = trans;
-    } else {
-      colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, RDRAW_FILTER_NONE);
+}
+
+//
+// Patch cache
+//
+// A stretched patch drawn again at the same place is kept as the spans of
+// screen pixels it covers, so the next draws are row copies. Patches are
+// kept from their third draw on, which leaves out most that move. The screen
+// size and stretch params are part of the key, and the whole cache is
+// dropped when the stretch params are set up again or when it gets too big.
+//
+
+#define PATCH_CACHE_HASH 1024
+#define PATCH_CACHE_BUILD_USES 3
+#define PATCH_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+typedef struct
+{
+  const rpatch_t *patch;
+  const byte *trans;
+  const void *video;
+  int flags;
+  int x;
+  int y;
+  int deltax1;
+  int deltax2;
+  int deltay1;
+  int screenwidth;
+  int screenheight;
+} patch_cache_key_t;
+
+typedef struct
+{
+  int x;
+  int length;
+} patch_span_t;
+
+typedef struct patch_cache_s
+{
+  struct patch_cache_s *next;
+  patch_cache_key_t key;
+  int uses;
+  dboolean built;
+  int left;
+  int top;
+  int height;
+  int *row_spans;       // number of spans in each row
+  patch_span_t *spans;
+  byte *pixels;
+} patch_cache_t;
+
+static patch_cache_t *patch_cache[PATCH_CACHE_HASH];
+static size_t patch_cache_bytes;
+static byte *patch_cache_scratch;
+static int patch_cache_scratch_size;
+
+void V_FreePatchCache(void)
+{
+  int i;
+
+  for (i = 0; i < PATCH_CACHE_HASH; i++)
+  {
+    while (patch_cache[i])
+    {
+      patch_cache_t *entry = patch_cache[i];
+
+      patch_cache[i] = entry->next;
+      Z_Free(entry->row_spans);
+      Z_Free(entry);
     }
+  }
+
+  Z_Free(patch_cache_scratch);
+  patch_cache_scratch = NULL;
+  patch_cache_scratch_size = 0;
+  patch_cache_bytes = 0;
+}
+
+// The patch is drawn over two screen sized buffers, one cleared to 0 and
+// one to 255, and the pixels that come out the same in both are covered.
+static void V_BuildCachedPatch(patch_cache_t *entry, int x, int y, const rpatch_t *patch,
+        const byte *trans, stretch_param_t *params, enum patch_translation_e flags)
+{
+  int left, right, top, bottom;
+  int width, row, i;
+  int span_count, pixel_count;
+  int screen_size;
+  byte *clear0, *clear255;
+  patch_span_t *span;
+  byte *dest;
+  draw_vars_t olddrawvars;
 
-    DXI = params->video->xstep;
-    DYI = params->video->ystep;
+  entry->built = true;
 
-    left = (x < 0 || x > 320 ? (x * params->video->width) / 320 : params->video->x1lookup[x]);
-    top =  (y < 0 || y > 200 ? (y * params->video->height) / 200 : params->video->y1lookup[y]);
+  V_StretchedPatchRect(x, y, patch, params, flags, &left, &right, &top, &bottom);
 
-    if (x + patch->width < 0 || x + patch->width > 320)
-      right = ( ((x + patch->width) * params->video->width - 1) / 320 );
-    else
-      right = params->video->x2lookup[x + patch->width - 1];
+  left = MAX(left, 0);
+  right = MIN(right, SCREENWIDTH - 1);
+  top = MAX(top, 0);
+  bottom = MIN(bottom, SCREENHEIGHT - 1);
 
-    if (y + patch->height < 0 || y + patch->height > 200)
-      bottom = ( ((y + patch->height - 0) * params->video->height) / 200 );
-    else
-      bottom = params->video->y2lookup[y + patch->height - 1];
+  if (left > right || top > bottom)
+    return;
 
-    deltay1 = params->deltay1;
+  width = right - left + 1;
+  screen_size = SCREENWIDTH * SCREENHEIGHT;
 
-    if (TOP_ALIGNMENT(flags & VPT_STRETCH_MASK))
-      deltay1 += global_patch_top_offset;
+  if (patch_cache_scratch_size != screen_size)
+  {
+    patch_cache_scratch = Z_Realloc(patch_cache_scratch, 2 * screen_size);
+    patch_cache_scratch_size = screen_size;
+  }
 
-    left   += params->deltax1;
-    right  += params->deltax2;
-    top    += deltay1;
-    bottom += deltay1;
+  clear0 = patch_cache_scratch;
+  clear255 = patch_cache_scratch + screen_size;
 
-    dcvars.texheight = patch->height;
-    dcvars.iscale = DYI;
-    dcvars.drawingmasked = MAX(patch->width, patch->height) > 8;
+  for (row = top; row <= bottom; row++)
+  {
+    memset(clear0 + row * SCREENWIDTH + left, 0, width);
+    memset(clear255 + row * SCREENWIDTH + left, 255, width);
+  }
 
-    col = 0;
+  // columns queued for the screen go out before drawvars change
+  R_ResetColumnBuffer();
 
-    for (dcvars.x=left; dcvars.x<=right; dcvars.x++, col+=DXI) {
-      int i;
-      const int colindex = (flags & VPT_FLIP) ? ((w - col)>>16): (col>>16);
-      const rcolumn_t *column = R_GetPatchColumn(patch, colindex);
-      const rcolumn_t *prevcolumn = R_GetPatchColumn(patch, colindex-1);
-      const rcolumn_t *nextcolumn = R_GetPatchColumn(patch, colindex+1);
+  olddrawvars = drawvars;
+  drawvars.pitch = SCREENWIDTH;
 
-      // ignore this column if it's to the left of our clampRect
-      if (dcvars.x < 0)
-        continue;
-      if (dcvars.x >= SCREENWIDTH)
-        break;
+  drawvars.topleft = clear0;
+  V_DrawMemPatchStretched(x, y, patch, trans, params, flags);
+  R_ResetColumnBuffer();
 
-      // step through the posts in a column
-      for (i=0; i<column->numPosts; i++) {
-        const rpost_t *post = &column->posts[i];
-        int yoffset = 0;
+  drawvars.topleft = clear255;
+  V_DrawMemPatchStretched(x, y, patch, trans, params, flags);
+  R_ResetColumnBuffer();
 
-        //e6y
-        if (!(flags & VPT_STRETCH_MASK))
-        {
-          dcvars.yl = y + post->topdelta;
-          dcvars.yh = ((((y + post->topdelta + post->length) << 16) - (FRACUNIT>>1))>>FRACBITS);
-        }
-        else
+  drawvars = olddrawvars;
+
+  span_count = 0;
+  pixel_count = 0;
+
+  for (row = top; row <= bottom; row++)
+  {
+    const byte *a = clear0 + row * SCREENWIDTH + left;
+    const byte *b = clear255 + row * SCREENWIDTH + left;
+
+    for (i = 0; i < width; i++)
+      if (a[i] == b[i])
+      {
+        if (!i || a[i - 1] != b[i - 1])
+          span_count++;
+        pixel_count++;
+      }
+  }
+
+  entry->left = left;
+  entry->top = top;
+  entry->height = bottom - top + 1;
+  entry->row_spans = Z_Malloc(entry->height * sizeof(*entry->row_spans) +
+                              span_count * sizeof(*entry->spans) + pixel_count);
+  entry->spans = (patch_span_t *) (entry->row_spans + entry->height);
+  entry->pixels = (byte *) (entry->spans + span_count);
+
+  patch_cache_bytes += entry->height * sizeof(*entry->row_spans) +
+                       span_count * sizeof(*entry->spans) + pixel_count;
+
+  span = entry->spans;
+  dest = entry->pixels;
+
+  for (row = top; row <= bottom; row++)
+  {
+    const byte *a = clear0 + row * SCREENWIDTH + left;
+    const byte *b = clear255 + row * SCREENWIDTH + left;
+
+    entry->row_spans[row - top] = 0;
+
+    for (i = 0; i < width; i++)
+      if (a[i] == b[i])
+      {
+        if (!i || a[i - 1] != b[i - 1])
         {
-          // e6y
-          // More accurate patch drawing from Eternity.
-          // Predefined arrays are used instead of dynamic calculation
-          // of the top and bottom screen coordinates of a column.
-
-          int tmpy;
-
-          tmpy = y + post->topdelta;
-          if (tmpy < 0 || tmpy > 200)
-            dcvars.yl = (tmpy * params->video->height) / 200 + deltay1;
-          else
-            dcvars.yl = params->video->y1lookup[tmpy] + deltay1;
-
-          tmpy = y + post->topdelta + post->length - 1;
-          if (tmpy < 0 || tmpy > 200)
-            dcvars.yh = (tmpy * params->video->height) / 200 + deltay1;
-          else
-            dcvars.yh = params->video->y2lookup[tmpy] + deltay1;
+          span->x = i;
+          span->length = 0;
+          span++;
+          entry->row_spans[row - top]++;
         }
-        dcvars.edgeslope = post->slope;
+        span[-1].length++;
+        *dest++ = a[i];
+      }
+  }
+}
 
-        if ((dcvars.yh < 0) || (dcvars.yh < top))
-          continue;
-        if ((dcvars.yl >= SCREENHEIGHT) || (dcvars.yl >= bottom))
-          continue;
+// Returns the cached patch, or NULL when it has to be drawn by columns
+static const patch_cache_t *V_CachedPatch(int x, int y, int scrn, const rpatch_t *patch,
+        const byte *trans, stretch_param_t *params, enum patch_translation_e flags)
+{
+  patch_cache_key_t key;
+  patch_cache_t *entry;
+  int hash;
+
+  if (screens[scrn].width != SCREENWIDTH || screens[scrn].height != SCREENHEIGHT)
+    return NULL;
+
+  memset(&key, 0, sizeof(key));
+  key.patch = patch;
+  key.trans = trans;
+  key.video = params->video;
+  key.flags = flags;
+  key.x = x;
+  key.y = y;
+  key.deltax1 = params->deltax1;
+  key.deltax2 = params->deltax2;
+  key.deltay1 = params->deltay1;
+  if (TOP_ALIGNMENT(flags & VPT_STRETCH_MASK))
+    key.deltay1 += global_patch_top_offset;
+  key.screenwidth = SCREENWIDTH;
+  key.screenheight = SCREENHEIGHT;
+
+  hash = (int) (((uintptr_t) patch >> 4) + x * 31 + y * 131 + flags) & (PATCH_CACHE_HASH - 1);
+
+  for (entry = patch_cache[hash]; entry; entry = entry->next)
+    if (!memcmp(&entry->key, &key, sizeof(key)))
+      break;
 
-        if (dcvars.yh >= bottom) {
-          //dcvars.yh = bottom-1;
-          dcvars.edgeslope &= ~RDRAW_EDGESLOPE_BOT_MASK;
-        }
-        if (dcvars.yh >= SCREENHEIGHT) {
-          dcvars.yh = SCREENHEIGHT-1;
-          dcvars.edgeslope &= ~RDRAW_EDGESLOPE_BOT_MASK;
-        }
+  if (!entry)
+  {
+    if (patch_cache_bytes > PATCH_CACHE_MAX_BYTES)
+      V_FreePatchCache();
+
+    entry = Z_Calloc(1, sizeof(*entry));
+    memcpy(&entry->key, &key, sizeof(key));
+    entry->next = patch_cache[hash];
+    patch_cache[hash] = entry;
+    patch_cache_bytes += sizeof(*entry);
+  }
 
-        if (dcvars.yl < 0) {
-          yoffset = (0-dcvars.yl) * 200/params->video->height;
-          dcvars.yl = 0;
-          dcvars.edgeslope &= ~RDRAW_EDGESLOPE_TOP_MASK;
-        }
-        if (dcvars.yl < top) {
-          yoffset = (top-dcvars.yl) * 200/params->video->height;
-          dcvars.yl = top;
-          dcvars.edgeslope &= ~RDRAW_EDGESLOPE_TOP_MASK;
-        }
+  if (!entry->built)
+  {
+    if (++entry->uses < PATCH_CACHE_BUILD_USES)
+      return NULL;
 
-        dcvars.source = column->pixels + post->topdelta + yoffset;
-        dcvars.prevsource = prevcolumn ? prevcolumn->pixels + post->topdelta + yoffset: dcvars.source;
-        dcvars.nextsource = nextcolumn ? nextcolumn->pixels + post->topdelta + yoffset: dcvars.source;
+    V_BuildCachedPatch(entry, x, y, patch, trans, params, flags);
+  }
 
-        dcvars.texturemid = -((dcvars.yl-centery)*dcvars.iscale);
+  return entry;
+}
 
-        //e6y
-        dcvars.dy = deltay1;
-        dcvars.flags |= DRAW_COLUMN_ISPATCH;
+static void V_BlitCachedPatch(const patch_cache_t *entry, int scrn)
+{
+  const patch_span_t *span = entry->spans;
+  const byte *source = entry->pixels;
+  byte *dest;
+  int row, i;
 
-        colfunc(&dcvars);
-      }
+  dest = screens[scrn].data + entry->top * screens[scrn].pitch + entry->left;
+
+  for (row = 0; row < entry->height; row++, dest += screens[scrn].pitch)
+    for (i = 0; i < entry->row_spans[row]; i++, span++)
+    {
+      memcpy(dest + span->x, source, span->length);
+      source += span->length;
     }
+}
 
-    R_ResetColumnBuffer();
-    drawvars = olddrawvars;
+static void V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
+        dboolean center, int cm, enum patch_translation_e flags)
+{
+  const byte *trans;
+
+  trans = V_PreparePatch(&x, &y, patch, center, cm, &flags);
+
+  if (!(flags & VPT_STRETCH_MASK))
+    V_DrawMemPatchUnstretched(x, y, scrn, patch, trans, flags);
+  else
+  {
+    stretch_param_t *params = dsda_StretchParams(flags);
+    const patch_cache_t *entry;
+
+    entry = V_CachedPatch(x, y, scrn, patch, trans, params, flags);
+
+    if (entry)
+      V_BlitCachedPatch(entry, scrn);
+    else
+    {
+      draw_vars_t olddrawvars = drawvars;
+
+      drawvars.topleft = screens[scrn].data;
+      drawvars.pitch = screens[scrn].pitch;
+
+      V_DrawMemPatchStretched(x, y, patch, trans, params, flags);
+
+      R_ResetColumnBuffer();
+      drawvars = olddrawvars;
+    }
   }
 }
 
@@ -663,6 +981,73 @@ static void FUNC_V_DrawNumPatchPrecise(float x, float y, int scrn, int lump,
   V_DrawMemPatch((int)x, (int)y, scrn, R_PatchByNum(lump), center, cm, flags);
 }
 
+//
+// FUNC_V_DrawPatchRun
+//
+// Draws every patch of the run with one screen and column buffer setup,
+// which is flushed once at the end instead of after each patch. Cached
+// patches are copied, after any columns still queued.
+//
+static void FUNC_V_DrawPatchRun(const patch_run_t *run, int count,
+         int dx, int dy, int scrn, enum patch_translation_e flags)
+{
+  int i;
+  draw_vars_t olddrawvars;
+  stretch_param_t *params;
+  dboolean columns_queued = false;
+
+  if ((flags & VPT_STRETCH_MASK) && SCREEN_320x200)
+    flags &= ~VPT_STRETCH_MASK;
+
+  if (!(flags & VPT_STRETCH_MASK))
+  {
+    for (i = 0; i < count; i++)
+      V_DrawMemPatch(run[i].x + dx, run[i].y + dy, scrn, R_PatchByNum(run[i].lump),
+                     false, run[i].cm, flags);
+    return;
+  }
+
+  params = dsda_StretchParams(flags);
+
+  olddrawvars = drawvars;
+  drawvars.topleft = screens[scrn].data;
+  drawvars.pitch = screens[scrn].pitch;
+
+  for (i = 0; i < count; i++)
+  {
+    const rpatch_t *patch = R_PatchByNum(run[i].lump);
+    enum patch_translation_e patch_flags = flags;
+    int x = run[i].x + dx;
+    int y = run[i].y + dy;
+    const byte *trans;
+    const patch_cache_t *entry;
+
+    trans = V_PreparePatch(&x, &y, patch, false, run[i].cm, &patch_flags);
+    entry = V_CachedPatch(x, y, scrn, patch, trans, params, patch_flags);
+
+    if (entry)
+    {
+      // queued columns of earlier patches go first
+      if (columns_queued)
+      {
+        R_ResetColumnBuffer();
+        columns_queued = false;
+      }
+
+      V_BlitCachedPatch(entry, scrn);
+    }
+    else
+    {
+      V_DrawMemPatchStretched(x, y, patch, trans, params, patch_flags);
+      columns_queued = true;
+    }
+  }
+
+  if (columns_queued)
+    R_ResetColumnBuffer();
+  drawvars = olddrawvars;
+}
+
 static int currentPaletteIndex = 0;
 
 void V_TouchPalette(void)
@@ -769,6 +1154,13 @@ static void WRAP_gld_DrawNumPatchPrecise(float x, float y, int scrn, int lump, d
 {
   gld_DrawNumPatch_f(x,y,lump,center,cm,flags);
 }
+static void WRAP_gld_DrawPatchRun(const patch_run_t *run, int count, int dx, int dy, int scrn, enum patch_translation_e flags)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    gld_DrawNumPatch(run[i].x + dx, run[i].y + dy, run[i].lump, false, run[i].cm, flags);
+}
 static void V_PlotPixelGL(int scrn, int x, int y, byte color) {
   gld_DrawLine(x-1, y, x+1, y, color);
   gld_DrawLine(x, y-1, x, y+1, color);
@@ -798,6 +1190,7 @@ static void NULL_FillPatch(int lump, int n, int x, int y, int width, int height,
 static void NULL_DrawBackground(const char *flatname, int n) {}
 static void NULL_DrawNumPatch(int x, int y, int scrn, int lump, dboolean center, int cm, enum patch_translation_e flags) {}
 static void NULL_DrawNumPatchPrecise(float x, float y, int scrn, int lump, dboolean center, int cm, enum patch_translation_e flags) {}
+static void NULL_DrawPatchRun(const patch_run_t *run, int count, int dx, int dy, int scrn, enum patch_translation_e flags) {}
 static void NULL_PlotPixel(int scrn, int x, int y, byte color) {}
 static void NULL_PlotPixelWu(int scrn, int x, int y, byte color, int weight) {}
 static void NULL_DrawLine(fline_t* fl, int color) {}
@@ -816,6 +1209,7 @@ V_CopyRect_f V_CopyRect = NULL_CopyRect;
 V_FillRect_f V_FillRect = NULL_FillRect;
 V_DrawNumPatchGen_f V_DrawNumPatchGen = NULL_DrawNumPatch;
 V_DrawNumPatchGenPrecise_f V_DrawNumPatchGenPrecise = NULL_DrawNumPatchPrecise;
+V_DrawPatchRun_f V_DrawPatchRun = NULL_DrawPatchRun;
 V_FillFlat_f V_FillFlat = NULL_FillFlat;
 V_FillPatch_f V_FillPatch = NULL_FillPatch;
 V_DrawBackground_f V_DrawBackground = NULL_DrawBackground;
@@ -842,6 +1236,7 @@ void V_InitMode(video_mode_t mode) {
       V_FillRect = V_FillRect8;
       V_DrawNumPatchGen = FUNC_V_DrawNumPatch;
       V_DrawNumPatchGenPrecise = FUNC_V_DrawNumPatchPrecise;
+      V_DrawPatchRun = FUNC_V_DrawPatchRun;
       V_FillFlat = FUNC_V_FillFlat;
       V_FillPatch = FUNC_V_FillPatch;
       V_DrawBackground = FUNC_V_DrawBackground;
@@ -864,6 +1259,7 @@ void V_InitMode(video_mode_t mode) {
       V_FillRect = WRAP_gld_FillRect;
       V_DrawNumPatchGen = WRAP_gld_DrawNumPatch;
       V_DrawNumPatchGenPrecise = WRAP_gld_DrawNumPatchPrecise;
+      V_DrawPatchRun = WRAP_gld_DrawPatchRun;
       V_FillFlat = WRAP_gld_FillFlat;
       V_FillPatch = WRAP_gld_FillPatch;
       V_DrawBackground = WRAP_gld_DrawBackground;
@@ -932,6 +1328,8 @@ void V_FreeScreens(void) {
 
   for (i=0; i<NUM_SCREENS; i++)
     V_FreeScreen(&screens[i]);
+
+  V_FreePatchCache();
 }
 
 static void V_PlotPixel8(int scrn, int x, int y, byte color) {
@@ -176,6 +176,10 @@ void V_InitColorTranslation(void);
 
 void V_InitFlexTranTable(void);
 
+// Flex translucency tables, valid after V_InitFlexTranTable
+extern unsigned int Col2RGB8[65][256];
+extern byte RGB32k[32][32][32];
+
 // Allocates buffer screens, call before R_Init.
 void V_Init (void);
 
@@ -231,6 +235,24 @@ typedef void (*V_DrawNumPatchGenPrecise_f)(float x, float y, int scrn,
                                  enum patch_translation_e flags);
 extern V_DrawNumPatchGenPrecise_f V_DrawNumPatchGenPrecise;
 
+// V_DrawPatchRun - Draws a run of patches offset by dx,dy with one setup,
+// e.g. the glyphs of a line of text
+typedef struct
+{
+  int lump;
+  int x;
+  int y;
+  int cm;
+} patch_run_t;
+
+typedef void (*V_DrawPatchRun_f)(const patch_run_t *run, int count,
+                                 int dx, int dy, int scrn,
+                                 enum patch_translation_e flags);
+extern V_DrawPatchRun_f V_DrawPatchRun;
+
+// V_FreePatchCache - Drops the stretched patches kept for copying
+void V_FreePatchCache(void);
+
 // V_DrawNumPatch - Draws the patch from lump "num"
 #define V_DrawNumPatch(x,y,s,n,t,f) V_DrawNumPatchGen(x,y,s,n,false,t,f)
 #define V_DrawNumPatchPrecise(x,y,s,n,t,f) V_DrawNumPatchGenPrecise(x,y,s,n,false,t,f)
@@ -27,6 +27,11 @@
  * DESCRIPTION:
  *      Transparent access to data in WADs using mmap
  *
+ *      Lumps are returned as pointers straight into a read-only mapping of
+ *      their file. A private copy is only made when the caller needs to
+ *      modify the data. Files which can't be mapped (or platforms without
+ *      mmap) fall back to reading lumps into memory on first use.
+ *
  *-----------------------------------------------------------------------------
  */
 
@@ -37,10 +42,12 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
-#ifdef _WIN32
+#if defined(_WIN32) && defined(HAVE_CREATE_FILE_MAPPING)
+#define W_MAP_WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
-#else
+#elif defined(HAVE_MMAP)
+#define W_MAP_POSIX
 #include <sys/mman.h>
 #endif
 
@@ -55,53 +62,164 @@
 
 #include "e6y.h"//e6y
 
+// Private copies of lumps: either read in from an unmapped file,
+// or copied out of a mapping by W_GetModifiableLumpData
 static void **lump_data;
 
-#ifdef _WIN32
 typedef struct {
+  const byte *data;
+  size_t size;
+  dboolean tried;
+#ifdef W_MAP_WIN32
   HANDLE hnd;
-  OFSTRUCT fileinfo;
   HANDLE hnd_map;
-  void   *data;
-} mmap_info_t;
+#endif
+} mapped_wad_t;
+
+static mapped_wad_t *mapped_wad;
+static size_t mapped_wad_count;
+
+static int W_WadIndex(int lump)
+{
+  int wad_index = (int)(lumpinfo[lump].wadfile - wadfiles);
+
+#ifdef RANGECHECK
+  if ((wad_index < 0) || ((size_t) wad_index >= numwadfiles))
+    I_Error("W_WadIndex: wad_index out of range");
+#endif
 
-mmap_info_t *mapped_wad;
+  return wad_index;
+}
+
+#ifdef W_MAP_WIN32
+
+static dboolean W_MapWad(const wadfile_info_t *wad, mapped_wad_t *map)
+{
+  wchar_t *wname;
+  LARGE_INTEGER size;
+
+  // Wads stored inside a zip are mapped through the archive itself
+  wname = ConvertUtf8ToWide(wad->archive ? wad->archive : wad->name);
+  map->hnd = CreateFileW(wname,
+    GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+    NULL, OPEN_EXISTING, 0, NULL);
+  Z_Free(wname);
+  if (map->hnd == INVALID_HANDLE_VALUE)
+  {
+    map->hnd = NULL;
+    lprintf(LO_WARN, "W_MapWad: CreateFile failed for %s (LastError %li)\n",
+            wad->name, GetLastError());
+    return false;
+  }
+
+  if (!GetFileSizeEx(map->hnd, &size) || !size.QuadPart)
+    return false;
+
+  map->hnd_map = CreateFileMapping(map->hnd, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (map->hnd_map == NULL)
+  {
+    lprintf(LO_WARN, "W_MapWad: CreateFileMapping failed for %s (LastError %li)\n",
+            wad->name, GetLastError());
+    return false;
+  }
+
+  map->data = MapViewOfFile(map->hnd_map, FILE_MAP_READ, 0, 0, 0);
+  if (map->data == NULL)
+  {
+    lprintf(LO_WARN, "W_MapWad: MapViewOfFile failed for %s (LastError %li)\n",
+            wad->name, GetLastError());
+    return false;
+  }
+
+  map->size = (size_t) size.QuadPart;
+
+  return true;
+}
+
+static void W_UnmapWad(mapped_wad_t *map)
+{
+  if (map->data)
+    UnmapViewOfFile(map->data);
+  if (map->hnd_map)
+    CloseHandle(map->hnd_map);
+  if (map->hnd)
+    CloseHandle(map->hnd);
+}
+
+#elif defined(W_MAP_POSIX)
+
+static dboolean W_MapWad(const wadfile_info_t *wad, mapped_wad_t *map)
+{
+  void *data;
+  int64_t length;
+
+  length = I_Filelength(wad->handle);
+  if (length <= 0 || (uint64_t) length > SIZE_MAX)
+    return false;
+
+  data = mmap(NULL, (size_t) length, PROT_READ, MAP_SHARED, wad->handle, 0);
+  if (data == MAP_FAILED)
+  {
+    lprintf(LO_WARN, "W_MapWad: failed to mmap %s\n", wad->name);
+    return false;
+  }
+
+  map->data = data;
+  map->size = (size_t) length;
+
+  return true;
+}
+
+static void W_UnmapWad(mapped_wad_t *map)
+{
+  if (map->data && munmap((void *) map->data, map->size))
+    I_Error("W_DoneCache: failed to munmap");
+}
+
+#else
+
+static dboolean W_MapWad(const wadfile_info_t *wad, mapped_wad_t *map)
+{
+  return false;
+}
+
+static void W_UnmapWad(mapped_wad_t *map)
+{
+}
+
+#endif
 
 void W_DoneCache(void)
 {
   size_t i;
 
-  if (lump_data) {
+  if (lump_data)
+  {
+    int lump;
+
+    for (lump = 0; lump < numlumps; lump++)
+      if (lump_data[lump])
+        Z_Free(lump_data[lump]);
+
     Z_Free(lump_data);
     lump_data = NULL;
   }
 
   if (!mapped_wad)
     return;
-  for (i=0; i<numwadfiles; i++)
-  {
-    if (mapped_wad[i].data)
-    {
-      UnmapViewOfFile(mapped_wad[i].data);
-      mapped_wad[i].data=NULL;
-    }
-    if (mapped_wad[i].hnd_map)
-    {
-      CloseHandle(mapped_wad[i].hnd_map);
-      mapped_wad[i].hnd_map=NULL;
-    }
-    if (mapped_wad[i].hnd)
-    {
-      CloseHandle(mapped_wad[i].hnd);
-      mapped_wad[i].hnd=NULL;
-    }
-  }
+
+  for (i = 0; i < mapped_wad_count; i++)
+    W_UnmapWad(&mapped_wad[i]);
+
   Z_Free(mapped_wad);
   mapped_wad = NULL;
+  mapped_wad_count = 0;
 }
 
 void W_InitCache(void)
 {
+  int i;
+
   // Wipe any existing cache
   W_DoneCache();
 
@@ -110,121 +228,71 @@ void W_InitCache(void)
   if (!lump_data)
     I_Error ("W_Init: Couldn't allocate lump data");
 
-  mapped_wad = Z_Calloc(numwadfiles,sizeof(mmap_info_t));
-  memset(mapped_wad,0,sizeof(mmap_info_t)*numwadfiles);
+  mapped_wad = Z_Calloc(numwadfiles, sizeof *mapped_wad);
+  mapped_wad_count = numwadfiles;
+
+  for (i = 0; i < numlumps; i++)
   {
-    int i;
-    for (i=0; i<numlumps; i++)
-    {
-      int wad_index = (int)(lumpinfo[i].wadfile-wadfiles);
+    mapped_wad_t *map;
+    int wad_index;
 
-      if (!lumpinfo[i].wadfile)
-        continue;
-#ifdef RANGECHECK
-      if ((wad_index<0)||((size_t)wad_index>=numwadfiles))
-        I_Error("W_InitCache: wad_index out of range");
-#endif
-      if (!mapped_wad[wad_index].data)
+    if (!lumpinfo[i].wadfile)
+      continue;
+
+    wad_index = W_WadIndex(i);
+    map = &mapped_wad[wad_index];
+
+    if (!map->tried)
+    {
+      map->tried = true;
+      if (!W_MapWad(&wadfiles[wad_index], map))
       {
-        wchar_t *wname = ConvertUtf8ToWide(wadfiles[wad_index].name);
-        mapped_wad[wad_index].hnd = CreateFileW(wname,
-          GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
-          NULL, OPEN_EXISTING, 0, NULL);
-        Z_Free(wname);
-        if (mapped_wad[wad_index].hnd==INVALID_HANDLE_VALUE)
-          I_Error("W_InitCache: CreateFile for memory mapping failed (LastError %li)",GetLastError());
-        mapped_wad[wad_index].hnd_map =
-          CreateFileMapping(
-            mapped_wad[wad_index].hnd,
-            NULL,
-            PAGE_READONLY,
-            0,
-            0,
-            NULL
-          );
-        if (mapped_wad[wad_index].hnd_map==NULL)
-          I_Error("W_InitCache: CreateFileMapping for memory mapping failed (LastError %li)",GetLastError());
-        mapped_wad[wad_index].data =
-          MapViewOfFile(
-            mapped_wad[wad_index].hnd_map,
-            FILE_MAP_READ,
-            0,
-            0,
-            0
-          );
-        if (mapped_wad[wad_index].data==NULL)
-          I_Error("W_InitCache: MapViewOfFile for memory mapping failed (LastError %li)",GetLastError());
+        W_UnmapWad(map);
+        memset(map, 0, sizeof(*map));
+        map->tried = true;
       }
     }
   }
 }
 
-const void* W_LumpByNum(int lump)
+static const byte *W_MappedLump(int lump)
 {
-  int wad_index = (int)(lumpinfo[lump].wadfile-wadfiles);
-#ifdef RANGECHECK
-  if ((wad_index<0)||((size_t)wad_index>=numwadfiles))
-    I_Error("W_LumpByNum: wad_index out of range");
-  if ((unsigned)lump >= (unsigned)numlumps)
-    I_Error ("W_LumpByNum: %i >= numlumps",lump);
-#endif
-  if (!lumpinfo[lump].wadfile)
-    return NULL;
-  return (void*)((unsigned char *)mapped_wad[wad_index].data+lumpinfo[lump].position);
-}
+  const mapped_wad_t *map = &mapped_wad[W_WadIndex(lump)];
 
-#else
+  if (!map->data ||
+      (uint64_t) lumpinfo[lump].position + lumpinfo[lump].size > map->size)
+    return NULL;
 
-void ** mapped_wad;
+  return map->data + lumpinfo[lump].position;
+}
 
-void W_InitCache(void)
+static void *W_CopyLump(int lump)
 {
-  int maxfd = 0;
-  // set up caching
-  lump_data = Z_Calloc(numlumps, sizeof *lump_data);
-  if (!lump_data)
-    I_Error ("W_Init: Couldn't allocate lump data");
+  const byte *mapped;
 
+  if (!lump_data[lump])
   {
-    int i;
-    for (i=0; i<numlumps; i++)
-      if (lumpinfo[i].wadfile)
-        if (lumpinfo[i].wadfile->handle > maxfd) maxfd = lumpinfo[i].wadfile->handle;
-  }
-  mapped_wad = Z_Calloc(maxfd+1,sizeof *mapped_wad);
-  {
-    int i;
-    for (i=0; i<numlumps; i++) {
-      if (lumpinfo[i].wadfile) {
-        int fd = lumpinfo[i].wadfile->handle;
-        if (!mapped_wad[fd])
-          if ((mapped_wad[fd] = mmap(NULL,I_Filelength(fd),PROT_READ,MAP_SHARED,fd,0)) == MAP_FAILED)
-            I_Error("W_InitCache: failed to mmap");
-      }
-    }
-  }
-}
+    lump_data[lump] = Z_Malloc(W_LumpLength(lump));
 
-void W_DoneCache(void)
-{
-  {
-    int i;
-    for (i=0; i<numlumps; i++)
-      if (lumpinfo[i].wadfile) {
-        int fd = lumpinfo[i].wadfile->handle;
-        if (fd > 0 && mapped_wad[fd]) {
-          if (munmap(mapped_wad[fd],I_Filelength(fd)))
-            I_Error("W_DoneCache: failed to munmap");
-          mapped_wad[fd] = NULL;
-        }
-      }
+    mapped = W_MappedLump(lump);
+    if (mapped)
+      memcpy(lump_data[lump], mapped, W_LumpLength(lump));
+    else
+      W_ReadLump(lump, lump_data[lump]);
   }
-  Z_Free(mapped_wad);
-  mapped_wad = NULL;
+
+  return lump_data[lump];
 }
 
+/* W_LumpByNum
+ *
+ * Returns the original lump data: a pointer into the mapping when the file is
+ * mapped, otherwise a copy read in on first use.
+ */
 const void* W_LumpByNum(int lump)
 {
+  const byte *mapped;
+
 #ifdef RANGECHECK
   if ((unsigned)lump >= (unsigned)numlumps)
     I_Error ("W_LumpByNum: %i >= numlumps",lump);
@@ -232,36 +300,89 @@ const void* W_LumpByNum(int lump)
   if (!lumpinfo[lump].wadfile)
     return NULL;
 
-  return
-    (const void *) (
-      ((const byte *) (mapped_wad[lumpinfo[lump].wadfile->handle]))
-      + lumpinfo[lump].position
-    );
+  mapped = W_MappedLump(lump);
+  if (mapped)
+    return mapped;
+
+  return W_CopyLump(lump);
 }
-#endif
 
 /*
  * W_LockLumpNum
  *
- * This copies the lump into a malloced memory region and returns its address
- * instead of returning a pointer into the memory mapped area
+ * Returns the lump data with all of its pages resident, so that it can be
+ * read from the sound thread without faulting. If the lump has been modified
+ * via W_GetModifiableLumpData, the private copy is returned.
  *
  */
 const void* W_LockLumpNum(int lump)
 {
-  size_t len = W_LumpLength(lump);
-  const void *data = W_LumpByNum(lump);
+  const byte *data;
+  volatile byte sink = 0;
+  size_t i, len;
 
-  // read the lump in
-  if (!lump_data[lump]) {
-    lump_data[lump] = Z_Malloc(len);
-    memcpy(lump_data[lump], data, len);
-  }
+  if (!lumpinfo[lump].wadfile)
+    return NULL;
 
-  return lump_data[lump];
+  if (lump_data[lump])
+    return lump_data[lump];
+
+  data = W_MappedLump(lump);
+  if (!data)
+    return W_CopyLump(lump);
+
+  len = W_LumpLength(lump);
+  for (i = 0; i < len; i += 4096)
+    sink ^= data[i];
+  if (len)
+    sink ^= data[len - 1];
+
+  return data;
 }
 
+/*
+ * W_GetModifiableLumpData
+ *
+ * Copy-on-write: the first call makes a private copy of the lump, which is
+ * then returned by W_LockLumpNum in place of the mapped data.
+ *
+ */
 void *W_GetModifiableLumpData(int lump)
 {
-  return lump_data[lump];
+  if (!lumpinfo[lump].wadfile)
+    return NULL;
+
+  return W_CopyLump(lump);
+}
+
+/*
+ * W_PrefetchLumps
+ *
+ * Hints that a run of lumps is about to be read, e.g. the lumps of a map
+ * before P_SetupLevel parses them.
+ *
+ */
+void W_PrefetchLumps(int lump, int count)
+{
+#if defined(W_MAP_POSIX) && defined(MADV_WILLNEED)
+  uintptr_t page_mask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+  int i;
+
+  for (i = lump; i < lump + count && i < numlumps; i++)
+  {
+    const byte *data;
+    uintptr_t start, end;
+
+    if (!lumpinfo[i].wadfile || !lumpinfo[i].size || lump_data[i])
+      continue;
+
+    data = W_MappedLump(i);
+    if (!data)
+      continue;
+
+    start = (uintptr_t) data & ~page_mask;
+    end = (uintptr_t) data + lumpinfo[i].size;
+    madvise((void *) start, end - start, MADV_WILLNEED);
+  }
+#endif
 }
@@ -153,7 +153,8 @@ static void W_AddFile(wadfile_info_t *wadfile)
 
   // open the file and add to directory
 
-  wadfile->handle = M_OpenRB(wadfile->name);
+  // wads stored uncompressed in a zip are read in place from the archive
+  wadfile->handle = M_OpenRB(wadfile->archive ? wadfile->archive : wadfile->name);
   if (wadfile->handle == -1)
   {
     if (!dsda_HasFileExt(wadfile->name, ".lmp"))
@@ -185,13 +186,15 @@ static void W_AddFile(wadfile_info_t *wadfile)
       // single lump file
       fileinfo = &singleinfo;
       singleinfo.filepos = 0;
-      singleinfo.size = LittleLong(I_Filelength(wadfile->handle));
+      singleinfo.size = LittleLong((int) I_Filelength(wadfile->handle));
       ExtractFileBase(wadfile->name, singleinfo.name);
       numlumps++;
     }
   else
     {
       // WAD file
+      if (wadfile->archive_offset)
+        I_Seek(wadfile->handle, wadfile->archive_offset);
       I_Read(wadfile->handle, &header, sizeof(header));
       if (strncmp(header.identification,"IWAD",4) &&
           strncmp(header.identification,"PWAD",4))
@@ -200,7 +203,7 @@ static void W_AddFile(wadfile_info_t *wadfile)
       header.infotableofs = LittleLong(header.infotableofs);
       length = header.numlumps*sizeof(filelump_t);
       fileinfo2free = fileinfo = Z_Malloc(length);    // killough
-      lseek(wadfile->handle, header.infotableofs, SEEK_SET),
+      I_Seek(wadfile->handle, wadfile->archive_offset + header.infotableofs),
       I_Read(wadfile->handle, fileinfo, length);
       numlumps += header.numlumps;
     }
@@ -214,7 +217,7 @@ static void W_AddFile(wadfile_info_t *wadfile)
       {
         lump_p->flags = flags;
         lump_p->wadfile = wadfile;                    //  killough 4/25/98
-        lump_p->position = LittleLong(fileinfo->filepos);
+        lump_p->position = LittleLong(fileinfo->filepos) + wadfile->archive_offset;
         lump_p->size = LittleLong(fileinfo->size);
         if (wadfile->src == source_lmp)
         {
@@ -564,7 +567,7 @@ void W_ReadLump(int lump, void *dest)
     {
       if (l->wadfile)
       {
-        lseek(l->wadfile->handle, l->position, SEEK_SET);
+        I_Seek(l->wadfile->handle, l->position);
         I_Read(l->wadfile->handle, dest, l->size);
       }
     }
@@ -578,7 +581,7 @@ char* W_ReadLumpToString(int lump)
   if (lump >= 0 && lump < numlumps && l->wadfile)
   {
     buffer = Z_Malloc(l->size + 1);
-    lseek(l->wadfile->handle, l->position, SEEK_SET);
+    I_Seek(l->wadfile->handle, l->position);
     I_Read(l->wadfile->handle, buffer, l->size);
     buffer[l->size] = '\0';
   }
@@ -646,6 +649,12 @@ void W_Shutdown(void)
       close(wadfiles[i].handle);
       wadfiles[i].handle = -1;
     }
+
+    if (wadfiles[i].archive)
+    {
+      Z_Free(wadfiles[i].archive);
+      wadfiles[i].archive = NULL;
+    }
   }
 }
 
@@ -90,6 +90,8 @@ typedef struct {
   char* name;
   wad_source_t src;
   int handle;
+  char* archive;          // zip holding this wad as a stored member, or NULL
+  int64_t archive_offset; // offset of the wad data within archive
 } wadfile_info_t;
 
 extern wadfile_info_t *wadfiles;
@@ -129,7 +131,7 @@ typedef struct
   li_namespace_e li_namespace; // haleyjd 05/21/02: renamed from "namespace"
 
   wadfile_info_t *wadfile;
-  int position;
+  int64_t position;
   wad_source_t source;
   int flags; //e6y
 } lumpinfo_t;
@@ -169,6 +171,7 @@ const void* W_SafeLumpByNum (int lump);
 const void* W_LumpByNum (int lump);
 const void* W_LockLumpNum(int lump);
 void *W_GetModifiableLumpData(int lump);
+void W_PrefetchLumps(int lump, int count);
 
 int W_LumpNumExists(int lump);
 int W_LumpNameExists(const char *name);
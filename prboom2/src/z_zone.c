@@ -46,9 +46,12 @@
 #include "config.h"
 #endif
 
+#include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "SDL.h"
+
 #include "z_zone.h"
 #include "doomstat.h"
 #include "v_video.h"
@@ -78,6 +81,30 @@ static const size_t HEADER_SIZE = sizeof(memblock_t);
 
 static memblock_t *blockbytag[ZONE_MAX];
 
+// The thread that borrowed the zone, if any
+static SDL_atomic_t zone_thread_set;
+static SDL_threadID zone_thread;
+
+void Z_EnterThread(void)
+{
+  zone_thread = SDL_ThreadID();
+  SDL_AtomicSet(&zone_thread_set, 1);
+}
+
+void Z_LeaveThread(void)
+{
+  SDL_AtomicSet(&zone_thread_set, 0);
+}
+
+#ifdef NDEBUG
+#define Z_CheckThread()
+#else
+static void Z_CheckThread(void)
+{
+  assert(!SDL_AtomicGet(&zone_thread_set) || zone_thread == SDL_ThreadID());
+}
+#endif
+
 /* Z_Malloc
  * cph - the algorithm here was a very simple first-fit round-robin
  *  one - just keep looping around, freeing everything we can until
@@ -95,6 +122,8 @@ static void *Z_MallocTag(size_t size, int tag)
   if (!size)
     return NULL; // malloc(0) returns NULL
 
+  Z_CheckThread();
+
   if (!(block = malloc(size + HEADER_SIZE)))
   {
     I_Error ("Z_Malloc: Failure trying to allocate %lu bytes", (unsigned long) size);
@@ -128,6 +157,8 @@ void Z_Free(void *p)
   if (!p)
     return;
 
+  Z_CheckThread();
+
   if (block->signature != ZONE_SIGNATURE)
     I_Error("Z_Free: freed a non-zone pointer");
   block->signature = 0;       // Nullify signature so another free fails
@@ -66,6 +66,11 @@ void *Z_CallocLevel(size_t n, size_t n2);
 void *Z_ReallocLevel(void *p, size_t n);
 char *Z_StrdupLevel(const char *s);
 
+// The zone is not thread safe. A thread may borrow it between these,
+//  while the thread that owns it stays out.
+void Z_EnterThread(void);
+void Z_LeaveThread(void);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
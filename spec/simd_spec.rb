@@ -0,0 +1,41 @@
+require 'digest'
+require 'tmpdir'
+
+RSpec.describe 'simd' do
+  let(:lmp) { 'lv01-005.lmp' }
+
+  def frame_digests(simd, width, height)
+    Dir.mktmpdir do |dir|
+      Utility.render_demo(lmp: lmp, frame_dir: dir, width: width, height: height, extra: "-simd #{simd}")
+
+      Dir.glob("#{dir}/frame_*").sort.map { |frame| Digest::MD5.file(frame).hexdigest }
+    end
+  end
+
+  # Odd widths leave spans that end part way through a vector,
+  # and 4k gives the longest spans
+  [
+    [320, 200], [321, 200], [640, 400], [1279, 720],
+    [1366, 768], [1920, 1080], [3840, 2160]
+  ].each do |width, height|
+    context "at #{width}x#{height}" do
+      let(:scalar_frames) { frame_digests('none', width, height) }
+
+      describe 'scalar span drawer' do
+        subject { scalar_frames }
+
+        it { is_expected.not_to be_empty }
+      end
+
+      # A cpu without the instruction set falls back to a lower level,
+      # so these also pass there, without testing the missing drawer
+      %w[sse4.1 avx2].each do |simd|
+        describe "#{simd} span drawer" do
+          subject { frame_digests(simd, width, height) }
+
+          it { is_expected.to eq(scalar_frames) }
+        end
+      end
+    end
+  end
+end
@@ -11,6 +11,17 @@ module Utility
     system(command)
   end
 
+  # Software renders every frame of the demo into frame_dir as 8-bit dumps
+  def render_demo(lmp:, frame_dir:, iwad: "DOOM2.WAD", width: 640, height: 400, extra: nil)
+    command = "./build/dsda-doom.exe -iwad spec/support/wads/#{iwad}"
+    command << " -timedemo \"spec/support/lmps/#{lmp}\""
+    command << " -nosound -nomusic -window -width #{width} -height #{height} -vidmode sw"
+    command << " -framedump \"#{frame_dir}\" -framedumpformat raw"
+    command << " #{extra}" if extra
+
+    system({ "SDL_VIDEODRIVER" => ENV.fetch("SDL_VIDEODRIVER", "dummy") }, command)
+  end
+
   def read_analysis
     Analysis.new
   end